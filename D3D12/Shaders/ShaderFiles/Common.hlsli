@@ -11,6 +11,7 @@
 #endif
 
 #include "LightingUtil.hlsli"
+#include "ObjectData.hlsli"
 
 struct MaterialData
 {
@@ -20,14 +21,19 @@ struct MaterialData
     float4x4 MatTransform;
     uint DiffuseMapIndex;
     uint NormalMapIndex;
-    uint MatPad1;
-    uint MatPad2;
+    uint DiffuseMapSlice;
+    uint NormalMapSlice;
 };
 
 StructuredBuffer<MaterialData> materialData : register(t0, space1);
 
+// One object index per instance.
+StructuredBuffer<uint> gInstanceObjects : register(t1, space1);
+
 TextureCube cubeMap : register(t0);
-Texture2D gDiffuseMap[10] : register(t1);
+// Every 2D texture is an array, so textures packed together take one descriptor;
+// a material's map index picks the array and its slice the texture.
+Texture2DArray gDiffuseMap[10] : register(t1);
 
 SamplerState gsamPointWrap : register(s0);
 SamplerState gsamPointClamp : register(s1);
@@ -36,14 +42,17 @@ SamplerState gsamLinearClamp : register(s3);
 SamplerState gsamAnisotropicWrap : register(s4);
 SamplerState gsamAnisotropicClamp : register(s5);
 
+// Object index of a draw that is not instanced.
 cbuffer cbPerObject : register(b0)
 {
-    float4x4 gWorld;
-    float4x4 gTexTransform;
-    uint gMaterialIndex;
-    uint gObjPad0;
-    uint gObjPad1;
-    uint gObjPad2;
+    uint gObjectIndex;
+};
+
+// SV_InstanceID always starts at zero, so the batch offset into gInstanceObjects
+// is passed as a root constant.
+cbuffer cbInstance : register(b2)
+{
+    uint gBaseInstance;
 };
 
 cbuffer cbPass : register(b1)
@@ -65,5 +74,19 @@ cbuffer cbPass : register(b1)
     float4 gAmbientLight;
     
     Light gLights[MaxLights];
+
+    // Order 3 spherical harmonics of the sky's diffuse light, basis constants included.
+    float4 gAmbientSh[9];
 };
 
+// Light a surface facing unit normal n receives from the sky, per unit albedo.
+float3 AmbientSh(float3 n)
+{
+    float3 c = gAmbientSh[0].rgb;
+    c += gAmbientSh[1].rgb * n.y + gAmbientSh[2].rgb * n.z + gAmbientSh[3].rgb * n.x;
+    c += gAmbientSh[4].rgb * (n.x * n.y) + gAmbientSh[5].rgb * (n.y * n.z) +
+        gAmbientSh[6].rgb * (3.0f * n.z * n.z - 1.0f) + gAmbientSh[7].rgb * (n.x * n.z) +
+        gAmbientSh[8].rgb * (n.x * n.x - n.y * n.y);
+    // Ringing can take the truncated series below zero opposite bright light.
+    return max(c, 0.0f);
+}
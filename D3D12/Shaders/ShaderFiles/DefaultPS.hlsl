@@ -8,6 +8,9 @@ struct VertexOut
     float3 NormalW : NORMAL;
     float3 TangentW : TANGENT;
     float2 TexC : TEXCOORD;
+
+    // nointerpolation so the index is not interpolated across the triangle.
+    nointerpolation uint MatIndex : MATINDEX;
 };
 
 float3 NormalSampleToWorldSpace(float3 normalMapSample, float3 unitNormalW, float3 tangentW)
@@ -32,30 +35,32 @@ float3 NormalSampleToWorldSpace(float3 normalMapSample, float3 unitNormalW, floa
 float4 main(VertexOut pin) : SV_Target
 {
 	
-    clip(materialData[gMaterialIndex].DiffuseAlbedo.a < 0.1f ? -1.0f : 1.0f);
+    clip(materialData[pin.MatIndex].DiffuseAlbedo.a < 0.1f ? -1.0f : 1.0f);
     
     // Fetch the material data.
-    MaterialData matData = materialData[gMaterialIndex];
+    MaterialData matData = materialData[pin.MatIndex];
     float4 diffuseAlbedo = matData.DiffuseAlbedo;
     float3 fresnelR0 = matData.FresnelR0;
     float roughness = matData.Roughness;
     uint diffuseMapIndex = matData.DiffuseMapIndex;
     uint normalMapIndex = matData.NormalMapIndex;
+    uint diffuseMapSlice = matData.DiffuseMapSlice;
+    uint normalMapSlice = matData.NormalMapSlice;
 	
 	// Interpolating normal can unnormalize it, so renormalize it.
     pin.NormalW = normalize(pin.NormalW);
 	
-    float4 normalMapSample = gDiffuseMap[normalMapIndex].Sample(gsamAnisotropicWrap, pin.TexC);
+    float4 normalMapSample = gDiffuseMap[normalMapIndex].Sample(gsamAnisotropicWrap, float3(pin.TexC, normalMapSlice));
     float3 bumpedNormalW = NormalSampleToWorldSpace(normalMapSample.rgb, pin.NormalW, pin.TangentW);
 
 	// Dynamically look up the texture in the array.
-    diffuseAlbedo *= gDiffuseMap[diffuseMapIndex].Sample(gsamAnisotropicWrap, pin.TexC);
+    diffuseAlbedo *= gDiffuseMap[diffuseMapIndex].Sample(gsamAnisotropicWrap, float3(pin.TexC, diffuseMapSlice));
 
     // Vector from point being lit to eye. 
     float3 toEyeW = normalize(gEyePosW - pin.PosW);
 
-    // Light terms.
-    float4 ambient = gAmbientLight * diffuseAlbedo;
+    // Light terms.  Ambient light comes from the sky, in the direction of the normal.
+    float4 ambient = float4(AmbientSh(bumpedNormalW), 1.0f) * gAmbientLight * diffuseAlbedo;
 
     const float shininess = (1.0f - roughness) * normalMapSample.a;
     Material mat = { diffuseAlbedo, fresnelR0, shininess };
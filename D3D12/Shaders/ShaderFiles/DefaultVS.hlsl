@@ -15,26 +15,35 @@ struct VertexOut
     float3 NormalW : NORMAL;
     float3 TangentW : TANGENT;
     float2 TexC : TEXCOORD;
+
+    // nointerpolation so the index is not interpolated across the triangle.
+    nointerpolation uint MatIndex : MATINDEX;
 };
 
-VertexOut main(VertexIn vin)
+VertexOut main(VertexIn vin, uint instanceID : SV_InstanceID)
 {
     VertexOut vout = (VertexOut) 0.0f;
+
+    // Fetch the object data of the instance.
+    ObjectData obj = LoadObject(gInstanceObjects[gBaseInstance + instanceID]);
+    uint matIndex = obj.MaterialIndex;
+
+    vout.MatIndex = matIndex;
 	
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
-    vout.PosW = posW.xyz;
+    float3 posW = TransformAffine(obj.World, float4(vin.PosL, 1.0f));
+    vout.PosW = posW;
 
     // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3) gWorld);
+    vout.NormalW = TransformAffine(obj.World, float4(vin.NormalL, 0.0f));
     
-    vout.TangentW = mul(vin.Tangent, (float3x3) gWorld);
+    vout.TangentW = TransformAffine(obj.World, float4(vin.Tangent, 0.0f));
 
     // Transform to homogeneous clip space.
-    vout.PosH = mul(posW, gViewProj);
+    vout.PosH = mul(float4(posW, 1.0f), gViewProj);
     
-    float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
-    vout.TexC = mul(texC, materialData[gMaterialIndex].MatTransform).xy;
+    float4 texC = float4(TransformAffine(obj.TexTransform, float4(vin.TexC, 0.0f, 1.0f)), 1.0f);
+    vout.TexC = mul(texC, materialData[matIndex].MatTransform).xy;
 
     return vout;
 }
\ No newline at end of file
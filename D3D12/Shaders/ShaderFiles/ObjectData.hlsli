@@ -0,0 +1,33 @@
+// Per-object data, shared by every shader that places objects.  The layout must
+// match ObjectData in FrameResource.h (100 bytes), and DYNAMIC_OBJECT_BIT
+// TransformStore::DynamicObjectBit.
+
+// World and TexTransform are affine, so only the first three rows of their
+// transposes are stored.
+struct ObjectData
+{
+    float4 World[3];
+    float4 TexTransform[3];
+    uint MaterialIndex;
+};
+
+StructuredBuffer<ObjectData> gStaticObjects : register(t2, space1);
+StructuredBuffer<ObjectData> gDynamicObjects : register(t3, space1);
+
+// Object indices with this bit set refer to gDynamicObjects.
+#define DYNAMIC_OBJECT_BIT 0x80000000
+
+ObjectData LoadObject(uint objectIndex)
+{
+    if (objectIndex & DYNAMIC_OBJECT_BIT)
+    {
+        return gDynamicObjects[objectIndex & ~DYNAMIC_OBJECT_BIT];
+    }
+    return gStaticObjects[objectIndex];
+}
+
+// Same as mul(v, M) for an affine M stored as the rows of its transpose.
+float3 TransformAffine(float4 m[3], float4 v)
+{
+    return float3(dot(v, m[0]), dot(v, m[1]), dot(v, m[2]));
+}
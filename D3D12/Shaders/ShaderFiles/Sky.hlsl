@@ -1,12 +1,8 @@
 #include "LightingUtil.hlsli"
+#include "ObjectData.hlsli"
 cbuffer cbPerObject : register(b0)
 {
-    float4x4 gWorld;
-    float4x4 gTexTransform;
-    uint gMaterialIndex;
-    uint gObjPad0;
-    uint gObjPad1;
-    uint gObjPad2;
+    uint gObjectIndex;
 };
 
 cbuffer cbPass : register(b1)
@@ -69,7 +65,8 @@ VertexOut VS(VertexIn vin)
     vout.PosL = vin.PosL;
 	
 	// Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    ObjectData obj = LoadObject(gObjectIndex);
+    float4 posW = float4(TransformAffine(obj.World, float4(vin.PosL, 1.0f)), 1.0f);
 
 	// Always center sky about camera.
     posW.xyz += gEyePosW;
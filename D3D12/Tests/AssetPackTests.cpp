@@ -0,0 +1,227 @@
+#include "AssetPack.h"
+#include "ContentHash.h"
+#include "TestCheck.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace
+{
+	const std::filesystem::path PackFile = std::filesystem::temp_directory_path() / "AssetPackTests.pak";
+
+	std::vector<uint8_t> ReadFile(const std::filesystem::path& path)
+	{
+		std::ifstream in(path, std::ios::binary);
+		return std::vector<uint8_t>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	}
+
+	void WriteFile(const std::filesystem::path& path, const std::vector<uint8_t>& data)
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(data.data()), data.size());
+	}
+
+	std::vector<uint8_t> RandomBytes(size_t size, uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+		std::vector<uint8_t> data(size);
+		for (uint8_t& b : data)
+		{
+			b = (uint8_t)rng();
+		}
+		return data;
+	}
+
+	std::vector<uint8_t> RepeatedBytes(size_t size)
+	{
+		std::vector<uint8_t> data(size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			data[i] = (uint8_t)(i % 13);
+		}
+		return data;
+	}
+
+	void TestRoundTrip()
+	{
+		const std::vector<uint8_t> texture = RandomBytes(100000, 1);
+		const std::vector<uint8_t> shader = RepeatedBytes(5000);
+		const std::vector<uint8_t> noise = RandomBytes(3000, 2);
+		const std::vector<uint8_t> small = { 1, 2, 3 };
+
+		AssetPackWriter writer;
+		writer.Add("Textures/b.dds", AssetType::Texture, texture, false);
+		writer.Add("Shaders/a.cso", AssetType::Shader, shader, true);
+		writer.Add("noise", AssetType::Raw, noise, true);
+		writer.Add("small", AssetType::Raw, { 9 }, false);
+		// Replaces the asset added under the same name.
+		writer.Add("small", AssetType::Raw, small, false);
+		writer.SetManifest(0x1234567890abcdefull);
+		CHECK(writer.Write(PackFile));
+		CHECK(!std::filesystem::exists(PackFile.string() + ".tmp"));
+
+		AssetPack pack;
+		CHECK(pack.Open(PackFile));
+		CHECK(pack.Manifest() == 0x1234567890abcdefull);
+		CHECK(pack.EntryCount() == 4);
+
+		// Sorted by name.
+		CHECK(pack.Name(pack.Entry(0)) == "Shaders/a.cso");
+		CHECK(pack.Name(pack.Entry(1)) == "Textures/b.dds");
+		CHECK(pack.Name(pack.Entry(2)) == "noise");
+		CHECK(pack.Name(pack.Entry(3)) == "small");
+		CHECK(pack.Find("missing") == nullptr);
+		CHECK(pack.Find("Textures/b") == nullptr);
+
+		struct Expected
+		{
+			const char* Name;
+			const std::vector<uint8_t>* Data;
+			AssetType Type;
+			bool Compressed;
+		};
+		const Expected expected[] =
+		{
+			{ "Shaders/a.cso", &shader, AssetType::Shader, true },
+			{ "Textures/b.dds", &texture, AssetType::Texture, false },
+			// Random bytes do not shrink enough to be worth decompressing.
+			{ "noise", &noise, AssetType::Raw, false },
+			{ "small", &small, AssetType::Raw, false }
+		};
+		for (const Expected& e : expected)
+		{
+			const AssetEntry* entry = pack.Find(e.Name);
+			CHECK(entry != nullptr);
+			if (entry == nullptr)
+				continue;
+
+			CHECK(entry->Type == e.Type);
+			CHECK(entry->Size == e.Data->size());
+			CHECK(entry->Hash == ContentHash(e.Data->data(), e.Data->size()));
+			CHECK(((entry->Flags & AssetEntry::Compressed) != 0) == e.Compressed);
+
+			const uint64_t alignment = entry->StoredSize >= AssetPack::LargeAlignment ?
+				AssetPack::LargeAlignment : AssetPack::SmallAlignment;
+			CHECK(entry->Offset % alignment == 0);
+
+			if (e.Compressed)
+			{
+				CHECK(entry->StoredSize < entry->Size);
+				CHECK(pack.Data(*entry) == nullptr);
+			}
+			else
+			{
+				CHECK(pack.Data(*entry) != nullptr);
+				CHECK(std::memcmp(pack.Data(*entry), e.Data->data(), e.Data->size()) == 0);
+			}
+
+			std::vector<uint8_t> read;
+			CHECK(pack.Read(*entry, read));
+			CHECK(read == *e.Data);
+		}
+
+		pack.Close();
+		CHECK(pack.EntryCount() == 0);
+		CHECK(pack.Manifest() == 0);
+	}
+
+	// A pack whose header or table of contents does not fit the file, or that an
+	// older version wrote, does not open.
+	void TestRejects()
+	{
+		AssetPackWriter writer;
+		writer.Add("a", AssetType::Raw, RepeatedBytes(1000), false);
+		writer.Add("b", AssetType::Raw, RepeatedBytes(2000), true);
+		CHECK(writer.Write(PackFile));
+		const std::vector<uint8_t> good = ReadFile(PackFile);
+
+		AssetPack pack;
+		CHECK(pack.Open(PackFile));
+		CHECK(pack.Manifest() == 0);
+		pack.Close();
+
+		// Magic, then the version.
+		for (size_t field : { 0, 4 })
+		{
+			std::vector<uint8_t> bad = good;
+			bad[field] ^= 1;
+			WriteFile(PackFile, bad);
+			CHECK(!pack.Open(PackFile));
+		}
+
+		// Cut inside the header, the table of contents and the last payload.
+		for (size_t size : { (size_t)16, (size_t)60, good.size() - 1 })
+		{
+			WriteFile(PackFile, std::vector<uint8_t>(good.begin(), good.begin() + size));
+			CHECK(!pack.Open(PackFile));
+		}
+
+		CHECK(!pack.Open(std::filesystem::temp_directory_path() / "AssetPackTests.missing"));
+		std::filesystem::remove(PackFile);
+	}
+
+	void TestCorruptPayload()
+	{
+		AssetPackWriter writer;
+		writer.Add("a", AssetType::Raw, RepeatedBytes(10000), true);
+		CHECK(writer.Write(PackFile));
+
+		std::vector<uint8_t> file = ReadFile(PackFile);
+		uint64_t offset = 0;
+		{
+			AssetPack pack;
+			CHECK(pack.Open(PackFile));
+			const AssetEntry& entry = pack.Entry(0);
+			CHECK((entry.Flags & AssetEntry::Compressed) != 0);
+			offset = entry.Offset;
+		}
+
+		// An overlong first literal run sends the stream past its end.
+		file[offset] = 0xFF;
+		WriteFile(PackFile, file);
+		AssetPack pack;
+		CHECK(pack.Open(PackFile));
+		std::vector<uint8_t> read;
+		CHECK(!pack.Read(pack.Entry(0), read));
+		CHECK(read.empty());
+		pack.Close();
+		std::filesystem::remove(PackFile);
+	}
+
+	void TestMeshView()
+	{
+		MeshHeader header;
+		header.VertexCount = 3;
+		header.IndexCount = 6;
+		header.VertexStride = 12;
+		header.IndexSize = 2;
+		const float vertices[9] = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+		const uint16_t indices[6] = { 0, 1, 2, 2, 1, 0 };
+		const std::vector<uint8_t> data = MeshView::Build(header, vertices, indices);
+		CHECK(data.size() == sizeof(MeshHeader) + sizeof(vertices) + sizeof(indices));
+
+		MeshView view;
+		CHECK(view.Parse(data.data(), data.size()));
+		CHECK(view.Header->VertexCount == 3);
+		CHECK(std::memcmp(view.Vertices, vertices, sizeof(vertices)) == 0);
+		CHECK(std::memcmp(view.Indices, indices, sizeof(indices)) == 0);
+
+		CHECK(!view.Parse(data.data(), data.size() - 1));
+		CHECK(!view.Parse(data.data(), sizeof(MeshHeader) - 1));
+		CHECK(view.Header == nullptr);
+
+		std::vector<uint8_t> badIndexSize = data;
+		reinterpret_cast<MeshHeader*>(badIndexSize.data())->IndexSize = 3;
+		CHECK(!view.Parse(badIndexSize.data(), badIndexSize.size()));
+	}
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestRejects();
+	TestCorruptPayload();
+	TestMeshView();
+	return TestExitCode();
+}
@@ -0,0 +1,385 @@
+#include "BcTexture.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	double Psnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, int channelMask)
+	{
+		double squaredError = 0.0;
+		size_t count = 0;
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (((channelMask >> (i % 4)) & 1) == 0)
+				continue;
+			const double d = (double)a[i] - b[i];
+			squaredError += d * d;
+			count++;
+		}
+		return squaredError == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / (squaredError / count));
+	}
+
+	// Smooth colour and alpha with a little noise, sized to leave partial blocks.
+	std::vector<uint8_t> MakeImage(uint32_t width, uint32_t height)
+	{
+		std::mt19937 rng(1);
+		std::vector<uint8_t> image(width * height * 4);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				uint8_t* p = &image[(y * width + x) * 4];
+				const int texel[4] =
+				{
+					(int)(127 + 120 * std::sin(x * 0.1)),
+					(int)(127 + 100 * std::cos(y * 0.13 + x * 0.05)),
+					(int)((x * 3 + y * 2) % 256),
+					(int)(x * 2)
+				};
+				for (int c = 0; c < 4; ++c)
+				{
+					p[c] = (uint8_t)std::clamp(texel[c] + (int)(rng() % 9) - 4, 0, 255);
+				}
+			}
+		}
+		return image;
+	}
+
+	void TestRoundTrip()
+	{
+		const uint32_t width = 125;
+		const uint32_t height = 67;
+		const std::vector<uint8_t> image = MakeImage(width, height);
+
+		struct Case
+		{
+			DXGI_FORMAT Format;
+			int ChannelMask;
+			double MinPsnr;
+		};
+		const Case cases[] =
+		{
+			{ DXGI_FORMAT_BC1_UNORM, 7, 32.0 },
+			{ DXGI_FORMAT_BC3_UNORM, 15, 33.0 },
+			{ DXGI_FORMAT_BC4_UNORM, 1, 45.0 },
+			{ DXGI_FORMAT_BC5_UNORM, 3, 44.0 },
+			{ DXGI_FORMAT_BC7_UNORM, 15, 34.0 }
+		};
+
+		for (const Case& test : cases)
+		{
+			double fastPsnr = 0.0;
+			for (BcQuality quality : { BcQuality::Fast, BcQuality::High })
+			{
+				BcOptions options;
+				options.Quality = quality;
+				options.AlphaThreshold = 0;
+				options.ThreadCount = 4;
+
+				BcTexture texture;
+				CHECK(texture.Compress(test.Format, DXGI_FORMAT_R8G8B8A8_UNORM, width, height, image.data(),
+					width * 4, options) == BcResult::Ok);
+				CHECK(texture.LevelCount() == 1);
+				CHECK(texture.DataSize() == 32 * 17 * BcTexture::BlockBytes(test.Format));
+
+				std::vector<uint8_t> decoded(image.size());
+				CHECK(texture.Decompress(0, decoded.data(), width * 4));
+				const double psnr = Psnr(image, decoded, test.ChannelMask);
+				CHECK(psnr > test.MinPsnr);
+				if (quality == BcQuality::Fast)
+				{
+					fastPsnr = psnr;
+				}
+				else
+				{
+					CHECK(psnr >= fastPsnr - 0.01);
+				}
+			}
+		}
+
+		BcTexture texture;
+		CHECK(texture.Compress(DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM, width, height, image.data(),
+			width * 4) == BcResult::NotSupported);
+		CHECK(texture.Compress(DXGI_FORMAT_BC7_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM, 0, height, image.data(),
+			width * 4) == BcResult::InvalidArgument);
+	}
+
+	void TestSolidBlocks()
+	{
+		std::mt19937 rng(2);
+		for (int k = 0; k < 500; ++k)
+		{
+			uint8_t color[4];
+			for (uint8_t& c : color)
+			{
+				c = (uint8_t)rng();
+			}
+			uint8_t texels[64];
+			for (int i = 0; i < 16; ++i)
+			{
+				std::memcpy(texels + i * 4, color, 4);
+			}
+
+			BcOptions options;
+			options.Quality = k & 1 ? BcQuality::High : BcQuality::Fast;
+			uint8_t block[16];
+			uint8_t decoded[64];
+
+			// Mode 6 shares a p-bit across the channels of an endpoint, which can cost
+			// one step on some of them.
+			BcTexture::EncodeBlock(DXGI_FORMAT_BC7_UNORM, texels, block, options);
+			CHECK(BcTexture::DecodeBlock(DXGI_FORMAT_BC7_UNORM, block, decoded));
+			for (int i = 0; i < 64; ++i)
+			{
+				CHECK(std::abs(decoded[i] - texels[i]) <= 1);
+			}
+
+			BcTexture::EncodeBlock(DXGI_FORMAT_BC4_UNORM, texels, block, options);
+			CHECK(BcTexture::DecodeBlock(DXGI_FORMAT_BC4_UNORM, block, decoded));
+			CHECK(decoded[0] == color[0]);
+			CHECK(decoded[3] == 255);
+
+			BcTexture::EncodeBlock(DXGI_FORMAT_BC3_UNORM, texels, block, options);
+			CHECK(BcTexture::DecodeBlock(DXGI_FORMAT_BC3_UNORM, block, decoded));
+			CHECK(decoded[3] == color[3]);
+		}
+	}
+
+	void TestBc1Transparency()
+	{
+		uint8_t texels[64];
+		for (int i = 0; i < 16; ++i)
+		{
+			texels[i * 4 + 0] = 200;
+			texels[i * 4 + 1] = (uint8_t)(i * 10);
+			texels[i * 4 + 2] = 30;
+			texels[i * 4 + 3] = i % 3 == 0 ? 0 : 255;
+		}
+
+		for (BcQuality quality : { BcQuality::Fast, BcQuality::High })
+		{
+			BcOptions options;
+			options.Quality = quality;
+			uint8_t block[8];
+			uint8_t decoded[64];
+			BcTexture::EncodeBlock(DXGI_FORMAT_BC1_UNORM, texels, block, options);
+			CHECK(BcTexture::DecodeBlock(DXGI_FORMAT_BC1_UNORM, block, decoded));
+			for (int i = 0; i < 16; ++i)
+			{
+				CHECK((decoded[i * 4 + 3] == 0) == (texels[i * 4 + 3] == 0));
+			}
+		}
+	}
+
+	// Builds BC7 blocks field by field, in the order the format lays them out.
+	struct Bc7Writer
+	{
+		uint8_t Block[16] = {};
+		int Position = 0;
+
+		void Put(uint32_t value, int bits)
+		{
+			for (int i = 0; i < bits; ++i, ++Position)
+			{
+				if ((value >> i) & 1)
+				{
+					Block[Position >> 3] |= (uint8_t)(1 << (Position & 7));
+				}
+			}
+		}
+		void Mode(int mode)
+		{
+			Put(1u << mode, mode + 1);
+		}
+	};
+
+	// Every field of a 2-subset mode 1 block and a 3-subset mode 0 block, with index
+	// widths that only line up if the anchors are where the format puts them.
+	void TestBc7Partitions()
+	{
+		// Mode 1, partition 13: the top two rows are subset 0, the bottom two subset 1.
+		// Subset 0 runs from near black to white, subset 1 is solid (253, 0, 129).
+		{
+			Bc7Writer w;
+			w.Mode(1);
+			w.Put(13, 6);
+			const uint32_t red[4] = { 0, 63, 63, 63 };
+			const uint32_t green[4] = { 0, 63, 0, 0 };
+			const uint32_t blue[4] = { 0, 63, 32, 32 };
+			for (const uint32_t* channel : { red, green, blue })
+			{
+				for (int e = 0; e < 4; ++e)
+				{
+					w.Put(channel[e], 6);
+				}
+			}
+			// Shared p-bits: subset 0 gets 1, which lifts its white to 255 and its black to 2.
+			w.Put(1, 1);
+			w.Put(0, 1);
+			// 3-bit indices; texels 0 and 15 anchor the subsets and lose their top bit.
+			for (int i = 0; i < 16; ++i)
+			{
+				w.Put(i < 8 ? i % 8 : 3, i == 0 || i == 15 ? 2 : 3);
+			}
+			CHECK(w.Position == 128);
+
+			uint8_t decoded[64];
+			CHECK(BcTexture::DecodeBlock(DXGI_FORMAT_BC7_UNORM, w.Block, decoded));
+			const uint8_t ramp[8] = { 2, 38, 73, 109, 148, 184, 219, 255 };
+			for (int i = 0; i < 16; ++i)
+			{
+				const uint8_t* texel = decoded + i * 4;
+				if (i < 8)
+				{
+					const uint8_t expected = ramp[i];
+					CHECK(texel[0] == expected && texel[1] == expected && texel[2] == expected);
+				}
+				else
+				{
+					CHECK(texel[0] == 253 && texel[1] == 0 && texel[2] == 129);
+				}
+				CHECK(texel[3] == 255);
+			}
+		}
+
+		// Mode 0, partition 0:
+		//   0 0 1 1
+		//   0 0 1 1
+		//   0 2 2 1
+		//   2 2 2 2
+		// with anchors 0, 3 and 15.  Each subset runs from black to one primary.
+		{
+			Bc7Writer w;
+			w.Mode(0);
+			w.Put(0, 4);
+			for (int c = 0; c < 3; ++c)
+			{
+				for (int s = 0; s < 3; ++s)
+				{
+					w.Put(0, 4);
+					w.Put(s == c ? 15 : 0, 4);
+				}
+			}
+			// One p-bit per endpoint, all 0: the primaries expand to 247.
+			for (int e = 0; e < 6; ++e)
+			{
+				w.Put(0, 1);
+			}
+			for (int i = 0; i < 16; ++i)
+			{
+				const bool anchor = i == 0 || i == 3 || i == 15;
+				w.Put(anchor ? 3 : 7, anchor ? 2 : 3);
+			}
+			CHECK(w.Position == 128);
+
+			const int subsets[16] = { 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2 };
+			uint8_t decoded[64];
+			CHECK(BcTexture::DecodeBlock(DXGI_FORMAT_BC7_UNORM, w.Block, decoded));
+			for (int i = 0; i < 16; ++i)
+			{
+				// Index 3 of 7 weighs the primary by 27/64, index 7 gives it whole.
+				const bool anchor = i == 0 || i == 3 || i == 15;
+				const uint8_t level = anchor ? 104 : 247;
+				for (int c = 0; c < 3; ++c)
+				{
+					CHECK(decoded[i * 4 + c] == (c == subsets[i] ? level : 0));
+				}
+				CHECK(decoded[i * 4 + 3] == 255);
+			}
+		}
+	}
+
+	// Mode 7 carries alpha in a 2-subset block; mode 4 swaps the index sets and a
+	// channel with alpha.
+	void TestBc7Alpha()
+	{
+		{
+			Bc7Writer w;
+			w.Mode(7);
+			w.Put(0, 6);
+			for (int c = 0; c < 4; ++c)
+			{
+				for (int e = 0; e < 4; ++e)
+				{
+					// Subset 1's alpha runs from 0 to 255; everything else is 0.
+					w.Put(c == 3 && e == 3 ? 31 : 0, 5);
+				}
+			}
+			for (int e = 0; e < 4; ++e)
+			{
+				w.Put(e == 3 ? 1 : 0, 1);
+			}
+			for (int i = 0; i < 16; ++i)
+			{
+				w.Put(1, i == 0 || i == 15 ? 1 : 2);
+			}
+			CHECK(w.Position == 128);
+
+			uint8_t decoded[64];
+			CHECK(BcTexture::DecodeBlock(DXGI_FORMAT_BC7_UNORM, w.Block, decoded));
+			for (int i = 0; i < 16; ++i)
+			{
+				const bool subset1 = (i & 3) >= 2;
+				// Index 1 of 3 weighs the second endpoint by 21/64.  Its p-bit also
+				// lifts the colour of that endpoint from 0 to 4.
+				CHECK(decoded[i * 4 + 3] == (subset1 ? 84 : 0));
+				CHECK(decoded[i * 4 + 0] == (subset1 ? 1 : 0));
+			}
+		}
+
+		{
+			Bc7Writer w;
+			w.Mode(4);
+			// Rotation 1 swaps red and alpha; the index mode bit gives colour the 3-bit set.
+			w.Put(1, 2);
+			w.Put(1, 1);
+			for (int c = 0; c < 3; ++c)
+			{
+				w.Put(0, 5);
+				w.Put(31, 5);
+			}
+			w.Put(0, 6);
+			w.Put(63, 6);
+			for (int i = 0; i < 16; ++i)
+			{
+				w.Put(i == 0 ? 1 : 3, i == 0 ? 1 : 2);
+			}
+			for (int i = 0; i < 16; ++i)
+			{
+				w.Put(i == 0 ? 0 : 4, i == 0 ? 2 : 3);
+			}
+			CHECK(w.Position == 128);
+
+			uint8_t decoded[64];
+			CHECK(BcTexture::DecodeBlock(DXGI_FORMAT_BC7_UNORM, w.Block, decoded));
+			// Texel 0: colour index 0, alpha index 1 of 3.  The others: colour index 4 of 7,
+			// alpha 3 of 3.  Red and alpha then trade places.
+			CHECK(decoded[0] == 84 && decoded[1] == 0 && decoded[2] == 0 && decoded[3] == 0);
+			for (int i = 1; i < 16; ++i)
+			{
+				const uint8_t* texel = decoded + i * 4;
+				CHECK(texel[0] == 255 && texel[1] == 147 && texel[2] == 147 && texel[3] == 147);
+			}
+		}
+
+		// A block with no mode bit is reserved.
+		uint8_t reserved[16] = {};
+		uint8_t decoded[64];
+		CHECK(!BcTexture::DecodeBlock(DXGI_FORMAT_BC7_UNORM, reserved, decoded));
+		CHECK(std::all_of(decoded, decoded + 64, [](uint8_t v) { return v == 0; }));
+	}
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestSolidBlocks();
+	TestBc1Transparency();
+	TestBc7Partitions();
+	TestBc7Alpha();
+	return TestExitCode();
+}
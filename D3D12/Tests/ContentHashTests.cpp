@@ -0,0 +1,76 @@
+#include "ContentHash.h"
+#include "TestCheck.h"
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// Pack entries keep their hashes across runs, so the function must stay XXH64.
+	void TestReferenceVectors()
+	{
+		CHECK(ContentHash("", 0) == 0xEF46DB3751D8E999ull);
+		CHECK(ContentHash("a", 1) == 0xD24EC4F1A98C6E5Bull);
+		CHECK(ContentHash("abc", 3) == 0x44BC2CF5AD770999ull);
+
+		const char* fox = "The quick brown fox jumps over the lazy dog";
+		CHECK(ContentHash(fox, std::strlen(fox)) == 0x0B242D361FDA71BCull);
+	}
+
+	// Prefixes of one pattern, covering each tail (bytes, a 4-byte word, 8-byte words)
+	// with and without the 32-byte stripes in front.
+	void TestLengths()
+	{
+		std::vector<uint8_t> pattern(256);
+		for (size_t i = 0; i < pattern.size(); ++i)
+		{
+			pattern[i] = (uint8_t)(i * 7 + 1);
+		}
+
+		struct Vector
+		{
+			size_t Length;
+			uint64_t Hash;
+		};
+		const Vector vectors[] =
+		{
+			{ 1, 0x8A4127811B21E730ull },
+			{ 3, 0xB6E6C910C2FD373Aull },
+			{ 4, 0x22EDA2CF6AF4C124ull },
+			{ 7, 0x34084D91A233A751ull },
+			{ 8, 0xC6F1803A5E0B3222ull },
+			{ 12, 0x9178B724DCE384C0ull },
+			{ 15, 0x514C6F58D37CE6F1ull },
+			{ 31, 0x6AB1C40E29F50073ull },
+			{ 32, 0x5A0756FBE9ECD3D1ull },
+			{ 33, 0xDC50CDC37BB9C183ull },
+			{ 36, 0x31E83081F3301BB8ull },
+			{ 40, 0x7899CACB89A78430ull },
+			{ 47, 0xDDA7573AF4285E5Cull },
+			{ 63, 0x10DD94885C71894Aull },
+			{ 64, 0x90083DA9CDB9D795ull },
+			{ 100, 0xD248BFC5208B0B16ull },
+			{ 256, 0xB451505592B94D00ull }
+		};
+
+		// Copies at every offset from an 8-byte boundary hash the same.
+		std::vector<uint8_t> shifted(pattern.size() + 8);
+		for (const Vector& v : vectors)
+		{
+			CHECK(ContentHash(pattern.data(), v.Length) == v.Hash);
+			for (size_t offset = 1; offset < 8; ++offset)
+			{
+				std::memcpy(shifted.data() + offset, pattern.data(), v.Length);
+				CHECK(ContentHash(shifted.data() + offset, v.Length) == v.Hash);
+			}
+		}
+
+		CHECK(ContentHash(pattern.data(), 100, 0x9E3779B97F4A7C15ull) == 0x8D818C65AB873D61ull);
+	}
+}
+
+int main()
+{
+	TestReferenceVectors();
+	TestLengths();
+	return TestExitCode();
+}
@@ -0,0 +1,141 @@
+#include "DdsImage.h"
+#include "TestCheck.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+	std::vector<uint8_t> MakeDds(DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t mipCount,
+		uint32_t arraySize, size_t dataSize)
+	{
+		std::vector<uint8_t> file(DdsImage::HeaderSize + dataSize);
+		CHECK(DdsImage::WriteHeader(file.data(), format, width, height, mipCount, arraySize));
+		for (size_t i = DdsImage::HeaderSize; i < file.size(); ++i)
+		{
+			file[i] = (uint8_t)i;
+		}
+		return file;
+	}
+
+	void TestLayout()
+	{
+		// 64x32 RGBA8 with all 7 mips: 8192 + 2048 + 512 + 128 + 32 + 8 + 4 bytes per slice.
+		const size_t sliceSize = 10924;
+		std::vector<uint8_t> file = MakeDds(DXGI_FORMAT_R8G8B8A8_UNORM, 64, 32, 7, 3, sliceSize * 3);
+
+		DdsImage image;
+		CHECK(image.Parse(file.data(), file.size()) == DdsResult::Ok);
+		CHECK(image.Format() == DXGI_FORMAT_R8G8B8A8_UNORM);
+		CHECK(image.Dimension() == DdsDimension::Texture2D);
+		CHECK(image.Width() == 64);
+		CHECK(image.Height() == 32);
+		CHECK(image.MipCount() == 7);
+		CHECK(image.ArraySize() == 3);
+		CHECK(!image.IsCubeMap());
+		CHECK(image.SubresourceCount() == 21);
+		CHECK(image.DataSize() == sliceSize * 3);
+
+		const uint8_t* texels = file.data() + DdsImage::HeaderSize;
+		DdsSubresource top = image.Subresource(0, 1);
+		CHECK(top.Data == texels + sliceSize);
+		CHECK(top.Width == 64);
+		CHECK(top.Height == 32);
+		CHECK(top.RowPitch == 256);
+		CHECK(top.NumRows == 32);
+		CHECK(top.SlicePitch == 8192);
+
+		DdsSubresource mip2 = image.Subresource(2, 2);
+		CHECK(mip2.Data == texels + 2 * sliceSize + 8192 + 2048);
+		CHECK(mip2.Width == 16);
+		CHECK(mip2.Height == 8);
+		CHECK(mip2.RowPitch == 64);
+
+		// Subresources are numbered mip + slice * MipCount, as in D3D12.
+		CHECK(image.Subresource(2 + 2 * 7).Data == mip2.Data);
+
+		DdsSubresource last = image.Subresource(6, 2);
+		CHECK(last.Width == 1);
+		CHECK(last.Data + last.SlicePitch == texels + image.DataSize());
+	}
+
+	void TestBlockCompressed()
+	{
+		size_t bytes = 0;
+		size_t rowBytes = 0;
+		size_t rows = 0;
+		DdsImage::GetSurfaceInfo(128, 60, DXGI_FORMAT_BC1_UNORM, &bytes, &rowBytes, &rows);
+		CHECK(rowBytes == 32 * 8);
+		CHECK(rows == 15);
+		CHECK(bytes == rowBytes * rows);
+
+		// Mips smaller than a block still take a whole block.
+		DdsImage::GetSurfaceInfo(2, 1, DXGI_FORMAT_BC7_UNORM, &bytes, &rowBytes, &rows);
+		CHECK(bytes == 16);
+		CHECK(rows == 1);
+	}
+
+	void TestRejects()
+	{
+		std::vector<uint8_t> file = MakeDds(DXGI_FORMAT_R8G8B8A8_UNORM, 16, 16, 1, 1, 1024);
+		DdsImage image;
+
+		CHECK(image.Parse(nullptr, 0) == DdsResult::InvalidHeader);
+		CHECK(image.Parse(file.data(), 100) == DdsResult::InvalidHeader);
+		CHECK(image.Parse(file.data(), file.size() - 1) == DdsResult::Truncated);
+		CHECK(image.Parse(file.data(), DdsImage::HeaderSize) == DdsResult::Truncated);
+
+		std::vector<uint8_t> badMagic = file;
+		badMagic[0] = 'X';
+		CHECK(image.Parse(badMagic.data(), badMagic.size()) == DdsResult::InvalidHeader);
+
+		// Trailing bytes are ignored.
+		file.resize(file.size() + 7);
+		CHECK(image.Parse(file.data(), file.size()) == DdsResult::Ok);
+		CHECK(image.DataSize() == 1024);
+	}
+
+	// Every DDS file the samples ship parses, and its texels lie inside the file.
+	void TestTextures()
+	{
+		int parsed = 0;
+		for (const auto& entry : std::filesystem::directory_iterator(TEXTURE_DIR))
+		{
+			if (entry.path().extension() != ".dds")
+				continue;
+
+			std::ifstream in(entry.path(), std::ios::binary);
+			std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+			DdsImage image;
+			const DdsResult result = image.Parse(file.data(), file.size());
+			if (result != DdsResult::Ok)
+			{
+				std::printf("%s: DdsResult %d\n", entry.path().filename().string().c_str(), (int)result);
+			}
+			CHECK(result == DdsResult::Ok);
+			if (result != DdsResult::Ok)
+				continue;
+
+			DdsSubresource last = image.Subresource(image.SubresourceCount() - 1);
+			CHECK(last.Data + last.SlicePitch * last.Depth <= file.data() + file.size());
+
+			// One texel byte short of what the header describes.
+			const size_t needed = (size_t)(last.Data + last.SlicePitch * last.Depth - file.data());
+			DdsImage truncated;
+			CHECK(truncated.Parse(file.data(), needed - 1) == DdsResult::Truncated);
+			parsed++;
+		}
+		CHECK(parsed > 0);
+	}
+}
+
+int main()
+{
+	TestLayout();
+	TestBlockCompressed();
+	TestRejects();
+	TestTextures();
+	return TestExitCode();
+}
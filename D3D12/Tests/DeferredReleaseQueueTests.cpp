@@ -0,0 +1,97 @@
+#include "DeferredReleaseQueue.h"
+#include "TestCheck.h"
+#include <memory>
+
+namespace
+{
+	// Stands in for an ID3D12Fence and the queue signaling it.
+	struct FakeFence
+	{
+		uint64_t Signaled = 0;
+		uint64_t Completed = 0;
+
+		uint64_t Signal()
+		{
+			return ++Signaled;
+		}
+		void GpuCatchesUp(uint64_t value)
+		{
+			Completed = value;
+		}
+	};
+
+	using Owner = std::shared_ptr<int>;
+
+	void TestFrames()
+	{
+		FakeFence fence;
+		DeferredReleaseQueue<Owner> queue;
+
+		Owner a = std::make_shared<int>(1);
+		std::weak_ptr<int> aAlive = a;
+		queue.Release(std::move(a));
+
+		// Not tied to a fence until the frame ends, so nothing can be reclaimed yet.
+		CHECK(queue.Reclaim(UINT64_MAX) == 0);
+		CHECK(!aAlive.expired());
+
+		const uint64_t frame1 = fence.Signal();
+		queue.EndFrame(frame1);
+
+		Owner b = std::make_shared<int>(2);
+		std::weak_ptr<int> bAlive = b;
+		queue.Release(std::move(b));
+		const uint64_t frame2 = fence.Signal();
+		queue.EndFrame(frame2);
+		CHECK(queue.Size() == 2);
+
+		CHECK(queue.Reclaim(fence.Completed) == 0);
+		CHECK(!aAlive.expired());
+
+		fence.GpuCatchesUp(frame1);
+		CHECK(queue.Reclaim(fence.Completed) == 1);
+		CHECK(aAlive.expired());
+		CHECK(!bAlive.expired());
+
+		fence.GpuCatchesUp(frame2);
+		CHECK(queue.Reclaim(fence.Completed) == 1);
+		CHECK(bAlive.expired());
+		CHECK(queue.Size() == 0);
+	}
+
+	void TestExplicitFence()
+	{
+		FakeFence fence;
+		DeferredReleaseQueue<Owner> queue;
+
+		// An object waiting for the next EndFrame does not hold up one released
+		// against a fence that was already signaled.
+		Owner pending = std::make_shared<int>(1);
+		std::weak_ptr<int> pendingAlive = pending;
+		queue.Release(std::move(pending));
+
+		const uint64_t signaled = fence.Signal();
+		Owner uploader = std::make_shared<int>(2);
+		std::weak_ptr<int> uploaderAlive = uploader;
+		queue.Release(std::move(uploader), signaled);
+
+		fence.GpuCatchesUp(signaled);
+		CHECK(queue.Reclaim(fence.Completed) == 1);
+		CHECK(uploaderAlive.expired());
+		CHECK(!pendingAlive.expired());
+
+		queue.EndFrame(fence.Signal());
+		CHECK(queue.Reclaim(fence.Completed) == 0);
+
+		queue.Clear();
+		CHECK(pendingAlive.expired());
+		CHECK(queue.Size() == 0);
+	}
+}
+
+int main()
+{
+	TestFrames();
+	TestExplicitFence();
+	return TestExitCode();
+}
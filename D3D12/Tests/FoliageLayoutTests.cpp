@@ -0,0 +1,249 @@
+#include "FoliageLayout.h"
+#include "TestCheck.h"
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	float Hills(float x, float z)
+	{
+		return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
+	}
+
+	FoliageDesc SmallDesc()
+	{
+		FoliageDesc desc;
+		desc.Width = 96.0f;
+		desc.Depth = 64.0f;
+		desc.MinSpacing = 3.0f;
+		desc.CellSize = 16.0f;
+		return desc;
+	}
+
+	const float Origin[3] = { 0.0f, 0.0f, 0.0f };
+
+	// Every pair of instances is at least MinSpacing apart, and the dart throwing
+	// still fills the area: a Poisson disk set covers well over a third of the
+	// densest packing.
+	void TestPoissonSpacing()
+	{
+		FoliageDesc desc = SmallDesc();
+		FoliageLayout layout(desc);
+		layout.Scatter(Hills, 7);
+
+		const std::vector<FoliageInstance>& instances = layout.Instances();
+		CHECK(layout.Stats().TotalInstances == instances.size());
+		const float hexPacking = desc.Width * desc.Depth / (0.5f * sqrtf(3.0f) * desc.MinSpacing * desc.MinSpacing);
+		CHECK(instances.size() > 0.35f * hexPacking);
+
+		int tooClose = 0;
+		for (size_t i = 0; i < instances.size(); ++i)
+		{
+			const FoliageInstance& a = instances[i];
+			CHECK(fabsf(a.Pos[0]) <= 0.5f * desc.Width && fabsf(a.Pos[2]) <= 0.5f * desc.Depth);
+			CHECK(a.Pos[1] == Hills(a.Pos[0], a.Pos[2]) + desc.HeightOffset);
+			CHECK(a.Size[0] >= desc.MinSize && a.Size[0] <= desc.MaxSize && a.Size[1] == a.Size[0]);
+
+			for (size_t j = i + 1; j < instances.size(); ++j)
+			{
+				const FoliageInstance& b = instances[j];
+				float dx = a.Pos[0] - b.Pos[0];
+				float dz = a.Pos[2] - b.Pos[2];
+				tooClose += dx * dx + dz * dz < desc.MinSpacing * desc.MinSpacing;
+			}
+		}
+		CHECK(tooClose == 0);
+
+		// The same seed scatters the same instances.
+		FoliageLayout again(desc);
+		again.Scatter(Hills, 7);
+		CHECK(again.Instances().size() == instances.size());
+		for (size_t i = 0; i < instances.size() && i < again.Instances().size(); ++i)
+		{
+			CHECK(again.Instances()[i].Pos[0] == instances[i].Pos[0]);
+			CHECK(again.Instances()[i].Pos[2] == instances[i].Pos[2]);
+		}
+	}
+
+	// Samples below MinHeight are dropped and nothing else is: on a plane that
+	// rises along x, MinHeight 0 keeps exactly the half with x >= 0.
+	void TestMinHeight()
+	{
+		auto plane = [](float x, float) { return x; };
+
+		FoliageDesc desc = SmallDesc();
+		FoliageLayout all(desc);
+		all.Scatter(plane, 3);
+
+		desc.MinHeight = 0.0f;
+		FoliageLayout land(desc);
+		land.Scatter(plane, 3);
+
+		size_t expected = 0;
+		for (const FoliageInstance& inst : all.Instances())
+		{
+			expected += inst.Pos[0] >= 0.0f;
+		}
+		CHECK(land.Instances().size() == expected);
+		CHECK(expected > 0 && expected < all.Instances().size());
+		for (const FoliageInstance& inst : land.Instances())
+		{
+			CHECK(inst.Pos[0] >= 0.0f);
+		}
+
+		// All under water leaves empty cells that Cull skips.
+		desc.MinHeight = 1000.0f;
+		FoliageLayout flooded(desc);
+		flooded.Scatter(plane, 3);
+		CHECK(flooded.Instances().empty());
+		CHECK(flooded.Stats().TotalCells == 24);
+		uint32_t written = flooded.Cull([](const FoliageCell&) { return true; }, Origin, 100,
+			[](uint32_t, std::span<const FoliageInstance>) { CHECK(false); });
+		CHECK(written == 0);
+		CHECK(flooded.Stats().VisibleCells == 0);
+	}
+
+	// Cells own contiguous ranges of the instances inside them, bounded by their
+	// sprites.
+	void TestCells()
+	{
+		FoliageDesc desc = SmallDesc();
+		FoliageLayout layout(desc);
+		layout.Scatter(Hills, 11);
+
+		const std::vector<FoliageCell>& cells = layout.Cells();
+		CHECK(cells.size() == 6 * 4);
+		CHECK(layout.Stats().TotalCells == cells.size());
+
+		uint32_t next = 0;
+		for (uint32_t c = 0; c < (uint32_t)cells.size(); ++c)
+		{
+			const FoliageCell& cell = cells[c];
+			CHECK(cell.FirstInstance == next);
+			CHECK(cell.InstanceCount > 0);
+			next += cell.InstanceCount;
+
+			const float cellX = -0.5f * desc.Width + (c % 6) * desc.CellSize;
+			const float cellZ = -0.5f * desc.Depth + (c / 6) * desc.CellSize;
+			for (uint32_t i = 0; i < cell.InstanceCount; ++i)
+			{
+				const FoliageInstance& inst = layout.Instances()[cell.FirstInstance + i];
+				CHECK(inst.Pos[0] >= cellX && inst.Pos[0] <= cellX + desc.CellSize);
+				CHECK(inst.Pos[2] >= cellZ && inst.Pos[2] <= cellZ + desc.CellSize);
+
+				const float half[3] = { 0.5f * inst.Size[0], 0.5f * inst.Size[1], 0.5f * inst.Size[0] };
+				for (int k = 0; k < 3; ++k)
+				{
+					CHECK(cell.BoundsMin[k] <= inst.Pos[k] - half[k]);
+					CHECK(cell.BoundsMax[k] >= inst.Pos[k] + half[k]);
+				}
+			}
+		}
+		CHECK(next == layout.Instances().size());
+	}
+
+	struct Written
+	{
+		uint32_t First;
+		const FoliageInstance* Instances;
+		size_t Count;
+	};
+
+	// Cull draws a prefix of every visible cell in range, thinned with distance,
+	// into consecutive elements, and stops at maxInstances.
+	void TestCull()
+	{
+		FoliageDesc desc = SmallDesc();
+		desc.LodNear = 20.0f;
+		desc.LodFar = 60.0f;
+		desc.LodMinDensity = 0.25f;
+		desc.CullDistance = 70.0f;
+		FoliageLayout layout(desc);
+		layout.Scatter(Hills, 5);
+
+		CHECK(layout.CellDensity(0.0f) == 1.0f);
+		CHECK(layout.CellDensity(20.0f) == 1.0f);
+		CHECK(fabsf(layout.CellDensity(40.0f) - 0.625f) < 1e-6f);
+		CHECK(layout.CellDensity(60.0f) == 0.25f);
+		CHECK(layout.CellDensity(500.0f) == 0.25f);
+
+		// Standing off the -x edge, with the frustum test dropping the cells of the -z half.
+		const float eye[3] = { -80.0f, 0.0f, 0.0f };
+		auto isVisible = [](const FoliageCell& cell) { return cell.BoundsMax[2] > 0.0f; };
+
+		std::vector<Written> writes;
+		uint32_t written = layout.Cull(isVisible, eye, 100000,
+			[&](uint32_t first, std::span<const FoliageInstance> instances)
+			{
+				writes.push_back({ first, instances.data(), instances.size() });
+			});
+
+		uint32_t expected = 0;
+		uint32_t visibleCells = 0;
+		size_t w = 0;
+		bool skippedFar = false;
+		for (const FoliageCell& cell : layout.Cells())
+		{
+			if (!isVisible(cell))
+				continue;
+
+			float d2 = 0.0f;
+			for (int k = 0; k < 3; ++k)
+			{
+				float d = std::fmax(std::fmax(cell.BoundsMin[k] - eye[k], eye[k] - cell.BoundsMax[k]), 0.0f);
+				d2 += d * d;
+			}
+			float distance = sqrtf(d2);
+			if (distance > desc.CullDistance)
+			{
+				skippedFar = true;
+				continue;
+			}
+
+			uint32_t count = (uint32_t)ceilf(cell.InstanceCount * layout.CellDensity(distance));
+			CHECK(w < writes.size());
+			if (w < writes.size())
+			{
+				CHECK(writes[w].First == expected);
+				CHECK(writes[w].Instances == layout.Instances().data() + cell.FirstInstance);
+				CHECK(writes[w].Count == count);
+			}
+			++w;
+			expected += count;
+			++visibleCells;
+		}
+		CHECK(skippedFar);
+		CHECK(w == writes.size());
+		CHECK(written == expected);
+		CHECK(written < layout.Instances().size());
+		CHECK(layout.Stats().VisibleCells == visibleCells);
+		CHECK(layout.Stats().VisibleInstances == written);
+
+		// The budget cuts the last cell short and nothing is written past it.
+		const uint32_t budget = writes[0].Count + 1;
+		std::vector<Written> capped;
+		written = layout.Cull(isVisible, eye, budget,
+			[&](uint32_t first, std::span<const FoliageInstance> instances)
+			{
+				capped.push_back({ first, instances.data(), instances.size() });
+			});
+		CHECK(written == budget);
+		CHECK(capped.size() == 2);
+		CHECK(capped.size() == 2 && capped[1].First == writes[0].Count && capped[1].Count == 1);
+		CHECK(layout.Stats().VisibleCells == 2);
+
+		// From far enough away every cell is culled.
+		const float farEye[3] = { 0.0f, 500.0f, 0.0f };
+		CHECK(layout.Cull([](const FoliageCell&) { return true; }, farEye, 100000,
+			[](uint32_t, std::span<const FoliageInstance>) {}) == 0);
+	}
+}
+
+int main()
+{
+	TestPoissonSpacing();
+	TestMinHeight();
+	TestCells();
+	TestCull();
+	return TestExitCode();
+}
@@ -0,0 +1,154 @@
+#include "IndirectCommandPacker.h"
+#include "TestCheck.h"
+#include <cstddef>
+
+namespace
+{
+	struct FakeGeometry
+	{
+	};
+
+	// The members Pack reads from InstanceBatch, without the D3D12 types.
+	struct FakeBatch
+	{
+		const FakeGeometry* Geo = nullptr;
+		int PrimitiveType = 4;
+		uint32_t IndexCount = 0;
+		uint32_t StartIndexLocation = 0;
+		int32_t BaseVertexLocation = 0;
+		uint32_t StartInstance = 0;
+		uint32_t InstanceCount = 0;
+	};
+
+	FakeBatch MakeBatch(const FakeGeometry* geo, uint32_t indexCount, uint32_t startInstance, uint32_t instanceCount)
+	{
+		FakeBatch b;
+		b.Geo = geo;
+		b.IndexCount = indexCount;
+		b.StartIndexLocation = indexCount * 2;
+		b.BaseVertexLocation = (int32_t)indexCount / 3;
+		b.StartInstance = startInstance;
+		b.InstanceCount = instanceCount;
+		return b;
+	}
+
+	void TestLayout()
+	{
+		// The command signature is a 32-bit root constant followed by
+		// D3D12_DRAW_INDEXED_ARGUMENTS, whose fields are five 32-bit values.
+		CHECK(sizeof(IndirectDrawCommand) == IndirectDrawCommandStride);
+		CHECK(offsetof(IndirectDrawCommand, BaseInstance) == IndirectBaseInstanceOffset);
+		CHECK(offsetof(IndirectDrawCommand, IndexCountPerInstance) == IndirectDrawArgumentsOffset);
+		CHECK(offsetof(IndirectDrawCommand, InstanceCount) == IndirectDrawArgumentsOffset + 4);
+		CHECK(offsetof(IndirectDrawCommand, StartIndexLocation) == IndirectDrawArgumentsOffset + 8);
+		CHECK(offsetof(IndirectDrawCommand, BaseVertexLocation) == IndirectDrawArgumentsOffset + 12);
+		CHECK(offsetof(IndirectDrawCommand, StartInstanceLocation) == IndirectDrawArgumentsOffset + 16);
+		CHECK(IndirectDrawArgumentsSize == 5 * sizeof(uint32_t));
+	}
+
+	void TestEmpty()
+	{
+		IndirectCommandPacker packer;
+		packer.Pack(std::vector<FakeBatch>());
+		CHECK(packer.Commands().empty());
+		CHECK(packer.Runs().empty());
+
+		// Batches without instances draw nothing.
+		FakeGeometry geo;
+		packer.Pack(std::vector<FakeBatch>{ MakeBatch(&geo, 36, 0, 0), MakeBatch(&geo, 6, 0, 0) });
+		CHECK(packer.Commands().empty());
+		CHECK(packer.Runs().empty());
+	}
+
+	void TestOneBatch()
+	{
+		FakeGeometry geo;
+		IndirectCommandPacker packer;
+		packer.Pack(std::vector<FakeBatch>{ MakeBatch(&geo, 36, 7, 3) });
+
+		CHECK(packer.Commands().size() == 1);
+		CHECK(packer.Runs().size() == 1);
+
+		const IndirectDrawCommand& cmd = packer.Commands()[0];
+		CHECK(cmd.BaseInstance == 7);
+		CHECK(cmd.IndexCountPerInstance == 36);
+		CHECK(cmd.InstanceCount == 3);
+		CHECK(cmd.StartIndexLocation == 72);
+		CHECK(cmd.BaseVertexLocation == 12);
+		CHECK(cmd.StartInstanceLocation == 0);
+
+		const IndirectDrawRun& run = packer.Runs()[0];
+		CHECK(run.FirstBatch == 0);
+		CHECK(run.FirstCommand == 0);
+		CHECK(run.CommandCount == 1);
+	}
+
+	void TestManyBatches()
+	{
+		FakeGeometry geoA;
+		FakeGeometry geoB;
+
+		std::vector<FakeBatch> batches;
+		batches.push_back(MakeBatch(&geoA, 36, 0, 2));
+		batches.push_back(MakeBatch(&geoA, 30, 2, 3));
+		batches.push_back(MakeBatch(&geoA, 12, 5, 0));
+		batches.push_back(MakeBatch(&geoB, 6, 5, 1));
+		batches.push_back(MakeBatch(&geoB, 6, 6, 4));
+		batches.push_back(MakeBatch(&geoB, 6, 10, 1));
+		batches.back().PrimitiveType = 5;
+		batches.push_back(MakeBatch(&geoA, 36, 11, 2));
+
+		IndirectCommandPacker packer;
+		packer.Pack(batches);
+
+		// The empty batch is skipped; a new run starts at every change of geometry
+		// or topology, even back to geometry seen before.
+		const std::vector<IndirectDrawCommand>& commands = packer.Commands();
+		const std::vector<IndirectDrawRun>& runs = packer.Runs();
+		CHECK(commands.size() == 6);
+		CHECK(runs.size() == 4);
+
+		const uint32_t expectedFirstBatch[] = { 0, 3, 5, 6 };
+		const uint32_t expectedFirstCommand[] = { 0, 2, 4, 5 };
+		const uint32_t expectedCount[] = { 2, 2, 1, 1 };
+		for (size_t i = 0; i < runs.size() && i < 4; ++i)
+		{
+			CHECK(runs[i].FirstBatch == expectedFirstBatch[i]);
+			CHECK(runs[i].FirstCommand == expectedFirstCommand[i]);
+			CHECK(runs[i].CommandCount == expectedCount[i]);
+		}
+
+		// Every command carries its batch's first instance in the root constant,
+		// and the draw itself starts at instance 0 since SV_InstanceID ignores it.
+		const uint32_t expectedBaseInstance[] = { 0, 2, 5, 6, 10, 11 };
+		for (size_t i = 0; i < commands.size() && i < 6; ++i)
+		{
+			CHECK(commands[i].BaseInstance == expectedBaseInstance[i]);
+			CHECK(commands[i].StartInstanceLocation == 0);
+		}
+
+		// A run's commands are read from FirstCommand * stride bytes into the
+		// argument buffer, where the root constant comes first.
+		const uint8_t* args = reinterpret_cast<const uint8_t*>(commands.data());
+		for (const IndirectDrawRun& run : runs)
+		{
+			const uint8_t* first = args + (size_t)run.FirstCommand * IndirectDrawCommandStride;
+			uint32_t baseInstance = *reinterpret_cast<const uint32_t*>(first + IndirectBaseInstanceOffset);
+			CHECK(baseInstance == batches[run.FirstBatch].StartInstance);
+		}
+
+		// Packing again starts over.
+		packer.Pack(std::vector<FakeBatch>{ MakeBatch(&geoB, 6, 0, 1) });
+		CHECK(packer.Commands().size() == 1);
+		CHECK(packer.Runs().size() == 1);
+	}
+}
+
+int main()
+{
+	TestLayout();
+	TestEmpty();
+	TestOneBatch();
+	TestManyBatches();
+	return TestExitCode();
+}
@@ -0,0 +1,117 @@
+#include "LinearRingAllocator.h"
+#include "TestCheck.h"
+#include <deque>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	void TestWrapAndReclaim()
+	{
+		LinearRingAllocator ring(1024);
+
+		CHECK(ring.Allocate(100, 1) == 0);
+		CHECK(ring.Allocate(10, 256) == 256);
+		ring.EndFrame(1);
+
+		CHECK(ring.Allocate(600, 1) == 266);
+		ring.EndFrame(2);
+
+		// 200 bytes fit neither before the end nor before the oldest frame.
+		CHECK(ring.Allocate(200, 1) == LinearRingAllocator::InvalidOffset);
+		CHECK(ring.Allocate(2000, 1) == LinearRingAllocator::InvalidOffset);
+
+		// Once frame 1 is done they wrap to the front; the skipped end counts as used.
+		ring.Reclaim(1);
+		CHECK(ring.UsedBytes() == 600);
+		CHECK(ring.Allocate(200, 1) == 0);
+		CHECK(ring.UsedBytes() == 600 + 158 + 200);
+
+		ring.Reclaim(2);
+		CHECK(ring.UsedBytes() == 358);
+		ring.EndFrame(3);
+		ring.Reclaim(3);
+		CHECK(ring.UsedBytes() == 0);
+
+		// With nothing in flight the next allocation starts over at the front.
+		CHECK(ring.Allocate(1024, 256) == 0);
+	}
+
+	// Random allocations, frame ends and fence completions, checked against the
+	// allocations each frame still holds.
+	void TestRandomFrames()
+	{
+		const uint64_t capacity = 1024;
+		LinearRingAllocator ring(capacity);
+		std::mt19937 rng(1);
+
+		using Range = std::pair<uint64_t, uint64_t>;
+		std::deque<std::pair<uint64_t, std::vector<Range>>> inFlight;
+		std::vector<Range> current;
+		uint64_t fence = 0;
+		uint64_t completed = 0;
+
+		auto overlaps = [](const Range& a, const Range& b)
+		{
+			return a.second != 0 && b.second != 0 && a.first < b.first + b.second && b.first < a.first + a.second;
+		};
+
+		for (int i = 0; i < 50000; ++i)
+		{
+			const uint32_t op = rng() % 10;
+			if (op < 7)
+			{
+				const uint64_t size = rng() % 300;
+				const uint64_t alignment = 1ull << (rng() % 9);
+				const uint64_t offset = ring.Allocate(size, alignment);
+				if (offset == LinearRingAllocator::InvalidOffset)
+					continue;
+
+				CHECK(offset % alignment == 0);
+				CHECK(offset + size <= capacity);
+
+				const Range range(offset, size);
+				for (const auto& frame : inFlight)
+				{
+					for (const Range& other : frame.second)
+					{
+						CHECK(!overlaps(range, other));
+					}
+				}
+				for (const Range& other : current)
+				{
+					CHECK(!overlaps(range, other));
+				}
+				current.push_back(range);
+			}
+			else if (op < 9)
+			{
+				ring.EndFrame(++fence);
+				inFlight.emplace_back(fence, std::move(current));
+				current.clear();
+			}
+			else if (completed < fence)
+			{
+				completed += 1 + rng() % (fence - completed);
+				ring.Reclaim(completed);
+				while (!inFlight.empty() && inFlight.front().first <= completed)
+				{
+					inFlight.pop_front();
+				}
+			}
+			CHECK(ring.UsedBytes() <= capacity);
+		}
+
+		ring.EndFrame(++fence);
+		ring.Reclaim(fence);
+		CHECK(ring.UsedBytes() == 0);
+	}
+}
+
+int main()
+{
+	TestWrapAndReclaim();
+	TestRandomFrames();
+	return TestExitCode();
+}
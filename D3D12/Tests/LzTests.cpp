@@ -0,0 +1,104 @@
+#include "Lz.h"
+#include "TestCheck.h"
+#include <cstring>
+#include <random>
+
+namespace
+{
+	// Random bytes, short repeats, a small alphabet and back references of up to 8.
+	std::vector<uint8_t> MakeData(std::mt19937& rng, int kind, size_t size)
+	{
+		std::vector<uint8_t> data(size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			switch (kind)
+			{
+			case 0:
+				data[i] = (uint8_t)rng();
+				break;
+			case 1:
+				data[i] = (uint8_t)(i % 7);
+				break;
+			case 2:
+				data[i] = (uint8_t)(rng() % 4);
+				break;
+			default:
+				data[i] = i > 8 ? data[i - 1 - rng() % 8] : (uint8_t)rng();
+				break;
+			}
+		}
+		return data;
+	}
+
+	void TestRoundTrip()
+	{
+		std::mt19937 rng(1);
+		for (int test = 0; test < 300; ++test)
+		{
+			const size_t size = rng() % (test < 100 ? 64 : 200000);
+			const int kind = test % 4;
+			const std::vector<uint8_t> data = MakeData(rng, kind, size);
+
+			std::vector<uint8_t> packed;
+			LzCompress(data.data(), data.size(), packed);
+			std::vector<uint8_t> unpacked(size);
+			CHECK(LzDecompress(packed.data(), packed.size(), unpacked.data(), unpacked.size()));
+			CHECK(unpacked == data);
+
+			// Repetitive data shrinks, random data grows by little.
+			if (size >= 1024)
+			{
+				const size_t bound = kind == 0 ? size + size / 64 + 16 : kind == 2 ? size - 1 : size / 2;
+				CHECK(packed.size() <= bound);
+			}
+		}
+
+		std::vector<uint8_t> packed;
+		LzCompress(nullptr, 0, packed);
+		CHECK(LzDecompress(packed.data(), packed.size(), nullptr, 0));
+	}
+
+	// Corrupt, truncated and random input and wrong sizes fail without touching
+	// memory outside the buffers, which the sanitizers or a crash would show.
+	void TestCorruptInput()
+	{
+		std::mt19937 rng(2);
+		for (int test = 0; test < 2000; ++test)
+		{
+			const size_t size = rng() % 5000;
+			const std::vector<uint8_t> data = MakeData(rng, test % 4, size);
+			std::vector<uint8_t> packed;
+			LzCompress(data.data(), data.size(), packed);
+			std::vector<uint8_t> unpacked(size);
+
+			if (size > 0)
+			{
+				CHECK(!LzDecompress(packed.data(), packed.size(), unpacked.data(), size - 1));
+				std::vector<uint8_t> larger(size + 1);
+				CHECK(!LzDecompress(packed.data(), packed.size(), larger.data(), larger.size()));
+			}
+
+			if (!packed.empty())
+			{
+				std::vector<uint8_t> flipped = packed;
+				flipped[rng() % flipped.size()] ^= (uint8_t)(1 << (rng() % 8));
+				LzDecompress(flipped.data(), flipped.size(), unpacked.data(), unpacked.size());
+				CHECK(!LzDecompress(packed.data(), rng() % packed.size(), unpacked.data(), unpacked.size()) || size == 0);
+			}
+
+			std::vector<uint8_t> garbage(rng() % 200);
+			for (uint8_t& b : garbage)
+			{
+				b = (uint8_t)rng();
+			}
+			LzDecompress(garbage.data(), garbage.size(), unpacked.data(), unpacked.size());
+		}
+	}
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestCorruptInput();
+	return TestExitCode();
+}
@@ -0,0 +1,269 @@
+#include "MipChain.h"
+#include "DdsImage.h"
+#include "TestCheck.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace
+{
+	// Averages of two 8-bit sRGB texels, by way of linear light.
+	float SrgbToLinear(float s)
+	{
+		return s <= 0.04045f ? s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSrgb(float l)
+	{
+		return l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+	}
+
+	// A 2x1 image filters to one texel: the average of the two in linear light.
+	void TestSrgb()
+	{
+		MipChain chain;
+		for (int a = 0; a < 256; ++a)
+		{
+			for (int b = a; b < 256; b += 5)
+			{
+				const uint8_t pixels[8] = { (uint8_t)a, 0, 0, 255, (uint8_t)b, 0, 0, 255 };
+				CHECK(chain.Generate(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, 2, 1, pixels, 8) == MipResult::Ok);
+				const float linear = (SrgbToLinear(a / 255.0f) + SrgbToLinear(b / 255.0f)) * 0.5f;
+				CHECK(chain.LevelData(1)[0] == (int)std::floor(LinearToSrgb(linear) * 255.0f + 0.5f));
+			}
+		}
+
+		// Black and white average to mid-grey on screen, not to 128.
+		const uint8_t checker[16] = { 0, 0, 0, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0, 0, 0, 255 };
+		CHECK(chain.Generate(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, 2, 2, checker, 8) == MipResult::Ok);
+		CHECK(chain.LevelCount() == 2);
+		CHECK(chain.LevelData(1)[0] == 188);
+		CHECK(chain.LevelData(1)[3] == 255);
+
+		CHECK(chain.Generate(DXGI_FORMAT_R8G8B8A8_UNORM, 2, 2, checker, 8) == MipResult::Ok);
+		CHECK(chain.LevelData(1)[0] == 128);
+
+		MipOptions options;
+		options.TreatAsSRGB = true;
+		CHECK(chain.Generate(DXGI_FORMAT_R8G8B8A8_UNORM, 2, 2, checker, 8, options) == MipResult::Ok);
+		CHECK(chain.LevelData(1)[0] == 188);
+		CHECK(chain.Format() == DXGI_FORMAT_R8G8B8A8_UNORM);
+	}
+
+	// An odd-sized level does not halve evenly: each destination texel averages the
+	// source area it covers, with partial texels weighted by how much of them it covers.
+	void TestOddBoxFilter()
+	{
+		float row[5 * 4] = {};
+		for (int x = 0; x < 5; ++x)
+		{
+			row[x * 4] = (float)(x + 1);
+			row[x * 4 + 3] = 1.0f;
+		}
+
+		MipChain chain;
+		CHECK(chain.Generate(DXGI_FORMAT_R32G32B32A32_FLOAT, 5, 1, row, sizeof(row)) == MipResult::Ok);
+		CHECK(chain.LevelCount() == 3);
+		CHECK(chain.Level(1).Width == 2 && chain.Level(1).Height == 1);
+
+		// [0, 2.5) and [2.5, 5): (1 + 2 + 3 / 2) / 2.5 and (3 / 2 + 4 + 5) / 2.5.
+		const float* level1 = reinterpret_cast<const float*>(chain.LevelData(1));
+		CHECK(std::fabs(level1[0] - 1.8f) < 1e-5f);
+		CHECK(std::fabs(level1[4] - 4.2f) < 1e-5f);
+		CHECK(std::fabs(level1[3] - 1.0f) < 1e-6f);
+		CHECK(std::fabs(reinterpret_cast<const float*>(chain.LevelData(2))[0] - 3.0f) < 1e-5f);
+
+		// 3x3 to 1x1 is the mean of all nine.
+		float square[3 * 3 * 4] = {};
+		for (int i = 0; i < 9; ++i)
+		{
+			square[i * 4] = (float)i;
+		}
+		CHECK(chain.Generate(DXGI_FORMAT_R32G32B32A32_FLOAT, 3, 3, square, 3 * 16) == MipResult::Ok);
+		CHECK(chain.LevelCount() == 2);
+		CHECK(std::fabs(reinterpret_cast<const float*>(chain.LevelData(1))[0] - 4.0f) < 1e-5f);
+	}
+
+	// A constant image stays constant at every level, for both filters, with and
+	// without wrapping, whatever the texel format.
+	void TestConstantImages()
+	{
+		const uint32_t width = 37;
+		const uint32_t height = 11;
+		const uint16_t halfValue = 0x3800;
+		const float floatValue = 0.5f;
+
+		for (DXGI_FORMAT format : { DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R16G16B16A16_FLOAT, DXGI_FORMAT_R32G32B32A32_FLOAT })
+		{
+			const size_t channelBytes = format == DXGI_FORMAT_R8G8B8A8_UNORM ? 1 : format == DXGI_FORMAT_R16G16B16A16_FLOAT ? 2 : 4;
+			std::vector<uint8_t> pixels((size_t)width * height * 4 * channelBytes);
+			for (size_t i = 0; i < (size_t)width * height * 4; ++i)
+			{
+				if (channelBytes == 1)
+					pixels[i] = 128;
+				else if (channelBytes == 2)
+					std::memcpy(&pixels[i * 2], &halfValue, 2);
+				else
+					std::memcpy(&pixels[i * 4], &floatValue, 4);
+			}
+
+			for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+			{
+				for (bool wrap : { false, true })
+				{
+					MipOptions options;
+					options.Filter = filter;
+					options.Wrap = wrap;
+					options.ThreadCount = 4;
+
+					MipChain chain;
+					CHECK(chain.Generate(format, width, height, pixels.data(), width * 4 * channelBytes, options) == MipResult::Ok);
+					CHECK(chain.LevelCount() == MipChain::FullLevelCount(width, height));
+					CHECK(chain.Level(chain.LevelCount() - 1).Width == 1);
+
+					for (uint32_t level = 1; level < chain.LevelCount(); ++level)
+					{
+						const MipLevel& l = chain.Level(level);
+						std::vector<float> rgba((size_t)l.Width * 4);
+						for (uint32_t y = 0; y < l.Height; ++y)
+						{
+							CHECK(MipChain::DecodeLinear(format, chain.LevelData(level) + y * l.RowPitch, l.Width, rgba.data()));
+							for (float value : rgba)
+							{
+								const float expected = channelBytes == 1 ? 128.0f / 255.0f : 0.5f;
+								CHECK(std::fabs(value - expected) < 1e-5f);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	float Coverage(const MipChain& chain, uint32_t level, float reference)
+	{
+		const MipLevel& l = chain.Level(level);
+		size_t passed = 0;
+		for (size_t i = 0; i < (size_t)l.Width * l.Height; ++i)
+		{
+			if (chain.LevelData(level)[i * 4 + 3] / 255.0f > reference)
+				passed++;
+		}
+		return (float)passed / ((float)l.Width * l.Height);
+	}
+
+	// Random alpha tested at 0.7: plain filtering pulls the alpha towards its mean and
+	// the passing texels vanish within a few levels; with AlphaTestReference the
+	// fraction stays that of the top level for as long as a level has texels to spare.
+	void TestCoveragePreserved()
+	{
+		const uint32_t size = 256;
+		const float reference = 0.7f;
+		std::mt19937 rng(1);
+		std::vector<uint8_t> pixels((size_t)size * size * 4);
+		for (uint8_t& b : pixels)
+		{
+			b = (uint8_t)rng();
+		}
+
+		MipChain plain;
+		CHECK(plain.Generate(DXGI_FORMAT_R8G8B8A8_UNORM, size, size, pixels.data(), size * 4) == MipResult::Ok);
+		const float top = Coverage(plain, 0, reference);
+		CHECK(top > 0.25f && top < 0.35f);
+		CHECK(Coverage(plain, 2, reference) < 0.05f);
+
+		MipOptions options;
+		options.AlphaTestReference = reference;
+		MipChain preserved;
+		CHECK(preserved.Generate(DXGI_FORMAT_R8G8B8A8_UNORM, size, size, pixels.data(), size * 4, options) == MipResult::Ok);
+		for (uint32_t level = 1; level < preserved.LevelCount(); ++level)
+		{
+			const MipLevel& l = preserved.Level(level);
+			const size_t count = (size_t)l.Width * l.Height;
+			if (count < 64)
+				break;
+			CHECK(std::fabs(Coverage(preserved, level, reference) - top) < 0.02f + 1.0f / count);
+		}
+	}
+
+	// SaveDds and WriteDds give the same file, which DdsImage reads back level by level.
+	void TestDds()
+	{
+		std::vector<uint8_t> pixels(64 * 32 * 4);
+		for (size_t i = 0; i < pixels.size(); ++i)
+		{
+			pixels[i] = (uint8_t)(i * 7);
+		}
+
+		MipChain chain;
+		CHECK(chain.Generate(DXGI_FORMAT_B8G8R8A8_UNORM, 64, 32, pixels.data(), 64 * 4) == MipResult::Ok);
+		CHECK(chain.LevelCount() == 7);
+
+		const std::filesystem::path file = std::filesystem::temp_directory_path() / "MipChainTests.dds";
+		CHECK(chain.SaveDds(file));
+		std::ifstream in(file, std::ios::binary);
+		const std::vector<uint8_t> saved((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		in.close();
+		std::filesystem::remove(file);
+
+		std::vector<uint8_t> written;
+		CHECK(chain.WriteDds(written));
+		CHECK(written == saved);
+
+		DdsImage image;
+		CHECK(image.Parse(saved.data(), saved.size()) == DdsResult::Ok);
+		CHECK(image.Format() == DXGI_FORMAT_B8G8R8A8_UNORM);
+		CHECK(image.Width() == 64 && image.Height() == 32);
+		CHECK(image.MipCount() == chain.LevelCount());
+		CHECK(image.ArraySize() == 1);
+		CHECK(image.DataSize() == chain.DataSize());
+		for (uint32_t level = 0; level < chain.LevelCount(); ++level)
+		{
+			const DdsSubresource s = image.Subresource(level);
+			const MipLevel& l = chain.Level(level);
+			CHECK(s.Width == l.Width && s.Height == l.Height && s.RowPitch == l.RowPitch);
+			CHECK(std::memcmp(s.Data, chain.LevelData(level), l.RowPitch * l.Height) == 0);
+		}
+		CHECK(std::memcmp(chain.LevelData(0), pixels.data(), pixels.size()) == 0);
+
+		MipChain empty;
+		CHECK(!empty.WriteDds(written));
+		CHECK(written.empty());
+	}
+
+	void TestRejects()
+	{
+		const uint8_t pixels[16] = {};
+		MipChain chain;
+		CHECK(chain.Generate(DXGI_FORMAT_R8G8B8A8_UNORM, 0, 1, pixels, 16) == MipResult::InvalidArgument);
+		CHECK(chain.Generate(DXGI_FORMAT_R8G8B8A8_UNORM, 2, 2, nullptr, 8) == MipResult::InvalidArgument);
+		CHECK(chain.Generate(DXGI_FORMAT_R8G8B8A8_UNORM, 2, 2, pixels, 7) == MipResult::InvalidArgument);
+		CHECK(chain.Generate(DXGI_FORMAT_BC1_UNORM, 4, 4, pixels, 8) == MipResult::NotSupported);
+		CHECK(chain.LevelCount() == 0);
+		CHECK(!MipChain::IsSupported(DXGI_FORMAT_BC7_UNORM));
+
+		CHECK(MipChain::FullLevelCount(1, 1) == 1);
+		CHECK(MipChain::FullLevelCount(64, 32) == 7);
+		CHECK(MipChain::FullLevelCount(37, 11) == 6);
+
+		MipOptions options;
+		options.MaxLevels = 3;
+		std::vector<uint8_t> large(64 * 64 * 4, 9);
+		CHECK(chain.Generate(DXGI_FORMAT_R8G8B8A8_UNORM, 64, 64, large.data(), 64 * 4, options) == MipResult::Ok);
+		CHECK(chain.LevelCount() == 3);
+		CHECK(chain.Level(2).Width == 16);
+	}
+}
+
+int main()
+{
+	TestSrgb();
+	TestOddBoxFilter();
+	TestConstantImages();
+	TestCoveragePreserved();
+	TestDds();
+	TestRejects();
+	return TestExitCode();
+}
@@ -0,0 +1,97 @@
+#include "SlotMap.h"
+#include "TestCheck.h"
+#include <iterator>
+#include <map>
+#include <random>
+
+namespace
+{
+	using Map = SlotMap<std::string>;
+
+	void TestStaleHandles()
+	{
+		Map map;
+		const Map::Handle a = map.Insert("a", "alpha");
+		const Map::Handle b = map.Insert("b", "beta");
+		const Map::Handle c = map.Insert("gamma");
+		CHECK(map.Size() == 3);
+		CHECK(map[a] == "alpha");
+		CHECK(*map.Get(c) == "gamma");
+		CHECK(map.Find("b") == b);
+		CHECK(map.Find("gamma").IsNull());
+		CHECK(map.Get(Map::Handle()) == nullptr);
+
+		// Removing a moves the last value into its place; b and c still resolve.
+		map.Remove(a);
+		CHECK(map.Size() == 2);
+		CHECK(!map.Contains(a));
+		CHECK(map.Get(a) == nullptr);
+		CHECK(map.Find("a").IsNull());
+		CHECK(map[b] == "beta");
+		CHECK(map[c] == "gamma");
+		CHECK(*map.begin() == "gamma");
+
+		// The next insert reuses a's slot under a new generation, so the old handle
+		// stays stale and the name can be registered again.
+		const Map::Handle d = map.Insert("a", "delta");
+		CHECK(d.Slot == a.Slot);
+		CHECK(d.Generation != a.Generation);
+		CHECK(map.Get(a) == nullptr);
+		CHECK(map[d] == "delta");
+		CHECK(map.Find("a") == d);
+
+		// Removing the last value moves nothing.
+		map.Remove(d);
+		CHECK(map[b] == "beta");
+		CHECK(map[c] == "gamma");
+		CHECK(!map.Contains(d));
+	}
+
+	// Random inserts and removes, checked against a map of the live handles.
+	void TestAgainstModel()
+	{
+		Map map;
+		std::map<int, std::pair<Map::Handle, std::string>> live;
+		std::vector<Map::Handle> removed;
+		std::mt19937 rng(1);
+		int next = 0;
+
+		for (int i = 0; i < 20000; ++i)
+		{
+			if (live.empty() || rng() % 3 != 0)
+			{
+				const std::string value = "v" + std::to_string(next);
+				live[next++] = { map.Insert(value, value), value };
+			}
+			else
+			{
+				auto victim = live.begin();
+				std::advance(victim, rng() % live.size());
+				map.Remove(victim->second.first);
+				CHECK(map.Find(victim->second.second).IsNull());
+				removed.push_back(victim->second.first);
+				live.erase(victim);
+			}
+		}
+
+		CHECK(map.Size() == live.size());
+		for (const auto& entry : live)
+		{
+			CHECK(map.Contains(entry.second.first));
+			CHECK(map[entry.second.first] == entry.second.second);
+			CHECK(map.Find(entry.second.second) == entry.second.first);
+		}
+		for (const Map::Handle& h : removed)
+		{
+			CHECK(map.Get(h) == nullptr);
+		}
+		CHECK((size_t)std::distance(map.begin(), map.end()) == live.size());
+	}
+}
+
+int main()
+{
+	TestStaleHandles();
+	TestAgainstModel();
+	return TestExitCode();
+}
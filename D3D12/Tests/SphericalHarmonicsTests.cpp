@@ -0,0 +1,302 @@
+#include "SphericalHarmonics.h"
+#include "BcTexture.h"
+#include "DdsImage.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const float Pi = 3.14159265f;
+
+	// The direction through texel (u, v) of a face, u and v in [-1, 1], in D3D face order.
+	void FaceDirection(int face, float u, float v, float d[3])
+	{
+		const float axes[6][3] =
+		{
+			{ 1.0f, -v, -u }, { -1.0f, -v, u }, { u, 1.0f, v }, { u, -1.0f, -v }, { u, -v, 1.0f }, { -u, -v, -1.0f }
+		};
+		const float length = std::sqrt(1.0f + u * u + v * v);
+		for (int i = 0; i < 3; ++i)
+		{
+			d[i] = axes[face][i] / length;
+		}
+	}
+
+	// Six size x size RGBA float faces of radiance(direction, rgb).
+	struct FloatCube
+	{
+		uint32_t Size;
+		std::vector<float> Texels;
+
+		template<typename F>
+		FloatCube(uint32_t size, F radiance) : Size(size), Texels((size_t)6 * size * size * 4)
+		{
+			for (int f = 0; f < 6; ++f)
+			{
+				for (uint32_t y = 0; y < size; ++y)
+				{
+					for (uint32_t x = 0; x < size; ++x)
+					{
+						float d[3];
+						FaceDirection(f, (x + 0.5f) * 2.0f / size - 1.0f, (y + 0.5f) * 2.0f / size - 1.0f, d);
+						float* texel = &Texels[(((size_t)f * size + y) * size + x) * 4];
+						radiance(d, texel);
+						texel[3] = 1.0f;
+					}
+				}
+			}
+		}
+
+		ShResult Project(ShRgb& sh, uint32_t threadCount = 0)const
+		{
+			const void* faces[6];
+			for (int f = 0; f < 6; ++f)
+			{
+				faces[f] = &Texels[(size_t)f * Size * Size * 4];
+			}
+			ShOptions options;
+			options.ThreadCount = threadCount;
+			return ProjectCubeFaces(DXGI_FORMAT_R32G32B32A32_FLOAT, Size, faces, Size * 16, sh, options);
+		}
+	};
+
+	void TestConstant()
+	{
+		FloatCube cube(64, [](const float*, float* c) { c[0] = 1.0f; c[1] = 0.5f; c[2] = 0.25f; });
+		ShRgb sh;
+		CHECK(cube.Project(sh) == ShResult::Ok);
+		CHECK(std::fabs(sh.Coefficients[0][0] - std::sqrt(4.0f * Pi)) < 1e-4f);
+		for (uint32_t k = 1; k < ShRgb::MaxCoefficients; ++k)
+		{
+			CHECK(std::fabs(sh.Coefficients[k][0]) < 1e-4f);
+		}
+
+		// A uniform sky lights every normal with its own radiance.
+		float rgb[3];
+		ShEvaluate(ShDiffuse(sh), 0.0f, 1.0f, 0.0f, rgb);
+		CHECK(std::fabs(rgb[0] - 1.0f) < 1e-4f);
+		CHECK(std::fabs(rgb[1] - 0.5f) < 1e-4f);
+		CHECK(std::fabs(rgb[2] - 0.25f) < 1e-4f);
+	}
+
+	// Polynomials of degree 2 lie in the span of the first 9 functions, so they come back.
+	void TestPolynomial()
+	{
+		auto radiance = [](const float* d, float* c)
+		{
+			c[0] = 1.0f + 0.5f * d[0] + 0.3f * d[0] * d[1] - 0.2f * (3.0f * d[2] * d[2] - 1.0f);
+			c[1] = 0.7f * d[1];
+			c[2] = d[2] * d[2];
+		};
+		FloatCube cube(64, radiance);
+		ShRgb sh;
+		CHECK(cube.Project(sh) == ShResult::Ok);
+
+		float maxError = 0.0f;
+		for (int i = 0; i < 200; ++i)
+		{
+			const float phi = i * 0.37f;
+			const float theta = std::acos(1.0f - 2.0f * (i * 0.618f - std::floor(i * 0.618f)));
+			const float d[3] = { std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta) };
+			float expected[3], rgb[3];
+			radiance(d, expected);
+			ShEvaluate(sh, d[0], d[1], d[2], rgb);
+			for (int c = 0; c < 3; ++c)
+			{
+				maxError = std::max(maxError, std::fabs(expected[c] - rgb[c]));
+			}
+		}
+		CHECK(maxError < 1e-3f);
+
+		// Rows sum on their own and in order, so threads do not change the result.
+		ShRgb one, seven;
+		cube.Project(one, 1);
+		cube.Project(seven, 7);
+		CHECK(std::memcmp(&one, &seven, sizeof(ShRgb)) == 0);
+	}
+
+	// Lighting one face at a time moves the linear band towards that axis.
+	void TestFaceOrder()
+	{
+		// Coefficients 1, 2 and 3 follow y, z and x.
+		const int axis[6] = { 3, 3, 1, 1, 2, 2 };
+		for (int face = 0; face < 6; ++face)
+		{
+			FloatCube cube(32, [](const float*, float* c) { c[0] = c[1] = c[2] = 0.0f; });
+			for (size_t i = 0; i < (size_t)32 * 32; ++i)
+			{
+				cube.Texels[((size_t)face * 32 * 32 + i) * 4] = 1.0f;
+			}
+			ShRgb sh;
+			CHECK(cube.Project(sh) == ShResult::Ok);
+			for (int k = 1; k <= 3; ++k)
+			{
+				const float expected = k != axis[face] ? 0.0f : (face % 2 == 0 ? 0.851f : -0.851f);
+				CHECK(std::fabs(sh.Coefficients[k][0] - expected) < 1e-3f);
+			}
+		}
+	}
+
+	// A bright upper and dark lower hemisphere, checked against the cosine-weighted
+	// sum over the texels.
+	void TestIrradiance()
+	{
+		const uint32_t size = 64;
+		auto sky = [](const float* d, float* c) { c[0] = c[1] = c[2] = d[1] > 0.0f ? 1.0f : 0.1f; };
+		FloatCube cube(size, sky);
+		ShRgb sh;
+		CHECK(cube.Project(sh) == ShResult::Ok);
+		const ShRgb diffuse = ShDiffuse(sh);
+
+		const float normals[3][3] = { { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f } };
+		for (const float* n : normals)
+		{
+			double irradiance = 0.0;
+			for (int f = 0; f < 6; ++f)
+			{
+				for (uint32_t y = 0; y < size; ++y)
+				{
+					for (uint32_t x = 0; x < size; ++x)
+					{
+						const float u = (x + 0.5f) * 2.0f / size - 1.0f;
+						const float v = (y + 0.5f) * 2.0f / size - 1.0f;
+						float d[3], c[3];
+						FaceDirection(f, u, v, d);
+						sky(d, c);
+						const float solidAngle = 4.0f / (size * size) / std::pow(1.0f + u * u + v * v, 1.5f);
+						irradiance += c[0] * std::max(0.0f, d[0] * n[0] + d[1] * n[1] + d[2] * n[2]) * solidAngle;
+					}
+				}
+			}
+
+			// The step is not band limited, so the SH is off by its ringing.
+			float rgb[3];
+			ShEvaluate(diffuse, n[0], n[1], n[2], rgb);
+			CHECK(std::fabs(rgb[0] - irradiance / Pi) < 5e-3);
+		}
+	}
+
+	// A DDS cube map of one colour in format, made of six copies of a face.
+	std::vector<uint8_t> MakeCubeDds(DXGI_FORMAT format, uint32_t size, const uint8_t* face, size_t faceBytes)
+	{
+		std::vector<uint8_t> file(DdsImage::HeaderSize + faceBytes * 6);
+		CHECK(DdsImage::WriteHeader(file.data(), format, size, size, 1, 1));
+		DDS_HEADER_DXT10 dx10;
+		const size_t dx10Offset = DdsImage::HeaderSize - sizeof(DDS_HEADER_DXT10);
+		std::memcpy(&dx10, file.data() + dx10Offset, sizeof(dx10));
+		dx10.miscFlag |= DDS_RESOURCE_MISC_TEXTURECUBE;
+		std::memcpy(file.data() + dx10Offset, &dx10, sizeof(dx10));
+		for (int f = 0; f < 6; ++f)
+		{
+			std::memcpy(file.data() + DdsImage::HeaderSize + f * faceBytes, face, faceBytes);
+		}
+		return file;
+	}
+
+	// Block compressed skies, such as a BC7 cube, project through BcTexture.
+	void TestBlockCompressed()
+	{
+		const uint32_t size = 32;
+		std::vector<uint8_t> texels((size_t)size * size * 4);
+		for (size_t i = 0; i < texels.size(); i += 4)
+		{
+			texels[i + 0] = 255;
+			texels[i + 1] = 128;
+			texels[i + 2] = 0;
+			texels[i + 3] = 255;
+		}
+
+		for (DXGI_FORMAT format : { DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC7_UNORM })
+		{
+			BcTexture face;
+			CHECK(face.Compress(format, DXGI_FORMAT_R8G8B8A8_UNORM, size, size, texels.data(), size * 4) == BcResult::Ok);
+			std::vector<uint8_t> file = MakeCubeDds(format, size, face.Data(), face.DataSize());
+
+			DdsImage cube;
+			CHECK(cube.Parse(file.data(), file.size()) == DdsResult::Ok);
+			CHECK(cube.IsCubeMap());
+
+			ShRgb sh;
+			CHECK(ProjectCubeMap(cube, sh) == ShResult::Ok);
+			const float dc = std::sqrt(4.0f * Pi);
+			// Give or take the endpoint rounding of either format.
+			CHECK(std::fabs(sh.Coefficients[0][0] / dc - 1.0f) < 0.01f);
+			CHECK(std::fabs(sh.Coefficients[0][1] / dc - 0.5f) < 0.02f);
+			CHECK(std::fabs(sh.Coefficients[0][2] / dc) < 0.01f);
+		}
+
+		// A 2-subset BC7 block: mode 1, partition 13, the top half black and the bottom
+		// half white, as encoders other than BcTexture write them.
+		uint8_t block[16] = {};
+		int position = 0;
+		auto put = [&](uint32_t value, int bits)
+		{
+			for (int i = 0; i < bits; ++i, ++position)
+			{
+				block[position >> 3] |= (uint8_t)(((value >> i) & 1) << (position & 7));
+			}
+		};
+		put(2, 2);
+		put(13, 6);
+		for (int c = 0; c < 3; ++c)
+		{
+			put(0, 6);
+			put(0, 6);
+			put(63, 6);
+			put(63, 6);
+		}
+		// Shared p-bits: subset 1's endpoints expand to 255.  Every index is 0.
+		put(0, 1);
+		put(1, 1);
+		std::vector<uint8_t> face((size_t)(size / 4) * (size / 4) * 16);
+		for (size_t i = 0; i < face.size(); i += 16)
+		{
+			std::memcpy(face.data() + i, block, 16);
+		}
+		std::vector<uint8_t> file = MakeCubeDds(DXGI_FORMAT_BC7_UNORM, size, face.data(), face.size());
+		DdsImage cube;
+		CHECK(cube.Parse(file.data(), file.size()) == DdsResult::Ok);
+		ShRgb sh;
+		CHECK(ProjectCubeMap(cube, sh) == ShResult::Ok);
+		CHECK(std::fabs(sh.Coefficients[0][0] / std::sqrt(4.0f * Pi) - 0.5f) < 1e-3f);
+	}
+
+	void TestRejects()
+	{
+		std::vector<uint8_t> texels((size_t)8 * 8 * 8);
+		const void* faces[6] = { texels.data(), texels.data(), texels.data(), texels.data(), texels.data(), texels.data() };
+		ShRgb sh;
+
+		CHECK(ProjectCubeFaces(DXGI_FORMAT_R8G8B8A8_UNORM, 8, faces, 32, sh) == ShResult::Ok);
+		CHECK(ProjectCubeFaces(DXGI_FORMAT_R8G8B8A8_UNORM, 8, faces, 31, sh) == ShResult::InvalidArgument);
+		CHECK(ProjectCubeFaces(DXGI_FORMAT_R8G8B8A8_UNORM, 0, faces, 32, sh) == ShResult::InvalidArgument);
+
+		ShOptions order4;
+		order4.Order = 4;
+		CHECK(ProjectCubeFaces(DXGI_FORMAT_R8G8B8A8_UNORM, 8, faces, 32, sh, order4) == ShResult::InvalidArgument);
+
+		// Neither MipChain nor BcTexture decodes BC6H.
+		CHECK(ProjectCubeFaces(DXGI_FORMAT_BC6H_UF16, 8, faces, 32, sh) == ShResult::NotSupported);
+
+		// Six slices that are not a cube.
+		std::vector<uint8_t> file(DdsImage::HeaderSize + texels.size() / 2 * 6);
+		CHECK(DdsImage::WriteHeader(file.data(), DXGI_FORMAT_R8G8B8A8_UNORM, 8, 8, 1, 6));
+		DdsImage array;
+		CHECK(array.Parse(file.data(), file.size()) == DdsResult::Ok);
+		CHECK(ProjectCubeMap(array, sh) == ShResult::InvalidArgument);
+	}
+}
+
+int main()
+{
+	TestConstant();
+	TestPolynomial();
+	TestFaceOrder();
+	TestIrradiance();
+	TestBlockCompressed();
+	TestRejects();
+	return TestExitCode();
+}
@@ -0,0 +1,139 @@
+#include "TaskGraph.h"
+#include "TestCheck.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+	void TestSequentialOrder()
+	{
+		TaskGraph graph;
+		std::vector<int> order;
+		const TaskGraph::TaskId a = graph.Add("a", [&] { order.push_back(0); });
+		graph.AddMainThread("b", [&] { order.push_back(1); }, { a });
+		graph.Add("c", [&] { order.push_back(2); });
+		graph.Add("d", [&] { order.push_back(3); }, { a });
+
+		// One thread runs the tasks in the order they were added.
+		graph.Run(1);
+		CHECK((order == std::vector<int>{ 0, 1, 2, 3 }));
+		CHECK(graph.TaskCount() == 4);
+		CHECK(graph.Name(a) == "a");
+	}
+
+	// Random graphs on 1 to 6 threads: every task runs once, after all of its
+	// dependencies, and main-thread tasks run on the thread calling Run.
+	void TestRandomGraphs()
+	{
+		std::mt19937 rng(1);
+		for (int graphIndex = 0; graphIndex < 200; ++graphIndex)
+		{
+			const int taskCount = 50;
+			TaskGraph graph;
+			std::unique_ptr<std::atomic<int>[]> runs(new std::atomic<int>[taskCount]);
+			std::atomic<int> violations{ 0 };
+			const std::thread::id caller = std::this_thread::get_id();
+
+			for (int i = 0; i < taskCount; ++i)
+			{
+				runs[i] = 0;
+				std::vector<TaskGraph::TaskId> dependencies;
+				for (int k = 0; i > 0 && k < (int)(rng() % 4); ++k)
+				{
+					dependencies.push_back(rng() % i);
+				}
+
+				const bool mainThread = rng() % 5 == 0;
+				auto work = [&, i, dependencies, mainThread]
+				{
+					for (TaskGraph::TaskId dependency : dependencies)
+					{
+						if (runs[dependency] != 1)
+							violations++;
+					}
+					if (mainThread && std::this_thread::get_id() != caller)
+						violations++;
+					runs[i]++;
+				};
+				const TaskGraph::TaskId id = mainThread ?
+					graph.AddMainThread("main", work, dependencies) : graph.Add("any", work, dependencies);
+				CHECK(id == (TaskGraph::TaskId)i);
+			}
+
+			graph.Run(graphIndex % 6 + 1);
+			CHECK(violations == 0);
+			for (int i = 0; i < taskCount; ++i)
+			{
+				CHECK(runs[i] == 1);
+			}
+		}
+	}
+
+	// Two chains of two 20 ms tasks: 80 ms of work, 40 ms along the longest chain.
+	void TestStats()
+	{
+		TaskGraph graph;
+		auto sleep = [] { std::this_thread::sleep_for(std::chrono::milliseconds(20)); };
+		const TaskGraph::TaskId a = graph.Add("a", sleep);
+		const TaskGraph::TaskId b = graph.Add("b", sleep);
+		const TaskGraph::TaskId c = graph.AddMainThread("c", sleep, { a });
+		const TaskGraph::TaskId d = graph.Add("d", sleep, { b });
+		graph.Run(2);
+
+		const TaskGraphStats stats = graph.GetStats();
+		CHECK(stats.SerialMilliseconds >= 80.0);
+		CHECK(stats.CriticalPathMilliseconds >= 40.0);
+		CHECK(stats.CriticalPathMilliseconds < stats.SerialMilliseconds);
+		CHECK(stats.WallMilliseconds >= stats.CriticalPathMilliseconds);
+		CHECK(graph.DurationMilliseconds(c) >= 20.0);
+		CHECK(graph.StartMilliseconds(c) >= graph.StartMilliseconds(a) + graph.DurationMilliseconds(a));
+		CHECK(graph.StartMilliseconds(d) >= graph.StartMilliseconds(b) + graph.DurationMilliseconds(b));
+	}
+
+	void TestException()
+	{
+		for (uint32_t threads : { 1u, 4u })
+		{
+			TaskGraph graph;
+			std::atomic<int> dependentRuns{ 0 };
+			const TaskGraph::TaskId failing = graph.Add("failing", [] { throw std::runtime_error("failed"); });
+			const TaskGraph::TaskId dependent = graph.Add("dependent", [&] { dependentRuns++; }, { failing });
+			graph.AddMainThread("main", [&] { dependentRuns++; }, { dependent });
+
+			bool caught = false;
+			try
+			{
+				graph.Run(threads);
+			}
+			catch (const std::runtime_error& e)
+			{
+				caught = std::string(e.what()) == "failed";
+			}
+			CHECK(caught);
+			CHECK(dependentRuns == 0);
+		}
+	}
+
+	void TestEmpty()
+	{
+		TaskGraph graph;
+		graph.Run();
+		CHECK(graph.TaskCount() == 0);
+		CHECK(graph.GetStats().SerialMilliseconds == 0.0);
+	}
+}
+
+int main()
+{
+	TestSequentialOrder();
+	TestRandomGraphs();
+	TestStats();
+	TestException();
+	TestEmpty();
+	return TestExitCode();
+}
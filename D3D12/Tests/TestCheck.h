@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdio>
+
+// Just enough of a test framework for the host tests: CHECK reports a failed
+// condition and carries on, and main returns TestExitCode() so ctest sees it.
+inline int& TestFailureCount()
+{
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			TestFailureCount()++; \
+		} \
+	} while (false)
+
+inline int TestExitCode()
+{
+	if (TestFailureCount() != 0)
+	{
+		std::printf("%d check(s) failed\n", TestFailureCount());
+		return 1;
+	}
+	return 0;
+}
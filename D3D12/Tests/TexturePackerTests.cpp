@@ -0,0 +1,396 @@
+#include "TexturePacker.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct TestImage
+	{
+		std::vector<uint8_t> File;
+		DdsImage Image;
+	};
+
+	// Images built in memory with random texels, so every texel (or block) of a
+	// copy can be traced back to exactly one source element.
+	class TestImages
+	{
+	public:
+		const DdsImage* Add(DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t mipCount,
+			uint32_t arraySize = 1)
+		{
+			size_t sliceSize = 0;
+			for (uint32_t m = 0; m < mipCount; ++m)
+			{
+				size_t numBytes = 0;
+				DdsImage::GetSurfaceInfo(std::max(1u, width >> m), std::max(1u, height >> m), format,
+					&numBytes, nullptr, nullptr);
+				sliceSize += numBytes;
+			}
+
+			TestImage& t = images.emplace_back();
+			t.File.resize(DdsImage::HeaderSize + sliceSize * arraySize);
+			CHECK(DdsImage::WriteHeader(t.File.data(), format, width, height, mipCount, arraySize));
+			for (size_t i = DdsImage::HeaderSize; i < t.File.size(); ++i)
+			{
+				t.File[i] = (uint8_t)random();
+			}
+			CHECK(t.Image.Parse(t.File.data(), t.File.size()) == DdsResult::Ok);
+			return &t.Image;
+		}
+
+	private:
+		std::deque<TestImage> images;
+		std::mt19937 random{ 47 };
+	};
+
+	bool SameBytes(const DdsSubresource& a, const DdsSubresource& b)
+	{
+		return a.SlicePitch == b.SlicePitch && std::memcmp(a.Data, b.Data, a.SlicePitch) == 0;
+	}
+
+	int Wrap(int i, int n)
+	{
+		return ((i % n) + n) % n;
+	}
+
+	// Groups by format, size and mip count, in order of each group's first image,
+	// with slices in image order.
+	void TestArrayGrouping()
+	{
+		TestImages t;
+		std::vector<const DdsImage*> images =
+		{
+			t.Add(DXGI_FORMAT_R8G8B8A8_UNORM, 8, 8, 3),
+			t.Add(DXGI_FORMAT_BC1_UNORM, 16, 16, 5),
+			t.Add(DXGI_FORMAT_R8G8B8A8_UNORM, 8, 8, 3),
+			t.Add(DXGI_FORMAT_R8G8B8A8_UNORM, 8, 8, 1),
+			t.Add(DXGI_FORMAT_BC1_UNORM, 16, 16, 5),
+			t.Add(DXGI_FORMAT_R8G8B8A8_UNORM, 16, 8, 3),
+			t.Add(DXGI_FORMAT_B8G8R8A8_UNORM, 8, 8, 3),
+			t.Add(DXGI_FORMAT_R8G8B8A8_UNORM, 8, 8, 3),
+		};
+
+		TextureArrayPacker packer;
+		CHECK(packer.Pack(images) == PackResult::Ok);
+		CHECK(packer.ArrayCount() == 5);
+
+		const std::vector<std::vector<uint32_t>> members = { { 0, 2, 7 }, { 1, 4 }, { 3 }, { 5 }, { 6 } };
+		for (uint32_t a = 0; a < packer.ArrayCount() && a < members.size(); ++a)
+		{
+			const TextureArray& array = packer.Array(a);
+			CHECK(array.Members == members[a]);
+
+			const DdsImage* first = images[array.Members[0]];
+			CHECK(array.Format == first->Format());
+			CHECK(array.Width == first->Width());
+			CHECK(array.Height == first->Height());
+			CHECK(array.MipCount == first->MipCount());
+
+			for (uint32_t s = 0; s < (uint32_t)array.Members.size(); ++s)
+			{
+				ArraySlice location = packer.Location(array.Members[s]);
+				CHECK(location.Array == a);
+				CHECK(location.Slice == s);
+			}
+		}
+
+		// The same images pack to the same files.
+		TextureArrayPacker again;
+		CHECK(again.Pack(images) == PackResult::Ok);
+		CHECK(again.ArrayCount() == packer.ArrayCount());
+		for (uint32_t a = 0; a < packer.ArrayCount() && a < again.ArrayCount(); ++a)
+		{
+			CHECK(again.Array(a).File == packer.Array(a).File);
+		}
+	}
+
+	// Every mip of every slice of the packed DDS matches the image it came from.
+	void TestArraySlices()
+	{
+		TestImages t;
+		std::vector<const DdsImage*> images =
+		{
+			t.Add(DXGI_FORMAT_BC3_UNORM, 32, 16, 6),
+			t.Add(DXGI_FORMAT_R8G8B8A8_UNORM, 12, 20, 5),
+			t.Add(DXGI_FORMAT_BC3_UNORM, 32, 16, 6),
+			t.Add(DXGI_FORMAT_R8G8B8A8_UNORM, 12, 20, 5),
+			t.Add(DXGI_FORMAT_BC3_UNORM, 32, 16, 6),
+		};
+
+		TextureArrayPacker packer;
+		CHECK(packer.Pack(images) == PackResult::Ok);
+		CHECK(packer.ArrayCount() == 2);
+
+		for (uint32_t a = 0; a < packer.ArrayCount(); ++a)
+		{
+			const TextureArray& array = packer.Array(a);
+			DdsImage packed;
+			CHECK(packed.Parse(array.File.data(), array.File.size()) == DdsResult::Ok);
+			CHECK(packed.Format() == array.Format);
+			CHECK(packed.Width() == array.Width);
+			CHECK(packed.Height() == array.Height);
+			CHECK(packed.MipCount() == array.MipCount);
+			CHECK(packed.ArraySize() == array.Members.size());
+			CHECK(!packed.IsCubeMap());
+
+			for (uint32_t s = 0; s < packed.ArraySize(); ++s)
+			{
+				for (uint32_t m = 0; m < packed.MipCount(); ++m)
+				{
+					CHECK(SameBytes(packed.Subresource(m, s), images[array.Members[s]]->Subresource(m, 0)));
+				}
+			}
+		}
+
+		std::vector<uint8_t> file = packer.TakeFile(0);
+		CHECK(!file.empty());
+		CHECK(packer.Array(0).File.empty());
+	}
+
+	// Checks every texel of an uncompressed atlas: each region holds its image at
+	// every level, surrounded by a border of clamped or wrapped edge texels.
+	void CheckTexels(const TextureAtlas& atlas, const std::vector<const DdsImage*>& images, bool wrap,
+		uint32_t gutter)
+	{
+		DdsImage packed;
+		CHECK(packed.Parse(atlas.File().data(), atlas.File().size()) == DdsResult::Ok);
+		CHECK(packed.MipCount() == atlas.MipCount());
+
+		for (uint32_t m = 0; m < atlas.MipCount(); ++m)
+		{
+			DdsSubresource level = packed.Subresource(m, 0);
+			const int border = (int)(gutter >> m);
+
+			for (uint32_t i = 0; i < (uint32_t)images.size(); ++i)
+			{
+				const AtlasRegion& r = atlas.Region(i);
+				DdsSubresource s = images[i]->Subresource(m, 0);
+				const int w = (int)s.Width;
+				const int h = (int)s.Height;
+				CHECK(s.Width == r.Width >> m && s.Height == r.Height >> m);
+				CHECK(((r.X >> m) << m) == r.X && ((r.Y >> m) << m) == r.Y);
+
+				int mismatches = 0;
+				for (int y = -border; y < h + border; ++y)
+				{
+					int sy = wrap ? Wrap(y, h) : std::clamp(y, 0, h - 1);
+					for (int x = -border; x < w + border; ++x)
+					{
+						int sx = wrap ? Wrap(x, w) : std::clamp(x, 0, w - 1);
+						const uint8_t* expected = s.Data + sy * s.RowPitch + sx * 4;
+						const uint8_t* actual = level.Data + ((r.Y >> m) + y) * level.RowPitch + ((r.X >> m) + x) * 4;
+						mismatches += std::memcmp(expected, actual, 4) != 0;
+					}
+				}
+				CHECK(mismatches == 0);
+			}
+		}
+	}
+
+	// Regions and their borders lie inside the atlas and do not overlap.
+	void CheckRegions(const TextureAtlas& atlas, uint32_t gutter)
+	{
+		for (uint32_t i = 0; i < atlas.RegionCount(); ++i)
+		{
+			const AtlasRegion& a = atlas.Region(i);
+			CHECK(a.X >= gutter && a.Y >= gutter);
+			CHECK(a.X + a.Width + gutter <= atlas.Width());
+			CHECK(a.Y + a.Height + gutter <= atlas.Height());
+
+			CHECK(a.ScaleU == (float)a.Width / atlas.Width());
+			CHECK(a.ScaleV == (float)a.Height / atlas.Height());
+			CHECK(a.OffsetU == (float)a.X / atlas.Width());
+			CHECK(a.OffsetV == (float)a.Y / atlas.Height());
+
+			for (uint32_t j = i + 1; j < atlas.RegionCount(); ++j)
+			{
+				const AtlasRegion& b = atlas.Region(j);
+				bool apart = a.X + a.Width + gutter <= b.X - gutter || b.X + b.Width + gutter <= a.X - gutter ||
+					a.Y + a.Height + gutter <= b.Y - gutter || b.Y + b.Height + gutter <= a.Y - gutter;
+				CHECK(apart);
+			}
+		}
+	}
+
+	// A 6 texel gutter rounds up to 8, which stays at least a texel wide for four
+	// levels; the borders repeat or wrap the edges at each of them.
+	void TestAtlasGutters()
+	{
+		TestImages t;
+		std::vector<const DdsImage*> images =
+		{
+			t.Add(DXGI_FORMAT_R8G8B8A8_UNORM, 64, 32, 7),
+			t.Add(DXGI_FORMAT_R8G8B8A8_UNORM, 48, 80, 7),
+			t.Add(DXGI_FORMAT_R8G8B8A8_UNORM, 16, 16, 5),
+		};
+
+		for (bool wrap : { false, true })
+		{
+			AtlasOptions options;
+			options.Gutter = 6;
+			options.Wrap = wrap;
+
+			TextureAtlas atlas;
+			CHECK(atlas.Build(images, options) == PackResult::Ok);
+			CHECK(atlas.Format() == DXGI_FORMAT_R8G8B8A8_UNORM);
+			CHECK(atlas.MipCount() == 4);
+			CHECK(atlas.RegionCount() == 3);
+			CheckRegions(atlas, 8);
+			CheckTexels(atlas, images, wrap, 8);
+
+			options.MaxLevels = 2;
+			CHECK(atlas.Build(images, options) == PackResult::Ok);
+			CHECK(atlas.MipCount() == 2);
+			CheckTexels(atlas, images, wrap, 8);
+		}
+
+		// 24 halves exactly down to 3 texels, so all four levels stay; 12 halves
+		// exactly only twice, so the atlas drops to three.
+		images.push_back(t.Add(DXGI_FORMAT_R8G8B8A8_UNORM, 24, 8, 4));
+		TextureAtlas atlas;
+		CHECK(atlas.Build(images) == PackResult::Ok);
+		CHECK(atlas.MipCount() == 4);
+		images.back() = t.Add(DXGI_FORMAT_R8G8B8A8_UNORM, 12, 8, 4);
+		CHECK(atlas.Build(images) == PackResult::Ok);
+		CHECK(atlas.MipCount() == 3);
+		CheckTexels(atlas, images, false, 8);
+	}
+
+	// Block-compressed images are copied whole blocks at a time, borders included,
+	// and regions sit on a grid that keeps them block-aligned at every level.
+	void TestAtlasBlockCompressed()
+	{
+		TestImages t;
+		std::vector<const DdsImage*> images =
+		{
+			t.Add(DXGI_FORMAT_BC1_UNORM, 32, 16, 6),
+			t.Add(DXGI_FORMAT_BC1_UNORM, 64, 32, 7),
+			t.Add(DXGI_FORMAT_BC1_UNORM, 16, 48, 5),
+		};
+		const size_t blockBytes = 8;
+
+		for (bool wrap : { false, true })
+		{
+			// 16 texels of gutter is at least a block wide for three levels.
+			AtlasOptions options;
+			options.Gutter = 16;
+			options.Wrap = wrap;
+
+			TextureAtlas atlas;
+			CHECK(atlas.Build(images, options) == PackResult::Ok);
+			CHECK(atlas.MipCount() == 3);
+			CheckRegions(atlas, 16);
+
+			DdsImage packed;
+			CHECK(packed.Parse(atlas.File().data(), atlas.File().size()) == DdsResult::Ok);
+			CHECK(packed.Format() == DXGI_FORMAT_BC1_UNORM);
+
+			for (uint32_t m = 0; m < atlas.MipCount(); ++m)
+			{
+				DdsSubresource level = packed.Subresource(m, 0);
+				const int border = (int)((16 >> m) / 4);
+
+				for (uint32_t i = 0; i < (uint32_t)images.size(); ++i)
+				{
+					const AtlasRegion& r = atlas.Region(i);
+					CHECK((r.X >> m) % 4 == 0 && (r.Y >> m) % 4 == 0);
+					CHECK(r.X % 16 == 0 && r.Y % 16 == 0);
+
+					DdsSubresource s = images[i]->Subresource(m, 0);
+					CHECK(s.Width == r.Width >> m && s.Height == r.Height >> m);
+					const int w = (int)(s.Width / 4);
+					const int h = (int)(s.Height / 4);
+					const int left = (int)((r.X >> m) / 4);
+					const int top = (int)((r.Y >> m) / 4);
+
+					int mismatches = 0;
+					for (int y = -border; y < h + border; ++y)
+					{
+						int sy = wrap ? Wrap(y, h) : std::clamp(y, 0, h - 1);
+						for (int x = -border; x < w + border; ++x)
+						{
+							int sx = wrap ? Wrap(x, w) : std::clamp(x, 0, w - 1);
+							const uint8_t* expected = s.Data + sy * s.RowPitch + sx * blockBytes;
+							const uint8_t* actual = level.Data + (top + y) * level.RowPitch + (left + x) * blockBytes;
+							mismatches += std::memcmp(expected, actual, blockBytes) != 0;
+						}
+					}
+					CHECK(mismatches == 0);
+				}
+			}
+		}
+
+		// 20 blocks are 5 wide at the top and do not halve into whole blocks, so
+		// only the top level is kept.
+		images.push_back(t.Add(DXGI_FORMAT_BC1_UNORM, 20, 12, 3));
+		AtlasOptions options;
+		options.Gutter = 16;
+		TextureAtlas atlas;
+		CHECK(atlas.Build(images, options) == PackResult::Ok);
+		CHECK(atlas.MipCount() == 1);
+
+		// A gutter narrower than a block still gets one whole block.
+		images.pop_back();
+		options.Gutter = 1;
+		CHECK(atlas.Build(images, options) == PackResult::Ok);
+		CHECK(atlas.MipCount() == 1);
+		CheckRegions(atlas, 4);
+	}
+
+	void TestRejects()
+	{
+		TestImages t;
+		const DdsImage* rgba = t.Add(DXGI_FORMAT_R8G8B8A8_UNORM, 16, 16, 5);
+		const DdsImage* array = t.Add(DXGI_FORMAT_R8G8B8A8_UNORM, 16, 16, 5, 3);
+		const DdsImage* bc1 = t.Add(DXGI_FORMAT_BC1_UNORM, 16, 16, 5);
+		const DdsImage* oddBc1 = t.Add(DXGI_FORMAT_BC1_UNORM, 6, 8, 1);
+		const DdsImage* packedFormat = t.Add(DXGI_FORMAT_R8G8_B8G8_UNORM, 16, 16, 1);
+		const DdsImage* large = t.Add(DXGI_FORMAT_R8G8B8A8_UNORM, 64, 64, 1);
+
+		TextureArrayPacker packer;
+		CHECK(packer.Pack({}) == PackResult::InvalidArgument);
+		CHECK(packer.Pack({ rgba, nullptr }) == PackResult::InvalidArgument);
+		CHECK(packer.ArrayCount() == 0);
+		CHECK(packer.Pack({ rgba, array }) == PackResult::InvalidArgument);
+		CHECK(packer.ArrayCount() == 0);
+
+		TextureAtlas atlas;
+		CHECK(atlas.Build({}) == PackResult::InvalidArgument);
+		CHECK(atlas.Build({ rgba, nullptr }) == PackResult::InvalidArgument);
+		CHECK(atlas.Build({ array }) == PackResult::InvalidArgument);
+		AtlasOptions noSize;
+		noSize.MaxSize = 0;
+		CHECK(atlas.Build({ rgba }, noSize) == PackResult::InvalidArgument);
+
+		CHECK(atlas.Build({ rgba, bc1 }) == PackResult::NotSupported);
+		CHECK(atlas.Build({ oddBc1 }) == PackResult::NotSupported);
+		CHECK(atlas.Build({ packedFormat }) == PackResult::NotSupported);
+		CHECK(!TextureAtlas::IsSupported(DXGI_FORMAT_R8G8_B8G8_UNORM));
+		CHECK(TextureAtlas::IsSupported(DXGI_FORMAT_BC7_UNORM));
+		CHECK(TextureAtlas::IsSupported(DXGI_FORMAT_R16G16B16A16_FLOAT));
+
+		// 64 texels and two 8 texel gutters do not fit in 64, but do in 80.
+		AtlasOptions small;
+		small.MaxSize = 64;
+		CHECK(atlas.Build({ large }, small) == PackResult::TooLarge);
+		CHECK(atlas.RegionCount() == 0);
+		CHECK(atlas.File().empty());
+		small.MaxSize = 80;
+		CHECK(atlas.Build({ large }, small) == PackResult::Ok);
+		CHECK(atlas.Width() == 80 && atlas.Height() == 80);
+	}
+}
+
+int main()
+{
+	TestArrayGrouping();
+	TestArraySlices();
+	TestAtlasGutters();
+	TestAtlasBlockCompressed();
+	TestRejects();
+	return TestExitCode();
+}
@@ -0,0 +1,122 @@
+#include "TlsfAllocator.h"
+#include "TestCheck.h"
+#include <iterator>
+#include <map>
+#include <random>
+
+namespace
+{
+	void TestMerge()
+	{
+		TlsfAllocator allocator(4096, 256);
+
+		const uint64_t a = allocator.Allocate(1000);
+		const uint64_t b = allocator.Allocate(256);
+		const uint64_t c = allocator.Allocate(512);
+		CHECK(a == 0);
+		CHECK(allocator.AllocationSize(a) == 1024);
+		CHECK(b == 1024);
+		CHECK(c == 1280);
+		CHECK(allocator.AllocationCount() == 3);
+
+		// Nothing left that fits 4 KB.
+		CHECK(allocator.Allocate(4096) == TlsfAllocator::InvalidOffset);
+
+		// b's hole sits between two allocations: two free blocks.
+		allocator.Free(b);
+		TlsfAllocator::Stats stats = allocator.GetStats();
+		CHECK(stats.FreeBlockCount == 2);
+		CHECK(stats.FreeBytes == 4096 - 1024 - 512);
+		CHECK(stats.LargestFreeBlock == 4096 - 1792);
+		CHECK(stats.Fragmentation() > 0.0f);
+
+		// Freeing a merges it with b's hole; freeing c merges everything.
+		allocator.Free(a);
+		CHECK(allocator.GetStats().FreeBlockCount == 2);
+		CHECK(allocator.GetStats().LargestFreeBlock == 4096 - 1792);
+		allocator.Free(c);
+		stats = allocator.GetStats();
+		CHECK(stats.FreeBlockCount == 1);
+		CHECK(stats.LargestFreeBlock == 4096);
+		CHECK(stats.Fragmentation() == 0.0f);
+		CHECK(allocator.Allocate(4096) == 0);
+	}
+
+	// Random allocations and frees checked against a map of the live ones.
+	void TestAgainstModel()
+	{
+		for (int seed = 0; seed < 50; ++seed)
+		{
+			std::mt19937_64 rng(seed);
+			const uint64_t capacity = (rng() % 4096 + 1) * 256 + (rng() % 3 == 0 ? 100 : 0);
+			TlsfAllocator allocator(capacity, 256);
+			CHECK(allocator.Capacity() % 256 == 0);
+
+			std::map<uint64_t, uint64_t> live;
+			for (int i = 0; i < 2000; ++i)
+			{
+				if (live.empty() || rng() % 3 != 0)
+				{
+					const uint64_t size = rng() % 5 == 0 ? rng() % (capacity + 512) : rng() % 20000;
+					const uint64_t offset = allocator.Allocate(size);
+					if (offset == TlsfAllocator::InvalidOffset)
+					{
+						CHECK(size == 0 || allocator.GetStats().LargestFreeBlock < (size + 255) / 256 * 256);
+						continue;
+					}
+
+					const uint64_t allocated = allocator.AllocationSize(offset);
+					CHECK(allocated >= size);
+					CHECK(offset % 256 == 0);
+					CHECK(offset + allocated <= allocator.Capacity());
+
+					auto next = live.lower_bound(offset);
+					if (next != live.end())
+					{
+						CHECK(offset + allocated <= next->first);
+					}
+					if (next != live.begin())
+					{
+						auto prev = std::prev(next);
+						CHECK(prev->first + prev->second <= offset);
+					}
+					live[offset] = allocated;
+				}
+				else
+				{
+					auto victim = live.begin();
+					std::advance(victim, rng() % live.size());
+					allocator.Free(victim->first);
+					live.erase(victim);
+				}
+
+				uint64_t used = 0;
+				for (const auto& allocation : live)
+				{
+					used += allocation.second;
+				}
+				const TlsfAllocator::Stats stats = allocator.GetStats();
+				CHECK(stats.FreeBytes + used == allocator.Capacity());
+				CHECK(stats.AllocationCount == live.size());
+				CHECK(stats.LargestFreeBlock <= stats.FreeBytes);
+			}
+
+			// Everything freed merges back into one block.
+			for (const auto& allocation : live)
+			{
+				allocator.Free(allocation.first);
+			}
+			const TlsfAllocator::Stats stats = allocator.GetStats();
+			CHECK(stats.FreeBlockCount == 1);
+			CHECK(stats.LargestFreeBlock == allocator.Capacity());
+			CHECK(allocator.Allocate(allocator.Capacity()) == 0);
+		}
+	}
+}
+
+int main()
+{
+	TestMerge();
+	TestAgainstModel();
+	return TestExitCode();
+}
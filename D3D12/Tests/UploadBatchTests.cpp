@@ -0,0 +1,284 @@
+#include "UploadLayout.h"
+#include "TestCheck.h"
+#include <cstring>
+
+namespace
+{
+	// Stands in for ID3D12GraphicsCommandList and keeps every call in order.
+	class RecordingCommandList
+	{
+	public:
+		struct Call
+		{
+			bool Barrier = false;
+			std::vector<D3D12_RESOURCE_BARRIER> Barriers;
+			D3D12_TEXTURE_COPY_LOCATION Dst = {};
+			D3D12_TEXTURE_COPY_LOCATION Src = {};
+		};
+
+		void ResourceBarrier(UINT count, const D3D12_RESOURCE_BARRIER* barriers)
+		{
+			Call call;
+			call.Barrier = true;
+			call.Barriers.assign(barriers, barriers + count);
+			Calls.push_back(call);
+		}
+
+		void CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION* dst, UINT dstX, UINT dstY, UINT dstZ,
+			const D3D12_TEXTURE_COPY_LOCATION* src, const D3D12_BOX* srcBox)
+		{
+			CHECK(dstX == 0 && dstY == 0 && dstZ == 0 && srcBox == nullptr);
+			Call call;
+			call.Dst = *dst;
+			call.Src = *src;
+			Calls.push_back(call);
+		}
+
+		std::vector<Call> Calls;
+	};
+
+	// Distinct resource pointers; nothing ever dereferences them.
+	char resourceStorage[4];
+	ID3D12Resource* Resource(int i)
+	{
+		return reinterpret_cast<ID3D12Resource*>(&resourceStorage[i]);
+	}
+
+	D3D12_RESOURCE_DESC TextureDesc(DXGI_FORMAT format, UINT64 width, UINT height, UINT16 mips)
+	{
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		desc.Width = width;
+		desc.Height = height;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = mips;
+		desc.Format = format;
+		desc.SampleDesc.Count = 1;
+		return desc;
+	}
+
+	D3D12_SUBRESOURCE_DATA Data(const std::vector<uint8_t>& bytes, UINT64 rowBytes)
+	{
+		D3D12_SUBRESOURCE_DATA data = {};
+		data.pData = bytes.data();
+		data.RowPitch = (LONG_PTR)rowBytes;
+		data.SlicePitch = (LONG_PTR)bytes.size();
+		return data;
+	}
+
+	std::vector<uint8_t> Bytes(size_t size, uint8_t seed)
+	{
+		std::vector<uint8_t> bytes(size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			bytes[i] = (uint8_t)(seed + i * 3);
+		}
+		return bytes;
+	}
+
+	// A 5x3 RGBA8 texture and its 2x1 mip: rows padded to 256 bytes, subresources
+	// placed at multiples of 512.
+	void TestUncompressedLayout()
+	{
+		const D3D12_RESOURCE_DESC desc = TextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 5, 3, 2);
+		const std::vector<uint8_t> mip0 = Bytes(5 * 4 * 3, 1);
+		const std::vector<uint8_t> mip1 = Bytes(2 * 4, 100);
+
+		UploadLayout layout;
+		CHECK(layout.Empty());
+		layout.AddTextureSubresource(Resource(0), desc, 0, Data(mip0, 20),
+			D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		layout.AddTextureSubresource(Resource(0), desc, 1, Data(mip1, 8),
+			D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		CHECK(!layout.Empty());
+
+		const std::vector<UploadLayout::TextureCopy>& copies = layout.Textures();
+		CHECK(copies.size() == 2);
+		CHECK(copies[0].Footprint.Offset == 0);
+		CHECK(copies[0].Footprint.Footprint.Width == 5);
+		CHECK(copies[0].Footprint.Footprint.Height == 3);
+		CHECK(copies[0].Footprint.Footprint.RowPitch == 256);
+		CHECK(copies[0].NumRows == 3);
+		CHECK(copies[1].Footprint.Offset == 1024);
+		CHECK(copies[1].Footprint.Footprint.Width == 2);
+		CHECK(copies[1].Footprint.Footprint.Height == 1);
+		CHECK(copies[1].Footprint.Footprint.RowPitch == 256);
+		CHECK(layout.StagingSize() == 1024 + 256);
+
+		// Pack writes each row at its pitch and leaves the padding alone.
+		std::vector<uint8_t> staging(layout.StagingSize(), 0xCD);
+		layout.Pack(staging.data());
+		for (UINT row = 0; row < 3; ++row)
+		{
+			CHECK(std::memcmp(&staging[row * 256], &mip0[row * 20], 20) == 0);
+			CHECK(staging[row * 256 + 20] == 0xCD);
+		}
+		CHECK(std::memcmp(&staging[1024], mip1.data(), 8) == 0);
+		CHECK(staging[768] == 0xCD);
+
+		layout.Clear();
+		CHECK(layout.Empty());
+		CHECK(layout.StagingSize() == 0);
+		CHECK(layout.Targets().empty());
+	}
+
+	// A 10x6 BC1 texture is 3x2 blocks; its footprints cover whole blocks down to the
+	// 2x1 mip, which still takes one 4x4 block.
+	void TestBlockCompressedLayout()
+	{
+		const D3D12_RESOURCE_DESC desc = TextureDesc(DXGI_FORMAT_BC1_UNORM, 10, 6, 3);
+		const std::vector<uint8_t> mip0 = Bytes(3 * 8 * 2, 1);
+		const std::vector<uint8_t> mip1 = Bytes(2 * 8, 2);
+		const std::vector<uint8_t> mip2 = Bytes(8, 3);
+
+		UploadLayout layout;
+		layout.AddTextureSubresource(Resource(0), desc, 0, Data(mip0, 24),
+			D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		layout.AddTextureSubresource(Resource(0), desc, 1, Data(mip1, 16),
+			D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		layout.AddTextureSubresource(Resource(0), desc, 2, Data(mip2, 8),
+			D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+		struct Expected
+		{
+			UINT Width;
+			UINT Height;
+			UINT NumRows;
+			UINT64 RowSize;
+			UINT64 Offset;
+		};
+		const Expected expected[] =
+		{
+			{ 12, 8, 2, 24, 0 },
+			{ 8, 4, 1, 16, 512 },
+			{ 4, 4, 1, 8, 1024 }
+		};
+
+		const std::vector<UploadLayout::TextureCopy>& copies = layout.Textures();
+		CHECK(copies.size() == 3);
+		for (size_t i = 0; i < copies.size(); ++i)
+		{
+			const UploadLayout::TextureCopy& c = copies[i];
+			CHECK(c.Subresource == i);
+			CHECK(c.Footprint.Footprint.Format == DXGI_FORMAT_BC1_UNORM);
+			CHECK(c.Footprint.Footprint.Width == expected[i].Width);
+			CHECK(c.Footprint.Footprint.Height == expected[i].Height);
+			CHECK(c.Footprint.Footprint.Depth == 1);
+			CHECK(c.NumRows == expected[i].NumRows);
+			CHECK(c.RowSizeInBytes == expected[i].RowSize);
+			CHECK(c.Footprint.Offset == expected[i].Offset);
+			CHECK(c.Footprint.Offset % D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT == 0);
+			CHECK(c.Footprint.Footprint.RowPitch % D3D12_TEXTURE_DATA_PITCH_ALIGNMENT == 0);
+		}
+		CHECK(layout.StagingSize() == 1024 + 256);
+
+		std::vector<uint8_t> staging(layout.StagingSize(), 0);
+		layout.Pack(staging.data());
+		CHECK(std::memcmp(&staging[0], &mip0[0], 24) == 0);
+		CHECK(std::memcmp(&staging[256], &mip0[24], 24) == 0);
+		CHECK(std::memcmp(&staging[512], mip1.data(), 16) == 0);
+		CHECK(std::memcmp(&staging[1024], mip2.data(), 8) == 0);
+	}
+
+	bool IsTransition(const D3D12_RESOURCE_BARRIER& b, ID3D12Resource* resource,
+		D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+	{
+		return b.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION && b.Transition.pResource == resource &&
+			b.Transition.StateBefore == before && b.Transition.StateAfter == after &&
+			b.Transition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	}
+
+	// Three subresources of one texture and one of two others: one barrier call before
+	// the copies and one after, one transition per destination, and none for a side
+	// that already is COPY_DEST.
+	void TestRecordBarriers()
+	{
+		const D3D12_RESOURCE_DESC desc = TextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 4, 4, 3);
+		const std::vector<uint8_t> texels = Bytes(4 * 4 * 4, 1);
+		const D3D12_RESOURCE_STATES psr = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		const D3D12_RESOURCE_STATES common = D3D12_RESOURCE_STATE_COMMON;
+		const D3D12_RESOURCE_STATES copyDest = D3D12_RESOURCE_STATE_COPY_DEST;
+
+		UploadLayout layout;
+		for (UINT mip = 0; mip < 3; ++mip)
+		{
+			layout.AddTextureSubresource(Resource(0), desc, mip, Data(texels, (4 >> mip) * 4), common, psr);
+		}
+		layout.AddTextureSubresource(Resource(1), desc, 0, Data(texels, 16), copyDest, psr);
+		layout.AddTextureSubresource(Resource(2), desc, 1, Data(texels, 8), common, copyDest);
+		CHECK(layout.Targets().size() == 3);
+
+		const UINT64 stagingOffset = 4096;
+		RecordingCommandList cmdList;
+		layout.Record(&cmdList, Resource(3), stagingOffset);
+
+		const std::vector<RecordingCommandList::Call>& calls = cmdList.Calls;
+		CHECK(calls.size() == 7);
+		if (calls.size() != 7)
+			return;
+
+		CHECK(calls.front().Barrier);
+		CHECK(calls.front().Barriers.size() == 2);
+		CHECK(IsTransition(calls.front().Barriers[0], Resource(0), common, copyDest));
+		CHECK(IsTransition(calls.front().Barriers[1], Resource(2), common, copyDest));
+
+		CHECK(calls.back().Barrier);
+		CHECK(calls.back().Barriers.size() == 2);
+		CHECK(IsTransition(calls.back().Barriers[0], Resource(0), copyDest, psr));
+		CHECK(IsTransition(calls.back().Barriers[1], Resource(1), copyDest, psr));
+
+		// The copies read the placed footprints, moved to stagingOffset.
+		const std::vector<UploadLayout::TextureCopy>& copies = layout.Textures();
+		for (size_t i = 0; i < copies.size(); ++i)
+		{
+			const RecordingCommandList::Call& call = calls[i + 1];
+			CHECK(!call.Barrier);
+			CHECK(call.Dst.pResource == copies[i].Dest);
+			CHECK(call.Dst.Type == D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX);
+			CHECK(call.Dst.SubresourceIndex == copies[i].Subresource);
+			CHECK(call.Src.pResource == Resource(3));
+			CHECK(call.Src.Type == D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT);
+			CHECK(call.Src.PlacedFootprint.Offset == copies[i].Footprint.Offset + stagingOffset);
+			CHECK(call.Src.PlacedFootprint.Footprint.RowPitch == copies[i].Footprint.Footprint.RowPitch);
+		}
+
+		// A copy queue records the copies alone.
+		RecordingCommandList copyList;
+		layout.Record(&copyList, Resource(3), 0, false);
+		CHECK(copyList.Calls.size() == copies.size());
+		for (const RecordingCommandList::Call& call : copyList.Calls)
+		{
+			CHECK(!call.Barrier);
+		}
+	}
+
+	// Destinations that stay in COPY_DEST need no barrier call at all.
+	void TestRecordWithoutTransitions()
+	{
+		const D3D12_RESOURCE_DESC desc = TextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, 4, 4, 1);
+		const std::vector<uint8_t> texels = Bytes(4 * 4 * 4, 1);
+
+		UploadLayout layout;
+		layout.AddTextureSubresource(Resource(0), desc, 0, Data(texels, 16),
+			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_DEST);
+		layout.AddTextureSubresource(Resource(1), desc, 0, Data(texels, 16),
+			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_DEST);
+
+		RecordingCommandList cmdList;
+		layout.Record(&cmdList, Resource(3), 0);
+		CHECK(cmdList.Calls.size() == 2);
+		for (const RecordingCommandList::Call& call : cmdList.Calls)
+		{
+			CHECK(!call.Barrier);
+		}
+	}
+}
+
+int main()
+{
+	TestUncompressedLayout();
+	TestBlockCompressedLayout();
+	TestRecordBarriers();
+	TestRecordWithoutTransitions();
+	return TestExitCode();
+}
@@ -0,0 +1,116 @@
+#include "StreamingCopy.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Payload bytes per second for UploadBuffer's write paths: CopyData called once per
+// element, CopyRange, and one plain memcpy for reference.  Without a device the
+// destination is ordinary cached memory, where regular stores win as long as it
+// fits in the cache.  A mapped upload heap is write-combined and never cached, so
+// only the larger sizes say much about it.
+namespace
+{
+	// The shapes of MaterialData (a structured buffer element) and of a per-object
+	// constant buffer element with two matrices (144 bytes, 256 bytes apart).
+	struct MaterialLike
+	{
+		float Data[28];
+	};
+	struct ObjectLike
+	{
+		float Data[36];
+	};
+
+	using Clock = std::chrono::steady_clock;
+
+	template<typename F>
+	double BestSeconds(int repeats, F&& write)
+	{
+		double best = 1e30;
+		for (int r = 0; r < repeats; ++r)
+		{
+			Clock::time_point start = Clock::now();
+			write();
+			best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+		}
+		return best;
+	}
+
+	void Report(const char* layout, size_t payloadBytes, const char* path, double seconds)
+	{
+		std::printf("%-26s %9zu KB  %-18s %8.0f MB/s\n", layout, payloadBytes / 1024, path,
+			payloadBytes / seconds / (1024.0 * 1024.0));
+	}
+
+	template<typename T>
+	void Run(const char* layout, size_t stride, size_t count)
+	{
+		std::vector<T> src(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			for (float& f : src[i].Data)
+			{
+				f = (float)i;
+			}
+		}
+
+		// Upload heap allocations are at least 256 byte aligned.
+		std::vector<std::uint8_t> memory(stride * count + 256);
+		std::uint8_t* mapped = memory.data() + (256 - reinterpret_cast<std::uintptr_t>(memory.data()) % 256) % 256;
+
+		const size_t payload = sizeof(T) * count;
+		const int repeats = (int)std::max<size_t>(5, (64u << 20) / payload);
+
+		// UploadBuffer::CopyData, called for every element.
+		Report(layout, payload, "CopyData loop", BestSeconds(repeats, [&]
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				std::memcpy(&mapped[i * stride], &src[i], sizeof(T));
+			}
+		}));
+
+		// UploadBuffer::CopyRange.
+		Report(layout, payload, "CopyRange", BestSeconds(repeats, [&]
+		{
+			if (stride == sizeof(T))
+			{
+				StreamingCopy(mapped, src.data(), payload);
+			}
+			else
+			{
+				StreamingCopyStrided(mapped, stride, src.data(), sizeof(T), count);
+			}
+		}));
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (std::memcmp(mapped + i * stride, &src[i], sizeof(T)) != 0)
+			{
+				std::printf("CopyRange wrote element %zu wrong\n", i);
+				return;
+			}
+		}
+
+		if (stride == sizeof(T))
+		{
+			Report(layout, payload, "memcpy", BestSeconds(repeats, [&]
+			{
+				std::memcpy(mapped, src.data(), payload);
+			}));
+		}
+	}
+}
+
+int main()
+{
+	for (size_t count : { 1024u, 16384u, 262144u })
+	{
+		Run<MaterialLike>("structured, 112 B", sizeof(MaterialLike), count);
+		Run<ObjectLike>("constant, 144 B in 256 B", 256, count);
+	}
+	return 0;
+}
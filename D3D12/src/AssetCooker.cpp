@@ -0,0 +1,200 @@
+#include "AssetCooker.h"
+#include "ContentHash.h"
+#include "FrameResource.h"
+#include "Common/DdsImage.h"
+#include "Common/MipChain.h"
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+	bool ReadWholeFile(const std::filesystem::path& path, std::vector<std::uint8_t>& data)
+	{
+		std::ifstream in(path, std::ios::binary | std::ios::ate);
+		if (!in)
+			return false;
+
+		data.resize((size_t)in.tellg());
+		in.seekg(0);
+		in.read(reinterpret_cast<char*>(data.data()), data.size());
+		return (bool)in;
+	}
+
+	// Reads a DDS file.  A 2D texture stored as a single level of a format MipChain
+	// filters gets its full chain here, so it is not the one texture in the scene that
+	// shimmers in the distance and the streamer has mips to drop.  The textures of the
+	// scene tile, so the filter wraps around the edges.
+	bool CookTexture(const std::filesystem::path& path, std::vector<std::uint8_t>& data)
+	{
+		if (!ReadWholeFile(path, data))
+			return false;
+
+		DdsImage image;
+		if (image.Parse(data.data(), data.size()) != DdsResult::Ok)
+			return false;
+
+		if (image.Dimension() != DdsDimension::Texture2D || image.IsCubeMap() || image.ArraySize() != 1 ||
+			image.MipCount() != 1 || !MipChain::IsSupported(image.Format()) ||
+			MipChain::FullLevelCount(image.Width(), image.Height()) == 1)
+		{
+			return true;
+		}
+
+		const DdsSubresource top = image.Subresource(0);
+		MipOptions options;
+		options.Wrap = true;
+		MipChain chain;
+		return chain.Generate(image.Format(), top.Width, top.Height, top.Data, top.RowPitch, options) == MipResult::Ok &&
+			chain.WriteDds(data);
+	}
+
+	// Reads a model in the text format of Models/car.txt into the Vertex layout the
+	// shaders use, so loading it is a copy.
+	bool CookTextMesh(const std::filesystem::path& path, std::vector<std::uint8_t>& data)
+	{
+		using namespace DirectX;
+		std::ifstream fin(path);
+		if (!fin)
+			return false;
+
+		UINT vcount = 0;
+		UINT tcount = 0;
+		std::string ignore;
+
+		fin >> ignore >> vcount;
+		fin >> ignore >> tcount;
+		fin >> ignore >> ignore >> ignore >> ignore;
+
+		XMVECTOR vMin = XMVectorReplicate(+MathHelper::Infinity);
+		XMVECTOR vMax = XMVectorReplicate(-MathHelper::Infinity);
+
+		std::vector<Vertex> vertices(vcount);
+		for (UINT i = 0; i < vcount; ++i)
+		{
+			fin >> vertices[i].Pos.x >> vertices[i].Pos.y >> vertices[i].Pos.z;
+			fin >> vertices[i].Normal.x >> vertices[i].Normal.y >> vertices[i].Normal.z;
+
+			// Model does not have texture coordinates, so just zero them out and
+			// make up a tangent perpendicular to the normal.
+			vertices[i].TexC = { 0.0f, 0.0f };
+
+			XMVECTOR n = XMLoadFloat3(&vertices[i].Normal);
+			XMVECTOR axis = fabsf(vertices[i].Normal.y) < 0.99f ? XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) : XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+			XMStoreFloat3(&vertices[i].TangentU, XMVector3Normalize(XMVector3Cross(axis, n)));
+
+			XMVECTOR p = XMLoadFloat3(&vertices[i].Pos);
+			vMin = XMVectorMin(vMin, p);
+			vMax = XMVectorMax(vMax, p);
+		}
+
+		fin >> ignore;
+		fin >> ignore;
+		fin >> ignore;
+
+		std::vector<std::uint32_t> indices(3 * tcount);
+		for (UINT i = 0; i < tcount; ++i)
+		{
+			fin >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
+		}
+		if (!fin)
+			return false;
+
+		MeshHeader header;
+		header.VertexCount = vcount;
+		header.IndexCount = (UINT)indices.size();
+		header.VertexStride = sizeof(Vertex);
+		XMFLOAT3 center, extents;
+		XMStoreFloat3(&center, 0.5f * (vMin + vMax));
+		XMStoreFloat3(&extents, 0.5f * (vMax - vMin));
+		memcpy(header.BoundsCenter, &center, sizeof(center));
+		memcpy(header.BoundsExtents, &extents, sizeof(extents));
+
+		// 16-bit indices whenever the vertices allow it.
+		if (vcount <= 0x10000)
+		{
+			std::vector<std::uint16_t> shortIndices(indices.begin(), indices.end());
+			header.IndexSize = sizeof(std::uint16_t);
+			data = MeshView::Build(header, vertices.data(), shortIndices.data());
+		}
+		else
+		{
+			header.IndexSize = sizeof(std::uint32_t);
+			data = MeshView::Build(header, vertices.data(), indices.data());
+		}
+		return true;
+	}
+}
+
+std::uint64_t AssetManifest(const std::vector<AssetSource>& sources)
+{
+	std::vector<const AssetSource*> sorted;
+	for (const AssetSource& source : sources)
+	{
+		sorted.push_back(&source);
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const AssetSource* a, const AssetSource* b) { return a->Name < b->Name; });
+
+	// Names and paths end in a zero byte, so neighbouring fields cannot run together.
+	const std::uint32_t layout[3] = { AssetCookerVersion, (std::uint32_t)sizeof(Vertex), (std::uint32_t)sizeof(MeshHeader) };
+	std::string manifest(reinterpret_cast<const char*>(layout), sizeof(layout));
+	for (const AssetSource* source : sorted)
+	{
+		manifest += source->Name;
+		manifest += '\0';
+		manifest += source->Path.generic_string();
+		manifest += '\0';
+		manifest += (char)source->Type;
+		manifest += source->Compress ? '1' : '0';
+	}
+	return ContentHash(manifest.data(), manifest.size());
+}
+
+bool IsAssetPackStale(const std::filesystem::path& packFile, const std::vector<AssetSource>& sources)
+{
+	std::error_code ec;
+	auto packTime = std::filesystem::last_write_time(packFile, ec);
+	if (ec)
+		return true;
+
+	// Sources added to the list, or a cooker that writes them differently, may leave
+	// every file older than the pack.
+	AssetPack pack;
+	if (!pack.Open(packFile) || pack.Manifest() != AssetManifest(sources))
+		return true;
+
+	for (const AssetSource& source : sources)
+	{
+		auto sourceTime = std::filesystem::last_write_time(source.Path, ec);
+		if (!ec && sourceTime > packTime)
+			return true;
+	}
+	return false;
+}
+
+bool CookAssetPack(const std::filesystem::path& packFile, const std::vector<AssetSource>& sources)
+{
+	AssetPackWriter writer;
+	writer.SetManifest(AssetManifest(sources));
+	for (const AssetSource& source : sources)
+	{
+		std::vector<std::uint8_t> data;
+		bool read = false;
+		switch (source.Type)
+		{
+		case AssetType::Texture:
+			read = CookTexture(source.Path, data);
+			break;
+		case AssetType::Mesh:
+			read = CookTextMesh(source.Path, data);
+			break;
+		default:
+			read = ReadWholeFile(source.Path, data);
+			break;
+		}
+		if (!read)
+			return false;
+
+		writer.Add(source.Name, source.Type, std::move(data), source.Compress);
+	}
+	return writer.Write(packFile);
+}
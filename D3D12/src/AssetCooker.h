@@ -0,0 +1,42 @@
+#pragma once
+#include "AssetPack.h"
+
+// A loose file that goes into the asset pack.
+struct AssetSource
+{
+	// The entry name in the pack.
+	std::string Name;
+	std::filesystem::path Path;
+	// Texture sources are DDS files, which get a full mip chain if they come with a
+	// single level, and Mesh sources text models (the car.txt format); Shader and Raw
+	// sources are stored as they are.
+	AssetType Type = AssetType::Raw;
+	bool Compress = false;
+};
+
+// Part of every pack's manifest.  Bump it whenever the cooker writes something
+// different for the same sources, such as a change to Vertex, MeshHeader,
+// CookTextMesh or the mips generated for textures, so packs cooked before the
+// change are cooked again.
+const std::uint32_t AssetCookerVersion = 2;
+
+///<summary>
+/// Hashes AssetCookerVersion, the vertex and mesh header sizes, and the name, path,
+/// type and compression of every source in name order.  CookAssetPack stores it in
+/// the pack.
+///</summary>
+std::uint64_t AssetManifest(const std::vector<AssetSource>& sources);
+
+///<summary>
+/// Whether packFile has to be cooked again: it is missing or unreadable, its
+/// manifest differs from AssetManifest(sources), or a source that exists has been
+/// written to since.  Missing sources are not an error, so a pack can ship without
+/// them.
+///</summary>
+bool IsAssetPackStale(const std::filesystem::path& packFile, const std::vector<AssetSource>& sources);
+
+///<summary>
+/// Converts sources into their runtime form and writes them to packFile.  Returns
+/// false if a source cannot be read or converted, leaving any existing pack alone.
+///</summary>
+bool CookAssetPack(const std::filesystem::path& packFile, const std::vector<AssetSource>& sources);
@@ -0,0 +1,299 @@
+#include "AssetPack.h"
+#include "ContentHash.h"
+#include "Lz.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	const std::uint32_t PackMagic = 0x4B415041; // "APAK"
+	const std::uint32_t PackVersion = 2;
+
+	struct PackHeader
+	{
+		std::uint32_t Magic = PackMagic;
+		std::uint32_t Version = PackVersion;
+		std::uint32_t EntryCount = 0;
+		std::uint32_t Alignment = AssetPack::LargeAlignment;
+		// The entries followed by the string block with their names.
+		std::uint64_t TocOffset = 0;
+		std::uint64_t TocSize = 0;
+		// Set by whoever wrote the pack; see AssetPackWriter::SetManifest.
+		std::uint64_t Manifest = 0;
+	};
+
+	std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Whether [offset, offset + size) lies within fileSize bytes, without overflowing.
+	bool InBounds(std::uint64_t offset, std::uint64_t size, std::uint64_t fileSize)
+	{
+		return offset <= fileSize && size <= fileSize - offset;
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// MeshView
+//--------------------------------------------------------------------------------------
+bool MeshView::Parse(const std::uint8_t* data, size_t size)
+{
+	*this = MeshView();
+	if (size < sizeof(MeshHeader))
+		return false;
+
+	const MeshHeader* header = reinterpret_cast<const MeshHeader*>(data);
+	if (header->IndexSize != 2 && header->IndexSize != 4)
+		return false;
+
+	const std::uint64_t vertexBytes = (std::uint64_t)header->VertexCount * header->VertexStride;
+	const std::uint64_t indexBytes = (std::uint64_t)header->IndexCount * header->IndexSize;
+	if (vertexBytes + indexBytes != size - sizeof(MeshHeader))
+		return false;
+
+	Header = header;
+	Vertices = data + sizeof(MeshHeader);
+	Indices = Vertices + vertexBytes;
+	return true;
+}
+
+std::vector<std::uint8_t> MeshView::Build(const MeshHeader& header, const void* vertices, const void* indices)
+{
+	const size_t vertexBytes = (size_t)header.VertexCount * header.VertexStride;
+	const size_t indexBytes = (size_t)header.IndexCount * header.IndexSize;
+
+	std::vector<std::uint8_t> data(sizeof(MeshHeader) + vertexBytes + indexBytes);
+	std::memcpy(data.data(), &header, sizeof(MeshHeader));
+	std::memcpy(data.data() + sizeof(MeshHeader), vertices, vertexBytes);
+	std::memcpy(data.data() + sizeof(MeshHeader) + vertexBytes, indices, indexBytes);
+	return data;
+}
+
+//--------------------------------------------------------------------------------------
+// AssetPack
+//--------------------------------------------------------------------------------------
+bool AssetPack::Open(const std::filesystem::path& path)
+{
+	Close();
+	if (!file.Open(path))
+		return false;
+
+	const std::uint64_t fileSize = file.Size();
+	if (fileSize < sizeof(PackHeader))
+	{
+		Close();
+		return false;
+	}
+
+	PackHeader header;
+	std::memcpy(&header, file.Data(), sizeof(header));
+	const std::uint64_t entryBytes = (std::uint64_t)header.EntryCount * sizeof(AssetEntry);
+	if (header.Magic != PackMagic || header.Version != PackVersion ||
+		header.TocOffset % alignof(AssetEntry) != 0 || !InBounds(header.TocOffset, header.TocSize, fileSize) ||
+		entryBytes > header.TocSize)
+	{
+		Close();
+		return false;
+	}
+
+	const AssetEntry* toc = reinterpret_cast<const AssetEntry*>(file.Data() + header.TocOffset);
+	const char* stringBlock = reinterpret_cast<const char*>(file.Data() + header.TocOffset + entryBytes);
+	const std::uint64_t stringBytes = header.TocSize - entryBytes;
+
+	for (std::uint32_t i = 0; i < header.EntryCount; ++i)
+	{
+		const AssetEntry& e = toc[i];
+		bool valid = InBounds(e.NameOffset, e.NameLength, stringBytes) &&
+			InBounds(e.Offset, e.StoredSize, fileSize) &&
+			((e.Flags & AssetEntry::Compressed) != 0 || e.StoredSize == e.Size);
+
+		// Find relies on the order.
+		if (valid && i > 0)
+		{
+			std::string_view previous(stringBlock + toc[i - 1].NameOffset, toc[i - 1].NameLength);
+			valid = previous < std::string_view(stringBlock + e.NameOffset, e.NameLength);
+		}
+
+		if (!valid)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	entries = toc;
+	entryCount = header.EntryCount;
+	names = stringBlock;
+	manifest = header.Manifest;
+	return true;
+}
+
+void AssetPack::Close()
+{
+	file.Close();
+	entries = nullptr;
+	entryCount = 0;
+	names = nullptr;
+	manifest = 0;
+}
+
+std::uint64_t AssetPack::Manifest()const
+{
+	return manifest;
+}
+
+std::uint32_t AssetPack::EntryCount()const
+{
+	return entryCount;
+}
+
+const AssetEntry& AssetPack::Entry(std::uint32_t entry)const
+{
+	return entries[entry];
+}
+
+std::string_view AssetPack::Name(const AssetEntry& entry)const
+{
+	return std::string_view(names + entry.NameOffset, entry.NameLength);
+}
+
+const AssetEntry* AssetPack::Find(std::string_view name)const
+{
+	const AssetEntry* end = entries + entryCount;
+	const AssetEntry* e = std::lower_bound(entries, end, name, [this](const AssetEntry& a, std::string_view n)
+	{
+		return Name(a) < n;
+	});
+	return e != end && Name(*e) == name ? e : nullptr;
+}
+
+const std::uint8_t* AssetPack::Data(const AssetEntry& entry)const
+{
+	if (entry.Flags & AssetEntry::Compressed)
+		return nullptr;
+
+	return file.Data() + entry.Offset;
+}
+
+bool AssetPack::Read(const AssetEntry& entry, std::vector<std::uint8_t>& out)const
+{
+	const std::uint8_t* stored = file.Data() + entry.Offset;
+	if ((entry.Flags & AssetEntry::Compressed) == 0)
+	{
+		out.assign(stored, stored + entry.Size);
+		return true;
+	}
+
+	out.resize(entry.Size);
+	if (!LzDecompress(stored, entry.StoredSize, out.data(), out.size()))
+	{
+		out.clear();
+		return false;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------------------------------
+// AssetPackWriter
+//--------------------------------------------------------------------------------------
+void AssetPackWriter::Add(const std::string& name, AssetType type, std::vector<std::uint8_t> data, bool compress)
+{
+	auto a = std::find_if(assets.begin(), assets.end(), [&name](const Asset& a) { return a.Name == name; });
+	if (a == assets.end())
+	{
+		a = assets.insert(assets.end(), Asset());
+		a->Name = name;
+	}
+
+	a->Entry = AssetEntry();
+	a->Entry.Type = type;
+	a->Entry.Size = data.size();
+	a->Entry.Hash = ContentHash(data.data(), data.size());
+	a->Stored = std::move(data);
+
+	if (compress && !a->Stored.empty())
+	{
+		std::vector<std::uint8_t> packed;
+		LzCompress(a->Stored.data(), a->Stored.size(), packed);
+		if (packed.size() <= a->Stored.size() - a->Stored.size() / 8)
+		{
+			a->Stored = std::move(packed);
+			a->Entry.Flags |= AssetEntry::Compressed;
+		}
+	}
+	a->Entry.StoredSize = a->Stored.size();
+}
+
+void AssetPackWriter::SetManifest(std::uint64_t value)
+{
+	manifest = value;
+}
+
+bool AssetPackWriter::Write(const std::filesystem::path& path)const
+{
+	std::vector<const Asset*> sorted;
+	for (const Asset& a : assets)
+	{
+		sorted.push_back(&a);
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const Asset* a, const Asset* b) { return a->Name < b->Name; });
+
+	// The table of contents goes right after the header, so opening the pack touches
+	// only its first pages; the payloads follow, aligned.
+	std::vector<AssetEntry> toc;
+	std::string stringBlock;
+	for (const Asset* a : sorted)
+	{
+		AssetEntry e = a->Entry;
+		e.NameOffset = (std::uint32_t)stringBlock.size();
+		e.NameLength = (std::uint32_t)a->Name.size();
+		stringBlock += a->Name;
+		toc.push_back(e);
+	}
+
+	PackHeader header;
+	header.EntryCount = (std::uint32_t)toc.size();
+	header.Manifest = manifest;
+	header.TocOffset = AlignUp(sizeof(PackHeader), alignof(AssetEntry));
+	header.TocSize = toc.size() * sizeof(AssetEntry) + stringBlock.size();
+
+	std::uint64_t offset = header.TocOffset + header.TocSize;
+	for (AssetEntry& e : toc)
+	{
+		offset = AlignUp(offset, e.StoredSize >= AssetPack::LargeAlignment ?
+			AssetPack::LargeAlignment : AssetPack::SmallAlignment);
+		e.Offset = offset;
+		offset += e.StoredSize;
+	}
+
+	std::filesystem::path temporary = path;
+	temporary += ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		if (!out)
+			return false;
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(std::string(header.TocOffset - sizeof(header), '\0').data(), header.TocOffset - sizeof(header));
+		out.write(reinterpret_cast<const char*>(toc.data()), toc.size() * sizeof(AssetEntry));
+		out.write(stringBlock.data(), stringBlock.size());
+
+		std::uint64_t position = header.TocOffset + header.TocSize;
+		for (size_t i = 0; i < toc.size(); ++i)
+		{
+			const std::string padding(toc[i].Offset - position, '\0');
+			out.write(padding.data(), padding.size());
+			out.write(reinterpret_cast<const char*>(sorted[i]->Stored.data()), sorted[i]->Stored.size());
+			position = toc[i].Offset + toc[i].StoredSize;
+		}
+
+		if (!out)
+			return false;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temporary, path, ec);
+	return !ec;
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class AssetType : std::uint32_t
+{
+	Raw,
+	// A DDS file, stored as is.
+	Texture,
+	// A MeshHeader followed by the vertices and the indices.
+	Mesh,
+	// Compiled shader bytecode.
+	Shader
+};
+
+// One entry of the table of contents, as stored in the pack.
+struct AssetEntry
+{
+	// Payload position in the file and its size there, which is smaller than Size
+	// when the payload is compressed.
+	std::uint64_t Offset = 0;
+	std::uint64_t StoredSize = 0;
+	std::uint64_t Size = 0;
+	// ContentHash of the uncompressed payload.
+	std::uint64_t Hash = 0;
+	AssetType Type = AssetType::Raw;
+	std::uint32_t Flags = 0;
+	// The name in the string block that follows the entries.
+	std::uint32_t NameOffset = 0;
+	std::uint32_t NameLength = 0;
+
+	static const std::uint32_t Compressed = 1;
+};
+
+// Layout of an AssetType::Mesh payload.  Vertices start right after the header and
+// the indices right after the vertices.
+struct MeshHeader
+{
+	std::uint32_t VertexCount = 0;
+	std::uint32_t IndexCount = 0;
+	std::uint32_t VertexStride = 0;
+	// 2 or 4 bytes per index.
+	std::uint32_t IndexSize = 0;
+	float BoundsCenter[3] = {};
+	float BoundsExtents[3] = {};
+};
+
+// A mesh payload parsed in place.
+struct MeshView
+{
+	const MeshHeader* Header = nullptr;
+	const std::uint8_t* Vertices = nullptr;
+	const std::uint8_t* Indices = nullptr;
+
+	///<summary>
+	/// Points into a Mesh payload of size bytes.  Returns false if the sizes in the
+	/// header do not fit it.
+	///</summary>
+	bool Parse(const std::uint8_t* data, size_t size);
+
+	///<summary>
+	/// Builds a Mesh payload from vertices and indices.
+	///</summary>
+	static std::vector<std::uint8_t> Build(const MeshHeader& header, const void* vertices, const void* indices);
+};
+
+// A file of many assets behind a table of contents, mapped into memory once.  The
+// payloads are aligned, so an uncompressed one can be handed to the upload path
+// (or parsed in place) straight from the mapping, with no file reads and no copy;
+// the pack stays mapped for as long as anything points into it.  Compressed
+// entries are decompressed by Read.  Entries are sorted by name, so Find is a
+// binary search.
+class AssetPack
+{
+public:
+	AssetPack() = default;
+	AssetPack(const AssetPack& rhs) = delete;
+	AssetPack& operator=(const AssetPack& rhs) = delete;
+	~AssetPack() = default;
+
+	///<summary>
+	/// Maps the pack at path.  Returns false if it cannot be opened, or if the header or
+	/// any entry lies outside the file, so the views handed out later are always in
+	/// bounds.
+	///</summary>
+	bool Open(const std::filesystem::path& path);
+
+	void Close();
+
+	///<summary>
+	/// The value the writer passed to AssetPackWriter::SetManifest, 0 if none.
+	///</summary>
+	std::uint64_t Manifest()const;
+
+	std::uint32_t EntryCount()const;
+	const AssetEntry& Entry(std::uint32_t entry)const;
+	std::string_view Name(const AssetEntry& entry)const;
+
+	///<summary>
+	/// The entry called name, or nullptr.
+	///</summary>
+	const AssetEntry* Find(std::string_view name)const;
+
+	///<summary>
+	/// The payload of an uncompressed entry in the mapping; nullptr if it is compressed.
+	///</summary>
+	const std::uint8_t* Data(const AssetEntry& entry)const;
+
+	///<summary>
+	/// Copies the payload into out, decompressing it if necessary.  Returns false if a
+	/// compressed payload is corrupt.
+	///</summary>
+	bool Read(const AssetEntry& entry, std::vector<std::uint8_t>& out)const;
+
+	// Payloads of at least LargeAlignment bytes start on a multiple of it, smaller ones
+	// on a multiple of SmallAlignment.
+	static const std::uint32_t LargeAlignment = 64 * 1024;
+	static const std::uint32_t SmallAlignment = 256;
+
+private:
+	MappedFile file;
+	const AssetEntry* entries = nullptr;
+	std::uint32_t entryCount = 0;
+	const char* names = nullptr;
+	std::uint64_t manifest = 0;
+};
+
+// Collects assets and writes them as an AssetPack.
+class AssetPackWriter
+{
+public:
+	AssetPackWriter() = default;
+	AssetPackWriter(const AssetPackWriter& rhs) = delete;
+	AssetPackWriter& operator=(const AssetPackWriter& rhs) = delete;
+	~AssetPackWriter() = default;
+
+	///<summary>
+	/// Adds data under name, replacing an asset of the same name.  With compress, the
+	/// payload is stored LZ compressed if that saves at least an eighth of it.
+	///</summary>
+	void Add(const std::string& name, AssetType type, std::vector<std::uint8_t> data, bool compress);
+
+	///<summary>
+	/// Stores value in the header, for the tool that wrote the pack to recognise what
+	/// it was built from; AssetPack::Manifest reads it back.
+	///</summary>
+	void SetManifest(std::uint64_t value);
+
+	///<summary>
+	/// Writes the pack to path, through a temporary file renamed over it at the end, so
+	/// an interrupted write never leaves a truncated pack behind.
+	///</summary>
+	bool Write(const std::filesystem::path& path)const;
+
+private:
+	struct Asset
+	{
+		std::string Name;
+		AssetEntry Entry;
+		std::vector<std::uint8_t> Stored;
+	};
+
+	std::vector<Asset> assets;
+	std::uint64_t manifest = 0;
+};
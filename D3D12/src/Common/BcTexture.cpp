@@ -0,0 +1,1352 @@
+#include "BcTexture.h"
+#include "DdsImage.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <xmmintrin.h>
+
+namespace
+{
+	enum class BcKind
+	{
+		Unknown,
+		BC1,
+		BC3,
+		BC4,
+		BC5,
+		BC7
+	};
+
+	BcKind Kind(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+			return BcKind::BC1;
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+			return BcKind::BC3;
+		case DXGI_FORMAT_BC4_UNORM:
+			return BcKind::BC4;
+		case DXGI_FORMAT_BC5_UNORM:
+			return BcKind::BC5;
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			return BcKind::BC7;
+		default:
+			return BcKind::Unknown;
+		}
+	}
+
+	// Whether the source is 8-bit RGBA, and whether red and blue are swapped.
+	bool SourceLayout(DXGI_FORMAT format, bool& bgra)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+			bgra = false;
+			return true;
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+			bgra = true;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Shared encoder pieces
+	//--------------------------------------------------------------------------------------
+
+	// A 4x4 block as floats in [0, 255], one array per channel, so that four texels
+	// of a channel fill an SSE register.
+	struct Texels
+	{
+		alignas(16) float C[4][16];
+	};
+
+	void LoadTexels(const uint8_t rgba[64], Texels& t)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				t.C[c][i] = rgba[i * 4 + c];
+			}
+		}
+	}
+
+	// Picks for each texel the nearest of count palette entries, measured over the
+	// channels with a non-zero weight, and returns the total error.  Texels whose
+	// texelWeights entry is 0 get an index but add no error.
+	float AssignIndices(const Texels& t, const float weights[4], const float palette[][4], int count,
+		uint8_t indices[16], const float* texelWeights = nullptr)
+	{
+		float total = 0.0f;
+		for (int g = 0; g < 16; g += 4)
+		{
+			__m128 x[4];
+			for (int c = 0; c < 4; ++c)
+			{
+				x[c] = _mm_load_ps(&t.C[c][g]);
+			}
+
+			__m128 bestError = _mm_set1_ps(FLT_MAX);
+			__m128 bestIndex = _mm_setzero_ps();
+			for (int p = 0; p < count; ++p)
+			{
+				__m128 error = _mm_setzero_ps();
+				for (int c = 0; c < 4; ++c)
+				{
+					if (weights[c] == 0.0f)
+						continue;
+
+					__m128 d = _mm_sub_ps(x[c], _mm_set1_ps(palette[p][c]));
+					error = _mm_add_ps(error, _mm_mul_ps(_mm_mul_ps(d, d), _mm_set1_ps(weights[c])));
+				}
+
+				__m128 closer = _mm_cmplt_ps(error, bestError);
+				bestError = _mm_min_ps(error, bestError);
+				bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps((float)p)), _mm_andnot_ps(closer, bestIndex));
+			}
+
+			if (texelWeights != nullptr)
+			{
+				bestError = _mm_mul_ps(bestError, _mm_loadu_ps(texelWeights + g));
+			}
+
+			alignas(16) float index[4];
+			alignas(16) float error[4];
+			_mm_store_ps(index, bestIndex);
+			_mm_store_ps(error, bestError);
+			for (int k = 0; k < 4; ++k)
+			{
+				indices[g + k] = (uint8_t)index[k];
+				total += error[k];
+			}
+		}
+		return total;
+	}
+
+	// Endpoints along the principal axis of the texels over channels [first, first +
+	// count): the extremes of their projections onto the axis, found by power
+	// iteration on the covariance.  use selects texels, or all when null.
+	void PrincipalEndpoints(const Texels& t, int first, int count, const bool* use, float e0[4], float e1[4])
+	{
+		float mean[4] = {};
+		float lo[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+		float hi[4] = {};
+		int n = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			if (use != nullptr && !use[i])
+				continue;
+
+			for (int c = first; c < first + count; ++c)
+			{
+				mean[c] += t.C[c][i];
+				lo[c] = std::min(lo[c], t.C[c][i]);
+				hi[c] = std::max(hi[c], t.C[c][i]);
+			}
+			n++;
+		}
+		if (n == 0)
+		{
+			std::fill(e0, e0 + 4, 0.0f);
+			std::fill(e1, e1 + 4, 0.0f);
+			return;
+		}
+
+		float cov[4][4] = {};
+		for (int c = first; c < first + count; ++c)
+		{
+			mean[c] /= n;
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			if (use != nullptr && !use[i])
+				continue;
+
+			for (int a = first; a < first + count; ++a)
+			{
+				for (int b = first; b < first + count; ++b)
+				{
+					cov[a][b] += (t.C[a][i] - mean[a]) * (t.C[b][i] - mean[b]);
+				}
+			}
+		}
+
+		// Start from the bounding box diagonal, which is close for most blocks.
+		float axis[4] = {};
+		for (int c = first; c < first + count; ++c)
+		{
+			axis[c] = hi[c] - lo[c];
+		}
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float largest = 0.0f;
+			for (int a = first; a < first + count; ++a)
+			{
+				for (int b = first; b < first + count; ++b)
+				{
+					next[a] += cov[a][b] * axis[b];
+				}
+				largest = std::max(largest, fabsf(next[a]));
+			}
+			if (largest == 0.0f)
+				break;
+
+			for (int c = first; c < first + count; ++c)
+			{
+				axis[c] = next[c] / largest;
+			}
+		}
+
+		float length2 = 0.0f;
+		for (int c = first; c < first + count; ++c)
+		{
+			length2 += axis[c] * axis[c];
+		}
+		if (length2 == 0.0f)
+		{
+			// Every used texel is the same colour.
+			for (int c = first; c < first + count; ++c)
+			{
+				e0[c] = e1[c] = mean[c];
+			}
+			return;
+		}
+
+		float minProj = FLT_MAX;
+		float maxProj = -FLT_MAX;
+		for (int i = 0; i < 16; ++i)
+		{
+			if (use != nullptr && !use[i])
+				continue;
+
+			float proj = 0.0f;
+			for (int c = first; c < first + count; ++c)
+			{
+				proj += (t.C[c][i] - mean[c]) * axis[c];
+			}
+			minProj = std::min(minProj, proj);
+			maxProj = std::max(maxProj, proj);
+		}
+
+		for (int c = first; c < first + count; ++c)
+		{
+			e0[c] = std::clamp(mean[c] + minProj * axis[c] / length2, 0.0f, 255.0f);
+			e1[c] = std::clamp(mean[c] + maxProj * axis[c] / length2, 0.0f, 255.0f);
+		}
+	}
+
+	// Endpoints with the least squared error for fixed interpolation fractions: frac[i]
+	// is 0 at e0 and 1 at e1, or negative to leave texel i out.
+	bool FitEndpoints(const Texels& t, const float frac[16], int first, int count, float e0[4], float e1[4])
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = {}, bx[4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			if (frac[i] < 0.0f)
+				continue;
+
+			float b = frac[i];
+			float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = first; c < first + count; ++c)
+			{
+				ax[c] += a * t.C[c][i];
+				bx[c] += b * t.C[c][i];
+			}
+		}
+
+		float det = aa * bb - ab * ab;
+		if (fabsf(det) < 1e-6f)
+			return false;
+
+		for (int c = first; c < first + count; ++c)
+		{
+			e0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / det, 0.0f, 255.0f);
+			e1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / det, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// BC1 (and the colour half of BC3)
+	//--------------------------------------------------------------------------------------
+	uint16_t Pack565(const float c[4])
+	{
+		int r = std::clamp((int)(c[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+		int g = std::clamp((int)(c[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+		int b = std::clamp((int)(c[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	void Unpack565(uint16_t v, int rgb[3])
+	{
+		int r = (v >> 11) & 31;
+		int g = (v >> 5) & 63;
+		int b = v & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	// The texels a colour block decodes to.  BC3 colour blocks always use four colours.
+	void BC1Palette(uint16_t c0, uint16_t c1, bool fourColor, int palette[4][4])
+	{
+		int a[3], b[3];
+		Unpack565(c0, a);
+		Unpack565(c1, b);
+
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[0][c] = a[c];
+			palette[1][c] = b[c];
+			if (fourColor)
+			{
+				palette[2][c] = (2 * a[c] + b[c] + 1) / 3;
+				palette[3][c] = (a[c] + 2 * b[c] + 1) / 3;
+			}
+			else
+			{
+				palette[2][c] = (a[c] + b[c] + 1) / 2;
+				palette[3][c] = 0;
+			}
+		}
+		palette[0][3] = palette[1][3] = palette[2][3] = 255;
+		palette[3][3] = fourColor ? 255 : 0;
+	}
+
+	void PutUint16(uint8_t* out, uint16_t v)
+	{
+		out[0] = (uint8_t)v;
+		out[1] = (uint8_t)(v >> 8);
+	}
+
+	uint16_t GetUint16(const uint8_t* in)
+	{
+		return (uint16_t)(in[0] | (in[1] << 8));
+	}
+
+	// Encodes one colour block for endpoints a and b; fourColor picks the mode unless
+	// bc3 forces four colours.  Transparent texels get index 3 of a 3-colour block.
+	float EvaluateBC1(const Texels& t, const float a[4], const float b[4], bool fourColor, bool bc3,
+		const bool transparent[16], const float texelWeights[16], uint8_t out[8], float frac[16])
+	{
+		uint16_t c0 = Pack565(a);
+		uint16_t c1 = Pack565(b);
+		bool swapped = false;
+		if (!bc3 && (fourColor ? c0 < c1 : c0 > c1))
+		{
+			std::swap(c0, c1);
+			swapped = true;
+		}
+		bool isFour = bc3 || c0 > c1;
+
+		int palette[4][4];
+		BC1Palette(c0, c1, isFour, palette);
+		float paletteF[4][4];
+		for (int p = 0; p < 4; ++p)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				paletteF[p][c] = (float)palette[p][c];
+			}
+		}
+
+		const float weights[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+		uint8_t indices[16];
+		float error = AssignIndices(t, weights, paletteF, isFour ? 4 : 3, indices, texelWeights);
+
+		// Fractions toward the caller's endpoint b, for refitting.
+		static const float FourColorFrac[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		static const float ThreeColorFrac[3] = { 0.0f, 1.0f, 0.5f };
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			if (transparent[i])
+			{
+				indices[i] = 3;
+				frac[i] = -1.0f;
+			}
+			else
+			{
+				float f = isFour ? FourColorFrac[indices[i]] : ThreeColorFrac[indices[i]];
+				frac[i] = swapped ? 1.0f - f : f;
+			}
+			bits |= (uint32_t)indices[i] << (2 * i);
+		}
+
+		PutUint16(out, c0);
+		PutUint16(out + 2, c1);
+		memcpy(out + 4, &bits, 4);
+		return error;
+	}
+
+	void EncodeBC1(const Texels& t, uint8_t out[8], uint8_t alphaThreshold, bool high, bool bc3)
+	{
+		bool transparent[16] = {};
+		bool use[16];
+		float texelWeights[16];
+		int opaque = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			transparent[i] = !bc3 && alphaThreshold > 0 && t.C[3][i] < alphaThreshold;
+			use[i] = !transparent[i];
+			texelWeights[i] = use[i] ? 1.0f : 0.0f;
+			opaque += use[i] ? 1 : 0;
+		}
+
+		if (opaque == 0)
+		{
+			// Equal endpoints select 3-colour mode, and index 3 is transparent black.
+			memset(out, 0, 4);
+			memset(out + 4, 0xff, 4);
+			return;
+		}
+		const bool needsTransparency = opaque < 16;
+
+		float e0[4] = {}, e1[4] = {};
+		PrincipalEndpoints(t, 0, 3, use, e1, e0);
+
+		if (!high)
+		{
+			// Pull the endpoints in a little: the extremes are rarely worth a palette entry.
+			for (int c = 0; c < 3; ++c)
+			{
+				float inset = (e0[c] - e1[c]) / 16.0f;
+				e0[c] -= inset;
+				e1[c] += inset;
+			}
+		}
+
+		float frac[16];
+		float bestError = EvaluateBC1(t, e0, e1, !needsTransparency, bc3, transparent, texelWeights, out, frac);
+		if (!high)
+			return;
+
+		// Refine both modes by least squares, keeping the best block seen.
+		uint8_t candidate[8];
+		for (int mode = 0; mode < (needsTransparency || bc3 ? 1 : 2); ++mode)
+		{
+			bool fourColor = !needsTransparency && mode == 0;
+			float a[4] = { e0[0], e0[1], e0[2], 0.0f };
+			float b[4] = { e1[0], e1[1], e1[2], 0.0f };
+			for (int iteration = 0; iteration < 3; ++iteration)
+			{
+				float error = EvaluateBC1(t, a, b, fourColor, bc3, transparent, texelWeights, candidate, frac);
+				if (error < bestError)
+				{
+					bestError = error;
+					memcpy(out, candidate, 8);
+				}
+				if (!FitEndpoints(t, frac, 0, 3, a, b))
+					break;
+			}
+		}
+	}
+
+	void DecodeBC1(const uint8_t* block, uint8_t rgba[64], bool bc3)
+	{
+		uint16_t c0 = GetUint16(block);
+		uint16_t c1 = GetUint16(block + 2);
+		uint32_t bits;
+		memcpy(&bits, block + 4, 4);
+
+		int palette[4][4];
+		BC1Palette(c0, c1, bc3 || c0 > c1, palette);
+		for (int i = 0; i < 16; ++i)
+		{
+			const int* p = palette[(bits >> (2 * i)) & 3];
+			for (int c = 0; c < 4; ++c)
+			{
+				rgba[i * 4 + c] = (uint8_t)p[c];
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// BC4 (and the alpha half of BC3, and both halves of BC5)
+	//--------------------------------------------------------------------------------------
+	void BC4Palette(int r0, int r1, float palette[8])
+	{
+		palette[0] = (float)r0;
+		palette[1] = (float)r1;
+		if (r0 > r1)
+		{
+			for (int i = 1; i <= 6; ++i)
+			{
+				palette[i + 1] = ((7 - i) * r0 + i * r1) / 7.0f;
+			}
+		}
+		else
+		{
+			for (int i = 1; i <= 4; ++i)
+			{
+				palette[i + 1] = ((5 - i) * r0 + i * r1) / 5.0f;
+			}
+			palette[6] = 0.0f;
+			palette[7] = 255.0f;
+		}
+	}
+
+	float EvaluateBC4(const Texels& t, int channel, int r0, int r1, uint8_t out[8], float frac[16])
+	{
+		float values[8];
+		BC4Palette(r0, r1, values);
+
+		float palette[8][4] = {};
+		for (int p = 0; p < 8; ++p)
+		{
+			palette[p][channel] = values[p];
+		}
+		float weights[4] = {};
+		weights[channel] = 1.0f;
+
+		uint8_t indices[16];
+		float error = AssignIndices(t, weights, palette, 8, indices);
+
+		uint64_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			int index = indices[i];
+			bits |= (uint64_t)index << (3 * i);
+
+			// Only interpolated entries take part in a refit.
+			if (index <= 1)
+				frac[i] = (float)index;
+			else if (r0 > r1)
+				frac[i] = (index - 1) / 7.0f;
+			else
+				frac[i] = index < 6 ? (index - 1) / 5.0f : -1.0f;
+		}
+
+		out[0] = (uint8_t)r0;
+		out[1] = (uint8_t)r1;
+		for (int i = 0; i < 6; ++i)
+		{
+			out[2 + i] = (uint8_t)(bits >> (8 * i));
+		}
+		return error;
+	}
+
+	void EncodeBC4(const Texels& t, int channel, uint8_t out[8], bool high)
+	{
+		float lo = 255.0f, hi = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			lo = std::min(lo, t.C[channel][i]);
+			hi = std::max(hi, t.C[channel][i]);
+		}
+
+		float frac[16];
+		int r0 = (int)hi;
+		int r1 = (int)lo;
+		float bestError = EvaluateBC4(t, channel, r0, r1, out, frac);
+		if (!high || bestError == 0.0f)
+			return;
+
+		uint8_t candidate[8];
+		auto tryEndpoints = [&](int a, int b)
+		{
+			float error = EvaluateBC4(t, channel, std::clamp(a, 0, 255), std::clamp(b, 0, 255), candidate, frac);
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(out, candidate, 8);
+			}
+		};
+
+		// 8-value mode: refit, then search around the best endpoints.
+		float e0[4] = {}, e1[4] = {};
+		EvaluateBC4(t, channel, r0, r1, candidate, frac);
+		if (FitEndpoints(t, frac, channel, 1, e0, e1))
+		{
+			int a = (int)(e0[channel] + 0.5f);
+			int b = (int)(e1[channel] + 0.5f);
+			if (a > b)
+			{
+				tryEndpoints(a, b);
+			}
+		}
+		int bestR0 = out[0], bestR1 = out[1];
+		for (int d0 = -2; d0 <= 2; ++d0)
+		{
+			for (int d1 = -2; d1 <= 2; ++d1)
+			{
+				if (bestR0 + d0 > bestR1 + d1)
+				{
+					tryEndpoints(bestR0 + d0, bestR1 + d1);
+				}
+			}
+		}
+
+		// 6-value mode, which has exact 0 and 255 for the texels at the extremes.
+		float innerLo = 255.0f, innerHi = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			float v = t.C[channel][i];
+			if (v > 8.0f && v < 247.0f)
+			{
+				innerLo = std::min(innerLo, v);
+				innerHi = std::max(innerHi, v);
+			}
+		}
+		if (innerLo <= innerHi)
+		{
+			tryEndpoints((int)innerLo, (int)(innerHi + 0.5f));
+		}
+	}
+
+	void DecodeBC4(const uint8_t* block, uint8_t values[16])
+	{
+		float palette[8];
+		BC4Palette(block[0], block[1], palette);
+
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; ++i)
+		{
+			bits |= (uint64_t)block[2 + i] << (8 * i);
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			values[i] = (uint8_t)(palette[(bits >> (3 * i)) & 7] + 0.5f);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// BC7: encoded with modes 5 and 6, decoded in all eight modes
+	//--------------------------------------------------------------------------------------
+	const int Weights2[4] = { 0, 21, 43, 64 };
+	const int Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	const int Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	int Interpolate(int a, int b, int weight)
+	{
+		return ((64 - weight) * a + weight * b + 32) >> 6;
+	}
+
+	// Bits are stored from the least significant bit of the first byte on.
+	struct BitWriter
+	{
+		uint8_t* Out;
+		int Position = 0;
+
+		void Put(uint32_t value, int bits)
+		{
+			for (int i = 0; i < bits; ++i, ++Position)
+			{
+				if ((value >> i) & 1)
+				{
+					Out[Position >> 3] |= (uint8_t)(1 << (Position & 7));
+				}
+			}
+		}
+	};
+
+	struct BitReader
+	{
+		const uint8_t* In;
+		int Position = 0;
+
+		uint32_t Get(int bits)
+		{
+			uint32_t value = 0;
+			for (int i = 0; i < bits; ++i, ++Position)
+			{
+				value |= (uint32_t)((In[Position >> 3] >> (Position & 7)) & 1) << i;
+			}
+			return value;
+		}
+	};
+
+	// 7-bit endpoints sharing a p-bit: (q << 1) | p.  Picks the p-bit that
+	// reconstructs the endpoint best.
+	void QuantizeWithPBit(const float e[4], int q[4], int& p)
+	{
+		float bestError = FLT_MAX;
+		for (int pbit = 0; pbit < 2; ++pbit)
+		{
+			int candidate[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; ++c)
+			{
+				candidate[c] = std::clamp((int)floorf((e[c] - pbit) / 2.0f + 0.5f), 0, 127);
+				float d = (float)((candidate[c] << 1) | pbit) - e[c];
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				p = pbit;
+				memcpy(q, candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	// Mode 6: one subset, RGBA endpoints of 7 bits plus a p-bit each, 4-bit indices.
+	float EncodeMode6(const Texels& t, bool high, uint8_t out[16])
+	{
+		float e0[4], e1[4];
+		PrincipalEndpoints(t, 0, 4, nullptr, e0, e1);
+
+		const float weights[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		float bestError = FLT_MAX;
+		int q0[4], q1[4], p0 = 0, p1 = 0;
+		uint8_t indices[16];
+
+		for (int iteration = 0; iteration < (high ? 3 : 1); ++iteration)
+		{
+			int a[4], b[4], pa, pb;
+			QuantizeWithPBit(e0, a, pa);
+			QuantizeWithPBit(e1, b, pb);
+
+			float palette[16][4];
+			for (int i = 0; i < 16; ++i)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					palette[i][c] = (float)Interpolate((a[c] << 1) | pa, (b[c] << 1) | pb, Weights4[i]);
+				}
+			}
+
+			uint8_t candidate[16];
+			float error = AssignIndices(t, weights, palette, 16, candidate);
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(q0, a, sizeof(a));
+				memcpy(q1, b, sizeof(b));
+				p0 = pa;
+				p1 = pb;
+				memcpy(indices, candidate, 16);
+			}
+
+			float frac[16];
+			for (int i = 0; i < 16; ++i)
+			{
+				frac[i] = Weights4[candidate[i]] / 64.0f;
+			}
+			if (!FitEndpoints(t, frac, 0, 4, e0, e1))
+				break;
+		}
+
+		// The first index has an implicit leading zero.
+		if (indices[0] >= 8)
+		{
+			std::swap(q0, q1);
+			std::swap(p0, p1);
+			for (int i = 0; i < 16; ++i)
+			{
+				indices[i] = (uint8_t)(15 - indices[i]);
+			}
+		}
+
+		memset(out, 0, 16);
+		BitWriter w{ out };
+		w.Put(1 << 6, 7);
+		for (int c = 0; c < 4; ++c)
+		{
+			w.Put(q0[c], 7);
+			w.Put(q1[c], 7);
+		}
+		w.Put(p0, 1);
+		w.Put(p1, 1);
+		w.Put(indices[0], 3);
+		for (int i = 1; i < 16; ++i)
+		{
+			w.Put(indices[i], 4);
+		}
+		return bestError;
+	}
+
+	// Fits the 2-bit index endpoints of channels [first, first + count), quantised to
+	// bits each, and returns the error.
+	float FitMode5Part(const Texels& t, int first, int count, int bits, bool high, int q0[4], int q1[4],
+		uint8_t indices[16])
+	{
+		float e0[4] = {}, e1[4] = {};
+		PrincipalEndpoints(t, first, count, nullptr, e0, e1);
+
+		float weights[4] = {};
+		for (int c = first; c < first + count; ++c)
+		{
+			weights[c] = 1.0f;
+		}
+
+		const int maxValue = (1 << bits) - 1;
+		float bestError = FLT_MAX;
+		for (int iteration = 0; iteration < (high ? 3 : 1); ++iteration)
+		{
+			int a[4] = {}, b[4] = {};
+			float palette[4][4] = {};
+			for (int c = first; c < first + count; ++c)
+			{
+				a[c] = std::clamp((int)(e0[c] * maxValue / 255.0f + 0.5f), 0, maxValue);
+				b[c] = std::clamp((int)(e1[c] * maxValue / 255.0f + 0.5f), 0, maxValue);
+				int ea = (a[c] << (8 - bits)) | (a[c] >> (2 * bits - 8));
+				int eb = (b[c] << (8 - bits)) | (b[c] >> (2 * bits - 8));
+				for (int i = 0; i < 4; ++i)
+				{
+					palette[i][c] = (float)Interpolate(ea, eb, Weights2[i]);
+				}
+			}
+
+			uint8_t candidate[16];
+			float error = AssignIndices(t, weights, palette, 4, candidate);
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(q0, a, sizeof(a));
+				memcpy(q1, b, sizeof(b));
+				memcpy(indices, candidate, 16);
+			}
+
+			float frac[16];
+			for (int i = 0; i < 16; ++i)
+			{
+				frac[i] = Weights2[candidate[i]] / 64.0f;
+			}
+			if (!FitEndpoints(t, frac, first, count, e0, e1))
+				break;
+		}
+
+		// The first index has an implicit leading zero.
+		if (indices[0] >= 2)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				std::swap(q0[c], q1[c]);
+			}
+			for (int i = 0; i < 16; ++i)
+			{
+				indices[i] = (uint8_t)(3 - indices[i]);
+			}
+		}
+		return bestError;
+	}
+
+	// Mode 5: one subset, 7-bit colour and 8-bit alpha endpoints with separate 2-bit
+	// indices.  rotation swaps alpha with red, green or blue first, so that the
+	// channel varying independently of the others gets its own indices.
+	float EncodeMode5(const Texels& source, int rotation, bool high, uint8_t out[16])
+	{
+		Texels t = source;
+		if (rotation != 0)
+		{
+			std::swap(t.C[rotation - 1], t.C[3]);
+		}
+
+		int c0[4], c1[4], a0[4], a1[4];
+		uint8_t colorIndices[16], alphaIndices[16];
+		float error = FitMode5Part(t, 0, 3, 7, high, c0, c1, colorIndices);
+		error += FitMode5Part(t, 3, 1, 8, high, a0, a1, alphaIndices);
+
+		memset(out, 0, 16);
+		BitWriter w{ out };
+		w.Put(1 << 5, 6);
+		w.Put(rotation, 2);
+		for (int c = 0; c < 3; ++c)
+		{
+			w.Put(c0[c], 7);
+			w.Put(c1[c], 7);
+		}
+		w.Put(a0[3], 8);
+		w.Put(a1[3], 8);
+		w.Put(colorIndices[0], 1);
+		for (int i = 1; i < 16; ++i)
+		{
+			w.Put(colorIndices[i], 2);
+		}
+		w.Put(alphaIndices[0], 1);
+		for (int i = 1; i < 16; ++i)
+		{
+			w.Put(alphaIndices[i], 2);
+		}
+		return error;
+	}
+
+	void EncodeBC7(const Texels& t, uint8_t out[16], bool high)
+	{
+		float bestError = EncodeMode6(t, high, out);
+		if (!high || bestError == 0.0f)
+			return;
+
+		uint8_t candidate[16];
+		for (int rotation = 0; rotation < 4; ++rotation)
+		{
+			float error = EncodeMode5(t, rotation, high, candidate);
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(out, candidate, 16);
+			}
+		}
+	}
+
+	int Expand(uint32_t value, int bits)
+	{
+		return (int)((value << (8 - bits)) | (value >> (2 * bits - 8)));
+	}
+
+	// Partition of the 16 texels for 2-subset modes: bit i set puts texel i in subset 1.
+	const uint16_t Partitions2[64] =
+	{
+		0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+		0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+		0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+		0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+		0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+		0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+		0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+		0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22
+	};
+
+	// Partition for 3-subset modes: bits 2i and 2i + 1 hold texel i's subset.
+	const uint32_t Partitions3[64] =
+	{
+		0xaa685050, 0x6a5a5040, 0x5a5a4200, 0x5450a0a8, 0xa5a50000, 0xa0a05050, 0x5555a0a0, 0x5a5a5050,
+		0xaa550000, 0xaa555500, 0xaaaa5500, 0x90909090, 0x94949494, 0xa4a4a4a4, 0xa9a59450, 0x2a0a4250,
+		0xa5945040, 0x0a425054, 0xa5a5a500, 0x55a0a0a0, 0xa8a85454, 0x6a6a4040, 0xa4a45000, 0x1a1a0500,
+		0x0050a4a4, 0xaaa59090, 0x14696914, 0x69691400, 0xa08585a0, 0xaa821414, 0x50a4a450, 0x6a5a0200,
+		0xa9a58000, 0x5090a0a8, 0xa8a09050, 0x24242424, 0x00aa5500, 0x24924924, 0x24499224, 0x50a50a50,
+		0x500aa550, 0xaaaa4444, 0x66660000, 0xa5a0a5a0, 0x50a050a0, 0x69286928, 0x44aaaa44, 0x66666600,
+		0xaa444444, 0x54a854a8, 0x95809580, 0x96969600, 0xa85454a8, 0x80959580, 0xaa141414, 0x96960000,
+		0xaaaa1414, 0xa05050a0, 0xa0a5a5a0, 0x96000000, 0x40804080, 0xa9a8a9a8, 0xaaaaaa44, 0x2a4a5254
+	};
+
+	// The anchor texel of subset 1 in the 2-subset partitions, and of subsets 1 and 2
+	// in the 3-subset ones.  Texel 0 anchors subset 0.  An anchor's index is stored
+	// one bit short, its top bit implicitly zero.
+	const uint8_t Anchors2[64] =
+	{
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+		15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+		 6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+	};
+	const uint8_t Anchors3[2][64] =
+	{
+		{
+			 3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+			 3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+			 8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+			 3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3
+		},
+		{
+			15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+			15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+			15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+			15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8
+		}
+	};
+
+	struct Bc7Mode
+	{
+		int Subsets;
+		int PartitionBits;
+		int RotationBits;
+		int IndexModeBits;
+		int ColorBits;
+		int AlphaBits;
+		// One p-bit per endpoint, or one per subset shared by both endpoints.
+		int EndpointPBits;
+		int SharedPBits;
+		int IndexBits;
+		int SecondIndexBits;
+	};
+
+	const Bc7Mode Bc7Modes[8] =
+	{
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+	};
+
+	const int* WeightsFor(int bits)
+	{
+		return bits == 2 ? Weights2 : bits == 3 ? Weights3 : Weights4;
+	}
+
+	bool DecodeBC7(const uint8_t* block, uint8_t rgba[64])
+	{
+		int mode = 0;
+		while (mode < 8 && ((block[0] >> mode) & 1) == 0)
+		{
+			++mode;
+		}
+		// A block without a mode bit is reserved and decodes to transparent black.
+		if (mode == 8)
+		{
+			memset(rgba, 0, 64);
+			return false;
+		}
+
+		const Bc7Mode& m = Bc7Modes[mode];
+		BitReader r{ block, mode + 1 };
+		const int partition = (int)r.Get(m.PartitionBits);
+		const int rotation = (int)r.Get(m.RotationBits);
+		const int indexMode = (int)r.Get(m.IndexModeBits);
+
+		// Endpoints 2s and 2s + 1 belong to subset s; all reds come first, then greens,
+		// blues and alphas.
+		int endpoints[6][4];
+		for (int c = 0; c < 4; ++c)
+		{
+			const int bits = c < 3 ? m.ColorBits : m.AlphaBits;
+			for (int e = 0; e < m.Subsets * 2; ++e)
+			{
+				endpoints[e][c] = bits != 0 ? (int)r.Get(bits) : 255;
+			}
+		}
+
+		int pBits[6] = {};
+		for (int e = 0; e < m.Subsets * 2; ++e)
+		{
+			if (m.EndpointPBits != 0)
+			{
+				pBits[e] = (int)r.Get(1);
+			}
+			else if (m.SharedPBits != 0 && (e & 1) == 0)
+			{
+				pBits[e] = pBits[e + 1] = (int)r.Get(1);
+			}
+		}
+
+		const bool hasPBits = m.EndpointPBits != 0 || m.SharedPBits != 0;
+		for (int e = 0; e < m.Subsets * 2; ++e)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				const int bits = c < 3 ? m.ColorBits : m.AlphaBits;
+				if (bits == 0)
+					continue;
+				endpoints[e][c] = hasPBits ?
+					Expand((endpoints[e][c] << 1) | pBits[e], bits + 1) : Expand(endpoints[e][c], bits);
+			}
+		}
+
+		int subsets[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			subsets[i] = m.Subsets == 2 ? (Partitions2[partition] >> i) & 1 :
+				m.Subsets == 3 ? (Partitions3[partition] >> (2 * i)) & 3 : 0;
+		}
+
+		auto isAnchor = [&](int i)
+		{
+			return i == 0 ||
+				(m.Subsets == 2 && i == Anchors2[partition]) ||
+				(m.Subsets == 3 && (i == Anchors3[0][partition] || i == Anchors3[1][partition]));
+		};
+
+		int first[16], second[16] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			first[i] = (int)r.Get(isAnchor(i) ? m.IndexBits - 1 : m.IndexBits);
+		}
+		if (m.SecondIndexBits != 0)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				second[i] = (int)r.Get(i == 0 ? m.SecondIndexBits - 1 : m.SecondIndexBits);
+			}
+		}
+
+		// Modes 4 and 5 weight colour and alpha separately; indexMode swaps the sets.
+		const int* firstWeights = WeightsFor(m.IndexBits);
+		const int* secondWeights = WeightsFor(m.SecondIndexBits);
+		for (int i = 0; i < 16; ++i)
+		{
+			int colorWeight = firstWeights[first[i]];
+			int alphaWeight = colorWeight;
+			if (m.SecondIndexBits != 0)
+			{
+				alphaWeight = secondWeights[second[i]];
+				if (indexMode != 0)
+				{
+					std::swap(colorWeight, alphaWeight);
+				}
+			}
+
+			const int* e0 = endpoints[subsets[i] * 2];
+			const int* e1 = endpoints[subsets[i] * 2 + 1];
+			int texel[4];
+			for (int c = 0; c < 3; ++c)
+			{
+				texel[c] = Interpolate(e0[c], e1[c], colorWeight);
+			}
+			texel[3] = Interpolate(e0[3], e1[3], alphaWeight);
+			if (rotation != 0)
+			{
+				std::swap(texel[rotation - 1], texel[3]);
+			}
+
+			for (int c = 0; c < 4; ++c)
+			{
+				rgba[i * 4 + c] = (uint8_t)texel[c];
+			}
+		}
+		return true;
+	}
+
+	const uint32_t MinBlockRowsPerThread = 4;
+}
+
+BcResult BcTexture::Compress(DXGI_FORMAT bcFormat, const MipChain& source, const BcOptions& options)
+{
+	*this = BcTexture();
+	if (!IsSupported(bcFormat))
+		return BcResult::NotSupported;
+	if (source.LevelCount() == 0)
+		return BcResult::InvalidArgument;
+
+	format = bcFormat;
+	for (uint32_t i = 0; i < source.LevelCount(); ++i)
+	{
+		const MipLevel& level = source.Level(i);
+		BcResult result = AddLevel(source.Format(), level.Width, level.Height, source.LevelData(i), level.RowPitch, options);
+		if (result != BcResult::Ok)
+		{
+			*this = BcTexture();
+			return result;
+		}
+	}
+	return BcResult::Ok;
+}
+
+BcResult BcTexture::Compress(DXGI_FORMAT bcFormat, DXGI_FORMAT sourceFormat, uint32_t width, uint32_t height,
+	const void* pixels, size_t rowPitch, const BcOptions& options)
+{
+	*this = BcTexture();
+	if (!IsSupported(bcFormat))
+		return BcResult::NotSupported;
+
+	format = bcFormat;
+	BcResult result = AddLevel(sourceFormat, width, height, static_cast<const uint8_t*>(pixels), rowPitch, options);
+	if (result != BcResult::Ok)
+	{
+		*this = BcTexture();
+	}
+	return result;
+}
+
+bool BcTexture::Decompress(uint32_t level, uint8_t* rgba, size_t rowPitch)const
+{
+	const MipLevel& l = levels[level];
+	const size_t blockBytes = BlockBytes(format);
+	const uint32_t blocksX = (l.Width + 3) / 4;
+	const uint32_t blocksY = (l.Height + 3) / 4;
+
+	bool ok = true;
+	uint8_t texels[64];
+	for (uint32_t by = 0; by < blocksY; ++by)
+	{
+		for (uint32_t bx = 0; bx < blocksX; ++bx)
+		{
+			ok &= DecodeBlock(format, LevelData(level) + by * l.RowPitch + bx * blockBytes, texels);
+
+			// Blocks past the edge of the level are cut off.
+			for (uint32_t y = 0; y < 4 && by * 4 + y < l.Height; ++y)
+			{
+				uint32_t width = std::min(4u, l.Width - bx * 4);
+				memcpy(rgba + (by * 4 + y) * rowPitch + bx * 16, texels + y * 16, width * 4);
+			}
+		}
+	}
+	return ok;
+}
+
+DXGI_FORMAT BcTexture::Format()const
+{
+	return format;
+}
+
+uint32_t BcTexture::LevelCount()const
+{
+	return (uint32_t)levels.size();
+}
+
+const MipLevel& BcTexture::Level(uint32_t level)const
+{
+	return levels[level];
+}
+
+const uint8_t* BcTexture::LevelData(uint32_t level)const
+{
+	return data.data() + levels[level].Offset;
+}
+
+const uint8_t* BcTexture::Data()const
+{
+	return data.data();
+}
+
+size_t BcTexture::DataSize()const
+{
+	return data.size();
+}
+
+bool BcTexture::SaveDds(const std::filesystem::path& fileName)const
+{
+	if (levels.empty())
+		return false;
+
+	return DdsImage::Save(fileName, format, levels[0].Width, levels[0].Height, LevelCount(), 1, data.data(), data.size());
+}
+
+bool BcTexture::IsSupported(DXGI_FORMAT bcFormat)
+{
+	return Kind(bcFormat) != BcKind::Unknown;
+}
+
+size_t BcTexture::BlockBytes(DXGI_FORMAT bcFormat)
+{
+	BcKind kind = Kind(bcFormat);
+	return kind == BcKind::BC1 || kind == BcKind::BC4 ? 8 : 16;
+}
+
+void BcTexture::EncodeBlock(DXGI_FORMAT bcFormat, const uint8_t rgba[64], uint8_t* block, const BcOptions& options)
+{
+	Texels t;
+	LoadTexels(rgba, t);
+	const bool high = options.Quality == BcQuality::High;
+
+	switch (Kind(bcFormat))
+	{
+	case BcKind::BC1:
+		EncodeBC1(t, block, options.AlphaThreshold, high, false);
+		break;
+	case BcKind::BC3:
+		EncodeBC4(t, 3, block, high);
+		EncodeBC1(t, block + 8, 0, high, true);
+		break;
+	case BcKind::BC4:
+		EncodeBC4(t, 0, block, high);
+		break;
+	case BcKind::BC5:
+		EncodeBC4(t, 0, block, high);
+		EncodeBC4(t, 1, block + 8, high);
+		break;
+	case BcKind::BC7:
+		EncodeBC7(t, block, high);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+bool BcTexture::DecodeBlock(DXGI_FORMAT bcFormat, const uint8_t* block, uint8_t rgba[64])
+{
+	uint8_t values[16];
+	switch (Kind(bcFormat))
+	{
+	case BcKind::BC1:
+		DecodeBC1(block, rgba, false);
+		return true;
+	case BcKind::BC3:
+		DecodeBC1(block + 8, rgba, true);
+		DecodeBC4(block, values);
+		for (int i = 0; i < 16; ++i)
+		{
+			rgba[i * 4 + 3] = values[i];
+		}
+		return true;
+	case BcKind::BC4:
+		DecodeBC4(block, values);
+		for (int i = 0; i < 16; ++i)
+		{
+			rgba[i * 4 + 0] = values[i];
+			rgba[i * 4 + 1] = 0;
+			rgba[i * 4 + 2] = 0;
+			rgba[i * 4 + 3] = 255;
+		}
+		return true;
+	case BcKind::BC5:
+		DecodeBC4(block, values);
+		for (int i = 0; i < 16; ++i)
+		{
+			rgba[i * 4 + 0] = values[i];
+			rgba[i * 4 + 2] = 0;
+			rgba[i * 4 + 3] = 255;
+		}
+		DecodeBC4(block + 8, values);
+		for (int i = 0; i < 16; ++i)
+		{
+			rgba[i * 4 + 1] = values[i];
+		}
+		return true;
+	case BcKind::BC7:
+		return DecodeBC7(block, rgba);
+	default:
+		return false;
+	}
+}
+
+BcResult BcTexture::AddLevel(DXGI_FORMAT sourceFormat, uint32_t width, uint32_t height, const uint8_t* pixels,
+	size_t rowPitch, const BcOptions& options)
+{
+	bool bgra = false;
+	if (!SourceLayout(sourceFormat, bgra))
+		return BcResult::NotSupported;
+	if (width == 0 || height == 0 || pixels == nullptr || rowPitch < width * 4)
+		return BcResult::InvalidArgument;
+
+	const size_t blockBytes = BlockBytes(format);
+	const uint32_t blocksX = (width + 3) / 4;
+	const uint32_t blocksY = (height + 3) / 4;
+
+	MipLevel level;
+	level.Width = width;
+	level.Height = height;
+	level.RowPitch = blocksX * blockBytes;
+	level.Offset = data.size();
+	levels.push_back(level);
+	data.resize(data.size() + level.RowPitch * blocksY);
+
+	uint8_t* out = data.data() + level.Offset;
+	ParallelFor(blocksY, DefaultThreadCount(options.ThreadCount), MinBlockRowsPerThread, [&](uint32_t begin, uint32_t end)
+	{
+		uint8_t rgba[64];
+		for (uint32_t by = begin; by < end; ++by)
+		{
+			for (uint32_t bx = 0; bx < blocksX; ++bx)
+			{
+				// Blocks past the edge of the image repeat its last row and column.
+				for (uint32_t y = 0; y < 4; ++y)
+				{
+					const uint8_t* row = pixels + std::min(by * 4 + y, height - 1) * rowPitch;
+					for (uint32_t x = 0; x < 4; ++x)
+					{
+						const uint8_t* texel = row + std::min(bx * 4 + x, width - 1) * 4;
+						uint8_t* dst = rgba + (y * 4 + x) * 4;
+						dst[0] = texel[bgra ? 2 : 0];
+						dst[1] = texel[1];
+						dst[2] = texel[bgra ? 0 : 2];
+						dst[3] = texel[3];
+					}
+				}
+				EncodeBlock(format, rgba, out + by * level.RowPitch + bx * blockBytes, options);
+			}
+		}
+	});
+	return BcResult::Ok;
+}
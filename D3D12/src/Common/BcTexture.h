@@ -0,0 +1,106 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+#include "DxgiFormat.h"
+#include "MipChain.h"
+
+enum class BcQuality
+{
+	// One endpoint fit per block: the inset principal axis for BC1, the range for BC4,
+	// the principal axis for BC7 mode 6.
+	Fast,
+	// Principal axis fits refined by least squares, both BC1 and BC4 modes, and BC7
+	// modes 5 and 6 with every channel rotation, keeping the smallest error.
+	High
+};
+
+struct BcOptions
+{
+	BcQuality Quality = BcQuality::Fast;
+	// BC1 only: texels with alpha below this are transparent, which needs 3-colour
+	// blocks.  0 encodes every texel as opaque.
+	uint8_t AlphaThreshold = 128;
+	// Threads encoding each level; 0 for one per hardware thread.
+	uint32_t ThreadCount = 0;
+};
+
+enum class BcResult
+{
+	Ok,
+	// Zero size, no data or a row pitch smaller than a row.
+	InvalidArgument,
+	// A target other than BC1, BC3, BC4, BC5 or BC7, or a source other than RGBA8/BGRA8.
+	NotSupported
+};
+
+// A 2D texture compressed to BC1, BC3, BC4, BC5 or BC7 on the CPU.  Blocks are
+// encoded in parallel across block rows; within a block the index search tests four
+// texels at a time with SSE.  The levels are tightly packed in DDS layout, so
+// SaveDds writes a file CreateDDSTextureFromFile12 loads as is.
+//
+// BC5 suits tangent-space normal maps (X and Y, Z rebuilt in the shader) and BC4
+// single-channel masks.  BC7 is encoded with modes 5 and 6 only, which need no
+// partition tables; DecodeBlock decodes all eight modes, so BC7 files from other
+// encoders can be read back.
+// Endpoints are fitted to the stored values, so _SRGB targets are fitted in sRGB
+// space, where the hardware interpolates them.
+class BcTexture
+{
+public:
+	///<summary>
+	/// Compresses every level of source, which must be 8-bit RGBA or BGRA.
+	///</summary>
+	BcResult Compress(DXGI_FORMAT bcFormat, const MipChain& source, const BcOptions& options = BcOptions());
+
+	///<summary>
+	/// Compresses a single-level width x height image of sourceFormat.
+	///</summary>
+	BcResult Compress(DXGI_FORMAT bcFormat, DXGI_FORMAT sourceFormat, uint32_t width, uint32_t height,
+		const void* pixels, size_t rowPitch, const BcOptions& options = BcOptions());
+
+	///<summary>
+	/// Decodes level to RGBA8 texels, rowPitch bytes apart, for validation.  BC4 and
+	/// BC5 decode to (R, 0, 0, 255) and (R, G, 0, 255) as the hardware does.
+	///</summary>
+	bool Decompress(uint32_t level, uint8_t* rgba, size_t rowPitch)const;
+
+	DXGI_FORMAT Format()const;
+	uint32_t LevelCount()const;
+	// RowPitch is the size of one row of blocks.
+	const MipLevel& Level(uint32_t level)const;
+	const uint8_t* LevelData(uint32_t level)const;
+
+	const uint8_t* Data()const;
+	size_t DataSize()const;
+
+	bool SaveDds(const std::filesystem::path& fileName)const;
+
+	static bool IsSupported(DXGI_FORMAT bcFormat);
+
+	///<summary>
+	/// 8 for BC1 and BC4, 16 for the others.
+	///</summary>
+	static size_t BlockBytes(DXGI_FORMAT bcFormat);
+
+	///<summary>
+	/// Encodes a 4x4 block of RGBA8 texels, row by row.
+	///</summary>
+	static void EncodeBlock(DXGI_FORMAT bcFormat, const uint8_t rgba[64], uint8_t* block, const BcOptions& options);
+
+	///<summary>
+	/// Decodes a block to 4x4 RGBA8 texels, row by row.  Returns false for the
+	/// reserved BC7 mode, which decodes to transparent black.
+	///</summary>
+	static bool DecodeBlock(DXGI_FORMAT bcFormat, const uint8_t* block, uint8_t rgba[64]);
+
+private:
+	BcResult AddLevel(DXGI_FORMAT sourceFormat, uint32_t width, uint32_t height, const uint8_t* pixels,
+		size_t rowPitch, const BcOptions& options);
+
+private:
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	std::vector<MipLevel> levels;
+	std::vector<uint8_t> data;
+};
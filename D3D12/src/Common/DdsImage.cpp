@@ -0,0 +1,849 @@
+#include "DdsImage.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
+DdsResult DdsImage::Parse(const uint8_t* ddsData, size_t ddsDataSize)
+{
+	*this = DdsImage();
+
+	// Need at least enough data to fill the header and magic number to be a valid DDS
+	if (ddsData == nullptr || ddsDataSize < sizeof(uint32_t) + sizeof(DDS_HEADER))
+		return DdsResult::InvalidHeader;
+
+	// DDS files always start with the same magic number ("DDS ")
+	uint32_t magic;
+	std::memcpy(&magic, ddsData, sizeof(magic));
+	if (magic != DDS_MAGIC)
+		return DdsResult::InvalidHeader;
+
+	auto hdr = reinterpret_cast<const DDS_HEADER*>(ddsData + sizeof(uint32_t));
+	if (hdr->size != sizeof(DDS_HEADER) ||
+		hdr->ddspf.size != sizeof(DDS_PIXELFORMAT))
+	{
+		return DdsResult::InvalidHeader;
+	}
+
+	size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+	if ((hdr->ddspf.flags & DDS_FOURCC) &&
+		(MAKEFOURCC('D', 'X', '1', '0') == hdr->ddspf.fourCC))
+	{
+		// Must be long enough for both headers and magic value
+		if (ddsDataSize < offset + sizeof(DDS_HEADER_DXT10))
+			return DdsResult::InvalidHeader;
+
+		offset += sizeof(DDS_HEADER_DXT10);
+	}
+
+	return Parse(hdr, ddsData + offset, ddsDataSize - offset);
+}
+
+DdsResult DdsImage::Parse(const DDS_HEADER* hdr, const uint8_t* bits, size_t bitSize)
+{
+	*this = DdsImage();
+
+	uint32_t w = hdr->width;
+	uint32_t h = hdr->height;
+	uint32_t d = hdr->depth;
+	uint32_t mips = hdr->mipMapCount == 0 ? 1 : hdr->mipMapCount;
+	uint32_t slices = 1;
+	bool cube = false;
+	DXGI_FORMAT fmt = DXGI_FORMAT_UNKNOWN;
+	DdsDimension dim = DdsDimension::Unknown;
+
+	if ((hdr->ddspf.flags & DDS_FOURCC) && (MAKEFOURCC('D', 'X', '1', '0') == hdr->ddspf.fourCC))
+	{
+		auto d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>((const char*)hdr + sizeof(DDS_HEADER));
+
+		slices = d3d10ext->arraySize;
+		if (slices == 0)
+			return DdsResult::InvalidData;
+
+		switch (d3d10ext->dxgiFormat)
+		{
+		case DXGI_FORMAT_AI44:
+		case DXGI_FORMAT_IA44:
+		case DXGI_FORMAT_P8:
+		case DXGI_FORMAT_A8P8:
+			return DdsResult::NotSupported;
+
+		default:
+			if (BitsPerPixel(d3d10ext->dxgiFormat) == 0)
+				return DdsResult::NotSupported;
+		}
+		fmt = d3d10ext->dxgiFormat;
+
+		switch (d3d10ext->resourceDimension)
+		{
+		case DDS_DIMENSION_TEXTURE1D:
+			if ((hdr->flags & DDS_HEIGHT) && h != 1)
+				return DdsResult::InvalidData;
+			h = d = 1;
+			dim = DdsDimension::Texture1D;
+			break;
+
+		case DDS_DIMENSION_TEXTURE2D:
+			if (d3d10ext->miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)
+			{
+				if (slices > MaxArraySize / 6)
+					return DdsResult::NotSupported;
+				slices *= 6;
+				cube = true;
+			}
+			d = 1;
+			dim = DdsDimension::Texture2D;
+			break;
+
+		case DDS_DIMENSION_TEXTURE3D:
+			if (!(hdr->flags & DDS_HEADER_FLAGS_VOLUME))
+				return DdsResult::InvalidData;
+			if (slices > 1)
+				return DdsResult::NotSupported;
+			dim = DdsDimension::Texture3D;
+			break;
+
+		default:
+			return DdsResult::NotSupported;
+		}
+	}
+	else
+	{
+		fmt = GetDXGIFormat(hdr->ddspf);
+		if (fmt == DXGI_FORMAT_UNKNOWN)
+			return DdsResult::NotSupported;
+
+		if (hdr->flags & DDS_HEADER_FLAGS_VOLUME)
+		{
+			dim = DdsDimension::Texture3D;
+		}
+		else
+		{
+			if (hdr->caps2 & DDS_CUBEMAP)
+			{
+				// We require all six faces to be defined
+				if ((hdr->caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
+					return DdsResult::NotSupported;
+				slices = 6;
+				cube = true;
+			}
+			d = 1;
+			dim = DdsDimension::Texture2D;
+		}
+	}
+
+	if (w == 0 || h == 0 || d == 0)
+		return DdsResult::InvalidData;
+
+	// Bound sizes (for security purposes we don't trust DDS file metadata larger than the hardware requirements)
+	if (mips > MaxMipLevels)
+		return DdsResult::NotSupported;
+
+	switch (dim)
+	{
+	case DdsDimension::Texture1D:
+		if (slices > MaxArraySize || w > MaxTexture1DWidth)
+			return DdsResult::NotSupported;
+		break;
+
+	case DdsDimension::Texture2D:
+		if (slices > MaxArraySize)
+			return DdsResult::NotSupported;
+		if (cube ? (w > MaxTextureCubeDimension || h > MaxTextureCubeDimension) :
+			(w > MaxTexture2DDimension || h > MaxTexture2DDimension))
+		{
+			return DdsResult::NotSupported;
+		}
+		break;
+
+	default:
+		if (w > MaxTexture3DDimension || h > MaxTexture3DDimension || d > MaxTexture3DDimension)
+			return DdsResult::NotSupported;
+		break;
+	}
+
+	// Every array slice holds the same chain of mips, each Depth surfaces deep.
+	size_t offset = 0;
+	for (uint32_t mip = 0; mip < mips; ++mip)
+	{
+		mipOffsets[mip] = offset;
+
+		size_t numBytes = 0;
+		GetSurfaceInfo(std::max(w >> mip, 1u), std::max(h >> mip, 1u), fmt, &numBytes, nullptr, nullptr);
+		offset += numBytes * std::max(d >> mip, 1u);
+	}
+	sliceSize = offset;
+
+	if (bits == nullptr || sliceSize > bitSize / slices)
+	{
+		*this = DdsImage();
+		return DdsResult::Truncated;
+	}
+
+	header = hdr;
+	bitData = bits;
+	format = fmt;
+	dimension = dim;
+	width = w;
+	height = h;
+	depth = d;
+	mipCount = mips;
+	arraySize = slices;
+	cubeMap = cube;
+	return DdsResult::Ok;
+}
+
+const DDS_HEADER* DdsImage::Header()const
+{
+	return header;
+}
+
+DXGI_FORMAT DdsImage::Format()const
+{
+	return format;
+}
+
+DdsDimension DdsImage::Dimension()const
+{
+	return dimension;
+}
+
+uint32_t DdsImage::Width()const
+{
+	return width;
+}
+
+uint32_t DdsImage::Height()const
+{
+	return height;
+}
+
+uint32_t DdsImage::Depth()const
+{
+	return depth;
+}
+
+uint32_t DdsImage::MipCount()const
+{
+	return mipCount;
+}
+
+uint32_t DdsImage::ArraySize()const
+{
+	return arraySize;
+}
+
+bool DdsImage::IsCubeMap()const
+{
+	return cubeMap;
+}
+
+uint32_t DdsImage::SubresourceCount()const
+{
+	return mipCount * arraySize;
+}
+
+size_t DdsImage::DataSize()const
+{
+	return sliceSize * arraySize;
+}
+
+DdsSubresource DdsImage::Subresource(uint32_t index)const
+{
+	return Subresource(index % mipCount, index / mipCount);
+}
+
+DdsSubresource DdsImage::Subresource(uint32_t mip, uint32_t arraySlice)const
+{
+	assert(mip < mipCount && arraySlice < arraySize);
+
+	DdsSubresource s;
+	s.Width = std::max(width >> mip, 1u);
+	s.Height = std::max(height >> mip, 1u);
+	s.Depth = std::max(depth >> mip, 1u);
+	GetSurfaceInfo(s.Width, s.Height, format, &s.SlicePitch, &s.RowPitch, &s.NumRows);
+	s.Data = bitData + sliceSize * arraySlice + mipOffsets[mip];
+	return s;
+}
+
+bool DdsImage::WriteHeader(uint8_t* out, DXGI_FORMAT format, uint32_t width, uint32_t height,
+	uint32_t mipCount, uint32_t arraySize)
+{
+	size_t numBytes = 0;
+	size_t rowBytes = 0;
+	GetSurfaceInfo(width, height, format, &numBytes, &rowBytes, nullptr);
+	if (numBytes == 0 || mipCount == 0 || arraySize == 0)
+		return false;
+
+	// Block-compressed formats give the size of the top level, others its pitch.
+	const bool compressed = numBytes != rowBytes * height;
+
+	DDS_HEADER header = {};
+	header.size = sizeof(DDS_HEADER);
+	header.flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP |
+		(compressed ? DDS_HEADER_FLAGS_LINEARSIZE : DDS_HEADER_FLAGS_PITCH);
+	header.height = height;
+	header.width = width;
+	header.pitchOrLinearSize = (uint32_t)(compressed ? numBytes : rowBytes);
+	header.mipMapCount = mipCount;
+	header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+	header.ddspf.flags = DDS_FOURCC;
+	header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+	header.caps = DDS_SURFACE_FLAGS_TEXTURE | (mipCount > 1 ? DDS_SURFACE_FLAGS_MIPMAP : 0);
+
+	DDS_HEADER_DXT10 dx10 = {};
+	dx10.dxgiFormat = format;
+	dx10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+	dx10.arraySize = arraySize;
+
+	std::memcpy(out, &DDS_MAGIC, sizeof(DDS_MAGIC));
+	std::memcpy(out + sizeof(DDS_MAGIC), &header, sizeof(header));
+	std::memcpy(out + sizeof(DDS_MAGIC) + sizeof(header), &dx10, sizeof(dx10));
+	return true;
+}
+
+bool DdsImage::Save(const std::filesystem::path& fileName, DXGI_FORMAT format, uint32_t width, uint32_t height,
+	uint32_t mipCount, uint32_t arraySize, const uint8_t* data, size_t dataSize)
+{
+	uint8_t headers[HeaderSize];
+	if (!WriteHeader(headers, format, width, height, mipCount, arraySize))
+		return false;
+
+	std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+
+	out.write(reinterpret_cast<const char*>(headers), sizeof(headers));
+	out.write(reinterpret_cast<const char*>(data), dataSize);
+	return (bool)out;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Return the BPP for a particular format
+//--------------------------------------------------------------------------------------
+size_t DdsImage::BitsPerPixel(DXGI_FORMAT fmt)
+{
+	switch( fmt )
+	{
+	case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+	case DXGI_FORMAT_R32G32B32A32_SINT:
+		return 128;
+
+	case DXGI_FORMAT_R32G32B32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32B32_UINT:
+	case DXGI_FORMAT_R32G32B32_SINT:
+		return 96;
+
+	case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_SINT:
+	case DXGI_FORMAT_R32G32_TYPELESS:
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R32G32_UINT:
+	case DXGI_FORMAT_R32G32_SINT:
+	case DXGI_FORMAT_R32G8X24_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+	case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+	case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+	case DXGI_FORMAT_Y416:
+	case DXGI_FORMAT_Y210:
+	case DXGI_FORMAT_Y216:
+		return 64;
+
+	case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+	case DXGI_FORMAT_R10G10B10A2_UNORM:
+	case DXGI_FORMAT_R10G10B10A2_UINT:
+	case DXGI_FORMAT_R11G11B10_FLOAT:
+	case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_R8G8B8A8_UINT:
+	case DXGI_FORMAT_R8G8B8A8_SNORM:
+	case DXGI_FORMAT_R8G8B8A8_SINT:
+	case DXGI_FORMAT_R16G16_TYPELESS:
+	case DXGI_FORMAT_R16G16_FLOAT:
+	case DXGI_FORMAT_R16G16_UNORM:
+	case DXGI_FORMAT_R16G16_UINT:
+	case DXGI_FORMAT_R16G16_SNORM:
+	case DXGI_FORMAT_R16G16_SINT:
+	case DXGI_FORMAT_R32_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT:
+	case DXGI_FORMAT_R32_FLOAT:
+	case DXGI_FORMAT_R32_UINT:
+	case DXGI_FORMAT_R32_SINT:
+	case DXGI_FORMAT_R24G8_TYPELESS:
+	case DXGI_FORMAT_D24_UNORM_S8_UINT:
+	case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+	case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+	case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+	case DXGI_FORMAT_R8G8_B8G8_UNORM:
+	case DXGI_FORMAT_G8R8_G8B8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+	case DXGI_FORMAT_AYUV:
+	case DXGI_FORMAT_Y410:
+	case DXGI_FORMAT_YUY2:
+		return 32;
+
+	case DXGI_FORMAT_P010:
+	case DXGI_FORMAT_P016:
+		return 24;
+
+	case DXGI_FORMAT_R8G8_TYPELESS:
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R8G8_UINT:
+	case DXGI_FORMAT_R8G8_SNORM:
+	case DXGI_FORMAT_R8G8_SINT:
+	case DXGI_FORMAT_R16_TYPELESS:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_D16_UNORM:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_UINT:
+	case DXGI_FORMAT_R16_SNORM:
+	case DXGI_FORMAT_R16_SINT:
+	case DXGI_FORMAT_B5G6R5_UNORM:
+	case DXGI_FORMAT_B5G5R5A1_UNORM:
+	case DXGI_FORMAT_A8P8:
+	case DXGI_FORMAT_B4G4R4A4_UNORM:
+		return 16;
+
+	case DXGI_FORMAT_NV12:
+	case DXGI_FORMAT_420_OPAQUE:
+	case DXGI_FORMAT_NV11:
+		return 12;
+
+	case DXGI_FORMAT_R8_TYPELESS:
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_R8_UINT:
+	case DXGI_FORMAT_R8_SNORM:
+	case DXGI_FORMAT_R8_SINT:
+	case DXGI_FORMAT_A8_UNORM:
+	case DXGI_FORMAT_AI44:
+	case DXGI_FORMAT_IA44:
+	case DXGI_FORMAT_P8:
+		return 8;
+
+	case DXGI_FORMAT_R1_UNORM:
+		return 1;
+
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 4;
+
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return 8;
+
+	default:
+		return 0;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Get surface information for a particular format
+//--------------------------------------------------------------------------------------
+void DdsImage::GetSurfaceInfo(size_t width, size_t height, DXGI_FORMAT fmt,
+	size_t* outNumBytes, size_t* outRowBytes, size_t* outNumRows)
+{
+	size_t numBytes = 0;
+	size_t rowBytes = 0;
+	size_t numRows = 0;
+
+	bool bc = false;
+	bool packed = false;
+	bool planar = false;
+	size_t bpe = 0;
+	switch (fmt)
+	{
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		bc=true;
+		bpe = 8;
+		break;
+
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		bc = true;
+		bpe = 16;
+		break;
+
+	case DXGI_FORMAT_R8G8_B8G8_UNORM:
+	case DXGI_FORMAT_G8R8_G8B8_UNORM:
+	case DXGI_FORMAT_YUY2:
+		packed = true;
+		bpe = 4;
+		break;
+
+	case DXGI_FORMAT_Y210:
+	case DXGI_FORMAT_Y216:
+		packed = true;
+		bpe = 8;
+		break;
+
+	case DXGI_FORMAT_NV12:
+	case DXGI_FORMAT_420_OPAQUE:
+		planar = true;
+		bpe = 2;
+		break;
+
+	case DXGI_FORMAT_P010:
+	case DXGI_FORMAT_P016:
+		planar = true;
+		bpe = 4;
+		break;
+
+	default:
+		break;
+	}
+
+	if (bc)
+	{
+		size_t numBlocksWide = 0;
+		if (width > 0)
+		{
+			numBlocksWide = std::max<size_t>( 1, (width + 3) / 4 );
+		}
+		size_t numBlocksHigh = 0;
+		if (height > 0)
+		{
+			numBlocksHigh = std::max<size_t>( 1, (height + 3) / 4 );
+		}
+		rowBytes = numBlocksWide * bpe;
+		numRows = numBlocksHigh;
+		numBytes = rowBytes * numBlocksHigh;
+	}
+	else if (packed)
+	{
+		rowBytes = ( ( width + 1 ) >> 1 ) * bpe;
+		numRows = height;
+		numBytes = rowBytes * height;
+	}
+	else if ( fmt == DXGI_FORMAT_NV11 )
+	{
+		rowBytes = ( ( width + 3 ) >> 2 ) * 4;
+		numRows = height * 2; // Direct3D makes this simplifying assumption, although it is larger than the 4:1:1 data
+		numBytes = rowBytes * numRows;
+	}
+	else if (planar)
+	{
+		rowBytes = ( ( width + 1 ) >> 1 ) * bpe;
+		numBytes = ( rowBytes * height ) + ( ( rowBytes * height + 1 ) >> 1 );
+		numRows = height + ( ( height + 1 ) >> 1 );
+	}
+	else
+	{
+		size_t bpp = BitsPerPixel( fmt );
+		rowBytes = ( width * bpp + 7 ) / 8; // round up to nearest byte
+		numRows = height;
+		numBytes = rowBytes * height;
+	}
+
+	if (outNumBytes)
+	{
+		*outNumBytes = numBytes;
+	}
+	if (outRowBytes)
+	{
+		*outRowBytes = rowBytes;
+	}
+	if (outNumRows)
+	{
+		*outNumRows = numRows;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+#define ISBITMASK( r,g,b,a ) ( ddpf.RBitMask == r && ddpf.GBitMask == g && ddpf.BBitMask == b && ddpf.ABitMask == a )
+
+DXGI_FORMAT DdsImage::GetDXGIFormat(const DDS_PIXELFORMAT& ddpf)
+{
+	if (ddpf.flags & DDS_RGB)
+	{
+		// Note that sRGB formats are written using the "DX10" extended header
+
+		switch (ddpf.RGBBitCount)
+		{
+		case 32:
+			if (ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0xff000000))
+			{
+				return DXGI_FORMAT_R8G8B8A8_UNORM;
+			}
+
+			if (ISBITMASK(0x00ff0000,0x0000ff00,0x000000ff,0xff000000))
+			{
+				return DXGI_FORMAT_B8G8R8A8_UNORM;
+			}
+
+			if (ISBITMASK(0x00ff0000,0x0000ff00,0x000000ff,0x00000000))
+			{
+				return DXGI_FORMAT_B8G8R8X8_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0x00000000) aka D3DFMT_X8B8G8R8
+
+			// Note that many common DDS reader/writers (including D3DX) swap the
+			// the RED/BLUE masks for 10:10:10:2 formats. We assume
+			// below that the 'backwards' header mask is being used since it is most
+			// likely written by D3DX. The more robust solution is to use the 'DX10'
+			// header extension and specify the DXGI_FORMAT_R10G10B10A2_UNORM format directly
+
+			// For 'correct' writers, this should be 0x000003ff,0x000ffc00,0x3ff00000 for RGB data
+			if (ISBITMASK(0x3ff00000,0x000ffc00,0x000003ff,0xc0000000))
+			{
+				return DXGI_FORMAT_R10G10B10A2_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x000003ff,0x000ffc00,0x3ff00000,0xc0000000) aka D3DFMT_A2R10G10B10
+
+			if (ISBITMASK(0x0000ffff,0xffff0000,0x00000000,0x00000000))
+			{
+				return DXGI_FORMAT_R16G16_UNORM;
+			}
+
+			if (ISBITMASK(0xffffffff,0x00000000,0x00000000,0x00000000))
+			{
+				// Only 32-bit color channel format in D3D9 was R32F
+				return DXGI_FORMAT_R32_FLOAT; // D3DX writes this out as a FourCC of 114
+			}
+			break;
+
+		case 24:
+			// No 24bpp DXGI formats aka D3DFMT_R8G8B8
+			break;
+
+		case 16:
+			if (ISBITMASK(0x7c00,0x03e0,0x001f,0x8000))
+			{
+				return DXGI_FORMAT_B5G5R5A1_UNORM;
+			}
+			if (ISBITMASK(0xf800,0x07e0,0x001f,0x0000))
+			{
+				return DXGI_FORMAT_B5G6R5_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x7c00,0x03e0,0x001f,0x0000) aka D3DFMT_X1R5G5B5
+
+			if (ISBITMASK(0x0f00,0x00f0,0x000f,0xf000))
+			{
+				return DXGI_FORMAT_B4G4R4A4_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x0f00,0x00f0,0x000f,0x0000) aka D3DFMT_X4R4G4B4
+
+			// No 3:3:2, 3:3:2:8, or paletted DXGI formats aka D3DFMT_A8R3G3B2, D3DFMT_R3G3B2, D3DFMT_P8, D3DFMT_A8P8, etc.
+			break;
+		}
+	}
+	else if (ddpf.flags & DDS_LUMINANCE)
+	{
+		if (8 == ddpf.RGBBitCount)
+		{
+			if (ISBITMASK(0x000000ff,0x00000000,0x00000000,0x00000000))
+			{
+				return DXGI_FORMAT_R8_UNORM; // D3DX10/11 writes this out as DX10 extension
+			}
+
+			// No DXGI format maps to ISBITMASK(0x0f,0x00,0x00,0xf0) aka D3DFMT_A4L4
+		}
+
+		if (16 == ddpf.RGBBitCount)
+		{
+			if (ISBITMASK(0x0000ffff,0x00000000,0x00000000,0x00000000))
+			{
+				return DXGI_FORMAT_R16_UNORM; // D3DX10/11 writes this out as DX10 extension
+			}
+			if (ISBITMASK(0x000000ff,0x00000000,0x00000000,0x0000ff00))
+			{
+				return DXGI_FORMAT_R8G8_UNORM; // D3DX10/11 writes this out as DX10 extension
+			}
+		}
+	}
+	else if (ddpf.flags & DDS_ALPHA)
+	{
+		if (8 == ddpf.RGBBitCount)
+		{
+			return DXGI_FORMAT_A8_UNORM;
+		}
+	}
+	else if (ddpf.flags & DDS_FOURCC)
+	{
+		if (MAKEFOURCC( 'D', 'X', 'T', '1' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC1_UNORM;
+		}
+		if (MAKEFOURCC( 'D', 'X', 'T', '3' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC2_UNORM;
+		}
+		if (MAKEFOURCC( 'D', 'X', 'T', '5' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC3_UNORM;
+		}
+
+		// While pre-multiplied alpha isn't directly supported by the DXGI formats,
+		// they are basically the same as these BC formats so they can be mapped
+		if (MAKEFOURCC( 'D', 'X', 'T', '2' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC2_UNORM;
+		}
+		if (MAKEFOURCC( 'D', 'X', 'T', '4' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC3_UNORM;
+		}
+
+		if (MAKEFOURCC( 'A', 'T', 'I', '1' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC4_UNORM;
+		}
+		if (MAKEFOURCC( 'B', 'C', '4', 'U' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC4_UNORM;
+		}
+		if (MAKEFOURCC( 'B', 'C', '4', 'S' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC4_SNORM;
+		}
+
+		if (MAKEFOURCC( 'A', 'T', 'I', '2' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC5_UNORM;
+		}
+		if (MAKEFOURCC( 'B', 'C', '5', 'U' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC5_UNORM;
+		}
+		if (MAKEFOURCC( 'B', 'C', '5', 'S' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC5_SNORM;
+		}
+
+		// BC6H and BC7 are written using the "DX10" extended header
+
+		if (MAKEFOURCC( 'R', 'G', 'B', 'G' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_R8G8_B8G8_UNORM;
+		}
+		if (MAKEFOURCC( 'G', 'R', 'G', 'B' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_G8R8_G8B8_UNORM;
+		}
+
+		if (MAKEFOURCC('Y','U','Y','2') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_YUY2;
+		}
+
+		// Check for D3DFORMAT enums being set here
+		switch( ddpf.fourCC )
+		{
+		case 36: // D3DFMT_A16B16G16R16
+			return DXGI_FORMAT_R16G16B16A16_UNORM;
+
+		case 110: // D3DFMT_Q16W16V16U16
+			return DXGI_FORMAT_R16G16B16A16_SNORM;
+
+		case 111: // D3DFMT_R16F
+			return DXGI_FORMAT_R16_FLOAT;
+
+		case 112: // D3DFMT_G16R16F
+			return DXGI_FORMAT_R16G16_FLOAT;
+
+		case 113: // D3DFMT_A16B16G16R16F
+			return DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+		case 114: // D3DFMT_R32F
+			return DXGI_FORMAT_R32_FLOAT;
+
+		case 115: // D3DFMT_G32R32F
+			return DXGI_FORMAT_R32G32_FLOAT;
+
+		case 116: // D3DFMT_A32B32G32R32F
+			return DXGI_FORMAT_R32G32B32A32_FLOAT;
+		}
+	}
+
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+
+#undef ISBITMASK
+
+
+//--------------------------------------------------------------------------------------
+DXGI_FORMAT DdsImage::MakeSRGB(DXGI_FORMAT format)
+{
+	switch( format )
+	{
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+		return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+
+	case DXGI_FORMAT_BC1_UNORM:
+		return DXGI_FORMAT_BC1_UNORM_SRGB;
+
+	case DXGI_FORMAT_BC2_UNORM:
+		return DXGI_FORMAT_BC2_UNORM_SRGB;
+
+	case DXGI_FORMAT_BC3_UNORM:
+		return DXGI_FORMAT_BC3_UNORM_SRGB;
+
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+		return DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+		return DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+
+	case DXGI_FORMAT_BC7_UNORM:
+		return DXGI_FORMAT_BC7_UNORM_SRGB;
+
+	default:
+		return format;
+	}
+}
@@ -0,0 +1,243 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include "DxgiFormat.h"
+
+//--------------------------------------------------------------------------------------
+// DDS file structure definitions
+//
+// See DDS.h in the 'Texconv' sample and the 'DirectXTex' library
+//--------------------------------------------------------------------------------------
+#ifndef MAKEFOURCC
+	#define MAKEFOURCC(ch0, ch1, ch2, ch3)                              \
+				((uint32_t)(uint8_t)(ch0) | ((uint32_t)(uint8_t)(ch1) << 8) |       \
+				((uint32_t)(uint8_t)(ch2) << 16) | ((uint32_t)(uint8_t)(ch3) << 24 ))
+#endif /* defined(MAKEFOURCC) */
+
+#pragma pack(push,1)
+
+const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+struct DDS_PIXELFORMAT
+{
+	uint32_t    size;
+	uint32_t    flags;
+	uint32_t    fourCC;
+	uint32_t    RGBBitCount;
+	uint32_t    RBitMask;
+	uint32_t    GBitMask;
+	uint32_t    BBitMask;
+	uint32_t    ABitMask;
+};
+
+#define DDS_FOURCC      0x00000004  // DDPF_FOURCC
+#define DDS_RGB         0x00000040  // DDPF_RGB
+#define DDS_LUMINANCE   0x00020000  // DDPF_LUMINANCE
+#define DDS_ALPHA       0x00000002  // DDPF_ALPHA
+
+#define DDS_HEADER_FLAGS_TEXTURE        0x00001007  // DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT
+#define DDS_HEADER_FLAGS_MIPMAP         0x00020000  // DDSD_MIPMAPCOUNT
+#define DDS_HEADER_FLAGS_VOLUME         0x00800000  // DDSD_DEPTH
+#define DDS_HEADER_FLAGS_PITCH          0x00000008  // DDSD_PITCH
+#define DDS_HEADER_FLAGS_LINEARSIZE     0x00080000  // DDSD_LINEARSIZE
+
+#define DDS_SURFACE_FLAGS_TEXTURE 0x00001000 // DDSCAPS_TEXTURE
+#define DDS_SURFACE_FLAGS_MIPMAP  0x00400008 // DDSCAPS_COMPLEX | DDSCAPS_MIPMAP
+
+#define DDS_HEIGHT 0x00000002 // DDSD_HEIGHT
+#define DDS_WIDTH  0x00000004 // DDSD_WIDTH
+
+#define DDS_CUBEMAP_POSITIVEX 0x00000600 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEX
+#define DDS_CUBEMAP_NEGATIVEX 0x00000a00 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEX
+#define DDS_CUBEMAP_POSITIVEY 0x00001200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEY
+#define DDS_CUBEMAP_NEGATIVEY 0x00002200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEY
+#define DDS_CUBEMAP_POSITIVEZ 0x00004200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEZ
+#define DDS_CUBEMAP_NEGATIVEZ 0x00008200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEZ
+
+#define DDS_CUBEMAP_ALLFACES ( DDS_CUBEMAP_POSITIVEX | DDS_CUBEMAP_NEGATIVEX |\
+							   DDS_CUBEMAP_POSITIVEY | DDS_CUBEMAP_NEGATIVEY |\
+							   DDS_CUBEMAP_POSITIVEZ | DDS_CUBEMAP_NEGATIVEZ )
+
+#define DDS_CUBEMAP 0x00000200 // DDSCAPS2_CUBEMAP
+
+// DDS_HEADER_DXT10::resourceDimension and miscFlag, the D3D10/11 values.
+#define DDS_DIMENSION_TEXTURE1D 2
+#define DDS_DIMENSION_TEXTURE2D 3
+#define DDS_DIMENSION_TEXTURE3D 4
+#define DDS_RESOURCE_MISC_TEXTURECUBE 0x4
+
+enum DDS_MISC_FLAGS2
+{
+	DDS_MISC_FLAGS2_ALPHA_MODE_MASK = 0x7L,
+};
+
+struct DDS_HEADER
+{
+	uint32_t        size;
+	uint32_t        flags;
+	uint32_t        height;
+	uint32_t        width;
+	uint32_t        pitchOrLinearSize;
+	uint32_t        depth; // only if DDS_HEADER_FLAGS_VOLUME is set in flags
+	uint32_t        mipMapCount;
+	uint32_t        reserved1[11];
+	DDS_PIXELFORMAT ddspf;
+	uint32_t        caps;
+	uint32_t        caps2;
+	uint32_t        caps3;
+	uint32_t        caps4;
+	uint32_t        reserved2;
+};
+
+struct DDS_HEADER_DXT10
+{
+	DXGI_FORMAT     dxgiFormat;
+	uint32_t        resourceDimension;
+	uint32_t        miscFlag; // see D3D11_RESOURCE_MISC_FLAG
+	uint32_t        arraySize;
+	uint32_t        miscFlags2;
+};
+
+#pragma pack(pop)
+
+enum class DdsResult
+{
+	Ok,
+	// Not a DDS file: bad magic number or header sizes.
+	InvalidHeader,
+	// A DDS file with contradictory or out of range metadata.
+	InvalidData,
+	// A valid DDS file this loader or D3D12 cannot represent.
+	NotSupported,
+	// Shorter than its header says.
+	Truncated
+};
+
+// The values of D3D12_RESOURCE_DIMENSION.
+enum class DdsDimension : uint32_t
+{
+	Unknown = 0,
+	Texture1D = 2,
+	Texture2D = 3,
+	Texture3D = 4
+};
+
+// Where one subresource's texels are in the file.  Rows of pixels (or of 4x4
+// blocks for block-compressed formats) are tightly packed: RowPitch bytes apart,
+// NumRows per depth slice, Depth slices SlicePitch bytes apart.
+struct DdsSubresource
+{
+	const uint8_t* Data = nullptr;
+	size_t RowPitch = 0;
+	size_t SlicePitch = 0;
+	size_t NumRows = 0;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t Depth = 0;
+};
+
+// Device-independent view of a DDS file in memory: validates the header, works out
+// format, dimensions and mip/array layout, and locates each subresource's texels
+// inside the file.  Stores no more than a pointer to the data and a fixed table of
+// mip offsets, so parsing allocates nothing and needs neither D3D nor Windows.
+// Subresources are numbered as in D3D12: mip + arraySlice * MipCount(), with cube
+// faces counted as array slices.
+class DdsImage
+{
+public:
+	// D3D12 hardware limits; larger textures are rejected as NotSupported.
+	static const uint32_t MaxMipLevels = 15;
+	static const uint32_t MaxTexture1DWidth = 16384;
+	static const uint32_t MaxTexture2DDimension = 16384;
+	static const uint32_t MaxTextureCubeDimension = 16384;
+	static const uint32_t MaxTexture3DDimension = 2048;
+	static const uint32_t MaxArraySize = 2048;
+
+	///<summary>
+	/// Parses a whole DDS file, starting with its magic number.  The image points into
+	/// ddsData, which must outlive it.
+	///</summary>
+	DdsResult Parse(const uint8_t* ddsData, size_t ddsDataSize);
+
+	///<summary>
+	/// Parses a file whose magic number and header sizes the caller has validated;
+	/// bitData is the texel data after the headers.
+	///</summary>
+	DdsResult Parse(const DDS_HEADER* header, const uint8_t* bitData, size_t bitSize);
+
+	const DDS_HEADER* Header()const;
+	DXGI_FORMAT Format()const;
+	DdsDimension Dimension()const;
+	uint32_t Width()const;
+	uint32_t Height()const;
+	uint32_t Depth()const;
+	uint32_t MipCount()const;
+	// Six per cube for cube maps.
+	uint32_t ArraySize()const;
+	bool IsCubeMap()const;
+	uint32_t SubresourceCount()const;
+
+	///<summary>
+	/// Bytes of texel data the subresources span; trailing data in the file is ignored.
+	///</summary>
+	size_t DataSize()const;
+
+	DdsSubresource Subresource(uint32_t index)const;
+	DdsSubresource Subresource(uint32_t mip, uint32_t arraySlice)const;
+
+	///<summary>
+	/// Bits per pixel of fmt, or 0 for formats a DDS file cannot hold.
+	///</summary>
+	static size_t BitsPerPixel(DXGI_FORMAT fmt);
+
+	///<summary>
+	/// Size of a width x height surface of fmt: total bytes, bytes per row of pixels
+	/// or blocks, and rows.
+	///</summary>
+	static void GetSurfaceInfo(size_t width, size_t height, DXGI_FORMAT fmt,
+		size_t* outNumBytes, size_t* outRowBytes, size_t* outNumRows);
+
+	///<summary>
+	/// DXGI format of a legacy (non-DX10) pixel format, or DXGI_FORMAT_UNKNOWN.
+	///</summary>
+	static DXGI_FORMAT GetDXGIFormat(const DDS_PIXELFORMAT& ddpf);
+
+	static DXGI_FORMAT MakeSRGB(DXGI_FORMAT format);
+
+	// Bytes WriteHeader writes: the magic number, the header and the DX10 header.
+	static const size_t HeaderSize = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+
+	///<summary>
+	/// Writes the headers of a 2D texture or texture array of mipCount levels to out,
+	/// HeaderSize bytes, so that texel data after them makes a DDS file in memory.
+	/// Returns false for formats a DDS file cannot hold.
+	///</summary>
+	static bool WriteHeader(uint8_t* out, DXGI_FORMAT format, uint32_t width, uint32_t height,
+		uint32_t mipCount, uint32_t arraySize);
+
+	///<summary>
+	/// Writes a 2D texture or texture array of mipCount levels as a DDS file with a
+	/// DX10 header.  data holds the levels of each slice tightly packed one after the
+	/// other, as Parse expects them.
+	///</summary>
+	static bool Save(const std::filesystem::path& fileName, DXGI_FORMAT format, uint32_t width, uint32_t height,
+		uint32_t mipCount, uint32_t arraySize, const uint8_t* data, size_t dataSize);
+
+private:
+	const DDS_HEADER* header = nullptr;
+	const uint8_t* bitData = nullptr;
+
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	DdsDimension dimension = DdsDimension::Unknown;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t depth = 0;
+	uint32_t mipCount = 0;
+	uint32_t arraySize = 0;
+	bool cubeMap = false;
+
+	// Offset of each mip within an array slice; slices are sliceSize bytes apart.
+	size_t mipOffsets[MaxMipLevels] = {};
+	size_t sliceSize = 0;
+};
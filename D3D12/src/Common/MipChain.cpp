@@ -0,0 +1,660 @@
+#include "MipChain.h"
+#include "DdsImage.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <xmmintrin.h>
+
+namespace
+{
+	enum class PixelType
+	{
+		Unorm8,
+		Float16,
+		Float32
+	};
+
+	struct PixelFormat
+	{
+		PixelType Type = PixelType::Unorm8;
+		bool SRGB = false;
+		size_t Bytes = 0;
+	};
+
+	bool Describe(DXGI_FORMAT format, PixelFormat& pf)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+			pf = { PixelType::Unorm8, false, 4 };
+			return true;
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+			pf = { PixelType::Unorm8, true, 4 };
+			return true;
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			pf = { PixelType::Float16, false, 8 };
+			return true;
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			pf = { PixelType::Float32, false, 16 };
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Texel encoding
+	//--------------------------------------------------------------------------------------
+	float SRGBToLinear(float s)
+	{
+		return s <= 0.04045f ? s / 12.92f : powf((s + 0.055f) / 1.055f, 2.4f);
+	}
+
+	// Decoding is a lookup per channel.  Encoding starts from a table indexed by the
+	// linear value, whose buckets are narrower than the gap between any two sRGB
+	// codes, and steps past at most one code threshold.
+	struct SRGBTables
+	{
+		static const int EncodeSize = 8192;
+
+		float ToLinear[256];
+		// Smallest linear value that encodes to each code.
+		float Thresholds[256];
+		uint8_t Encode[EncodeSize];
+
+		SRGBTables()
+		{
+			for (int c = 0; c < 256; ++c)
+			{
+				ToLinear[c] = SRGBToLinear(c / 255.0f);
+				Thresholds[c] = c == 0 ? 0.0f : SRGBToLinear((c - 0.5f) / 255.0f);
+			}
+
+			int code = 0;
+			for (int i = 0; i < EncodeSize; ++i)
+			{
+				float v = (float)i / (EncodeSize - 1);
+				while (code < 255 && Thresholds[code + 1] <= v)
+				{
+					++code;
+				}
+				Encode[i] = (uint8_t)code;
+			}
+		}
+	};
+
+	const SRGBTables& Tables()
+	{
+		static const SRGBTables tables;
+		return tables;
+	}
+
+	uint8_t EncodeSRGB(float v, const SRGBTables& t)
+	{
+		if (!(v > 0.0f))
+			return 0;
+		if (v >= 1.0f)
+			return 255;
+
+		int code = t.Encode[(int)(v * (SRGBTables::EncodeSize - 1))];
+		while (code < 255 && v >= t.Thresholds[code + 1])
+		{
+			++code;
+		}
+		return (uint8_t)code;
+	}
+
+	uint8_t EncodeUnorm(float v)
+	{
+		v = v > 0.0f ? (v < 1.0f ? v : 1.0f) : 0.0f;
+		return (uint8_t)(v * 255.0f + 0.5f);
+	}
+
+	float HalfToFloat(uint16_t h)
+	{
+		const uint32_t shiftedExp = 0x7c00u << 13;
+		const uint32_t magicBits = 113u << 23;
+		float magic;
+		memcpy(&magic, &magicBits, sizeof(magic));
+
+		uint32_t u = (uint32_t)(h & 0x7fff) << 13;
+		uint32_t exp = shiftedExp & u;
+		u += (127u - 15u) << 23;
+
+		float f;
+		if (exp == shiftedExp)
+		{
+			// Inf or NaN.
+			u += (128u - 16u) << 23;
+			memcpy(&f, &u, sizeof(f));
+		}
+		else if (exp == 0)
+		{
+			// Zero or denormal: renormalise through the FPU.
+			u += 1u << 23;
+			memcpy(&f, &u, sizeof(f));
+			f -= magic;
+		}
+		else
+		{
+			memcpy(&f, &u, sizeof(f));
+		}
+
+		uint32_t bits;
+		memcpy(&bits, &f, sizeof(bits));
+		bits |= (uint32_t)(h & 0x8000) << 16;
+		memcpy(&f, &bits, sizeof(f));
+		return f;
+	}
+
+	// Rounds to nearest even; overflow becomes infinity.
+	uint16_t FloatToHalf(float value)
+	{
+		const uint32_t infinity = 255u << 23;
+		const uint32_t halfMax = (127u + 16u) << 23;
+		const uint32_t denormMagicBits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+		uint32_t u;
+		memcpy(&u, &value, sizeof(u));
+		uint32_t sign = u & 0x80000000u;
+		u ^= sign;
+
+		uint16_t h;
+		if (u >= halfMax)
+		{
+			h = u > infinity ? 0x7e00 : 0x7c00;
+		}
+		else if (u < (113u << 23))
+		{
+			// Denormal: let the FPU round the mantissa into place.
+			float f, denormMagic;
+			memcpy(&f, &u, sizeof(f));
+			memcpy(&denormMagic, &denormMagicBits, sizeof(denormMagic));
+			f += denormMagic;
+			memcpy(&u, &f, sizeof(u));
+			h = (uint16_t)(u - denormMagicBits);
+		}
+		else
+		{
+			uint32_t mantissaOdd = (u >> 13) & 1;
+			u += ((15u - 127u) << 23) + 0xfff;
+			u += mantissaOdd;
+			h = (uint16_t)(u >> 13);
+		}
+		return (uint16_t)(h | (sign >> 16));
+	}
+
+	// Decodes a row to linear RGBA floats.  Alpha is never sRGB.
+	void DecodeRow(const uint8_t* src, float* dst, uint32_t width, PixelType type, bool srgb)
+	{
+		switch (type)
+		{
+		case PixelType::Unorm8:
+		{
+			const float* toLinear = Tables().ToLinear;
+			for (uint32_t x = 0; x < width; ++x, src += 4, dst += 4)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					dst[c] = srgb ? toLinear[src[c]] : src[c] * (1.0f / 255.0f);
+				}
+				dst[3] = src[3] * (1.0f / 255.0f);
+			}
+			break;
+		}
+		case PixelType::Float16:
+		{
+			for (uint32_t i = 0; i < width * 4; ++i)
+			{
+				uint16_t h;
+				memcpy(&h, src + i * 2, sizeof(h));
+				dst[i] = HalfToFloat(h);
+			}
+			break;
+		}
+		case PixelType::Float32:
+			memcpy(dst, src, (size_t)width * 16);
+			break;
+		}
+	}
+
+	void EncodeRow(const float* src, uint8_t* dst, uint32_t width, PixelType type, bool srgb, float alphaScale)
+	{
+		const SRGBTables& tables = Tables();
+
+		for (uint32_t x = 0; x < width; ++x, src += 4)
+		{
+			float alpha = alphaScale == 1.0f ? src[3] : std::min(src[3] * alphaScale, 1.0f);
+
+			switch (type)
+			{
+			case PixelType::Unorm8:
+				for (int c = 0; c < 3; ++c)
+				{
+					*dst++ = srgb ? EncodeSRGB(src[c], tables) : EncodeUnorm(src[c]);
+				}
+				*dst++ = EncodeUnorm(alpha);
+				break;
+			case PixelType::Float16:
+				for (int c = 0; c < 4; ++c)
+				{
+					uint16_t h = FloatToHalf(c == 3 ? alpha : src[c]);
+					memcpy(dst, &h, sizeof(h));
+					dst += 2;
+				}
+				break;
+			case PixelType::Float32:
+				memcpy(dst, src, 12);
+				memcpy(dst + 12, &alpha, 4);
+				dst += 16;
+				break;
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Filtering
+	//--------------------------------------------------------------------------------------
+
+	// The source texels and weights of every destination texel along one axis; the
+	// taps of texel i are Taps[First[i]] to Taps[First[i + 1]].
+	struct TapTable
+	{
+		struct Tap
+		{
+			uint32_t Index;
+			float Weight;
+		};
+
+		std::vector<uint32_t> First;
+		std::vector<Tap> Taps;
+	};
+
+	// Halving an odd size 2n+1 to n takes three source texels per destination texel,
+	// weighted by how much of each it covers.
+	TapTable BoxTaps(uint32_t srcSize, uint32_t dstSize)
+	{
+		TapTable table;
+		for (uint32_t i = 0; i < dstSize; ++i)
+		{
+			table.First.push_back((uint32_t)table.Taps.size());
+			if (srcSize == 1)
+			{
+				table.Taps.push_back({ 0, 1.0f });
+			}
+			else if (srcSize % 2 == 0)
+			{
+				table.Taps.push_back({ 2 * i, 0.5f });
+				table.Taps.push_back({ 2 * i + 1, 0.5f });
+			}
+			else
+			{
+				float n = (float)dstSize;
+				float norm = 1.0f / (2.0f * n + 1.0f);
+				table.Taps.push_back({ 2 * i, (n - i) * norm });
+				table.Taps.push_back({ 2 * i + 1, n * norm });
+				table.Taps.push_back({ 2 * i + 2, (i + 1) * norm });
+			}
+		}
+		table.First.push_back((uint32_t)table.Taps.size());
+		return table;
+	}
+
+	// Modified Bessel function of the first kind, order 0.
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		double halfX = x * 0.5;
+		for (int k = 1; k < 64 && term > sum * 1e-12; ++k)
+		{
+			term *= (halfX / k) * (halfX / k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	TapTable KaiserTaps(uint32_t srcSize, uint32_t dstSize, const MipOptions& options)
+	{
+		const double pi = 3.14159265358979323846;
+		const double scale = (double)srcSize / dstSize;
+		const double width = options.KaiserWidth;
+		const double windowNorm = 1.0 / BesselI0(options.KaiserAlpha);
+
+		TapTable table;
+		for (uint32_t i = 0; i < dstSize; ++i)
+		{
+			uint32_t first = (uint32_t)table.Taps.size();
+			table.First.push_back(first);
+			if (srcSize == 1)
+			{
+				table.Taps.push_back({ 0, 1.0f });
+				continue;
+			}
+
+			// t is the distance from the destination texel centre in destination texels.
+			double center = (i + 0.5) * scale;
+			int begin = (int)floor(center - width * scale);
+			int end = (int)ceil(center + width * scale);
+
+			double sum = 0.0;
+			for (int j = begin; j <= end; ++j)
+			{
+				double t = (j + 0.5 - center) / scale;
+				if (fabs(t) >= width)
+					continue;
+
+				double x = t / width;
+				double sinc = t == 0.0 ? 1.0 : sin(pi * t) / (pi * t);
+				double window = BesselI0(options.KaiserAlpha * sqrt(1.0 - x * x)) * windowNorm;
+				double w = sinc * window;
+
+				int index = options.Wrap ? ((j % (int)srcSize) + (int)srcSize) % (int)srcSize :
+					std::min(std::max(j, 0), (int)srcSize - 1);
+				table.Taps.push_back({ (uint32_t)index, (float)w });
+				sum += w;
+			}
+
+			for (uint32_t t = first; t < (uint32_t)table.Taps.size(); ++t)
+			{
+				table.Taps[t].Weight = (float)(table.Taps[t].Weight / sum);
+			}
+		}
+		table.First.push_back((uint32_t)table.Taps.size());
+		return table;
+	}
+
+	const uint32_t MinRowsPerThread = 16;
+
+	// Filters a sw x sh image of RGBA floats to dst (dw x dh), rows first into tmp,
+	// then columns.  sourceRow(y, scratch) returns row y, either in place or decoded
+	// into scratch, which holds sw texels.  One SSE register holds one texel.
+	template<typename RowFn>
+	void Downsample(RowFn sourceRow, uint32_t sw, uint32_t sh, float* dst, uint32_t dw, uint32_t dh,
+		const TapTable& horizontal, const TapTable& vertical, float* tmp, uint32_t threadCount)
+	{
+		ParallelFor(sh, threadCount, MinRowsPerThread, [&](uint32_t begin, uint32_t end)
+		{
+			std::vector<float> scratch((size_t)sw * 4);
+			for (uint32_t y = begin; y < end; ++y)
+			{
+				const float* row = sourceRow(y, scratch.data());
+				float* out = tmp + (size_t)y * dw * 4;
+				for (uint32_t x = 0; x < dw; ++x)
+				{
+					__m128 acc = _mm_setzero_ps();
+					for (uint32_t t = horizontal.First[x]; t < horizontal.First[x + 1]; ++t)
+					{
+						const TapTable::Tap& tap = horizontal.Taps[t];
+						acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(tap.Weight), _mm_loadu_ps(row + tap.Index * 4)));
+					}
+					_mm_storeu_ps(out + x * 4, acc);
+				}
+			}
+		});
+
+		ParallelFor(dh, threadCount, MinRowsPerThread, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t y = begin; y < end; ++y)
+			{
+				float* out = dst + (size_t)y * dw * 4;
+				for (uint32_t x = 0; x < dw; ++x)
+				{
+					_mm_storeu_ps(out + x * 4, _mm_setzero_ps());
+				}
+
+				for (uint32_t t = vertical.First[y]; t < vertical.First[y + 1]; ++t)
+				{
+					const TapTable::Tap& tap = vertical.Taps[t];
+					const float* row = tmp + (size_t)tap.Index * dw * 4;
+					__m128 w = _mm_set1_ps(tap.Weight);
+					for (uint32_t x = 0; x < dw; ++x)
+					{
+						__m128 acc = _mm_loadu_ps(out + x * 4);
+						acc = _mm_add_ps(acc, _mm_mul_ps(w, _mm_loadu_ps(row + x * 4)));
+						_mm_storeu_ps(out + x * 4, acc);
+					}
+				}
+			}
+		});
+	}
+
+	size_t AlphaPassed(const float* pixels, size_t count, float reference)
+	{
+		size_t passed = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (pixels[i * 4 + 3] > reference)
+				passed++;
+		}
+		return passed;
+	}
+
+	float AlphaCoverage(const float* pixels, size_t count, float reference)
+	{
+		return (float)AlphaPassed(pixels, count, reference) / (float)count;
+	}
+
+	// Scale for the alpha of a level so that the fraction of texels above reference
+	// matches target.  Coverage falls as the threshold rises, so bisect for the
+	// threshold that gives the target, then scale that threshold to the reference.
+	float AlphaScale(const float* pixels, size_t count, float reference, float target)
+	{
+		float lo = 0.0f;
+		float hi = 1.0f;
+		for (int i = 0; i < 12; ++i)
+		{
+			float mid = (lo + hi) * 0.5f;
+			if (AlphaCoverage(pixels, count, mid) > target)
+				lo = mid;
+			else
+				hi = mid;
+		}
+
+		float threshold = std::max((lo + hi) * 0.5f, 1e-4f);
+		return reference / threshold;
+	}
+}
+
+MipResult MipChain::Generate(DXGI_FORMAT format, uint32_t width, uint32_t height, const void* pixels, size_t rowPitch,
+	const MipOptions& options)
+{
+	*this = MipChain();
+
+	PixelFormat pf;
+	if (!Describe(format, pf))
+		return MipResult::NotSupported;
+	if (width == 0 || height == 0 || pixels == nullptr || rowPitch < width * pf.Bytes)
+		return MipResult::InvalidArgument;
+
+	const bool srgb = pf.SRGB || (options.TreatAsSRGB && pf.Type == PixelType::Unorm8);
+	const bool alphaTest = options.AlphaTestReference >= 0.0f;
+	uint32_t threadCount = DefaultThreadCount(options.ThreadCount);
+
+	uint32_t levelCount = FullLevelCount(width, height);
+	if (options.MaxLevels != 0)
+	{
+		levelCount = std::min(levelCount, options.MaxLevels);
+	}
+
+	this->format = format;
+	levels.resize(levelCount);
+	size_t offset = 0;
+	for (uint32_t i = 0; i < levelCount; ++i)
+	{
+		MipLevel& level = levels[i];
+		level.Width = std::max(1u, width >> i);
+		level.Height = std::max(1u, height >> i);
+		level.RowPitch = level.Width * pf.Bytes;
+		level.Offset = offset;
+		offset += level.RowPitch * level.Height;
+	}
+	data.resize(offset);
+
+	auto src = static_cast<const uint8_t*>(pixels);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		memcpy(data.data() + y * levels[0].RowPitch, src + y * rowPitch, levels[0].RowPitch);
+	}
+
+	// The top level is decoded a row at a time as the first pass reads it; every
+	// level below is filtered from the float copy of the one above, not from its
+	// quantised texels.
+	auto decodeTop = [&](uint32_t y, float* scratch) -> const float*
+	{
+		DecodeRow(data.data() + y * levels[0].RowPitch, scratch, width, pf.Type, srgb);
+		return scratch;
+	};
+
+	float coverage = 0.0f;
+	if (alphaTest)
+	{
+		std::vector<float> row((size_t)width * 4);
+		size_t passed = 0;
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			passed += AlphaPassed(decodeTop(y, row.data()), width, options.AlphaTestReference);
+		}
+		coverage = (float)passed / ((float)width * height);
+	}
+
+	std::vector<float> current;
+	std::vector<float> next;
+	std::vector<float> tmp;
+
+	for (uint32_t i = 1; i < levelCount; ++i)
+	{
+		const MipLevel& above = levels[i - 1];
+		const MipLevel& level = levels[i];
+
+		TapTable horizontal = options.Filter == MipFilter::Kaiser ?
+			KaiserTaps(above.Width, level.Width, options) : BoxTaps(above.Width, level.Width);
+		TapTable vertical = options.Filter == MipFilter::Kaiser ?
+			KaiserTaps(above.Height, level.Height, options) : BoxTaps(above.Height, level.Height);
+
+		next.resize((size_t)level.Width * level.Height * 4);
+		tmp.resize((size_t)level.Width * above.Height * 4);
+		if (i == 1)
+		{
+			Downsample(decodeTop, above.Width, above.Height, next.data(), level.Width, level.Height,
+				horizontal, vertical, tmp.data(), threadCount);
+		}
+		else
+		{
+			auto aboveRow = [&](uint32_t y, float*) -> const float*
+			{
+				return current.data() + (size_t)y * above.Width * 4;
+			};
+			Downsample(aboveRow, above.Width, above.Height, next.data(), level.Width, level.Height,
+				horizontal, vertical, tmp.data(), threadCount);
+		}
+
+		float alphaScale = alphaTest ?
+			AlphaScale(next.data(), (size_t)level.Width * level.Height, options.AlphaTestReference, coverage) : 1.0f;
+
+		ParallelFor(level.Height, threadCount, MinRowsPerThread, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t y = begin; y < end; ++y)
+			{
+				EncodeRow(next.data() + (size_t)y * level.Width * 4, data.data() + level.Offset + y * level.RowPitch,
+					level.Width, pf.Type, srgb, alphaScale);
+			}
+		});
+
+		current.swap(next);
+	}
+
+	return MipResult::Ok;
+}
+
+DXGI_FORMAT MipChain::Format()const
+{
+	return format;
+}
+
+uint32_t MipChain::LevelCount()const
+{
+	return (uint32_t)levels.size();
+}
+
+const MipLevel& MipChain::Level(uint32_t level)const
+{
+	return levels[level];
+}
+
+const uint8_t* MipChain::LevelData(uint32_t level)const
+{
+	return data.data() + levels[level].Offset;
+}
+
+const uint8_t* MipChain::Data()const
+{
+	return data.data();
+}
+
+size_t MipChain::DataSize()const
+{
+	return data.size();
+}
+
+bool MipChain::SaveDds(const std::filesystem::path& fileName)const
+{
+	if (levels.empty())
+		return false;
+
+	return DdsImage::Save(fileName, format, levels[0].Width, levels[0].Height, LevelCount(), 1, data.data(), data.size());
+}
+
+bool MipChain::WriteDds(std::vector<uint8_t>& dds)const
+{
+	dds.clear();
+	if (levels.empty())
+		return false;
+
+	dds.resize(DdsImage::HeaderSize + data.size());
+	if (!DdsImage::WriteHeader(dds.data(), format, levels[0].Width, levels[0].Height, LevelCount(), 1))
+	{
+		dds.clear();
+		return false;
+	}
+	std::memcpy(dds.data() + DdsImage::HeaderSize, data.data(), data.size());
+	return true;
+}
+
+bool MipChain::IsSupported(DXGI_FORMAT format)
+{
+	PixelFormat pf;
+	return Describe(format, pf);
+}
+
+bool MipChain::DecodeLinear(DXGI_FORMAT format, const void* texels, uint32_t width, float* rgba)
+{
+	PixelFormat pf;
+	if (!Describe(format, pf))
+		return false;
+
+	DecodeRow(static_cast<const uint8_t*>(texels), rgba, width, pf.Type, pf.SRGB);
+	if (format == DXGI_FORMAT_B8G8R8A8_UNORM || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			std::swap(rgba[x * 4 + 0], rgba[x * 4 + 2]);
+		}
+	}
+	return true;
+}
+
+uint32_t MipChain::FullLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1u, width >> 1);
+		height = std::max(1u, height >> 1);
+		++count;
+	}
+	return count;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+#include "DxgiFormat.h"
+
+enum class MipFilter
+{
+	// Average of the texels each destination texel covers; exact for odd sizes too.
+	Box,
+	// Kaiser-windowed sinc: sharper minification with little aliasing.
+	Kaiser
+};
+
+struct MipOptions
+{
+	MipFilter Filter = MipFilter::Box;
+	// Half-width of the Kaiser window in destination texels, and its shape.
+	float KaiserWidth = 3.0f;
+	float KaiserAlpha = 4.0f;
+	// Filter across the opposite edge instead of clamping, for tiling textures.
+	bool Wrap = false;
+	// Treat 8-bit UNORM data as sRGB, for albedo maps stored without the _SRGB format.
+	bool TreatAsSRGB = false;
+	// Alpha test reference of the texture (0.1 for TreeSprite.hlsl's ALPHA_TEST), or
+	// negative to filter alpha like colour.  Each mip's alpha is scaled so that the
+	// same fraction of texels passes the test as in the top level, which keeps
+	// alpha-tested foliage from thinning out in the distance.
+	float AlphaTestReference = -1.0f;
+	// Levels to generate including the top one; 0 for the full chain down to 1x1.
+	uint32_t MaxLevels = 0;
+	// Threads filtering each level; 0 for one per hardware thread.
+	uint32_t ThreadCount = 0;
+};
+
+enum class MipResult
+{
+	Ok,
+	// Zero size, no data or a row pitch smaller than a row.
+	InvalidArgument,
+	// A format other than RGBA8, BGRA8, RGBA16F or RGBA32F.
+	NotSupported
+};
+
+struct MipLevel
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	size_t RowPitch = 0;
+	// Offset of the level in Data().
+	size_t Offset = 0;
+};
+
+// A 2D image with a full mip chain generated on the CPU, for textures that come
+// without one.  Each level is filtered from the one above in linear light: sRGB
+// texels are decoded, filtered as floats four channels at a time with SSE, and
+// re-encoded, so dark and bright texels blend as they do on screen.  Rows of a level
+// are split between threads.  The levels are tightly packed one after the other,
+// the layout of a DDS file, so the chain can go to UploadBatch or SaveDds as is.
+// Needs neither D3D nor Windows, so offline asset tools can use it headless.
+class MipChain
+{
+public:
+	///<summary>
+	/// Builds the chain for a width x height image of format whose rows are rowPitch
+	/// bytes apart in pixels.  The top level is a copy of pixels.
+	///</summary>
+	MipResult Generate(DXGI_FORMAT format, uint32_t width, uint32_t height, const void* pixels, size_t rowPitch,
+		const MipOptions& options = MipOptions());
+
+	DXGI_FORMAT Format()const;
+	uint32_t LevelCount()const;
+	const MipLevel& Level(uint32_t level)const;
+	const uint8_t* LevelData(uint32_t level)const;
+
+	const uint8_t* Data()const;
+	size_t DataSize()const;
+
+	///<summary>
+	/// Writes the chain as a DDS file with a DX10 header.
+	///</summary>
+	bool SaveDds(const std::filesystem::path& fileName)const;
+
+	///<summary>
+	/// Builds the DDS file SaveDds writes in dds instead.
+	///</summary>
+	bool WriteDds(std::vector<uint8_t>& dds)const;
+
+	static bool IsSupported(DXGI_FORMAT format);
+
+	///<summary>
+	/// Decodes width texels of a supported format to linear RGBA floats, in that
+	/// channel order whatever the format's.  Returns false for other formats.
+	///</summary>
+	static bool DecodeLinear(DXGI_FORMAT format, const void* texels, uint32_t width, float* rgba);
+
+	///<summary>
+	/// Levels of a full chain for a width x height image, down to 1x1.
+	///</summary>
+	static uint32_t FullLevelCount(uint32_t width, uint32_t height);
+
+private:
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	std::vector<MipLevel> levels;
+	std::vector<uint8_t> data;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+///<summary>
+/// Runs fn(begin, end) over [0, count) split between up to threadCount threads, with
+/// no thread getting fewer than minPerThread items.  The calling thread takes the
+/// first range; returns once every range is done.
+///</summary>
+template<typename F>
+void ParallelFor(uint32_t count, uint32_t threadCount, uint32_t minPerThread, F fn)
+{
+	threadCount = std::max(1u, std::min(threadCount, count / std::max(1u, minPerThread)));
+	if (threadCount == 1)
+	{
+		fn(0u, count);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	uint32_t chunk = (count + threadCount - 1) / threadCount;
+	for (uint32_t begin = chunk; begin < count; begin += chunk)
+	{
+		threads.emplace_back(fn, begin, std::min(begin + chunk, count));
+	}
+	fn(0u, std::min(chunk, count));
+
+	for (std::thread& t : threads)
+	{
+		t.join();
+	}
+}
+
+///<summary>
+/// Threads to use when the caller asked for 0: one per hardware thread.
+///</summary>
+inline uint32_t DefaultThreadCount(uint32_t requested)
+{
+	return requested != 0 ? requested : std::max(1u, std::thread::hardware_concurrency());
+}
@@ -0,0 +1,327 @@
+#include "SphericalHarmonics.h"
+#include "BcTexture.h"
+#include "DdsImage.h"
+#include "MipChain.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <xmmintrin.h>
+
+namespace
+{
+	// Normalization constants of the real SH basis.
+	const float K0 = 0.282095f;
+	const float K1 = 0.488603f;
+	const float K2 = 1.092548f;
+	const float K3 = 0.315392f;
+	const float K4 = 0.546274f;
+
+	const float Pi = 3.14159265f;
+
+	// Coefficients times RGB, then the total solid angle.
+	const int RowSums = ShRgb::MaxCoefficients * 3 + 1;
+
+	bool IsSRGB(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_BC1_UNORM_SRGB || format == DXGI_FORMAT_BC3_UNORM_SRGB ||
+			format == DXGI_FORMAT_BC7_UNORM_SRGB;
+	}
+
+	// The 8-bit format to decode format as, for options.TreatAsSRGB.
+	DXGI_FORMAT AsSRGB(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+			return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+			return DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+		default:
+			return format;
+		}
+	}
+
+	// Decodes a size x size face to linear RGBA floats.
+	bool DecodeFace(DXGI_FORMAT format, uint32_t size, const uint8_t* face, size_t rowPitch, bool treatAsSRGB,
+		float* rgba)
+	{
+		if (!BcTexture::IsSupported(format))
+		{
+			const DXGI_FORMAT decodeAs = treatAsSRGB ? AsSRGB(format) : format;
+			for (uint32_t y = 0; y < size; ++y)
+			{
+				if (!MipChain::DecodeLinear(decodeAs, face + y * rowPitch, size, rgba + (size_t)y * size * 4))
+					return false;
+			}
+			return true;
+		}
+
+		// Blocks decode to RGBA8, which is then decoded like an 8-bit face.
+		const DXGI_FORMAT blockTexels = IsSRGB(format) || treatAsSRGB ?
+			DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+		const size_t blockBytes = BcTexture::BlockBytes(format);
+		const uint32_t blocks = (size + 3) / 4;
+		for (uint32_t by = 0; by < blocks; ++by)
+		{
+			for (uint32_t bx = 0; bx < blocks; ++bx)
+			{
+				uint8_t texels[64];
+				if (!BcTexture::DecodeBlock(format, face + by * rowPitch + bx * blockBytes, texels))
+					return false;
+
+				// Faces smaller than a block use its top left corner.
+				const uint32_t w = std::min(4u, size - bx * 4);
+				const uint32_t h = std::min(4u, size - by * 4);
+				for (uint32_t y = 0; y < h; ++y)
+				{
+					float* dst = rgba + ((size_t)(by * 4 + y) * size + bx * 4) * 4;
+					MipChain::DecodeLinear(blockTexels, texels + y * 16, w, dst);
+				}
+			}
+		}
+		return true;
+	}
+
+	// Projects one row of a face, four texels at a time, into sums.
+	void ProjectRow(const float* rgba, uint32_t size, uint32_t face, uint32_t row, float sums[RowSums])
+	{
+		const float texel = 2.0f / size;
+		const float v = (row + 0.5f) * texel - 1.0f;
+		const __m128 vv = _mm_set1_ps(v);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 area = _mm_set1_ps(texel * texel);
+
+		__m128 acc[RowSums];
+		for (__m128& a : acc)
+		{
+			a = _mm_setzero_ps();
+		}
+
+		for (uint32_t x = 0; x < size; x += 4)
+		{
+			// Lanes past the end of the row get no weight and no colour.
+			const uint32_t count = std::min(4u, size - x);
+			alignas(16) float lanes[4][4] = {};
+			float us[4] = {};
+			float valid[4] = {};
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				std::copy(rgba + (x + i) * 4, rgba + (x + i) * 4 + 4, lanes[i]);
+				us[i] = (x + i + 0.5f) * texel - 1.0f;
+				valid[i] = 1.0f;
+			}
+			__m128 r = _mm_load_ps(lanes[0]);
+			__m128 g = _mm_load_ps(lanes[1]);
+			__m128 b = _mm_load_ps(lanes[2]);
+			__m128 a = _mm_load_ps(lanes[3]);
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+
+			// Direction through the texel centre in D3D cube face order.
+			const __m128 u = _mm_loadu_ps(us);
+			const __m128 negU = _mm_sub_ps(_mm_setzero_ps(), u);
+			const __m128 negV = _mm_sub_ps(_mm_setzero_ps(), vv);
+			__m128 dx, dy, dz;
+			switch (face)
+			{
+			case 0: dx = one; dy = negV; dz = negU; break;
+			case 1: dx = _mm_sub_ps(_mm_setzero_ps(), one); dy = negV; dz = u; break;
+			case 2: dx = u; dy = one; dz = vv; break;
+			case 3: dx = u; dy = _mm_sub_ps(_mm_setzero_ps(), one); dz = negV; break;
+			case 4: dx = u; dy = negV; dz = one; break;
+			default: dx = negU; dy = negV; dz = _mm_sub_ps(_mm_setzero_ps(), one); break;
+			}
+
+			// The texel covers area / (1 + u^2 + v^2)^(3/2) steradians.
+			const __m128 lengthSq = _mm_add_ps(one, _mm_add_ps(_mm_mul_ps(u, u), _mm_mul_ps(vv, vv)));
+			const __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSq));
+			const __m128 weight = _mm_mul_ps(_mm_mul_ps(area, _mm_loadu_ps(valid)),
+				_mm_mul_ps(invLength, _mm_mul_ps(invLength, invLength)));
+			const __m128 nx = _mm_mul_ps(dx, invLength);
+			const __m128 ny = _mm_mul_ps(dy, invLength);
+			const __m128 nz = _mm_mul_ps(dz, invLength);
+
+			__m128 basis[ShRgb::MaxCoefficients];
+			basis[0] = _mm_set1_ps(K0);
+			basis[1] = _mm_mul_ps(_mm_set1_ps(K1), ny);
+			basis[2] = _mm_mul_ps(_mm_set1_ps(K1), nz);
+			basis[3] = _mm_mul_ps(_mm_set1_ps(K1), nx);
+			basis[4] = _mm_mul_ps(_mm_set1_ps(K2), _mm_mul_ps(nx, ny));
+			basis[5] = _mm_mul_ps(_mm_set1_ps(K2), _mm_mul_ps(ny, nz));
+			basis[6] = _mm_mul_ps(_mm_set1_ps(K3), _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(3.0f), _mm_mul_ps(nz, nz)), one));
+			basis[7] = _mm_mul_ps(_mm_set1_ps(K2), _mm_mul_ps(nx, nz));
+			basis[8] = _mm_mul_ps(_mm_set1_ps(K4), _mm_sub_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)));
+
+			const __m128 wr = _mm_mul_ps(r, weight);
+			const __m128 wg = _mm_mul_ps(g, weight);
+			const __m128 wb = _mm_mul_ps(b, weight);
+			for (uint32_t k = 0; k < ShRgb::MaxCoefficients; ++k)
+			{
+				acc[k * 3 + 0] = _mm_add_ps(acc[k * 3 + 0], _mm_mul_ps(basis[k], wr));
+				acc[k * 3 + 1] = _mm_add_ps(acc[k * 3 + 1], _mm_mul_ps(basis[k], wg));
+				acc[k * 3 + 2] = _mm_add_ps(acc[k * 3 + 2], _mm_mul_ps(basis[k], wb));
+			}
+			acc[RowSums - 1] = _mm_add_ps(acc[RowSums - 1], weight);
+		}
+
+		for (int i = 0; i < RowSums; ++i)
+		{
+			alignas(16) float lane[4];
+			_mm_store_ps(lane, acc[i]);
+			sums[i] = (lane[0] + lane[1]) + (lane[2] + lane[3]);
+		}
+	}
+
+	ShResult Project(DXGI_FORMAT format, uint32_t size, const uint8_t* const faces[6], size_t rowPitch,
+		ShRgb& radiance, const ShOptions& options)
+	{
+		const std::uint32_t threadCount = DefaultThreadCount(options.ThreadCount);
+
+		std::vector<float> linear((size_t)6 * size * size * 4);
+		bool decoded[6] = {};
+		ParallelFor(6, threadCount, 1, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t f = begin; f < end; ++f)
+			{
+				decoded[f] = DecodeFace(format, size, faces[f], rowPitch, options.TreatAsSRGB,
+					linear.data() + (size_t)f * size * size * 4);
+			}
+		});
+		if (!std::all_of(std::begin(decoded), std::end(decoded), [](bool d) { return d; }))
+			return ShResult::NotSupported;
+
+		// Every row sums on its own, so the rows can be added in order afterwards.
+		const uint32_t rows = 6 * size;
+		std::vector<float> rowSums((size_t)rows * RowSums);
+		ParallelFor(rows, threadCount, std::max(1u, 4096 / size), [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t r = begin; r < end; ++r)
+			{
+				const uint32_t face = r / size;
+				const uint32_t row = r % size;
+				ProjectRow(linear.data() + ((size_t)face * size + row) * size * 4, size, face, row,
+					rowSums.data() + (size_t)r * RowSums);
+			}
+		});
+
+		double totals[RowSums] = {};
+		for (uint32_t r = 0; r < rows; ++r)
+		{
+			for (int i = 0; i < RowSums; ++i)
+			{
+				totals[i] += rowSums[(size_t)r * RowSums + i];
+			}
+		}
+
+		// The texel solid angles add up to 4 pi only approximately.
+		const double scale = 4.0 * Pi / totals[RowSums - 1];
+		radiance = ShRgb();
+		radiance.Order = options.Order;
+		const uint32_t count = options.Order * options.Order;
+		for (uint32_t k = 0; k < count; ++k)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				radiance.Coefficients[k][c] = (float)(totals[k * 3 + c] * scale);
+			}
+		}
+		return ShResult::Ok;
+	}
+}
+
+ShResult ProjectCubeMap(const DdsImage& cube, ShRgb& radiance, const ShOptions& options)
+{
+	radiance = ShRgb();
+	if (!cube.IsCubeMap() || cube.Width() != cube.Height() || cube.MipCount() == 0 ||
+		(options.Order != 2 && options.Order != 3))
+		return ShResult::InvalidArgument;
+
+	uint32_t mip = 0;
+	while (mip + 1 < cube.MipCount() && (cube.Width() >> mip) > options.MaxFaceSize)
+	{
+		++mip;
+	}
+
+	const uint8_t* faces[6];
+	for (uint32_t f = 0; f < 6; ++f)
+	{
+		faces[f] = cube.Subresource(mip, f).Data;
+	}
+	DdsSubresource top = cube.Subresource(mip, 0);
+	return Project(cube.Format(), top.Width, faces, top.RowPitch, radiance, options);
+}
+
+ShResult ProjectCubeFaces(DXGI_FORMAT format, uint32_t size, const void* const faces[6], size_t rowPitch,
+	ShRgb& radiance, const ShOptions& options)
+{
+	radiance = ShRgb();
+	if (size == 0 || faces == nullptr || (options.Order != 2 && options.Order != 3))
+		return ShResult::InvalidArgument;
+
+	const uint8_t* faceBytes[6];
+	for (uint32_t f = 0; f < 6; ++f)
+	{
+		if (faces[f] == nullptr)
+			return ShResult::InvalidArgument;
+		faceBytes[f] = static_cast<const uint8_t*>(faces[f]);
+	}
+
+	// Rows of texels, or of blocks, have to fit the pitch.
+	const size_t bpp = DdsImage::BitsPerPixel(format);
+	const size_t rowBytes = BcTexture::IsSupported(format) ?
+		(size + 3) / 4 * BcTexture::BlockBytes(format) : size * bpp / 8;
+	if (bpp == 0 || rowPitch < rowBytes)
+		return bpp == 0 ? ShResult::NotSupported : ShResult::InvalidArgument;
+
+	return Project(format, size, faceBytes, rowPitch, radiance, options);
+}
+
+ShRgb ShDiffuse(const ShRgb& radiance)
+{
+	// The clamped cosine's bands are pi, 2 pi / 3 and pi / 4.
+	const float bands[3] = { 1.0f, 2.0f / 3.0f, 0.25f };
+
+	ShRgb diffuse = radiance;
+	for (uint32_t k = 0; k < ShRgb::MaxCoefficients; ++k)
+	{
+		const float band = bands[k == 0 ? 0 : (k < 4 ? 1 : 2)];
+		for (int c = 0; c < 3; ++c)
+		{
+			diffuse.Coefficients[k][c] *= band;
+		}
+	}
+	return diffuse;
+}
+
+void ShEvaluate(const ShRgb& sh, float x, float y, float z, float rgb[3])
+{
+	const float basis[ShRgb::MaxCoefficients] =
+	{
+		K0,
+		K1 * y, K1 * z, K1 * x,
+		K2 * x * y, K2 * y * z, K3 * (3.0f * z * z - 1.0f), K2 * x * z, K4 * (x * x - y * y)
+	};
+
+	for (int c = 0; c < 3; ++c)
+	{
+		rgb[c] = 0.0f;
+		for (uint32_t k = 0; k < ShRgb::MaxCoefficients; ++k)
+		{
+			rgb[c] += basis[k] * sh.Coefficients[k][c];
+		}
+	}
+}
+
+void ShShaderConstants(const ShRgb& sh, float constants[ShRgb::MaxCoefficients][4])
+{
+	const float scale[ShRgb::MaxCoefficients] = { K0, K1, K1, K1, K2, K2, K3, K2, K4 };
+
+	for (uint32_t k = 0; k < ShRgb::MaxCoefficients; ++k)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			constants[k][c] = scale[k] * sh.Coefficients[k][c];
+		}
+		constants[k][3] = 0.0f;
+	}
+}
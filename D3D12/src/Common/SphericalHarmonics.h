@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "DxgiFormat.h"
+
+class DdsImage;
+
+enum class ShResult
+{
+	Ok,
+	// Not a cube map, faces that are not square, no data or an order other than 2 or 3.
+	InvalidArgument,
+	// A format neither MipChain nor BcTexture can decode, such as BC6H.
+	NotSupported
+};
+
+struct ShOptions
+{
+	// Bands to project onto: 2 for 4 coefficients, 3 for 9.  Irradiance needs no
+	// more; the clamped cosine leaves less than 1% of the energy in higher bands.
+	uint32_t Order = 3;
+	// ProjectCubeMap reads the largest mip with faces no larger than this, as low
+	// frequencies need few texels.
+	uint32_t MaxFaceSize = 64;
+	// Treat 8-bit UNORM data as sRGB, for colour maps stored without the _SRGB format.
+	bool TreatAsSRGB = false;
+	// Threads projecting the rows; 0 for one per hardware thread.
+	uint32_t ThreadCount = 0;
+};
+
+// RGB spherical harmonic coefficients of up to order 3, for the real basis in the
+// order (l, m) = (0,0), (1,-1), (1,0), (1,1), (2,-2), (2,-1), (2,0), (2,1), (2,2).
+// Coefficients past the order are zero.
+struct ShRgb
+{
+	static const uint32_t MaxCoefficients = 9;
+
+	uint32_t Order = 3;
+	float Coefficients[MaxCoefficients][3] = {};
+};
+
+///<summary>
+/// Projects the radiance of a cube map onto SH, each texel weighted by the solid
+/// angle it covers.  Faces are decoded to linear light and their rows projected on
+/// several threads four texels at a time with SSE; each row is summed on its own
+/// and the rows in order, so the result does not depend on the thread count.
+///</summary>
+ShResult ProjectCubeMap(const DdsImage& cube, ShRgb& radiance, const ShOptions& options = ShOptions());
+
+///<summary>
+/// ProjectCubeMap for six size x size faces in memory, in D3D face order (+X, -X,
+/// +Y, -Y, +Z, -Z) with rows rowPitch bytes apart, such as the faces of a
+/// CubeRenderTarget read back with CopyToReadback.  MaxFaceSize is ignored.
+///</summary>
+ShResult ProjectCubeFaces(DXGI_FORMAT format, uint32_t size, const void* const faces[6], size_t rowPitch,
+	ShRgb& radiance, const ShOptions& options = ShOptions());
+
+///<summary>
+/// Convolves radiance with the clamped cosine and divides by pi, giving the light a
+/// Lambertian surface reflects per unit albedo: evaluated at a normal, it is the
+/// ambient term to multiply the diffuse albedo by.
+///</summary>
+ShRgb ShDiffuse(const ShRgb& radiance);
+
+///<summary>
+/// The function sh represents, in direction (x, y, z) of unit length.
+///</summary>
+void ShEvaluate(const ShRgb& sh, float x, float y, float z, float rgb[3]);
+
+///<summary>
+/// Folds the basis constants into the coefficients, so the shader evaluates
+/// c[0] + c[1] y + c[2] z + c[3] x + c[4] xy + c[5] yz + c[6] (3z^2 - 1) + c[7] xz +
+/// c[8] (x^2 - y^2) with RGB in xyz of each constant.
+///</summary>
+void ShShaderConstants(const ShRgb& sh, float constants[ShRgb::MaxCoefficients][4]);
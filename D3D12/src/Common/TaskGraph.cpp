@@ -0,0 +1,228 @@
+#include "TaskGraph.h"
+#include "ParallelFor.h"
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+namespace
+{
+	// Ready tasks by id, lowest first, so tasks run close to the order they were added.
+	using ReadyQueue = std::priority_queue<TaskGraph::TaskId, std::vector<TaskGraph::TaskId>, std::greater<TaskGraph::TaskId>>;
+}
+
+TaskGraph::TaskId TaskGraph::Add(std::string name, std::function<void()> work, std::vector<TaskId> dependencies)
+{
+	return AddTask(std::move(name), std::move(work), std::move(dependencies), false);
+}
+
+TaskGraph::TaskId TaskGraph::AddMainThread(std::string name, std::function<void()> work, std::vector<TaskId> dependencies)
+{
+	return AddTask(std::move(name), std::move(work), std::move(dependencies), true);
+}
+
+TaskGraph::TaskId TaskGraph::AddTask(std::string name, std::function<void()> work, std::vector<TaskId> dependencies,
+	bool mainThread)
+{
+	const TaskId id = (TaskId)tasks.size();
+	for (TaskId d : dependencies)
+	{
+		assert(d < id && "tasks can only depend on tasks added before them");
+		tasks[d].Dependents.push_back(id);
+	}
+
+	Task t;
+	t.Name = std::move(name);
+	t.Work = std::move(work);
+	t.MainThread = mainThread;
+	t.Dependencies = std::move(dependencies);
+	tasks.push_back(std::move(t));
+	return id;
+}
+
+void TaskGraph::Run(std::uint32_t threadCount)
+{
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point runStart = Clock::now();
+	auto since = [runStart](Clock::time_point t)
+	{
+		return std::chrono::duration<double, std::milli>(t - runStart).count();
+	};
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	ReadyQueue anyReady;
+	ReadyQueue mainReady;
+	std::vector<std::uint32_t> waitingOn(tasks.size());
+	std::uint32_t finished = 0;
+	std::uint32_t running = 0;
+	std::exception_ptr error;
+
+	for (TaskId i = 0; i < (TaskId)tasks.size(); ++i)
+	{
+		tasks[i].Start = 0.0;
+		tasks[i].Duration = 0.0;
+		waitingOn[i] = (std::uint32_t)tasks[i].Dependencies.size();
+		if (waitingOn[i] == 0)
+		{
+			(tasks[i].MainThread ? mainReady : anyReady).push(i);
+		}
+	}
+
+	auto done = [&]()
+	{
+		return finished == (std::uint32_t)tasks.size() || error != nullptr;
+	};
+
+	// Called without the lock; takes it to release the dependents.
+	auto execute = [&](TaskId id)
+	{
+		Task& t = tasks[id];
+		const Clock::time_point start = Clock::now();
+		std::exception_ptr thrown;
+		try
+		{
+			t.Work();
+		}
+		catch (...)
+		{
+			thrown = std::current_exception();
+		}
+		const Clock::time_point end = Clock::now();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		t.Start = since(start);
+		t.Duration = since(end) - t.Start;
+		running--;
+		if (thrown)
+		{
+			if (!error)
+			{
+				error = thrown;
+			}
+		}
+		else
+		{
+			finished++;
+			for (TaskId d : t.Dependents)
+			{
+				if (--waitingOn[d] == 0)
+				{
+					(tasks[d].MainThread ? mainReady : anyReady).push(d);
+				}
+			}
+		}
+		changed.notify_all();
+	};
+
+	auto workerMain = [&]()
+	{
+		for (;;)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&]() { return !anyReady.empty() || done(); });
+			if (done())
+				return;
+
+			TaskId id = anyReady.top();
+			anyReady.pop();
+			running++;
+			lock.unlock();
+
+			execute(id);
+		}
+	};
+
+	// No more workers than tasks they could run.
+	std::uint32_t anyTasks = 0;
+	for (const Task& t : tasks)
+	{
+		anyTasks += t.MainThread ? 0 : 1;
+	}
+	const std::uint32_t workerCount = std::min(DefaultThreadCount(threadCount) - 1, anyTasks);
+
+	std::vector<std::thread> workers;
+	for (std::uint32_t i = 0; i < workerCount; ++i)
+	{
+		workers.emplace_back(workerMain);
+	}
+
+	// The calling thread runs its own tasks and helps with the others.
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;)
+		{
+			changed.wait(lock, [&]() { return !mainReady.empty() || !anyReady.empty() || done(); });
+			if (done())
+				break;
+
+			ReadyQueue& queue = anyReady.empty() || (!mainReady.empty() && mainReady.top() < anyReady.top()) ?
+				mainReady : anyReady;
+			TaskId id = queue.top();
+			queue.pop();
+			running++;
+			lock.unlock();
+
+			execute(id);
+			lock.lock();
+		}
+		changed.wait(lock, [&]() { return running == 0; });
+	}
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	// Each task's chain ends with it, and its dependencies come before it.
+	stats = TaskGraphStats();
+	std::vector<double> chain(tasks.size());
+	for (TaskId i = 0; i < (TaskId)tasks.size(); ++i)
+	{
+		const Task& t = tasks[i];
+		double longest = 0.0;
+		for (TaskId d : t.Dependencies)
+		{
+			longest = std::max(longest, chain[d]);
+		}
+		chain[i] = longest + t.Duration;
+
+		stats.WallMilliseconds = std::max(stats.WallMilliseconds, t.Start + t.Duration);
+		stats.SerialMilliseconds += t.Duration;
+		stats.CriticalPathMilliseconds = std::max(stats.CriticalPathMilliseconds, chain[i]);
+	}
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+std::uint32_t TaskGraph::TaskCount()const
+{
+	return (std::uint32_t)tasks.size();
+}
+
+const std::string& TaskGraph::Name(TaskId task)const
+{
+	return tasks[task].Name;
+}
+
+double TaskGraph::StartMilliseconds(TaskId task)const
+{
+	return tasks[task].Start;
+}
+
+double TaskGraph::DurationMilliseconds(TaskId task)const
+{
+	return tasks[task].Duration;
+}
+
+TaskGraphStats TaskGraph::GetStats()const
+{
+	return stats;
+}
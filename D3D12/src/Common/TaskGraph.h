@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct TaskGraphStats
+{
+	// From the start of Run until its last task finished.
+	double WallMilliseconds = 0.0;
+	// All task durations added up, what running them in sequence would take.
+	double SerialMilliseconds = 0.0;
+	// The longest chain of dependent tasks, the least Run can take on any number of threads.
+	double CriticalPathMilliseconds = 0.0;
+};
+
+// Tasks with dependencies between them, run on a pool of threads once all their
+// dependencies are done.  A task can only depend on tasks added before it, so the
+// graph never has cycles and adding it in a working sequential order keeps it
+// correct.  Main-thread tasks only ever run on the thread that calls Run, in the
+// order they become ready, which suits work that must stay on one thread such as
+// recording a command list; the calling thread runs other tasks when none of its
+// own are ready.  Needs neither D3D nor Windows.
+class TaskGraph
+{
+public:
+	using TaskId = std::uint32_t;
+
+	TaskGraph() = default;
+	TaskGraph(const TaskGraph& rhs) = delete;
+	TaskGraph& operator=(const TaskGraph& rhs) = delete;
+	~TaskGraph() = default;
+
+	///<summary>
+	/// Adds a task that runs work on any thread after every task in dependencies.
+	///</summary>
+	TaskId Add(std::string name, std::function<void()> work, std::vector<TaskId> dependencies = {});
+
+	///<summary>
+	/// Add for a task that must run on the thread calling Run.
+	///</summary>
+	TaskId AddMainThread(std::string name, std::function<void()> work, std::vector<TaskId> dependencies = {});
+
+	///<summary>
+	/// Runs every task on the calling thread and up to threadCount - 1 workers (0 for
+	/// one thread per hardware thread), returning once all are done.  If a task
+	/// throws, tasks not yet started are skipped and the first exception is rethrown
+	/// after the running ones have finished.  With one thread the tasks run in the
+	/// order they were added.
+	///</summary>
+	void Run(std::uint32_t threadCount = 0);
+
+	std::uint32_t TaskCount()const;
+	const std::string& Name(TaskId task)const;
+	// When the task started and how long it ran in the last Run, in milliseconds from its start.
+	double StartMilliseconds(TaskId task)const;
+	double DurationMilliseconds(TaskId task)const;
+
+	TaskGraphStats GetStats()const;
+
+private:
+	struct Task
+	{
+		std::string Name;
+		std::function<void()> Work;
+		bool MainThread = false;
+		std::vector<TaskId> Dependencies;
+		// Tasks depending on this one, to release when it finishes.
+		std::vector<TaskId> Dependents;
+		double Start = 0.0;
+		double Duration = 0.0;
+	};
+
+	TaskId AddTask(std::string name, std::function<void()> work, std::vector<TaskId> dependencies, bool mainThread);
+
+private:
+	std::vector<Task> tasks;
+	TaskGraphStats stats;
+};
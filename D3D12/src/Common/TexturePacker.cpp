@@ -0,0 +1,350 @@
+#include "TexturePacker.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	bool IsSingle2D(const DdsImage* image)
+	{
+		return image != nullptr && image->Dimension() == DdsDimension::Texture2D &&
+			image->ArraySize() == 1 && !image->IsCubeMap();
+	}
+
+	bool IsBlockCompressed(DXGI_FORMAT format)
+	{
+		return (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM) ||
+			(format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+	}
+
+	// Texels (or blocks) across one element, and its size in bytes.
+	void ElementInfo(DXGI_FORMAT format, uint32_t& elementTexels, size_t& elementBytes)
+	{
+		size_t bpp = DdsImage::BitsPerPixel(format);
+		elementTexels = IsBlockCompressed(format) ? 4 : 1;
+		elementBytes = bpp * elementTexels * elementTexels / 8;
+	}
+
+	uint32_t RoundUp(uint32_t value, uint32_t multiple)
+	{
+		return (value + multiple - 1) / multiple * multiple;
+	}
+
+	bool WriteFile(const std::filesystem::path& fileName, const std::vector<uint8_t>& data)
+	{
+		if (data.empty())
+			return false;
+
+		std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+		if (!out)
+			return false;
+
+		out.write(reinterpret_cast<const char*>(data.data()), data.size());
+		return (bool)out;
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// TextureArrayPacker
+//--------------------------------------------------------------------------------------
+PackResult TextureArrayPacker::Pack(const std::vector<const DdsImage*>& images)
+{
+	arrays.clear();
+	locations.assign(images.size(), ArraySlice());
+	if (images.empty())
+		return PackResult::InvalidArgument;
+
+	for (uint32_t i = 0; i < (uint32_t)images.size(); ++i)
+	{
+		const DdsImage* image = images[i];
+		if (!IsSingle2D(image))
+		{
+			arrays.clear();
+			return PackResult::InvalidArgument;
+		}
+
+		auto match = std::find_if(arrays.begin(), arrays.end(), [image](const TextureArray& a)
+		{
+			return a.Format == image->Format() && a.Width == image->Width() &&
+				a.Height == image->Height() && a.MipCount == image->MipCount();
+		});
+		if (match == arrays.end())
+		{
+			TextureArray a;
+			a.Format = image->Format();
+			a.Width = image->Width();
+			a.Height = image->Height();
+			a.MipCount = image->MipCount();
+			match = arrays.insert(arrays.end(), std::move(a));
+		}
+
+		locations[i].Array = (uint32_t)(match - arrays.begin());
+		locations[i].Slice = (uint32_t)match->Members.size();
+		match->Members.push_back(i);
+	}
+
+	// DDS arrays store each slice's mips together, as the images already hold them.
+	for (TextureArray& a : arrays)
+	{
+		const size_t sliceSize = images[a.Members[0]]->DataSize();
+		a.File.resize(DdsImage::HeaderSize + sliceSize * a.Members.size());
+		DdsImage::WriteHeader(a.File.data(), a.Format, a.Width, a.Height, a.MipCount, (uint32_t)a.Members.size());
+
+		uint8_t* slice = a.File.data() + DdsImage::HeaderSize;
+		for (uint32_t member : a.Members)
+		{
+			std::memcpy(slice, images[member]->Subresource(0, 0).Data, sliceSize);
+			slice += sliceSize;
+		}
+	}
+	return PackResult::Ok;
+}
+
+uint32_t TextureArrayPacker::ArrayCount()const
+{
+	return (uint32_t)arrays.size();
+}
+
+const TextureArray& TextureArrayPacker::Array(uint32_t array)const
+{
+	return arrays[array];
+}
+
+ArraySlice TextureArrayPacker::Location(uint32_t image)const
+{
+	return locations[image];
+}
+
+std::vector<uint8_t> TextureArrayPacker::TakeFile(uint32_t array)
+{
+	return std::move(arrays[array].File);
+}
+
+bool TextureArrayPacker::SaveDds(uint32_t array, const std::filesystem::path& fileName)const
+{
+	return WriteFile(fileName, arrays[array].File);
+}
+
+//--------------------------------------------------------------------------------------
+// TextureAtlas
+//--------------------------------------------------------------------------------------
+PackResult TextureAtlas::Build(const std::vector<const DdsImage*>& images, const AtlasOptions& options)
+{
+	*this = TextureAtlas();
+	if (images.empty() || options.MaxSize == 0)
+		return PackResult::InvalidArgument;
+
+	for (const DdsImage* image : images)
+	{
+		if (!IsSingle2D(image))
+			return PackResult::InvalidArgument;
+		if (image->Format() != images[0]->Format() || !IsSupported(image->Format()))
+			return PackResult::NotSupported;
+	}
+
+	const DXGI_FORMAT atlasFormat = images[0]->Format();
+	uint32_t elementTexels = 1;
+	size_t elementBytes = 0;
+	ElementInfo(atlasFormat, elementTexels, elementBytes);
+
+	// The gutter shrinks with the mips, so it decides how many levels stay separated.
+	uint32_t gutter = elementTexels;
+	while (gutter < options.Gutter)
+	{
+		gutter *= 2;
+	}
+	uint32_t levels = 1;
+	while ((gutter >> levels) >= elementTexels)
+	{
+		++levels;
+	}
+	if (options.MaxLevels != 0)
+	{
+		levels = std::min(levels, options.MaxLevels);
+	}
+
+	// Each image's mips must halve exactly down to the last level, in whole elements.
+	for (const DdsImage* image : images)
+	{
+		if (image->Width() % elementTexels != 0 || image->Height() % elementTexels != 0)
+			return PackResult::NotSupported;
+
+		levels = std::min(levels, image->MipCount());
+		while (levels > 1 && (image->Width() % (elementTexels << (levels - 1)) != 0 ||
+			image->Height() % (elementTexels << (levels - 1)) != 0))
+		{
+			--levels;
+		}
+	}
+
+	// Positions on this grid stay whole elements at every level.
+	const uint32_t align = elementTexels << (levels - 1);
+
+	struct Cell
+	{
+		uint32_t Image;
+		uint32_t Width;
+		uint32_t Height;
+	};
+	std::vector<Cell> cells;
+	uint64_t area = 0;
+	uint32_t widest = 0;
+	for (uint32_t i = 0; i < (uint32_t)images.size(); ++i)
+	{
+		Cell c = { i, RoundUp(images[i]->Width() + 2 * gutter, align), RoundUp(images[i]->Height() + 2 * gutter, align) };
+		area += (uint64_t)c.Width * c.Height;
+		widest = std::max(widest, c.Width);
+		cells.push_back(c);
+	}
+
+	// Shelves of images sorted by height, widening the atlas until it is tall enough.
+	std::stable_sort(cells.begin(), cells.end(), [](const Cell& a, const Cell& b) { return a.Height > b.Height; });
+
+	regions.resize(images.size());
+	uint32_t atlasWidth = RoundUp(std::max(widest, (uint32_t)std::ceil(std::sqrt((double)area))), align);
+	for (;;)
+	{
+		if (atlasWidth > options.MaxSize)
+		{
+			*this = TextureAtlas();
+			return PackResult::TooLarge;
+		}
+
+		uint32_t x = 0, y = 0, shelfHeight = 0, usedWidth = 0;
+		for (const Cell& c : cells)
+		{
+			if (x + c.Width > atlasWidth)
+			{
+				x = 0;
+				y += shelfHeight;
+				shelfHeight = 0;
+			}
+
+			AtlasRegion& r = regions[c.Image];
+			r.X = x + gutter;
+			r.Y = y + gutter;
+			r.Width = images[c.Image]->Width();
+			r.Height = images[c.Image]->Height();
+
+			x += c.Width;
+			usedWidth = std::max(usedWidth, x);
+			shelfHeight = std::max(shelfHeight, c.Height);
+		}
+
+		width = usedWidth;
+		height = y + shelfHeight;
+		if (height <= options.MaxSize)
+			break;
+
+		atlasWidth = RoundUp(atlasWidth + atlasWidth / 2, align);
+	}
+
+	format = atlasFormat;
+	mipCount = levels;
+	for (AtlasRegion& r : regions)
+	{
+		r.ScaleU = (float)r.Width / width;
+		r.ScaleV = (float)r.Height / height;
+		r.OffsetU = (float)r.X / width;
+		r.OffsetV = (float)r.Y / height;
+	}
+
+	size_t levelOffsets[DdsImage::MaxMipLevels] = {};
+	size_t dataSize = 0;
+	for (uint32_t m = 0; m < levels; ++m)
+	{
+		size_t numBytes = 0;
+		DdsImage::GetSurfaceInfo(width >> m, height >> m, format, &numBytes, nullptr, nullptr);
+		levelOffsets[m] = dataSize;
+		dataSize += numBytes;
+	}
+	file.assign(DdsImage::HeaderSize + dataSize, 0);
+	DdsImage::WriteHeader(file.data(), format, width, height, levels, 1);
+
+	for (uint32_t m = 0; m < levels; ++m)
+	{
+		size_t rowBytes = 0;
+		DdsImage::GetSurfaceInfo(width >> m, height >> m, format, nullptr, &rowBytes, nullptr);
+		uint8_t* level = file.data() + DdsImage::HeaderSize + levelOffsets[m];
+		const int border = (int)((gutter >> m) / elementTexels);
+
+		for (uint32_t i = 0; i < (uint32_t)images.size(); ++i)
+		{
+			DdsSubresource s = images[i]->Subresource(m, 0);
+			const int sourceWidth = (int)(s.RowPitch / elementBytes);
+			const int sourceHeight = (int)s.NumRows;
+			const int left = (int)((regions[i].X >> m) / elementTexels);
+			const int top = (int)((regions[i].Y >> m) / elementTexels);
+
+			for (int y = -border; y < sourceHeight + border; ++y)
+			{
+				int sy = options.Wrap ? ((y % sourceHeight) + sourceHeight) % sourceHeight : std::clamp(y, 0, sourceHeight - 1);
+				const uint8_t* sourceRow = s.Data + sy * s.RowPitch;
+				uint8_t* row = level + (top + y) * rowBytes;
+
+				for (int x = -border; x < sourceWidth + border; ++x)
+				{
+					int sx = options.Wrap ? ((x % sourceWidth) + sourceWidth) % sourceWidth : std::clamp(x, 0, sourceWidth - 1);
+					std::memcpy(row + (left + x) * elementBytes, sourceRow + sx * elementBytes, elementBytes);
+				}
+			}
+		}
+	}
+	return PackResult::Ok;
+}
+
+DXGI_FORMAT TextureAtlas::Format()const
+{
+	return format;
+}
+
+uint32_t TextureAtlas::Width()const
+{
+	return width;
+}
+
+uint32_t TextureAtlas::Height()const
+{
+	return height;
+}
+
+uint32_t TextureAtlas::MipCount()const
+{
+	return mipCount;
+}
+
+uint32_t TextureAtlas::RegionCount()const
+{
+	return (uint32_t)regions.size();
+}
+
+const AtlasRegion& TextureAtlas::Region(uint32_t image)const
+{
+	return regions[image];
+}
+
+const std::vector<uint8_t>& TextureAtlas::File()const
+{
+	return file;
+}
+
+bool TextureAtlas::SaveDds(const std::filesystem::path& fileName)const
+{
+	return WriteFile(fileName, file);
+}
+
+bool TextureAtlas::IsSupported(DXGI_FORMAT format)
+{
+	size_t bpp = DdsImage::BitsPerPixel(format);
+	if (bpp == 0)
+		return false;
+	if (IsBlockCompressed(format))
+		return true;
+
+	// Excludes packed and planar formats, whose texels do not have bytes of their own.
+	// A single texel cannot tell: a packed pair is stored even for a width of one.
+	size_t numBytes = 0, rowBytes = 0, numRows = 0;
+	DdsImage::GetSurfaceInfo(2, 2, format, &numBytes, &rowBytes, &numRows);
+	return bpp % 8 == 0 && rowBytes == 2 * bpp / 8 && numRows == 2;
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+#include "DdsImage.h"
+
+enum class PackResult
+{
+	Ok,
+	// No images, or an image that is not a single 2D texture.
+	InvalidArgument,
+	// Atlas images of differing formats, or a format that is not whole texels or 4x4 blocks.
+	NotSupported,
+	// The atlas would not fit in AtlasOptions::MaxSize.
+	TooLarge
+};
+
+// Textures of one format, size and mip count packed into a Texture2DArray.
+struct TextureArray
+{
+	DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t MipCount = 0;
+	// Indices of the packed images, in slice order.
+	std::vector<uint32_t> Members;
+	// The array as a DDS file in memory, ready for TextureStreamer::Add or a file.
+	std::vector<uint8_t> File;
+};
+
+// Where a packed image ended up.
+struct ArraySlice
+{
+	uint32_t Array = 0;
+	uint32_t Slice = 0;
+};
+
+// Groups 2D textures by format, size and mip count and packs each group into one
+// texture array, so that materials index an array and a slice and a whole group
+// takes a single descriptor.  Texels are copied a mip chain at a time from the
+// parsed images; nothing is resampled or re-encoded.  Needs neither D3D nor Windows,
+// so the same packing serves an offline asset step (SaveDds) and loading at runtime.
+class TextureArrayPacker
+{
+public:
+	///<summary>
+	/// Packs images, whose data only has to outlive the call.  Arrays are ordered by
+	/// their first member and slices by image index, so the result is deterministic.
+	///</summary>
+	PackResult Pack(const std::vector<const DdsImage*>& images);
+
+	uint32_t ArrayCount()const;
+	const TextureArray& Array(uint32_t array)const;
+
+	///<summary>
+	/// The array and slice image went to.
+	///</summary>
+	ArraySlice Location(uint32_t image)const;
+
+	///<summary>
+	/// Hands over the DDS file of array, leaving it empty, so it can go to the streamer
+	/// without a copy.
+	///</summary>
+	std::vector<uint8_t> TakeFile(uint32_t array);
+
+	bool SaveDds(uint32_t array, const std::filesystem::path& fileName)const;
+
+private:
+	std::vector<TextureArray> arrays;
+	std::vector<ArraySlice> locations;
+};
+
+struct AtlasOptions
+{
+	// Border around each image at the top level, in texels.  Rounded up to a power of
+	// two of at least one block; the atlas has as many mips as keep it at least one
+	// texel (block) wide, so filtering never reaches a neighbouring image.
+	uint32_t Gutter = 8;
+	// Fill the borders from the opposite edge instead of repeating the edge.
+	bool Wrap = false;
+	// Levels to keep including the top one; 0 for as many as the gutters and images allow.
+	uint32_t MaxLevels = 0;
+	uint32_t MaxSize = DdsImage::MaxTexture2DDimension;
+};
+
+struct AtlasRegion
+{
+	// Texels of the top level the image covers, borders excluded.
+	uint32_t X = 0;
+	uint32_t Y = 0;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	// uv * Scale + Offset maps the image's texture coordinates into the atlas.
+	float ScaleU = 1.0f;
+	float ScaleV = 1.0f;
+	float OffsetU = 0.0f;
+	float OffsetV = 0.0f;
+};
+
+// Images of one format but any size packed side by side into a single 2D texture,
+// for textures that do not repeat, such as billboards and decals, which an array
+// cannot hold unless they match in size.  Regions are placed on a grid coarse enough
+// that each image's own mips land exactly on the atlas mips, so block-compressed
+// images are copied block by block and nothing is re-encoded.  Every level gets
+// borders copied from the image's edges.  Repeating texture coordinates would need
+// frac() in the shader, which breaks the derivatives at the seams; tiling textures
+// belong in a TextureArrayPacker array instead.
+class TextureAtlas
+{
+public:
+	PackResult Build(const std::vector<const DdsImage*>& images, const AtlasOptions& options = AtlasOptions());
+
+	DXGI_FORMAT Format()const;
+	uint32_t Width()const;
+	uint32_t Height()const;
+	uint32_t MipCount()const;
+
+	uint32_t RegionCount()const;
+	const AtlasRegion& Region(uint32_t image)const;
+
+	///<summary>
+	/// The atlas as a DDS file in memory.
+	///</summary>
+	const std::vector<uint8_t>& File()const;
+
+	bool SaveDds(const std::filesystem::path& fileName)const;
+
+	static bool IsSupported(DXGI_FORMAT format);
+
+private:
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t mipCount = 0;
+	std::vector<AtlasRegion> regions;
+	std::vector<uint8_t> file;
+};
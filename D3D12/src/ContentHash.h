@@ -0,0 +1,10 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+///<summary>
+/// 64-bit hash of bytes (XXH64 with the given seed), to tell files apart by their
+/// contents.  Reads 32 bytes per step in four independent lanes, so hashing runs at
+/// close to memory bandwidth.
+///</summary>
+std::uint64_t ContentHash(const void* data, size_t bytes, std::uint64_t seed = 0);
@@ -74,6 +74,33 @@ void CubeRenderTarget::OnResize(UINT newWidth, UINT newHeight)
 	}
 }
 
+UINT64 CubeRenderTarget::ReadbackSize()const
+{
+	D3D12_RESOURCE_DESC desc = mCubeMap->GetDesc();
+	UINT64 totalBytes = 0;
+	md3dDevice->GetCopyableFootprints(&desc, 0, 6, 0, nullptr, nullptr, nullptr, &totalBytes);
+	return totalBytes;
+}
+
+D3D12_PLACED_SUBRESOURCE_FOOTPRINT CubeRenderTarget::ReadbackFootprint(int faceIndex)const
+{
+	// Each face starts where the previous ones end, so ask for all of them.
+	D3D12_RESOURCE_DESC desc = mCubeMap->GetDesc();
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprints[6];
+	md3dDevice->GetCopyableFootprints(&desc, 0, 6, 0, footprints, nullptr, nullptr, nullptr);
+	return footprints[faceIndex];
+}
+
+void CubeRenderTarget::CopyToReadback(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* readback)
+{
+	for (int i = 0; i < 6; ++i)
+	{
+		CD3DX12_TEXTURE_COPY_LOCATION dst(readback, ReadbackFootprint(i));
+		CD3DX12_TEXTURE_COPY_LOCATION src(mCubeMap.Get(), i);
+		cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+	}
+}
+
 void CubeRenderTarget::BuildDescriptors()
 {
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
@@ -41,6 +41,13 @@ public:
 
 	void OnResize(UINT newWidth, UINT newHeight);
 
+	// Reading the faces back, to project them onto spherical harmonics with
+	// ProjectCubeFaces.  The readback buffer holds all six faces, each at its
+	// footprint.  Copy from a state that includes COPY_SOURCE, such as GENERIC_READ.
+	UINT64 ReadbackSize()const;
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT ReadbackFootprint(int faceIndex)const;
+	void CopyToReadback(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* readback);
+
 private:
 	void BuildDescriptors();
 	void BuildResource();
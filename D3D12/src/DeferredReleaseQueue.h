@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+// Keeps objects the GPU may still be using alive until it has passed a fence.
+// Release queues an owner (typically a ComPtr) for the next fence value handed to
+// EndFrame, or for an explicit fence value; Reclaim destroys every owner whose
+// fence the GPU has reached.  Fence values are plain numbers, so the queue can be
+// driven by a counter instead of an ID3D12Fence.
+template<typename T>
+class DeferredReleaseQueue
+{
+public:
+	DeferredReleaseQueue() = default;
+	DeferredReleaseQueue(const DeferredReleaseQueue& rhs) = delete;
+	DeferredReleaseQueue& operator=(const DeferredReleaseQueue& rhs) = delete;
+	~DeferredReleaseQueue() = default;
+
+	///<summary>
+	/// Releases object once the commands recorded so far have completed, i.e. after
+	/// the fence value of the next EndFrame.
+	///</summary>
+	void Release(T object)
+	{
+		Entry e;
+		e.Object = std::move(object);
+		entries.push_back(std::move(e));
+		pendingCount++;
+	}
+
+	///<summary>
+	/// Releases object once the GPU has reached fenceValue, which must not be lower
+	/// than any fence value already queued.
+	///</summary>
+	void Release(T object, std::uint64_t fenceValue)
+	{
+		Entry e;
+		e.Object = std::move(object);
+		e.FenceValue = fenceValue;
+
+		// Objects waiting for EndFrame stay at the back.
+		entries.insert(entries.end() - pendingCount, std::move(e));
+	}
+
+	///<summary>
+	/// Call after signaling fenceValue; everything released since the previous call
+	/// waits for it.
+	///</summary>
+	void EndFrame(std::uint64_t fenceValue)
+	{
+		for (auto it = entries.end() - pendingCount; it != entries.end(); ++it)
+		{
+			it->FenceValue = fenceValue;
+		}
+		pendingCount = 0;
+	}
+
+	///<summary>
+	/// Destroys the objects whose fence value the GPU has reached and returns how many.
+	///</summary>
+	std::size_t Reclaim(std::uint64_t completedFenceValue)
+	{
+		std::size_t released = 0;
+		while (entries.size() > pendingCount && entries.front().FenceValue <= completedFenceValue)
+		{
+			entries.pop_front();
+			released++;
+		}
+		return released;
+	}
+
+	///<summary>
+	/// Destroys everything.  Only safe once the GPU is idle.
+	///</summary>
+	void Clear()
+	{
+		entries.clear();
+		pendingCount = 0;
+	}
+
+	std::size_t Size()const
+	{
+		return entries.size();
+	}
+
+private:
+	struct Entry
+	{
+		T Object{};
+		std::uint64_t FenceValue = UINT64_MAX;
+	};
+
+	// Ordered by fence value; entries without one yet are at the back.
+	std::deque<Entry> entries;
+	std::size_t pendingCount = 0;
+};
+
+#ifdef _WIN32
+#include <wrl.h>
+
+// Queue for D3D objects: resources, heaps, descriptor heaps, pipeline states.
+using ResourceReleaseQueue = DeferredReleaseQueue<Microsoft::WRL::ComPtr<IUnknown>>;
+#endif
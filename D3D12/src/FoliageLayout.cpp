@@ -0,0 +1,226 @@
+#include "FoliageLayout.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace
+{
+	struct Point
+	{
+		float X;
+		float Z;
+	};
+
+	float Lerp(float a, float b, float t)
+	{
+		return a + (b - a) * t;
+	}
+}
+
+FoliageLayout::FoliageLayout(const FoliageDesc& desc)
+	:desc(desc)
+{
+	cellCountX = (uint32_t)std::max(1.0f, ceilf(desc.Width / desc.CellSize));
+	cellCountZ = (uint32_t)std::max(1.0f, ceilf(desc.Depth / desc.CellSize));
+}
+
+void FoliageLayout::Scatter(const std::function<float(float, float)>& heightFn, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	const float x0 = -0.5f * desc.Width;
+	const float z0 = -0.5f * desc.Depth;
+
+	//
+	// Dart throwing on a jittered grid.  With a grid spacing of r/sqrt(2) every grid
+	// square holds at most one sample, so each candidate only has to be tested
+	// against the 5x5 neighbourhood of squares already visited.
+	//
+
+	const float r = desc.MinSpacing;
+	const float r2 = r * r;
+	const float gridSpacing = r / sqrtf(2.0f);
+	const int gridW = std::max(1, (int)ceilf(desc.Width / gridSpacing));
+	const int gridD = std::max(1, (int)ceilf(desc.Depth / gridSpacing));
+
+	std::vector<int> grid(gridW * gridD, -1);
+	std::vector<Point> points;
+	points.reserve(grid.size() / 2);
+
+	for (int gz = 0; gz < gridD; ++gz)
+	{
+		for (int gx = 0; gx < gridW; ++gx)
+		{
+			Point p;
+			p.X = x0 + (gx + unit(rng)) * gridSpacing;
+			p.Z = z0 + (gz + unit(rng)) * gridSpacing;
+
+			if (p.X > -x0 || p.Z > -z0)
+				continue;
+
+			bool accept = true;
+			for (int nz = std::max(0, gz - 2); nz <= gz && accept; ++nz)
+			{
+				for (int nx = std::max(0, gx - 2); nx <= std::min(gridW - 1, gx + 2); ++nx)
+				{
+					int n = grid[nz * gridW + nx];
+					if (n < 0)
+						continue;
+
+					float dx = points[n].X - p.X;
+					float dz = points[n].Z - p.Z;
+					if (dx * dx + dz * dz < r2)
+					{
+						accept = false;
+						break;
+					}
+				}
+			}
+
+			if (accept)
+			{
+				grid[gz * gridW + gx] = (int)points.size();
+				points.push_back(p);
+			}
+		}
+	}
+
+	points.erase(std::remove_if(points.begin(), points.end(),
+		[&](const Point& p) { return heightFn(p.X, p.Z) < desc.MinHeight; }), points.end());
+
+	//
+	// Bucket the samples into culling cells with a counting sort so every cell
+	// owns a contiguous range of instances.
+	//
+
+	auto cellIndex = [&](const Point& p)
+	{
+		uint32_t cx = std::min(cellCountX - 1, (uint32_t)((p.X - x0) / desc.CellSize));
+		uint32_t cz = std::min(cellCountZ - 1, (uint32_t)((p.Z - z0) / desc.CellSize));
+		return cz * cellCountX + cx;
+	};
+
+	cells.assign(cellCountX * cellCountZ, FoliageCell());
+	for (const Point& p : points)
+	{
+		cells[cellIndex(p)].InstanceCount++;
+	}
+
+	uint32_t first = 0;
+	for (FoliageCell& cell : cells)
+	{
+		cell.FirstInstance = first;
+		first += cell.InstanceCount;
+		cell.InstanceCount = 0;
+	}
+
+	instances.resize(points.size());
+	for (const Point& p : points)
+	{
+		FoliageCell& cell = cells[cellIndex(p)];
+
+		float size = Lerp(desc.MinSize, desc.MaxSize, unit(rng));
+
+		FoliageInstance& inst = instances[cell.FirstInstance + cell.InstanceCount++];
+		inst.Pos[0] = p.X;
+		inst.Pos[1] = heightFn(p.X, p.Z) + desc.HeightOffset;
+		inst.Pos[2] = p.Z;
+		inst.Size[0] = size;
+		inst.Size[1] = size;
+	}
+
+	for (FoliageCell& cell : cells)
+	{
+		auto begin = instances.begin() + cell.FirstInstance;
+		std::shuffle(begin, begin + cell.InstanceCount, rng);
+
+		if (cell.InstanceCount == 0)
+			continue;
+
+		// The sprite is expanded around its center, so grow the bounds by half its size.
+		std::fill(std::begin(cell.BoundsMin), std::end(cell.BoundsMin), +std::numeric_limits<float>::infinity());
+		std::fill(std::begin(cell.BoundsMax), std::end(cell.BoundsMax), -std::numeric_limits<float>::infinity());
+		for (uint32_t i = 0; i < cell.InstanceCount; ++i)
+		{
+			const FoliageInstance& inst = instances[cell.FirstInstance + i];
+			const float halfSize[3] = { 0.5f * inst.Size[0], 0.5f * inst.Size[1], 0.5f * inst.Size[0] };
+			for (int k = 0; k < 3; ++k)
+			{
+				cell.BoundsMin[k] = std::min(cell.BoundsMin[k], inst.Pos[k] - halfSize[k]);
+				cell.BoundsMax[k] = std::max(cell.BoundsMax[k], inst.Pos[k] + halfSize[k]);
+			}
+		}
+	}
+
+	stats = FoliageStats();
+	stats.TotalInstances = (uint32_t)instances.size();
+	stats.TotalCells = (uint32_t)cells.size();
+}
+
+uint32_t FoliageLayout::Cull(const std::function<bool(const FoliageCell&)>& isVisible,
+	const float eyePosW[3],
+	uint32_t maxInstances,
+	const std::function<void(uint32_t, std::span<const FoliageInstance>)>& write)
+{
+	uint32_t written = 0;
+	stats.VisibleCells = 0;
+
+	for (const FoliageCell& cell : cells)
+	{
+		if (written == maxInstances)
+			break;
+
+		if (cell.InstanceCount == 0)
+			continue;
+
+		if (!isVisible(cell))
+			continue;
+
+		// Distance from the eye to the closest point of the cell bounds.
+		float d2 = 0.0f;
+		for (int k = 0; k < 3; ++k)
+		{
+			float d = std::max({ cell.BoundsMin[k] - eyePosW[k], eyePosW[k] - cell.BoundsMax[k], 0.0f });
+			d2 += d * d;
+		}
+		float distance = sqrtf(d2);
+
+		if (distance > desc.CullDistance)
+			continue;
+
+		uint32_t count = (uint32_t)ceilf(cell.InstanceCount * CellDensity(distance));
+		count = std::min(count, maxInstances - written);
+
+		// A cell's instances are contiguous, so the whole cell is one bulk copy.
+		write(written, std::span<const FoliageInstance>(instances.data() + cell.FirstInstance, count));
+		written += count;
+
+		stats.VisibleCells++;
+	}
+
+	stats.VisibleInstances = written;
+
+	return written;
+}
+
+float FoliageLayout::CellDensity(float distance)const
+{
+	float t = std::clamp((distance - desc.LodNear) / std::max(desc.LodFar - desc.LodNear, 1e-3f), 0.0f, 1.0f);
+	return Lerp(1.0f, desc.LodMinDensity, t);
+}
+
+const std::vector<FoliageCell>& FoliageLayout::Cells()const
+{
+	return cells;
+}
+
+const std::vector<FoliageInstance>& FoliageLayout::Instances()const
+{
+	return instances;
+}
+
+const FoliageStats& FoliageLayout::Stats()const
+{
+	return stats;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <vector>
+
+// One billboard.  Matches the POSITION/SIZE layout the tree sprite shader reads,
+// so the per-frame instance buffer can be bound directly as a vertex buffer.
+struct FoliageInstance
+{
+	float Pos[3] = {};
+	float Size[2] = {};
+};
+
+struct FoliageDesc
+{
+	// Extent of the scattered area, centered at the origin in the xz-plane.
+	float Width = 160.0f;
+	float Depth = 160.0f;
+
+	// Minimum distance between two instances (Poisson disk radius).
+	float MinSpacing = 2.0f;
+
+	// Samples where the terrain is lower than this, such as under water, are dropped.
+	float MinHeight = -std::numeric_limits<float>::infinity();
+
+	// Side length of a culling cell.
+	float CellSize = 16.0f;
+
+	// Billboard size range and lift above the terrain.
+	float MinSize = 14.0f;
+	float MaxSize = 22.0f;
+	float HeightOffset = 8.0f;
+
+	// Cells closer than LodNear draw all their instances, the density then falls
+	// off linearly to LodMinDensity at LodFar.  Cells past CullDistance are skipped.
+	float LodNear = 60.0f;
+	float LodFar = 250.0f;
+	float LodMinDensity = 0.1f;
+	float CullDistance = 400.0f;
+};
+
+struct FoliageStats
+{
+	uint32_t TotalInstances = 0;
+	uint32_t TotalCells = 0;
+	uint32_t VisibleCells = 0;
+	uint32_t VisibleInstances = 0;
+};
+
+struct FoliageCell
+{
+	// Bounds of the cell's billboards, sprites included; empty cells keep zeros.
+	float BoundsMin[3] = {};
+	float BoundsMax[3] = {};
+	uint32_t FirstInstance = 0;
+	uint32_t InstanceCount = 0;
+};
+
+// Scatters billboards and picks the ones to draw, without touching D3D or DirectXMath:
+// the frustum test and the instance buffer come in as callbacks, so the placement and
+// the cell culling can be checked without a GPU.  FoliageSystem adds the D3D side.
+class FoliageLayout
+{
+public:
+	FoliageLayout(const FoliageDesc& desc);
+	FoliageLayout(const FoliageLayout& rhs) = delete;
+	FoliageLayout& operator=(const FoliageLayout& rhs) = delete;
+	~FoliageLayout() = default;
+
+	///<summary>
+	/// Places instances over the terrain with a jittered-grid dart throwing scheme, which
+	/// gives a blue-noise distribution in linear time, then buckets them into cells.
+	/// heightFn returns the terrain height at (x, z).
+	///</summary>
+	void Scatter(const std::function<float(float, float)>& heightFn, uint32_t seed);
+
+	///<summary>
+	/// Skips the cells isVisible rejects, picks a density per remaining cell from its
+	/// distance to the eye and hands the surviving instances to write, a cell at a time,
+	/// with the index of their first element.  Returns the number of instances written,
+	/// never more than maxInstances.
+	///</summary>
+	uint32_t Cull(const std::function<bool(const FoliageCell&)>& isVisible,
+		const float eyePosW[3],
+		uint32_t maxInstances,
+		const std::function<void(uint32_t, std::span<const FoliageInstance>)>& write);
+
+	///<summary>
+	/// Fraction of a cell's instances drawn at distance from the eye.
+	///</summary>
+	float CellDensity(float distance)const;
+
+	const std::vector<FoliageCell>& Cells()const;
+	const std::vector<FoliageInstance>& Instances()const;
+	const FoliageStats& Stats()const;
+
+private:
+	FoliageDesc desc;
+
+	uint32_t cellCountX = 0;
+	uint32_t cellCountZ = 0;
+
+	// Instances stored contiguously per cell.  Within a cell they are shuffled so
+	// that any prefix is an even thinning of the whole cell, which is what the
+	// distance LOD draws.
+	std::vector<FoliageInstance> instances;
+	std::vector<FoliageCell> cells;
+
+	FoliageStats stats;
+};
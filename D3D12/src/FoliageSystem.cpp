@@ -0,0 +1,30 @@
+#include "FoliageSystem.h"
+
+using namespace DirectX;
+
+FoliageSystem::FoliageSystem(const FoliageDesc& desc)
+	:FoliageLayout(desc)
+{
+}
+
+UINT FoliageSystem::Cull(const BoundingFrustum& frustumW,
+	const XMFLOAT3& eyePosW,
+	UploadBuffer<FoliageInstance>* instanceBuffer,
+	UINT maxInstances)
+{
+	auto isVisible = [&frustumW](const FoliageCell& cell)
+	{
+		BoundingBox bounds;
+		BoundingBox::CreateFromPoints(bounds,
+			XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(cell.BoundsMin)),
+			XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(cell.BoundsMax)));
+		return frustumW.Contains(bounds) != DirectX::DISJOINT;
+	};
+
+	const float eye[3] = { eyePosW.x, eyePosW.y, eyePosW.z };
+	return FoliageLayout::Cull(isVisible, eye, maxInstances,
+		[instanceBuffer](uint32_t first, std::span<const FoliageInstance> instances)
+		{
+			instanceBuffer->CopyRange(first, instances);
+		});
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "Common/d3dUtil.h"
+#include "FoliageLayout.h"
+#include "UploadBuffer.h"
+
+// FoliageLayout culled against a DirectXMath frustum into an upload buffer.
+class FoliageSystem : public FoliageLayout
+{
+public:
+	FoliageSystem(const FoliageDesc& desc);
+	FoliageSystem(const FoliageSystem& rhs) = delete;
+	FoliageSystem& operator=(const FoliageSystem& rhs) = delete;
+	~FoliageSystem() = default;
+
+	///<summary>
+	/// Culls cells against the world space frustum, picks a density per visible cell from
+	/// its distance to the eye and writes the surviving instances into instanceBuffer.
+	/// Returns the number of instances written, never more than maxInstances.
+	///</summary>
+	UINT Cull(const DirectX::BoundingFrustum& frustumW,
+		const DirectX::XMFLOAT3& eyePosW,
+		UploadBuffer<FoliageInstance>* instanceBuffer,
+		UINT maxInstances);
+};
@@ -1,16 +1,20 @@
 #pragma once
 #include "Common/d3dUtil.h"
 #include "UploadBuffer.h"
+#include "UploadRing.h"
+#include "IndirectCommandPacker.h"
 
-struct ObjectConstants
+// Per-object data, tightly packed into structured buffers (100 bytes instead of a
+// 256 byte constant buffer element).  Both matrices are affine, so they are stored
+// transposed without the constant last column: World[i] is column i of the world matrix.
+// The shaders read it through ObjectData.hlsli.
+struct ObjectData
 {
-    DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
-    DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+    DirectX::XMFLOAT4 World[3];
+    DirectX::XMFLOAT4 TexTransform[3];
     UINT     MaterialIndex;
-    UINT     ObjPad0;
-    UINT     ObjPad1;
-    UINT     ObjPad2;
 };
+static_assert(sizeof(ObjectData) == 100, "ObjectData.hlsli expects a 100 byte stride");
 
 struct PassConstants
 {
@@ -31,6 +35,10 @@ struct PassConstants
     DirectX::XMFLOAT4 AmbientLight = { 0.0f, 0.0f, 0.0f, 1.0f };
 
     Light Lights[MaxLights];
+
+    // Diffuse light from the sky as spherical harmonics (ShShaderConstants), scaled by
+    // AmbientLight; RGB in xyz.
+    DirectX::XMFLOAT4 AmbientSh[9] = {};
 };
 
 struct MaterialData
@@ -44,8 +52,9 @@ struct MaterialData
 
     UINT DiffuseMapIndex = 0;
     UINT NormalMapIndex = 0;
-    UINT MaterialPad1;
-    UINT MaterialPad2;
+    // Slices of the texture arrays the indices select.
+    UINT DiffuseMapSlice = 0;
+    UINT NormalMapSlice = 0;
 };
 
 struct Vertex
@@ -61,17 +70,23 @@ struct Vertex
 class FrameResource
 {
 public:
-    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount);
+    FrameResource(ID3D12Device* device, UINT materialCount);
     FrameResource(const FrameResource& rhs) = delete;
 	FrameResource& operator=(const FrameResource& rhs) = delete;
 	~FrameResource();
 
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> pCmdListAlloc;
 
-    std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
+    // Only updated when dirty, so every frame keeps its own copy.
     std::unique_ptr<UploadBuffer<MaterialData>> MaterialBuffer = nullptr;
-    std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
 
+    // Rewritten every frame, sub-allocated from the upload ring.  ObjectBuffer only
+    // holds the dynamic objects; static ones live in a default heap buffer.
+    // InstanceBuffer holds one object index per instance.
+    UploadAllocation PassCB;
+    UploadAllocation ObjectBuffer;
+    UploadAllocation InstanceBuffer;
+    UploadAllocation IndirectArgs;
 
 
 	UINT64 fenceVal = 0;
@@ -0,0 +1,263 @@
+#include "GpuBufferPool.h"
+#include "StreamingCopy.h"
+
+namespace
+{
+	const D3D12_RESOURCE_STATES ReadState =
+		D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_INDEX_BUFFER;
+}
+
+GpuBufferPool::GpuBufferPool(ID3D12Device* device, ResourceReleaseQueue& releaseQueue, UINT64 pageSize)
+	:device(device), releaseQueue(releaseQueue),
+	pageSize(LinearRingAllocator::AlignUp(pageSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT))
+{
+}
+
+UINT GpuBufferPool::Allocate(UINT64 size)
+{
+	Allocation a;
+	a.Size = size;
+
+	if (size <= pageSize)
+	{
+		for (UINT i = 0; i < (UINT)pages.size() && a.Page == UINT_MAX; ++i)
+		{
+			if (pages[i].pBuffer == nullptr)
+				continue;
+
+			UINT64 offset = pages[i].Allocator.Allocate(size);
+			if (offset != TlsfAllocator::InvalidOffset)
+			{
+				a.Page = i;
+				a.Offset = offset;
+			}
+		}
+	}
+
+	if (a.Page == UINT_MAX)
+	{
+		// Reuse an empty page entry if there is one.
+		UINT i = 0;
+		while (i < (UINT)pages.size() && pages[i].pBuffer != nullptr)
+		{
+			++i;
+		}
+		if (i == (UINT)pages.size())
+		{
+			pages.emplace_back();
+		}
+
+		CreatePage(pages[i], MathHelper::Max(pageSize,
+			LinearRingAllocator::AlignUp(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT)));
+
+		a.Page = i;
+		a.Offset = pages[i].Allocator.Allocate(size);
+		assert(a.Offset != TlsfAllocator::InvalidOffset);
+	}
+
+	UINT id;
+	if (!freeIds.empty())
+	{
+		id = freeIds.back();
+		freeIds.pop_back();
+		allocations[id] = a;
+	}
+	else
+	{
+		id = (UINT)allocations.size();
+		allocations.push_back(a);
+	}
+	return id;
+}
+
+UINT GpuBufferPool::Upload(ID3D12GraphicsCommandList* cmdList, UploadRing& uploadRing, const void* data, UINT64 size)
+{
+	UINT id = Allocate(size);
+	const Allocation& a = allocations[id];
+	Page& page = pages[a.Page];
+
+	UploadAllocation staging = uploadRing.Allocate(size);
+	StreamingCopy(staging.CPU, data, (size_t)size);
+
+	Transition(cmdList, page, D3D12_RESOURCE_STATE_COPY_DEST);
+	cmdList->CopyBufferRegion(page.pBuffer.Get(), a.Offset, staging.Resource, staging.Offset, size);
+
+	return id;
+}
+
+void GpuBufferPool::Free(UINT allocation)
+{
+	assert(allocation < allocations.size() && allocations[allocation].Page != UINT_MAX);
+
+	PendingFree f;
+	f.Allocation = allocation;
+	pendingFrees.push_back(f);
+}
+
+GpuBufferRange GpuBufferPool::Get(UINT allocation)const
+{
+	const Allocation& a = allocations[allocation];
+	const Page& page = pages[a.Page];
+
+	GpuBufferRange range;
+	range.Resource = page.pBuffer.Get();
+	range.Offset = a.Offset;
+	range.Size = a.Size;
+	range.GPU = page.pBuffer->GetGPUVirtualAddress() + a.Offset;
+	return range;
+}
+
+void GpuBufferPool::FinishUploads(ID3D12GraphicsCommandList* cmdList)
+{
+	for (Page& page : pages)
+	{
+		if (page.pBuffer != nullptr)
+		{
+			Transition(cmdList, page, ReadState);
+		}
+	}
+}
+
+UINT GpuBufferPool::Defragment(ID3D12GraphicsCommandList* cmdList, float maxFragmentation)
+{
+	UINT moved = 0;
+	std::vector<UINT> ids;
+
+	for (UINT i = 0; i < (UINT)pages.size(); ++i)
+	{
+		Page& page = pages[i];
+		if (page.pBuffer == nullptr || page.Allocator.AllocationCount() == 0 ||
+			page.Allocator.GetStats().Fragmentation() <= maxFragmentation)
+		{
+			continue;
+		}
+
+		// Frames in flight still read the old page, so the allocations are packed into a
+		// new one rather than moved in place.
+		ids.clear();
+		for (UINT id = 0; id < (UINT)allocations.size(); ++id)
+		{
+			if (allocations[id].Page == i)
+			{
+				ids.push_back(id);
+			}
+		}
+		std::sort(ids.begin(), ids.end(),
+			[this](UINT a, UINT b) { return allocations[a].Offset < allocations[b].Offset; });
+
+		Page packed;
+		CreatePage(packed, page.Allocator.Capacity());
+
+		Transition(cmdList, page, D3D12_RESOURCE_STATE_COPY_SOURCE);
+		Transition(cmdList, packed, D3D12_RESOURCE_STATE_COPY_DEST);
+
+		for (UINT id : ids)
+		{
+			Allocation& a = allocations[id];
+			UINT64 offset = packed.Allocator.Allocate(a.Size);
+			assert(offset != TlsfAllocator::InvalidOffset);
+
+			cmdList->CopyBufferRegion(packed.pBuffer.Get(), offset, page.pBuffer.Get(), a.Offset, a.Size);
+			a.Offset = offset;
+		}
+		moved += (UINT)ids.size();
+
+		ReleasePage(page);
+		page = std::move(packed);
+	}
+
+	return moved;
+}
+
+void GpuBufferPool::EndFrame(UINT64 fenceValue)
+{
+	for (PendingFree& f : pendingFrees)
+	{
+		if (f.FenceValue == UINT64_MAX)
+		{
+			f.FenceValue = fenceValue;
+		}
+	}
+}
+
+void GpuBufferPool::Reclaim(UINT64 completedFenceValue)
+{
+	auto done = std::stable_partition(pendingFrees.begin(), pendingFrees.end(),
+		[completedFenceValue](const PendingFree& f) { return f.FenceValue > completedFenceValue; });
+
+	for (auto it = done; it != pendingFrees.end(); ++it)
+	{
+		Allocation& a = allocations[it->Allocation];
+		Page& page = pages[a.Page];
+
+		page.Allocator.Free(a.Offset);
+		if (page.Allocator.AllocationCount() == 0)
+		{
+			ReleasePage(page);
+		}
+
+		a = Allocation();
+		freeIds.push_back(it->Allocation);
+	}
+
+	pendingFrees.erase(done, pendingFrees.end());
+}
+
+GpuBufferPoolStats GpuBufferPool::GetStats()const
+{
+	GpuBufferPoolStats stats;
+	for (const Page& page : pages)
+	{
+		if (page.pBuffer == nullptr)
+			continue;
+
+		TlsfAllocator::Stats s = page.Allocator.GetStats();
+		stats.PageCount++;
+		stats.AllocationCount += s.AllocationCount;
+		stats.FreeBlockCount += s.FreeBlockCount;
+		stats.ReservedBytes += s.Capacity;
+		stats.FreeBytes += s.FreeBytes;
+		stats.LargestFreeBlock = MathHelper::Max(stats.LargestFreeBlock, s.LargestFreeBlock);
+	}
+
+	if (stats.FreeBytes > 0)
+	{
+		stats.Fragmentation = 1.0f - (float)stats.LargestFreeBlock / (float)stats.FreeBytes;
+	}
+	return stats;
+}
+
+void GpuBufferPool::CreatePage(Page& page, UINT64 size)
+{
+	CD3DX12_HEAP_DESC heapDesc(size, D3D12_HEAP_TYPE_DEFAULT,
+		D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS);
+	ThrowIfFailed(device->CreateHeap(&heapDesc, IID_PPV_ARGS(page.pHeap.ReleaseAndGetAddressOf())));
+
+	ThrowIfFailed(device->CreatePlacedResource(
+		page.pHeap.Get(),
+		0,
+		&CD3DX12_RESOURCE_DESC::Buffer(size),
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(page.pBuffer.ReleaseAndGetAddressOf())));
+
+	page.Allocator = TlsfAllocator(size, Granularity);
+	page.State = D3D12_RESOURCE_STATE_COMMON;
+}
+
+void GpuBufferPool::ReleasePage(Page& page)
+{
+	// The buffer goes first: a placed resource must not outlive its heap.
+	releaseQueue.Release(std::move(page.pBuffer));
+	releaseQueue.Release(std::move(page.pHeap));
+	page.Allocator = TlsfAllocator();
+}
+
+void GpuBufferPool::Transition(ID3D12GraphicsCommandList* cmdList, Page& page, D3D12_RESOURCE_STATES state)
+{
+	if (page.State == state)
+		return;
+
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(page.pBuffer.Get(), page.State, state));
+	page.State = state;
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include "Common/d3dUtil.h"
+#include "TlsfAllocator.h"
+#include "UploadRing.h"
+#include "DeferredReleaseQueue.h"
+
+// Where an allocation of a GpuBufferPool currently lives.
+struct GpuBufferRange
+{
+	ID3D12Resource* Resource = nullptr;
+	UINT64 Offset = 0;
+	UINT64 Size = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS GPU = 0;
+};
+
+struct GpuBufferPoolStats
+{
+	UINT PageCount = 0;
+	UINT AllocationCount = 0;
+	UINT FreeBlockCount = 0;
+	UINT64 ReservedBytes = 0;
+	UINT64 FreeBytes = 0;
+	UINT64 LargestFreeBlock = 0;
+
+	///<summary>
+	/// 1 - largest free block / free bytes, over all pages.
+	///</summary>
+	float Fragmentation = 0.0f;
+};
+
+// Default heap memory for vertex and index buffers.  Meshes are placed in large
+// buffers (pages), each a placed resource filling its own heap, and sub-allocated
+// with a TlsfAllocator instead of getting a committed resource each.  Data is
+// staged through the UploadRing.  Allocations are referred to by id because
+// Defragment may move them; look up their location with Get after it.
+class GpuBufferPool
+{
+public:
+	static const UINT InvalidAllocation = UINT_MAX;
+
+	GpuBufferPool(ID3D12Device* device, ResourceReleaseQueue& releaseQueue, UINT64 pageSize = 16 * 1024 * 1024);
+	GpuBufferPool(const GpuBufferPool& rhs) = delete;
+	GpuBufferPool& operator=(const GpuBufferPool& rhs) = delete;
+	~GpuBufferPool() = default;
+
+	///<summary>
+	/// Reserves size bytes.  Allocations larger than a page get a page of their own.
+	///</summary>
+	UINT Allocate(UINT64 size);
+
+	///<summary>
+	/// Allocates size bytes and records a copy of data into them on cmdList.  The
+	/// range is readable after the next FinishUploads.
+	///</summary>
+	UINT Upload(ID3D12GraphicsCommandList* cmdList, UploadRing& uploadRing, const void* data, UINT64 size);
+
+	///<summary>
+	/// Frees the allocation once the frames in flight are done with it, i.e. after the
+	/// fence of the next EndFrame.
+	///</summary>
+	void Free(UINT allocation);
+
+	GpuBufferRange Get(UINT allocation)const;
+
+	///<summary>
+	/// Transitions the pages written since the last call back to vertex and index
+	/// buffer state.  Call after the copies and before drawing from the pool.
+	///</summary>
+	void FinishUploads(ID3D12GraphicsCommandList* cmdList);
+
+	///<summary>
+	/// Compacts every page whose fragmentation exceeds maxFragmentation into a new
+	/// page and retires the old one.  Returns the number of allocations moved; Get
+	/// returns their new location, and views of them must be rebuilt.
+	///</summary>
+	UINT Defragment(ID3D12GraphicsCommandList* cmdList, float maxFragmentation = 0.25f);
+
+	///<summary>
+	/// Call once per frame after signaling fenceValue for it.
+	///</summary>
+	void EndFrame(UINT64 fenceValue);
+
+	///<summary>
+	/// Completes the frees whose fence value the GPU has reached.
+	///</summary>
+	void Reclaim(UINT64 completedFenceValue);
+
+	GpuBufferPoolStats GetStats()const;
+
+private:
+	struct Page
+	{
+		Microsoft::WRL::ComPtr<ID3D12Heap> pHeap;
+		Microsoft::WRL::ComPtr<ID3D12Resource> pBuffer;
+		TlsfAllocator Allocator;
+		D3D12_RESOURCE_STATES State = D3D12_RESOURCE_STATE_COMMON;
+	};
+
+	struct Allocation
+	{
+		UINT Page = UINT_MAX;
+		UINT64 Offset = 0;
+		UINT64 Size = 0;
+	};
+
+	struct PendingFree
+	{
+		UINT Allocation = InvalidAllocation;
+		UINT64 FenceValue = UINT64_MAX;
+	};
+
+	void CreatePage(Page& page, UINT64 size);
+	void ReleasePage(Page& page);
+	void Transition(ID3D12GraphicsCommandList* cmdList, Page& page, D3D12_RESOURCE_STATES state);
+
+private:
+	// Placement granularity inside a page.  Vertex and index buffers need far less,
+	// but it keeps the allocator's block count low.
+	static const UINT64 Granularity = 256;
+
+	ID3D12Device* device = nullptr;
+	ResourceReleaseQueue& releaseQueue;
+	UINT64 pageSize = 0;
+
+	// Pages with a null buffer are empty and can be recreated.
+	std::vector<Page> pages;
+	std::vector<Allocation> allocations;
+	std::vector<UINT> freeIds;
+	std::vector<PendingFree> pendingFrees;
+};
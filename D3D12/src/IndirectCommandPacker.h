@@ -0,0 +1,102 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One indirect draw.  The layout matches a command signature made of a single root
+// 32-bit constant (the batch base instance) followed by D3D12_DRAW_INDEXED_ARGUMENTS,
+// so a packed array can be copied straight into the argument buffer.
+struct IndirectDrawCommand
+{
+	uint32_t BaseInstance = 0;
+
+	uint32_t IndexCountPerInstance = 0;
+	uint32_t InstanceCount = 0;
+	uint32_t StartIndexLocation = 0;
+	int32_t BaseVertexLocation = 0;
+	uint32_t StartInstanceLocation = 0;
+};
+
+// Where the two arguments sit in a command, and the command signature's ByteStride.
+// IndirectDrawArgumentsSize is sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), spelled out so
+// the layout can be checked without the D3D12 headers.
+const uint32_t IndirectBaseInstanceOffset = 0;
+const uint32_t IndirectDrawArgumentsOffset = 4;
+const uint32_t IndirectDrawArgumentsSize = 20;
+const uint32_t IndirectDrawCommandStride = IndirectDrawArgumentsOffset + IndirectDrawArgumentsSize;
+
+// Consecutive commands that share vertex/index buffers and topology and can
+// therefore be submitted with one ExecuteIndirect.  FirstBatch indexes the
+// batch list that was packed, so the caller can look up its input assembler state.
+struct IndirectDrawRun
+{
+	uint32_t FirstBatch = 0;
+	uint32_t FirstCommand = 0;
+	uint32_t CommandCount = 0;
+};
+
+// Packs draw batches into indirect arguments.  This is CPU only and never touches
+// the device, so it can be exercised without a GPU.
+class IndirectCommandPacker
+{
+public:
+	IndirectCommandPacker() = default;
+	IndirectCommandPacker(const IndirectCommandPacker& rhs) = delete;
+	IndirectCommandPacker& operator=(const IndirectCommandPacker& rhs) = delete;
+	~IndirectCommandPacker() = default;
+
+	///<summary>
+	/// TBatch needs Geo, PrimitiveType, IndexCount, StartIndexLocation, BaseVertexLocation,
+	/// StartInstance and InstanceCount members (see InstanceBatch).  Empty batches are
+	/// skipped, and a new run starts whenever the geometry or topology changes.
+	///</summary>
+	template<typename TBatch>
+	void Pack(const std::vector<TBatch>& batches)
+	{
+		commands.clear();
+		runs.clear();
+
+		for (size_t i = 0; i < batches.size(); ++i)
+		{
+			const TBatch& batch = batches[i];
+			if (batch.InstanceCount == 0)
+				continue;
+
+			if (runs.empty() ||
+				batches[runs.back().FirstBatch].Geo != batch.Geo ||
+				batches[runs.back().FirstBatch].PrimitiveType != batch.PrimitiveType)
+			{
+				IndirectDrawRun run;
+				run.FirstBatch = (uint32_t)i;
+				run.FirstCommand = (uint32_t)commands.size();
+				runs.push_back(run);
+			}
+
+			IndirectDrawCommand cmd;
+			cmd.BaseInstance = batch.StartInstance;
+			cmd.IndexCountPerInstance = batch.IndexCount;
+			cmd.InstanceCount = batch.InstanceCount;
+			cmd.StartIndexLocation = batch.StartIndexLocation;
+			cmd.BaseVertexLocation = batch.BaseVertexLocation;
+			// SV_InstanceID ignores StartInstanceLocation, the root constant carries the offset.
+			cmd.StartInstanceLocation = 0;
+
+			commands.push_back(cmd);
+			runs.back().CommandCount++;
+		}
+	}
+
+	const std::vector<IndirectDrawCommand>& Commands()const
+	{
+		return commands;
+	}
+
+	const std::vector<IndirectDrawRun>& Runs()const
+	{
+		return runs;
+	}
+
+private:
+	std::vector<IndirectDrawCommand> commands;
+	std::vector<IndirectDrawRun> runs;
+};
@@ -0,0 +1,93 @@
+#include "InstanceBatcher.h"
+
+using namespace DirectX;
+
+UINT InstanceBatcher::Build(const std::vector<RenderItem*>& visibleItems,
+	const TransformStore& transforms,
+	UINT* instanceObjects,
+	UINT firstInstance)
+{
+	batches.clear();
+
+	// Sort so that items drawing the same submesh end up next to each other.
+	sortedItems.assign(visibleItems.begin(), visibleItems.end());
+	std::sort(sortedItems.begin(), sortedItems.end(),
+		[](const RenderItem* a, const RenderItem* b)
+		{
+			if (a->Geo != b->Geo)
+				return a->Geo < b->Geo;
+			if (a->PrimitiveType != b->PrimitiveType)
+				return a->PrimitiveType < b->PrimitiveType;
+			if (a->StartIndexLocation != b->StartIndexLocation)
+				return a->StartIndexLocation < b->StartIndexLocation;
+			if (a->BaseVertexLocation != b->BaseVertexLocation)
+				return a->BaseVertexLocation < b->BaseVertexLocation;
+			return a->IndexCount < b->IndexCount;
+		});
+
+	UINT instance = firstInstance;
+	for (size_t i = 0; i < sortedItems.size(); ++i)
+	{
+		RenderItem* ri = sortedItems[i];
+
+		if (batches.empty() || !SameBatch(sortedItems[i - 1], ri))
+		{
+			InstanceBatch batch;
+			batch.Geo = ri->Geo;
+			batch.PrimitiveType = ri->PrimitiveType;
+			batch.IndexCount = ri->IndexCount;
+			batch.StartIndexLocation = ri->StartIndexLocation;
+			batch.BaseVertexLocation = ri->BaseVertexLocation;
+			batch.StartInstance = instance;
+			batches.push_back(batch);
+		}
+
+		// The shaders fetch world, tex transform and material through the object index.
+		instanceObjects[instance++] = transforms.ObjectIndex(ri->Transform);
+
+		batches.back().InstanceCount++;
+	}
+
+	return instance - firstInstance;
+}
+
+const std::vector<InstanceBatch>& InstanceBatcher::Batches()const
+{
+	return batches;
+}
+
+void InstanceBatcher::Draw(ID3D12GraphicsCommandList* cmdList, UINT baseInstanceRootParam)const
+{
+	MeshGeometry* boundGeo = nullptr;
+	D3D12_PRIMITIVE_TOPOLOGY boundTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+
+	for (const InstanceBatch& batch : batches)
+	{
+		// Only rebind the input assembler when the batch actually changes it.
+		if (batch.Geo != boundGeo)
+		{
+			cmdList->IASetVertexBuffers(0, 1, &batch.Geo->VertexBufferView());
+			cmdList->IASetIndexBuffer(&batch.Geo->IndexBufferView());
+			boundGeo = batch.Geo;
+		}
+		if (batch.PrimitiveType != boundTopology)
+		{
+			cmdList->IASetPrimitiveTopology(batch.PrimitiveType);
+			boundTopology = batch.PrimitiveType;
+		}
+
+		cmdList->SetGraphicsRoot32BitConstant(baseInstanceRootParam, batch.StartInstance, 0);
+
+		cmdList->DrawIndexedInstanced(batch.IndexCount, batch.InstanceCount,
+			batch.StartIndexLocation, batch.BaseVertexLocation, 0);
+	}
+}
+
+bool InstanceBatcher::SameBatch(const RenderItem* a, const RenderItem* b)
+{
+	return a->Geo == b->Geo &&
+		a->PrimitiveType == b->PrimitiveType &&
+		a->IndexCount == b->IndexCount &&
+		a->StartIndexLocation == b->StartIndexLocation &&
+		a->BaseVertexLocation == b->BaseVertexLocation;
+}
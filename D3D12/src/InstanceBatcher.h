@@ -0,0 +1,57 @@
+#pragma once
+#include "Common/d3dUtil.h"
+#include "FrameResource.h"
+#include "RenderItem.h"
+#include "TransformStore.h"
+
+// One instanced draw.  All instances share the geometry and submesh of the
+// batch; their object indices live in the instance buffer starting at StartInstance.
+struct InstanceBatch
+{
+	MeshGeometry* Geo = nullptr;
+
+	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+	UINT IndexCount = 0;
+	UINT StartIndexLocation = 0;
+	int BaseVertexLocation = 0;
+
+	UINT StartInstance = 0;
+	UINT InstanceCount = 0;
+};
+
+class InstanceBatcher
+{
+public:
+	InstanceBatcher() = default;
+	InstanceBatcher(const InstanceBatcher& rhs) = delete;
+	InstanceBatcher& operator=(const InstanceBatcher& rhs) = delete;
+	~InstanceBatcher() = default;
+
+	///<summary>
+	/// Groups the visible render items that share geometry, submesh and topology
+	/// into batches and writes the object index of every instance into instanceObjects,
+	/// which must hold firstInstance + visibleItems.size() elements.  Returns the number
+	/// of instances written.
+	///</summary>
+	UINT Build(const std::vector<RenderItem*>& visibleItems,
+		const TransformStore& transforms,
+		UINT* instanceObjects,
+		UINT firstInstance = 0);
+
+	const std::vector<InstanceBatch>& Batches()const;
+
+	///<summary>
+	/// Records one DrawIndexedInstanced per batch.  The instance buffer must already be
+	/// bound; the batch start instance is passed through the root constant at
+	/// baseInstanceRootParam because SV_InstanceID does not include StartInstanceLocation.
+	///</summary>
+	void Draw(ID3D12GraphicsCommandList* cmdList, UINT baseInstanceRootParam)const;
+
+private:
+	static bool SameBatch(const RenderItem* a, const RenderItem* b);
+
+private:
+	std::vector<RenderItem*> sortedItems;
+	std::vector<InstanceBatch> batches;
+};
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+
+// Offset bookkeeping for a ring buffer shared by the frames in flight.  Allocations
+// are bumped linearly from the head and wrap to the start when they do not fit
+// before the end.  EndFrame tags everything allocated since the previous call with
+// the frame's fence value; Reclaim releases whole frames once the GPU has passed
+// their fence.  Knows nothing about the memory itself, so it can be exercised
+// without a device.
+class LinearRingAllocator
+{
+public:
+	static const std::uint64_t InvalidOffset = UINT64_MAX;
+
+	explicit LinearRingAllocator(std::uint64_t capacity = 0)
+		:capacity(capacity)
+	{
+	}
+
+	///<summary>
+	/// Returns the offset of size bytes aligned to alignment (a power of two), or
+	/// InvalidOffset if the ring has no room until more frames are reclaimed.
+	///</summary>
+	std::uint64_t Allocate(std::uint64_t size, std::uint64_t alignment)
+	{
+		if (size > capacity)
+			return InvalidOffset;
+
+		// Nothing in flight: start over at the front for the longest contiguous run.
+		if (used == 0)
+		{
+			head = 0;
+			tail = 0;
+		}
+		else if (head == tail)
+		{
+			return InvalidOffset;
+		}
+
+		std::uint64_t offset = AlignUp(head, alignment);
+		std::uint64_t padding = offset - head;
+
+		if (head >= tail)
+		{
+			// Free space is [head, capacity) followed by [0, tail).
+			if (offset + size > capacity)
+			{
+				if (size > tail)
+					return InvalidOffset;
+
+				// The end of the ring is skipped and freed together with this frame.
+				offset = 0;
+				padding = capacity - head;
+			}
+		}
+		else if (offset + size > tail)
+		{
+			// Free space is [head, tail).
+			return InvalidOffset;
+		}
+
+		head = offset + size;
+		used += padding + size;
+		frameBytes += padding + size;
+
+		return offset;
+	}
+
+	///<summary>
+	/// Closes the current frame.  Its allocations stay alive until Reclaim sees fenceValue.
+	///</summary>
+	void EndFrame(std::uint64_t fenceValue)
+	{
+		frames.push_back({ fenceValue, head, frameBytes });
+		frameBytes = 0;
+	}
+
+	void Reclaim(std::uint64_t completedFenceValue)
+	{
+		while (!frames.empty() && frames.front().FenceValue <= completedFenceValue)
+		{
+			// Empty frames recorded a head that a later restart may have invalidated.
+			if (frames.front().Bytes > 0)
+			{
+				tail = frames.front().End;
+			}
+			used -= frames.front().Bytes;
+			frames.pop_front();
+		}
+	}
+
+	std::uint64_t Capacity()const
+	{
+		return capacity;
+	}
+
+	///<summary>
+	/// Bytes held by frames in flight and the current frame, including alignment padding.
+	///</summary>
+	std::uint64_t UsedBytes()const
+	{
+		return used;
+	}
+
+	static std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+private:
+	struct FrameRecord
+	{
+		std::uint64_t FenceValue;
+		std::uint64_t End;
+		std::uint64_t Bytes;
+	};
+
+	std::uint64_t capacity = 0;
+	std::uint64_t head = 0;
+	std::uint64_t tail = 0;
+	std::uint64_t used = 0;
+	std::uint64_t frameBytes = 0;
+
+	std::deque<FrameRecord> frames;
+};
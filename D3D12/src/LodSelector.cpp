@@ -0,0 +1,85 @@
+#include "LodSelector.h"
+
+using namespace DirectX;
+
+void LodSelector::SetView(float fovY, float viewportHeight, float hysteresis)
+{
+	pixelsPerUnitAtUnitDistance = viewportHeight / (2.0f * tanf(0.5f * fovY));
+	this->hysteresis = hysteresis;
+}
+
+void LodSelector::Select(const std::vector<RenderItem*>& rItems, const TransformStore& transforms,
+	const XMFLOAT3& eyePosW)
+{
+	stats = LodStats();
+
+	XMVECTOR eye = XMLoadFloat3(&eyePosW);
+
+	for (RenderItem* ri : rItems)
+	{
+		if (ri->Lods == nullptr || ri->Lods->Levels.empty())
+			continue;
+
+		const LodSet& lods = *ri->Lods;
+		float screenHeight = ProjectedHeight(lods.Levels[0].Bounds, transforms.GetWorld(ri->Transform), eye);
+
+		// A larger threshold scale favours coarser levels.  Only refine when even the
+		// inflated thresholds allow it, and only coarsen when even the deflated ones demand it.
+		UINT refined = PickLevel(lods, screenHeight, 1.0f + hysteresis);
+		UINT coarsened = PickLevel(lods, screenHeight, 1.0f - hysteresis);
+
+		UINT level = MathHelper::Min(ri->CurrentLod, (UINT)lods.Levels.size() - 1);
+		if (refined < level)
+			level = refined;
+		else if (coarsened > level)
+			level = coarsened;
+
+		if (level != ri->CurrentLod)
+			stats.LevelChanges++;
+
+		const SubmeshGeometry& submesh = lods.Levels[level];
+		ri->CurrentLod = level;
+		ri->IndexCount = submesh.IndexCount;
+		ri->StartIndexLocation = submesh.StartIndexLocation;
+		ri->BaseVertexLocation = submesh.BaseVertexLocation;
+
+		stats.ItemCount++;
+		stats.TrianglesFull += lods.Levels[0].IndexCount / 3;
+		stats.TrianglesDrawn += submesh.IndexCount / 3;
+	}
+}
+
+const LodStats& LodSelector::Stats()const
+{
+	return stats;
+}
+
+float LodSelector::ProjectedHeight(const BoundingBox& bounds, const XMFLOAT4X4A& worldMatrix, FXMVECTOR eyePosW)const
+{
+	XMMATRIX world = XMLoadFloat4x4A(&worldMatrix);
+
+	// Bounding sphere of the box in world space, using the largest axis scale.
+	float maxScale = XMVectorGetX(XMVectorMax(XMVector3Length(world.r[0]),
+		XMVectorMax(XMVector3Length(world.r[1]), XMVector3Length(world.r[2]))));
+	float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Extents))) * maxScale;
+
+	XMVECTOR centerW = XMVector3TransformCoord(XMLoadFloat3(&bounds.Center), world);
+	float distance = XMVectorGetX(XMVector3Length(centerW - eyePosW));
+
+	// Inside the sphere the object covers the whole screen.
+	distance = MathHelper::Max(distance, radius);
+
+	return 2.0f * radius * pixelsPerUnitAtUnitDistance / MathHelper::Max(distance, 1e-4f);
+}
+
+UINT LodSelector::PickLevel(const LodSet& lods, float screenHeight, float thresholdScale)
+{
+	UINT level = 0;
+	UINT maxLevel = (UINT)lods.Levels.size() - 1;
+	while (level < maxLevel && level < (UINT)lods.ScreenHeights.size() &&
+		screenHeight < lods.ScreenHeights[level] * thresholdScale)
+	{
+		++level;
+	}
+	return level;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "Common/d3dUtil.h"
+#include "RenderItem.h"
+#include "TransformStore.h"
+
+// Submeshes of one shape at decreasing tessellation, all in the same MeshGeometry.
+struct LodSet
+{
+	// Levels[0] is the most detailed.
+	std::vector<SubmeshGeometry> Levels;
+
+	// Projected height in pixels below which level i + 1 replaces level i, so
+	// ScreenHeights has Levels.size() - 1 entries in decreasing order.
+	std::vector<float> ScreenHeights;
+};
+
+struct LodStats
+{
+	UINT ItemCount = 0;
+	UINT LevelChanges = 0;
+	UINT64 TrianglesFull = 0;
+	UINT64 TrianglesDrawn = 0;
+
+	UINT64 TrianglesSaved()const { return TrianglesFull - TrianglesDrawn; }
+};
+
+class LodSelector
+{
+public:
+	LodSelector() = default;
+	LodSelector(const LodSelector& rhs) = delete;
+	LodSelector& operator=(const LodSelector& rhs) = delete;
+	~LodSelector() = default;
+
+	///<summary>
+	/// fovY is the vertical field of view in radians (Camera::GetFovY) and viewportHeight
+	/// the height of the render target in pixels.  An item only switches level once its
+	/// projected size is hysteresis (a fraction) past the threshold, which stops popping
+	/// when the camera hovers around a boundary.
+	///</summary>
+	void SetView(float fovY, float viewportHeight, float hysteresis = 0.15f);
+
+	///<summary>
+	/// Picks a level for every item that references an LodSet and writes the chosen
+	/// submesh into the item's draw arguments.
+	///</summary>
+	void Select(const std::vector<RenderItem*>& rItems, const TransformStore& transforms,
+		const DirectX::XMFLOAT3& eyePosW);
+
+	const LodStats& Stats()const;
+
+	///<summary>
+	/// Height in pixels of the bounding sphere of bounds, placed by world and seen from eyePosW.
+	///</summary>
+	float ProjectedHeight(const DirectX::BoundingBox& bounds, const DirectX::XMFLOAT4X4A& world,
+		DirectX::FXMVECTOR eyePosW)const;
+
+private:
+	static UINT PickLevel(const LodSet& lods, float screenHeight, float thresholdScale);
+
+private:
+	// viewportHeight / (2 * tan(fovY / 2)): pixels covered by one world unit at unit distance.
+	float pixelsPerUnitAtUnitDistance = 1.0f;
+	float hysteresis = 0.15f;
+
+	LodStats stats;
+};
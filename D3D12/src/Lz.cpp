@@ -0,0 +1,179 @@
+#include "Lz.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const size_t MinMatch = 4;
+	const size_t MaxOffset = 65535;
+	// The last bytes are always literals, so the decoder ends on a literal run.
+	const size_t LastLiterals = 5;
+	const int HashBits = 16;
+	const std::uint32_t NoPosition = 0xffffffffu;
+
+	std::uint32_t Read32(const std::uint8_t* p)
+	{
+		std::uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	std::uint32_t Hash(std::uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	// Lengths of 15 or more continue in bytes of 255 until a smaller one.
+	void WriteLength(std::vector<std::uint8_t>& out, size_t length)
+	{
+		length -= 15;
+		while (length >= 255)
+		{
+			out.push_back(255);
+			length -= 255;
+		}
+		out.push_back((std::uint8_t)length);
+	}
+
+	bool ReadLength(const std::uint8_t*& in, const std::uint8_t* end, size_t& length)
+	{
+		std::uint8_t b;
+		do
+		{
+			if (in == end)
+				return false;
+
+			b = *in++;
+			length += b;
+		} while (b == 255);
+		return true;
+	}
+
+	void WriteSequence(std::vector<std::uint8_t>& out, const std::uint8_t* literals, size_t literalCount,
+		size_t offset, size_t matchLength)
+	{
+		const size_t matchCode = matchLength - MinMatch;
+		out.push_back((std::uint8_t)((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCode, 15)));
+		if (literalCount >= 15)
+		{
+			WriteLength(out, literalCount);
+		}
+		out.insert(out.end(), literals, literals + literalCount);
+
+		out.push_back((std::uint8_t)offset);
+		out.push_back((std::uint8_t)(offset >> 8));
+		if (matchCode >= 15)
+		{
+			WriteLength(out, matchCode);
+		}
+	}
+}
+
+void LzCompress(const void* data, size_t bytes, std::vector<std::uint8_t>& out)
+{
+	out.clear();
+	out.reserve(bytes + bytes / 255 + 16);
+
+	const std::uint8_t* in = static_cast<const std::uint8_t*>(data);
+	std::vector<std::uint32_t> table((size_t)1 << HashBits, NoPosition);
+
+	size_t anchor = 0;
+	size_t pos = 0;
+	const size_t matchEnd = bytes > LastLiterals ? bytes - LastLiterals : 0;
+	while (pos + MinMatch <= matchEnd)
+	{
+		const std::uint32_t sequence = Read32(in + pos);
+		std::uint32_t& slot = table[Hash(sequence)];
+		const size_t candidate = slot;
+		slot = (std::uint32_t)pos;
+
+		if (candidate == NoPosition || pos - candidate > MaxOffset || Read32(in + candidate) != sequence)
+		{
+			// Step further the longer nothing has matched.
+			pos += 1 + ((pos - anchor) >> 6);
+			continue;
+		}
+
+		size_t length = MinMatch;
+		while (pos + length < matchEnd && in[candidate + length] == in[pos + length])
+		{
+			++length;
+		}
+
+		WriteSequence(out, in + anchor, pos - anchor, pos - candidate, length);
+		pos += length;
+		anchor = pos;
+	}
+
+	// The final sequence is literals only.
+	const size_t literalCount = bytes - anchor;
+	if (literalCount > 0)
+	{
+		out.push_back((std::uint8_t)(std::min<size_t>(literalCount, 15) << 4));
+		if (literalCount >= 15)
+		{
+			WriteLength(out, literalCount);
+		}
+		out.insert(out.end(), in + anchor, in + bytes);
+	}
+}
+
+bool LzDecompress(const void* src, size_t srcBytes, void* dst, size_t dstBytes)
+{
+	const std::uint8_t* in = static_cast<const std::uint8_t*>(src);
+	const std::uint8_t* const inEnd = in + srcBytes;
+	std::uint8_t* const outStart = static_cast<std::uint8_t*>(dst);
+	std::uint8_t* out = outStart;
+	std::uint8_t* const outEnd = out + dstBytes;
+
+	while (in < inEnd)
+	{
+		const std::uint8_t token = *in++;
+
+		size_t literalCount = token >> 4;
+		if (literalCount == 15 && !ReadLength(in, inEnd, literalCount))
+			return false;
+		if (literalCount > (size_t)(inEnd - in) || literalCount > (size_t)(outEnd - out))
+			return false;
+
+		memcpy(out, in, literalCount);
+		in += literalCount;
+		out += literalCount;
+		if (in == inEnd)
+			break;
+
+		if (inEnd - in < 2)
+			return false;
+		const size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+		if (offset == 0 || offset > (size_t)(out - outStart))
+			return false;
+
+		size_t length = token & 15;
+		if (length == 15 && !ReadLength(in, inEnd, length))
+			return false;
+		length += MinMatch;
+		if (length > (size_t)(outEnd - out))
+			return false;
+
+		// Copies may overlap their source, which repeats the last offset bytes.  Far
+		// enough back, eight bytes at a time are safe.
+		const std::uint8_t* match = out - offset;
+		if (offset >= 8)
+		{
+			while (length >= 8)
+			{
+				memcpy(out, match, 8);
+				out += 8;
+				match += 8;
+				length -= 8;
+			}
+		}
+		while (length > 0)
+		{
+			*out++ = *match++;
+			--length;
+		}
+	}
+	return out == outEnd;
+}
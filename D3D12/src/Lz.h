@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+///<summary>
+/// Compresses bytes into out (replacing its contents) as a byte-oriented LZ77 stream
+/// in the style of LZ4: each sequence is a token with 4-bit literal and match
+/// lengths, the literals, a 16-bit back offset and length extension bytes.  Matches
+/// are found greedily through a hash table of 4-byte sequences, and runs without
+/// matches are skipped over faster the longer they get, so incompressible data such
+/// as block-compressed texels costs little time.
+///</summary>
+void LzCompress(const void* data, size_t bytes, std::vector<std::uint8_t>& out);
+
+///<summary>
+/// Decompresses an LzCompress stream into exactly dstBytes bytes at dst.  Every
+/// length and offset is checked against both buffers, so corrupt input returns false
+/// instead of reading or writing out of bounds.
+///</summary>
+bool LzDecompress(const void* src, size_t srcBytes, void* dst, size_t dstBytes);
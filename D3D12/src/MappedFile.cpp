@@ -0,0 +1,165 @@
+#include "MappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& rhs) noexcept
+{
+	*this = std::move(rhs);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs) noexcept
+{
+	if (this != &rhs)
+	{
+		Close();
+		data = std::exchange(rhs.data, nullptr);
+		size = std::exchange(rhs.size, 0);
+#ifdef _WIN32
+		file = std::exchange(rhs.file, nullptr);
+		mapping = std::exchange(rhs.mapping, nullptr);
+#endif
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::filesystem::path& path)
+{
+	Close();
+
+	HANDLE hFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+	file = hFile;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0 ||
+		(unsigned long long)fileSize.QuadPart > SIZE_MAX)
+	{
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	data = static_cast<const std::uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (data == nullptr)
+	{
+		Close();
+		return false;
+	}
+	size = (std::size_t)fileSize.QuadPart;
+
+	// Have the pages read in ahead of the copies instead of one fault at a time.
+	WIN32_MEMORY_RANGE_ENTRY range = { const_cast<std::uint8_t*>(data), size };
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data != nullptr)
+	{
+		UnmapViewOfFile(data);
+	}
+	if (mapping != nullptr)
+	{
+		CloseHandle(mapping);
+	}
+	if (file != nullptr)
+	{
+		CloseHandle(file);
+	}
+
+	data = nullptr;
+	size = 0;
+	mapping = nullptr;
+	file = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::filesystem::path& path)
+{
+	Close();
+
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st = {};
+	if (fstat(fd, &st) != 0 || st.st_size <= 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* view = mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// The mapping keeps the file referenced on its own.
+	close(fd);
+
+	if (view == MAP_FAILED)
+		return false;
+
+	data = static_cast<const std::uint8_t*>(view);
+	size = (std::size_t)st.st_size;
+
+	// Have the pages read in ahead of the copies instead of one fault at a time.
+	madvise(view, size, MADV_SEQUENTIAL);
+	madvise(view, size, MADV_WILLNEED);
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data != nullptr)
+	{
+		munmap(const_cast<std::uint8_t*>(data), size);
+	}
+
+	data = nullptr;
+	size = 0;
+}
+
+#endif
+
+bool MappedFile::IsOpen()const
+{
+	return data != nullptr;
+}
+
+const std::uint8_t* MappedFile::Data()const
+{
+	return data;
+}
+
+std::size_t MappedFile::Size()const
+{
+	return size;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// Read-only view of a whole file mapped into the address space.  Pages are read
+// in by the OS on first touch, so the contents can be parsed and copied to their
+// destination without an intermediate heap buffer.  Uses file mappings on Win32
+// and mmap elsewhere.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile& rhs) = delete;
+	MappedFile& operator=(const MappedFile& rhs) = delete;
+	MappedFile(MappedFile&& rhs) noexcept;
+	MappedFile& operator=(MappedFile&& rhs) noexcept;
+	~MappedFile();
+
+	///<summary>
+	/// Maps the file at path, unmapping the previous one.  Returns false if the file
+	/// cannot be opened or is empty.  The view is hinted for sequential reading.
+	///</summary>
+	bool Open(const std::filesystem::path& path);
+
+	void Close();
+
+	bool IsOpen()const;
+	const std::uint8_t* Data()const;
+	std::size_t Size()const;
+
+private:
+	const std::uint8_t* data = nullptr;
+	std::size_t size = 0;
+#ifdef _WIN32
+	// File and mapping HANDLEs, kept as void* to leave <windows.h> out of the header.
+	void* file = nullptr;
+	void* mapping = nullptr;
+#endif
+};
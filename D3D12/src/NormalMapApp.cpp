@@ -1,5 +1,8 @@
 #include "NormalMapApp.h"
 #include "Common/GeometryGenerator.h"
+#include "Common/SphericalHarmonics.h"
+#include "Common/TaskGraph.h"
+#include "AssetCooker.h"
 
 
 NormalMapApp::NormalMapApp(HINSTANCE hInstance)
@@ -9,6 +12,11 @@ NormalMapApp::NormalMapApp(HINSTANCE hInstance)
 
 NormalMapApp::~NormalMapApp()
 {
+    // The members are destroyed before D3DApp waits for the GPU.
+    if (pDevice != nullptr)
+    {
+        FlushCommandQueue();
+    }
 }
 
 bool NormalMapApp::Initialize()
@@ -26,23 +34,66 @@ bool NormalMapApp::Initialize()
 
     cbvSrvDescriptorSize = pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
-    LoadTextures();
-    BuildRootSignature();
-    BuildDescriptorHeaps();
-    BuildShadersAndInputLayout();
-    BuildShapeGeometry();
-    BuildMaterials();
-    BuildRenderItems();
-    BuildFrameResources();
-    BuildPSOs();
+    // Grows on demand; this covers the pass constants, instances and indirect arguments of a few frames,
+    // and stages the meshes uploaded below.
+    uploadRing = std::make_unique<UploadRing>(pDevice.Get(), 1024 * 1024, releaseQueue);
+    geometryPool = std::make_unique<GpuBufferPool>(pDevice.Get(), releaseQueue);
+    // Textures start with their mip tails and stream in more detail as the scene needs it.
+    textureStreamer = std::make_unique<TextureStreamer>(pDevice.Get(), releaseQueue, TextureDescriptorCount,
+        64 * 1024 * 1024);
+    textureCache = std::make_unique<TextureCache>(*textureStreamer);
+
+    // Loading runs as a graph: file I/O, parsing, mesh generation and shader and
+    // pipeline creation go to worker threads, and the steps that record on the
+    // command list run here in dependency order.  Startup then takes about as long as
+    // the longest chain of dependent steps rather than the sum of all of them.
+    PendingTextures pendingTextures;
+    std::unique_ptr<MeshGeometry> shapeGeo;
+    std::unique_ptr<MeshGeometry> carGeo;
+
+    TaskGraph init;
+    auto assetPackTask = init.Add("LoadAssetPack", [this] { LoadAssetPack(); });
+    auto packTexturesTask = init.Add("PackTextures", [&] { PackTextures(pendingTextures); }, { assetPackTask });
+    auto texturesTask = init.AddMainThread("UploadTextures", [&] { UploadTextures(pendingTextures); }, { packTexturesTask });
+    auto rootSignatureTask = init.Add("BuildRootSignature", [this] { BuildRootSignature(); });
+    init.Add("BuildCommandSignature", [this] { BuildCommandSignature(); }, { rootSignatureTask });
+    init.Add("BuildDescriptorHeaps", [this] { BuildDescriptorHeaps(); });
+    auto shadersTask = init.Add("BuildShadersAndInputLayout", [this] { BuildShadersAndInputLayout(); }, { assetPackTask });
+    auto shapesTask = init.Add("BuildShapeGeometry", [&] { shapeGeo = BuildShapeGeometry(); });
+    auto carTask = init.Add("BuildCarGeometry", [&] { carGeo = BuildCarGeometry(); }, { assetPackTask });
+    auto geometryTask = init.AddMainThread("AddGeometry", [&]
+    {
+        AddGeometry(std::move(shapeGeo));
+        AddGeometry(std::move(carGeo));
+    }, { shapesTask, carTask });
+    auto materialsTask = init.Add("BuildMaterials", [this] { BuildMaterials(); }, { texturesTask });
+    init.Add("BuildRenderItems", [this] { BuildRenderItems(); }, { geometryTask, materialsTask });
+    init.Add("BuildFrameResources", [this] { BuildFrameResources(); }, { materialsTask });
+    init.Add("BuildPSOs", [this] { BuildPSOs(); }, { rootSignatureTask, shadersTask });
+    init.Add("ProjectSkyIrradiance", [this] { ProjectSkyIrradiance(); }, { assetPackTask });
+    init.Run();
+
+#if defined(DEBUG) || defined(_DEBUG)
+    TaskGraphStats initStats = init.GetStats();
+    char initTimes[128];
+    snprintf(initTimes, sizeof(initTimes), "Initialization took %.1f ms for %.1f ms of work; longest chain %.1f ms\n",
+        initStats.WallMilliseconds, initStats.SerialMilliseconds, initStats.CriticalPathMilliseconds);
+    OutputDebugStringA(initTimes);
+#endif
+
+    geometryPool->FinishUploads(pCommandList.Get());
 
     // Execute the initialization commands.
     ThrowIfFailed(pCommandList->Close());
     ID3D12CommandList* cmdsLists[] = { pCommandList.Get() };
     pCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
-    // Wait until initialization is complete.
-    FlushCommandQueue();
+    // Frames are queued behind the initialization commands, so there is no need to
+    // wait for them; only the upload heaps they read have to outlive them.
+    ThrowIfFailed(pCommandQueue->Signal(pFence.Get(), ++currentFence));
+    uploadRing->EndFrame(currentFence);
+    geometryPool->EndFrame(currentFence);
+    releaseQueue.EndFrame(currentFence);
 
     return true;
 }
@@ -54,6 +105,8 @@ void NormalMapApp::OnResize()
 
     cam.SetLens(45.0f, GetAR(), 0.5f, 400.0f);
 
+    lodSelector.SetView(cam.GetFovY(), screenViewport.Height);
+
 }
 
 void NormalMapApp::Update(const GameTimer& gt)
@@ -72,9 +125,18 @@ void NormalMapApp::Update(const GameTimer& gt)
         CloseHandle(eventHanlde);
     }
 
+    // Everything the GPU has finished with can be handed out again.
+    UINT64 completedFence = pFence->GetCompletedValue();
+    uploadRing->Reclaim(completedFence);
+    geometryPool->Reclaim(completedFence);
+    releaseQueue.Reclaim(completedFence);
+
     AnimateMaterials(gt);
-    UpdateObjectCBs(gt);
-    UpdateMaterialBuffer(gt);
+    AnimateScene(gt);
+    UpdateLods(gt);
+    UpdateTextureStreaming(gt);
+    UpdateObjectBuffer(gt);
+    UpdateInstanceBuffer(gt);
     UpdateMainPassCB(gt);
 }
 
@@ -88,26 +150,54 @@ void NormalMapApp::Draw(const GameTimer& gt)
 
     // A command list can be reset after it has been added to the command queue via ExecuteCommandList.
     // Reusing the command list reuses memory.
-    ThrowIfFailed(pCommandList->Reset(cmdListAlloc.Get(), PSOs["opaque"].Get()));
+    ThrowIfFailed(pCommandList->Reset(cmdListAlloc.Get(), PSOs[opaquePso].Get()));
 
     ID3D12DescriptorHeap* descriptorHeaps[] = { pSrvDescriptorHeap.Get() };
     pCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
     pCommandList->SetGraphicsRootSignature(pRootSignature.Get());
 
+    UploadStaticObjectBuffer(pCommandList.Get());
+
+    // Compact the mesh pages once freed meshes have scattered their free space.
+    if (geometryPool->Defragment(pCommandList.Get()) > 0)
+    {
+        UpdateGeometryLocations();
+    }
+    geometryPool->FinishUploads(pCommandList.Get());
+
+    // Record the finished texture uploads and evictions, then give this frame its own
+    // copy of the texture descriptors: earlier frames may still read theirs.
+    textureStreamer->Update(pCommandList.Get());
+
+    CD3DX12_CPU_DESCRIPTOR_HANDLE frameTexturesCPU(pSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
+        currFrameResourceIndex * TextureDescriptorCount, cbvSrvUavDescriptorSize);
+    pDevice->CopyDescriptorsSimple(TextureDescriptorCount, frameTexturesCPU, textureStreamer->Descriptors(),
+        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    CD3DX12_GPU_DESCRIPTOR_HANDLE frameTextures(pSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart(),
+        currFrameResourceIndex * TextureDescriptorCount, cbvSrvUavDescriptorSize);
+
     // Bind all the materials used in this scene.  For structured buffers, we can bypass the heap and 
     // set as a root descriptor.
     auto matBuffer = currFrameResource->MaterialBuffer->Resource();
     pCommandList->SetGraphicsRootShaderResourceView(2, matBuffer->GetGPUVirtualAddress());
 
-    CD3DX12_GPU_DESCRIPTOR_HANDLE skyTexDescriptor(pSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-    skyTexDescriptor.Offset(6, cbvSrvUavDescriptorSize);
+    CD3DX12_GPU_DESCRIPTOR_HANDLE skyTexDescriptor = frameTextures;
+    skyTexDescriptor.Offset(skyTextureSlot, cbvSrvUavDescriptorSize);
     pCommandList->SetGraphicsRootDescriptorTable(4, skyTexDescriptor);
 
-    pCommandList->SetGraphicsRootDescriptorTable(3, pSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+    pCommandList->SetGraphicsRootDescriptorTable(3, frameTextures);
+
+    pCommandList->SetGraphicsRootConstantBufferView(1, currFrameResource->PassCB.GPU);
+
+    pCommandList->SetGraphicsRootShaderResourceView(5, currFrameResource->InstanceBuffer.GPU);
 
-    auto passCB = currFrameResource->PassCB->Resource();
-    pCommandList->SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
+    // Object data for the instance object indices and the per-draw object index.
+    if (pStaticObjectBuffer != nullptr)
+    {
+        pCommandList->SetGraphicsRootShaderResourceView(7, pStaticObjectBuffer->GetGPUVirtualAddress());
+    }
+    pCommandList->SetGraphicsRootShaderResourceView(8, currFrameResource->ObjectBuffer.GPU);
 
     pCommandList->RSSetViewports(1, &screenViewport);
     pCommandList->RSSetScissorRects(1, &scissorRect);
@@ -123,9 +213,16 @@ void NormalMapApp::Draw(const GameTimer& gt)
     // Specify the buffers we are going to render to.
     pCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
 
-    DrawRenderItems(pCommandList.Get(), rItemLayer[(int)RenderLayer::Opaque]);
+    if (indirectDraw)
+    {
+        DrawBatchesIndirect(pCommandList.Get(), opaqueBatcher.Batches(), opaquePacker);
+    }
+    else
+    {
+        opaqueBatcher.Draw(pCommandList.Get(), 6);
+    }
 
-    pCommandList->SetPipelineState(PSOs["sky"].Get());
+    pCommandList->SetPipelineState(PSOs[skyPso].Get());
     DrawRenderItems(pCommandList.Get(), rItemLayer[(int)RenderLayer::Sky]);
 
     pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
@@ -140,6 +237,9 @@ void NormalMapApp::Draw(const GameTimer& gt)
     currBackBuffer = (currBackBuffer + 1) % SwapChainBufferCount;
 
     currFrameResource->fenceVal = ++currentFence;
+    uploadRing->EndFrame(currentFence);
+    geometryPool->EndFrame(currentFence);
+    releaseQueue.EndFrame(currentFence);
 
     pCommandQueue->Signal(pFence.Get(), currentFence);
 }
@@ -190,6 +290,9 @@ void NormalMapApp::OnKeyboardInput(const GameTimer& gt)
     if (GetAsyncKeyState('D') & 0x8000)
         cam.Strafe(10.0f * dt);
 
+    // Hold 1 to compare against one draw call per batch.
+    indirectDraw = (GetAsyncKeyState('1') & 0x8000) == 0;
+
     cam.UpdateViewMatrix();
 }
 
@@ -198,60 +301,161 @@ void NormalMapApp::AnimateMaterials(const GameTimer& gt)
 
 }
 
-void NormalMapApp::UpdateObjectCBs(const GameTimer& gf)
+void NormalMapApp::AnimateScene(const GameTimer& gt)
 {
-    auto currObjectCB = currFrameResource->ObjectCB.get();
-    for (auto& e : allRItems)
+    using namespace DirectX;
+    const float t = gt.TotalTime();
+
+    // The car drives a circle around the columns.  Only the root and the wheels
+    // change; the body just follows its parent.
+    const float carRadius = 13.0f;
+    const float carSpeed = 0.25f;
+    const float carScale = 0.3f;
+    const float heading = carSpeed * t;
+    sceneGraph.SetLocal(carNode, XMMatrixScaling(carScale, carScale, carScale) *
+        XMMatrixRotationY(heading + XM_PIDIV2) *
+        XMMatrixTranslation(carRadius * sinf(heading), 0.72f, carRadius * cosf(heading)));
+
+    // Roll without slipping: distance travelled over wheel radius in world units.
+    const float wheelRadius = 0.6f;
+    const float spin = carRadius * heading / (wheelRadius * carScale);
+    for (size_t i = 0; i < wheelNodes.size(); ++i)
     {
-        // Only update the cbuffer data if the constants have changed.  
-        // This needs to be tracked per frame resource.
-        if (e->NumFramesDirty > 0)
-        {
-            DirectX::XMMATRIX world = XMLoadFloat4x4(&e->World);
-            DirectX::XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
+        float x = (i % 2 == 0) ? -2.3f : +2.3f;
+        float z = (i < 2) ? -3.8f : +3.6f;
+        sceneGraph.SetLocal(wheelNodes[i], XMMatrixScaling(2.0f * wheelRadius, 0.2f, 2.0f * wheelRadius) *
+            XMMatrixRotationZ(XM_PIDIV2) * XMMatrixRotationX(spin) * XMMatrixTranslation(x, -1.8f, z));
+    }
 
-            ObjectConstants objConstants;
-            XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-            XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
-            objConstants.MaterialIndex = e->Mat->MatCBIndex;
+    // Reflectors orbit the globe and each one carries a moon.
+    sceneGraph.SetLocal(reflectorOrbitNode, XMMatrixRotationY(0.5f * t) * XMMatrixTranslation(0.0f, 2.0f, 0.0f));
+    for (size_t i = 0; i < moonOrbitNodes.size(); ++i)
+    {
+        sceneGraph.SetLocal(moonOrbitNodes[i], XMMatrixRotationY(2.0f * t + (float)i));
+    }
 
-            currObjectCB->CopyData(e->ObjCBIndex, objConstants);
+    sceneGraph.Update(transforms);
+}
 
-            // Next FrameResource need to be updated too.
-            e->NumFramesDirty--;
+void NormalMapApp::UpdateObjectBuffer(const GameTimer& gt)
+{
+    // Dynamic objects move every frame, so all of them are streamed into this frame's
+    // range.  Static objects are not touched here; see UploadStaticObjectBuffer.
+    currFrameResource->ObjectBuffer = uploadRing->Allocate((UINT64)transforms.DynamicCount() * sizeof(ObjectData));
+    transforms.WriteDynamic(reinterpret_cast<ObjectData*>(currFrameResource->ObjectBuffer.CPU));
+}
+
+void NormalMapApp::UploadStaticObjectBuffer(ID3D12GraphicsCommandList* cmdList)
+{
+    if (!transforms.StaticDirty() || transforms.StaticCount() == 0)
+        return;
+
+    UINT64 byteSize = (UINT64)transforms.StaticCount() * sizeof(ObjectData);
+
+    if (transforms.StaticCount() > staticObjectCapacity)
+    {
+        // Frames in flight may still read the old buffer.
+        if (pStaticObjectBuffer != nullptr)
+        {
+            releaseQueue.Release(pStaticObjectBuffer);
         }
+
+        staticObjectCapacity = MathHelper::Max(transforms.StaticCount(), 2 * staticObjectCapacity);
+        ThrowIfFailed(pDevice->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer((UINT64)staticObjectCapacity * sizeof(ObjectData)),
+            D3D12_RESOURCE_STATE_COMMON,
+            nullptr,
+            IID_PPV_ARGS(pStaticObjectBuffer.ReleaseAndGetAddressOf())));
+        staticObjectBufferState = D3D12_RESOURCE_STATE_COMMON;
     }
+
+    UploadAllocation staging = uploadRing->Allocate(byteSize);
+    transforms.WriteStatic(reinterpret_cast<ObjectData*>(staging.CPU));
+
+    cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(pStaticObjectBuffer.Get(),
+        staticObjectBufferState, D3D12_RESOURCE_STATE_COPY_DEST));
+    cmdList->CopyBufferRegion(pStaticObjectBuffer.Get(), 0, staging.Resource, staging.Offset, byteSize);
+    cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(pStaticObjectBuffer.Get(),
+        D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+    staticObjectBufferState = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
 }
 
-void NormalMapApp::UpdateMaterialBuffer(const GameTimer& gt)
+namespace
 {
-    using namespace DirectX;
-    auto currMaterialBuffer = currFrameResource->MaterialBuffer.get();
-    for (auto& e : materials)
+    MaterialData MakeMaterialData(const Material& mat)
     {
-        // Only update the cbuffer data if the constants have changed.  If the cbuffer
-        // data changes, it needs to be updated for each FrameResource.
-        Material* mat = e.second.get();
-        if (mat->NumFramesDirty > 0)
-        {
-            XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
+        using namespace DirectX;
+        XMMATRIX matTransform = XMLoadFloat4x4(&mat.MatTransform);
+
+        MaterialData matData;
+        matData.DiffuseAlbedo = mat.DiffuseAlbedo;
+        matData.FresnelR0 = mat.FresnelR0;
+        matData.Roughness = mat.Roughness;
+        XMStoreFloat4x4(&matData.MatTransform, XMMatrixTranspose(matTransform));
+        matData.DiffuseMapIndex = mat.DiffuseSrvHeapIndex;
+        matData.NormalMapIndex = mat.NormalSrvHeapIndex;
+        matData.DiffuseMapSlice = mat.DiffuseArraySlice;
+        matData.NormalMapSlice = mat.NormalArraySlice;
+        return matData;
+    }
+}
+
+void NormalMapApp::UpdateLods(const GameTimer& gt)
+{
+    lodSelector.Select(rItemLayer[(int)RenderLayer::Opaque], transforms, cam.GetPosition3f());
+
+    // Report the triangle savings next to the fps counter.
+    const LodStats& stats = lodSelector.Stats();
+    if (stats.TrianglesDrawn != lastLodTriangles)
+    {
+        lastLodTriangles = stats.TrianglesDrawn;
+        mainWndCaption = L"d3d12 App    tris: " + std::to_wstring(stats.TrianglesDrawn) +
+            L"   lod saved: " + std::to_wstring(stats.TrianglesSaved());
+    }
+}
+
+void NormalMapApp::UpdateTextureStreaming(const GameTimer& gt)
+{
+    DirectX::XMVECTOR eye = cam.GetPosition();
 
-            MaterialData matData;
-            matData.DiffuseAlbedo = mat->DiffuseAlbedo;
-            matData.FresnelR0 = mat->FresnelR0;
-            matData.Roughness = mat->Roughness;
-            XMStoreFloat4x4(&matData.MatTransform, XMMatrixTranspose(matTransform));
-            matData.DiffuseMapIndex = mat->DiffuseSrvHeapIndex;
-            matData.NormalMapIndex = mat->NormalSrvHeapIndex;
+    // Each item asks for its textures at the size it covers on screen, divided by how
+    // often its texture transform repeats them.
+    for (int layer : { (int)RenderLayer::Opaque, (int)RenderLayer::Sky })
+    {
+        for (const RenderItem* ri : rItemLayer[layer])
+        {
+            float height = lodSelector.ProjectedHeight(ri->Bounds, transforms.GetWorld(ri->Transform), eye);
 
-            currMaterialBuffer->CopyData(mat->MatCBIndex, matData);
+            const DirectX::XMFLOAT4X4A& texTransform = transforms.GetTexTransform(ri->Transform);
+            float repeat = MathHelper::Max(fabsf(texTransform._11), MathHelper::Max(fabsf(texTransform._22), 1e-3f));
 
-            // Next FrameResource need to be updated too.
-            mat->NumFramesDirty--;
+            const Material& mat = materials[ri->Mat];
+            textureStreamer->Request((UINT)mat.DiffuseSrvHeapIndex, height / repeat);
+            textureStreamer->Request((UINT)mat.NormalSrvHeapIndex, height / repeat);
         }
     }
 }
 
+void NormalMapApp::UpdateInstanceBuffer(const GameTimer& gt)
+{
+    const auto& opaqueItems = rItemLayer[(int)RenderLayer::Opaque];
+
+    // Instances are regrouped every frame so that visibility or submesh changes
+    // never leave a stale batch behind.  Each visible item is one instance, stored as
+    // the index of its object data.
+    currFrameResource->InstanceBuffer = uploadRing->Allocate(opaqueItems.size() * sizeof(UINT));
+    opaqueBatcher.Build(opaqueItems, transforms, reinterpret_cast<UINT*>(currFrameResource->InstanceBuffer.CPU));
+
+    // Pack the batches into this frame's indirect argument buffer.
+    opaquePacker.Pack(opaqueBatcher.Batches());
+
+    const auto& commands = opaquePacker.Commands();
+    currFrameResource->IndirectArgs = uploadRing->Allocate(commands.size() * sizeof(IndirectDrawCommand));
+    StreamingCopy(currFrameResource->IndirectArgs.CPU, commands.data(), commands.size() * sizeof(IndirectDrawCommand));
+}
+
 void NormalMapApp::UpdateMainPassCB(const GameTimer& gt)
 {
     DirectX::XMMATRIX view = cam.GetView();
@@ -275,7 +479,8 @@ void NormalMapApp::UpdateMainPassCB(const GameTimer& gt)
     mainPassCB.FarZ = 1000.0f;
     mainPassCB.TotalTime = gt.TotalTime();
     mainPassCB.DeltaTime = gt.DeltaTime();
-    mainPassCB.AmbientLight = { 0.05f, 0.05f, 0.10f, 1.0f };
+    // Scales the sky's light in AmbientSh.
+    mainPassCB.AmbientLight = { 0.25f, 0.25f, 0.25f, 1.0f };
     mainPassCB.Lights[0].Direction = { 0.57735f, -0.57735f, 0.57735f };
     mainPassCB.Lights[0].Strength = { 0.6f, 0.6f, 0.6f };
     mainPassCB.Lights[1].Direction = { -0.57735f, -0.57735f, 0.57735f };
@@ -283,44 +488,208 @@ void NormalMapApp::UpdateMainPassCB(const GameTimer& gt)
     mainPassCB.Lights[2].Direction = { 0.0f, -0.707f, -0.707f };
     mainPassCB.Lights[2].Strength = { 0.15f, 0.15f, 0.15f };
 
-    auto currPassCB = currFrameResource->PassCB.get();
-    currPassCB->CopyData(0, mainPassCB);
+    currFrameResource->PassCB = uploadRing->AllocateConstants(mainPassCB);
 }
 
-void NormalMapApp::LoadTextures()
+void NormalMapApp::LoadAssetPack()
 {
-    std::vector<std::string> texNames =
+    // DDS files go in as they are, so textures stream straight from the mapped pack;
+    // block-compressed texels would hardly shrink anyway.  Shader bytecode and meshes
+    // compress well.
+    const std::vector<AssetSource> sources =
+    {
+        { "Textures/bricks2.dds", L"Textures/bricks2.dds", AssetType::Texture, false },
+        { "Textures/bricks2_nmap.dds", L"Textures/bricks2_nmap.dds", AssetType::Texture, false },
+        { "Textures/tile.dds", L"Textures/tile.dds", AssetType::Texture, false },
+        { "Textures/tile_nmap.dds", L"Textures/tile_nmap.dds", AssetType::Texture, false },
+        { "Textures/white1x1.dds", L"Textures/white1x1.dds", AssetType::Texture, false },
+        { "Textures/default_nmap.dds", L"Textures/default_nmap.dds", AssetType::Texture, false },
+        { "Textures/snowcube1024.dds", L"Textures/snowcube1024.dds", AssetType::Texture, false },
+        { "Shaders/DefaultVS.cso", L"Shaders/ShaderBins/DefaultVS.cso", AssetType::Shader, true },
+        { "Shaders/DefaultPS.cso", L"Shaders/ShaderBins/DefaultPS.cso", AssetType::Shader, true },
+        { "Models/car", L"Models/car.txt", AssetType::Mesh, true },
+    };
+
+    // Cooked on the first run and again whenever a source, this list or the cooker
+    // changes; that launch pays for reading every source and writing the pack.  If
+    // cooking fails, an older pack is still better than none.
+    const wchar_t* packFile = L"Assets.pak";
+    if (IsAssetPackStale(packFile, sources) && !CookAssetPack(packFile, sources))
+    {
+        OutputDebugStringA("Cooking Assets.pak failed; using the existing pack.\n");
+    }
+
+    assets = std::make_shared<AssetPack>();
+    ThrowIfFailed(assets->Open(packFile) ? S_OK : HRESULT_FROM_WIN32(ERROR_OPEN_FAILED));
+}
+
+const AssetEntry& NormalMapApp::FindAsset(const std::string& name)const
+{
+    const AssetEntry* entry = assets->Find(name);
+    ThrowIfFailed(entry != nullptr ? S_OK : HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+    return *entry;
+}
+
+const std::uint8_t* NormalMapApp::AssetData(const AssetEntry& entry, std::vector<std::uint8_t>& buffer)const
+{
+    if (const std::uint8_t* data = assets->Data(entry))
+    {
+        return data;
+    }
+
+    ThrowIfFailed(assets->Read(entry, buffer) ? S_OK : HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+    return buffer.data();
+}
+
+namespace
+{
+    // Texture names for the materials and the pack entries they come from.
+    const char* const TextureNames[] =
     {
         "bricksDiffuseMap",
         "bricksNormalMap",
         "tileDiffuseMap",
         "tileNormalMap",
         "defaultDiffuseMap",
-        "defaultNormalMap",
-        "skyCubeMap"
+        "defaultNormalMap"
     };
 
-    std::vector<std::wstring> texFilenames =
+    const char* const TextureAssets[] =
     {
-        L"Textures/bricks2.dds",
-        L"Textures/bricks2_nmap.dds",
-        L"Textures/tile.dds",
-        L"Textures/tile_nmap.dds",
-        L"Textures/white1x1.dds",
-        L"Textures/default_nmap.dds",
-        L"Textures/snowcube1024.dds"
+        "Textures/bricks2.dds",
+        "Textures/bricks2_nmap.dds",
+        "Textures/tile.dds",
+        "Textures/tile_nmap.dds",
+        "Textures/white1x1.dds",
+        "Textures/default_nmap.dds"
     };
+}
 
-    for (int i = 0; i < (int)texNames.size(); ++i)
+void NormalMapApp::PackTextures(PendingTextures& pending)
+{
+    // Textures of one format, size and mip count are packed into a texture array that
+    // takes a single slot, and the materials pick their slice.
+    const size_t count = std::size(TextureAssets);
+    pending.Entries.resize(count);
+    std::vector<std::vector<std::uint8_t>> buffers(count);
+    std::vector<DdsImage> images(count);
+    std::vector<const DdsImage*> packed;
+    for (size_t i = 0; i < count; ++i)
     {
-        auto texMap = std::make_unique<Texture>();
-        texMap->Name = texNames[i];
-        texMap->Filename = texFilenames[i];
-        ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(pDevice.Get(),
-            pCommandList.Get(), texMap->Filename.c_str(),
-            texMap->Resource, texMap->UploadHeap));
+        pending.Entries[i] = &FindAsset(TextureAssets[i]);
+        const std::uint8_t* data = AssetData(*pending.Entries[i], buffers[i]);
+        ThrowIfFailed(images[i].Parse(data, (size_t)pending.Entries[i]->Size) == DdsResult::Ok ?
+            S_OK : HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+        packed.push_back(&images[i]);
+    }
+
+    ThrowIfFailed(pending.Packer.Pack(packed) == PackResult::Ok ? S_OK : HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+}
 
-        textures[texMap->Name] = std::move(texMap);
+void NormalMapApp::ProjectSkyIrradiance()
+{
+    // Diffuse light only has low frequencies, so a small mip of the sky is enough and
+    // nine coefficients stand in for it in the shader.
+    // The sky may be any 8-bit or float format, or BC1 to BC5 and BC7 in any mode;
+    // ProjectCubeMap cannot decode BC6H, so an HDR sky in it keeps the flat ambient.
+    const AssetEntry& entry = FindAsset("Textures/snowcube1024.dds");
+    std::vector<std::uint8_t> buffer;
+    const std::uint8_t* data = AssetData(entry, buffer);
+
+    DdsImage sky;
+    ShRgb radiance;
+    if (sky.Parse(data, (size_t)entry.Size) != DdsResult::Ok || ProjectCubeMap(sky, radiance) != ShResult::Ok)
+    {
+        // The flat bluish ambient the scene had before, once scaled by AmbientLight.
+        OutputDebugStringA("Cannot project the sky onto spherical harmonics; using a flat ambient.\n");
+        mainPassCB.AmbientSh[0] = { 0.2f, 0.2f, 0.4f, 0.0f };
+        return;
+    }
+
+    float constants[ShRgb::MaxCoefficients][4];
+    ShShaderConstants(ShDiffuse(radiance), constants);
+    for (UINT k = 0; k < ShRgb::MaxCoefficients; ++k)
+    {
+        mainPassCB.AmbientSh[k] = { constants[k][0], constants[k][1], constants[k][2], constants[k][3] };
+    }
+}
+
+void NormalMapApp::UploadTextures(PendingTextures& pending)
+{
+    // Only the mip tails are loaded here, all with one staging buffer; the streamer
+    // brings in the larger mips once they are drawn.  A texture alone in its array is
+    // streamed straight from the pack, whose hash of it lets textures with the same
+    // contents share a slot without reading them.
+    UploadBatch batch;
+    auto acquire = [this, &batch](const AssetEntry& entry)
+    {
+        if (const std::uint8_t* data = assets->Data(entry))
+        {
+            return textureCache->Acquire(data, (size_t)entry.Size, entry.Hash, assets, batch);
+        }
+
+        std::vector<std::uint8_t> buffer;
+        AssetData(entry, buffer);
+        return textureCache->Acquire(std::move(buffer), batch);
+    };
+
+    TextureArrayPacker& packer = pending.Packer;
+    std::vector<UINT> arraySlots(packer.ArrayCount());
+    for (UINT a = 0; a < packer.ArrayCount(); ++a)
+    {
+        const TextureArray& array = packer.Array(a);
+        arraySlots[a] = array.Members.size() == 1 ?
+            acquire(*pending.Entries[array.Members[0]]) :
+            textureCache->Acquire(packer.TakeFile(a), batch);
+    }
+    for (UINT i = 0; i < (UINT)std::size(TextureNames); ++i)
+    {
+        ArraySlice location = packer.Location(i);
+        textureSlots[TextureNames[i]] = { arraySlots[location.Array], location.Slice };
+    }
+
+    skyTextureSlot = acquire(FindAsset("Textures/snowcube1024.dds"));
+    textureSlots["skyCubeMap"] = { skyTextureSlot, 0 };
+
+    batch.Submit(pDevice.Get(), pCommandList.Get(), releaseQueue);
+}
+
+void NormalMapApp::AddGeometry(std::unique_ptr<MeshGeometry> geo)
+{
+    const void* vertices = geo->VertexBufferCPU->GetBufferPointer();
+    const void* indices = geo->IndexBufferCPU->GetBufferPointer();
+    const UINT vbByteSize = geo->VertexBufferByteSize;
+    const UINT ibByteSize = geo->IndexBufferByteSize;
+
+    // The blobs move along with the geometry, so the pointers stay valid.
+    GeometryHandle handle = geometries.Insert(geo->Name, std::move(*geo));
+    UploadGeometry(handle, vertices, vbByteSize, indices, ibByteSize);
+}
+
+void NormalMapApp::UploadGeometry(GeometryHandle geometry, const void* vertices, UINT vbByteSize,
+    const void* indices, UINT ibByteSize)
+{
+    GeometryAllocations allocs;
+    allocs.Geometry = geometry;
+    allocs.Vertices = geometryPool->Upload(pCommandList.Get(), *uploadRing, vertices, vbByteSize);
+    allocs.Indices = geometryPool->Upload(pCommandList.Get(), *uploadRing, indices, ibByteSize);
+    geometryAllocations.push_back(allocs);
+
+    UpdateGeometryLocations();
+}
+
+void NormalMapApp::UpdateGeometryLocations()
+{
+    for (const GeometryAllocations& allocs : geometryAllocations)
+    {
+        MeshGeometry* geo = &geometries[allocs.Geometry];
+
+        GpuBufferRange vb = geometryPool->Get(allocs.Vertices);
+        GpuBufferRange ib = geometryPool->Get(allocs.Indices);
+        geo->VertexBufferGPU = vb.Resource;
+        geo->VertexBufferOffset = vb.Offset;
+        geo->IndexBufferGPU = ib.Resource;
+        geo->IndexBufferOffset = ib.Offset;
     }
 }
 
@@ -331,12 +700,16 @@ void NormalMapApp::BuildRootSignature()
     CD3DX12_DESCRIPTOR_RANGE cubeMapTable{};
     cubeMapTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0U, 0U);
 
-    CD3DX12_ROOT_PARAMETER rootParams[5]{};
-    rootParams[0].InitAsConstantBufferView(0U);
+    CD3DX12_ROOT_PARAMETER rootParams[9]{};
+    rootParams[0].InitAsConstants(1, 0U, 0U, D3D12_SHADER_VISIBILITY_VERTEX);
     rootParams[1].InitAsConstantBufferView(1U);
     rootParams[2].InitAsShaderResourceView(0u, 1u);
     rootParams[3].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
     rootParams[4].InitAsDescriptorTable(1, &cubeMapTable, D3D12_SHADER_VISIBILITY_PIXEL);
+    rootParams[5].InitAsShaderResourceView(1u, 1u, D3D12_SHADER_VISIBILITY_VERTEX);
+    rootParams[6].InitAsConstants(1, 2U, 0U, D3D12_SHADER_VISIBILITY_VERTEX);
+    rootParams[7].InitAsShaderResourceView(2u, 1u, D3D12_SHADER_VISIBILITY_VERTEX);
+    rootParams[8].InitAsShaderResourceView(3u, 1u, D3D12_SHADER_VISIBILITY_VERTEX);
 
     auto samplers = GetStaticSamplers();
 
@@ -358,58 +731,55 @@ void NormalMapApp::BuildRootSignature()
         rootSigBlob->GetBufferSize(), IID_PPV_ARGS(&pRootSignature)));
 }
 
+void NormalMapApp::BuildCommandSignature()
+{
+    // Each command sets the batch base instance root constant and then draws.
+    D3D12_INDIRECT_ARGUMENT_DESC argDescs[2]{};
+    argDescs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+    argDescs[0].Constant.RootParameterIndex = 6;
+    argDescs[0].Constant.DestOffsetIn32BitValues = 0;
+    argDescs[0].Constant.Num32BitValuesToSet = 1;
+    argDescs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+    static_assert(sizeof(D3D12_DRAW_INDEXED_ARGUMENTS) == IndirectDrawArgumentsSize,
+        "IndirectDrawCommand no longer matches the command signature");
+    D3D12_COMMAND_SIGNATURE_DESC commandSigDesc{};
+    commandSigDesc.ByteStride = IndirectDrawCommandStride;
+    commandSigDesc.NumArgumentDescs = (UINT)std::size(argDescs);
+    commandSigDesc.pArgumentDescs = argDescs;
+    commandSigDesc.NodeMask = 0;
+
+    // The root signature is required because the signature changes root arguments.
+    ThrowIfFailed(pDevice->CreateCommandSignature(&commandSigDesc, pRootSignature.Get(),
+        IID_PPV_ARGS(&pCommandSignature)));
+}
+
 void NormalMapApp::BuildDescriptorHeaps()
 {
+    // The SRVs are copied in from the texture streamer each frame.
     D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc{};
-    srvHeapDesc.NumDescriptors = 10;
+    srvHeapDesc.NumDescriptors = TextureDescriptorCount * gNumFrameResources;
     srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
     srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
     srvHeapDesc.NodeMask = 0;
     ThrowIfFailed(pDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&pSrvDescriptorHeap)));
-
-    CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(pSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
-    std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> tex2DList =
-    {
-        textures["bricksDiffuseMap"]->Resource,
-        textures["bricksNormalMap"]->Resource,
-        textures["tileDiffuseMap"]->Resource,
-        textures["tileNormalMap"]->Resource,
-        textures["defaultDiffuseMap"]->Resource,
-        textures["defaultNormalMap"]->Resource
-    };
-
-    auto skyCubeMap = textures["skyCubeMap"]->Resource;
-
-    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-    srvDesc.Texture2D.MostDetailedMip = 0;
-    srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-
-    for (UINT i = 0; i < (UINT)tex2DList.size(); ++i)
-    {
-        srvDesc.Format = tex2DList[i]->GetDesc().Format;
-        srvDesc.Texture2D.MipLevels = tex2DList[i]->GetDesc().MipLevels;
-        pDevice->CreateShaderResourceView(tex2DList[i].Get(), &srvDesc, hDescriptor);
-
-        // next descriptor
-        hDescriptor.Offset(1, cbvSrvDescriptorSize);
-    }
-
-    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-    srvDesc.TextureCube.MostDetailedMip = 0;
-    srvDesc.TextureCube.MipLevels = skyCubeMap->GetDesc().MipLevels;
-    srvDesc.TextureCube.ResourceMinLODClamp = 0.0f;
-    srvDesc.Format = skyCubeMap->GetDesc().Format;
-    pDevice->CreateShaderResourceView(skyCubeMap.Get(), &srvDesc, hDescriptor);
-
 }
 
 void NormalMapApp::BuildShadersAndInputLayout()
 {
-    ThrowIfFailed(D3DReadFileToBlob(L"Shaders\\ShaderBins\\DefaultVS.cso", shaders["standardVS"].GetAddressOf()));
-    ThrowIfFailed(D3DReadFileToBlob(L"Shaders\\ShaderBins\\DefaultPS.cso", shaders["opaquePS"].GetAddressOf()));
+    auto loadShader = [this](const std::string& name)
+    {
+        const AssetEntry& entry = FindAsset(name);
+        std::vector<std::uint8_t> buffer;
+        const std::uint8_t* data = AssetData(entry, buffer);
+
+        Microsoft::WRL::ComPtr<ID3DBlob> blob;
+        ThrowIfFailed(D3DCreateBlob((SIZE_T)entry.Size, &blob));
+        CopyMemory(blob->GetBufferPointer(), data, (SIZE_T)entry.Size);
+        return blob;
+    };
+    shaders["standardVS"] = loadShader("Shaders/DefaultVS.cso");
+    shaders["opaquePS"] = loadShader("Shaders/DefaultPS.cso");
 
     shaders["skyVS"] = d3dUtil::CompileShader(L"Shaders\\ShaderFiles\\Sky.hlsl", nullptr, "VS", "vs_5_1");
     shaders["skyPS"] = d3dUtil::CompileShader(L"Shaders\\ShaderFiles\\Sky.hlsl", nullptr, "PS", "ps_5_1");
@@ -423,134 +793,132 @@ void NormalMapApp::BuildShadersAndInputLayout()
     };
 }
 
-void NormalMapApp::BuildShapeGeometry()
+std::unique_ptr<MeshGeometry> NormalMapApp::BuildShapeGeometry()
 {
+    using namespace DirectX;
     GeometryGenerator geoGen;
-    GeometryGenerator::MeshData box = geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3);
-    GeometryGenerator::MeshData grid = geoGen.CreateGrid(20.0f, 30.0f, 60, 40);
-    GeometryGenerator::MeshData sphere = geoGen.CreateSphere(0.5f, 20, 20);
-    GeometryGenerator::MeshData cylinder = geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20);
 
-    //
-    // We are concatenating all the geometry into one big vertex/index buffer.  So
-    // define the regions in the buffer each submesh covers.
-    //
+    // Spheres and cylinders also get coarser tessellations for the LOD selector.
+    std::vector<std::pair<std::string, GeometryGenerator::MeshData>> meshes;
+    meshes.emplace_back("box", geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3));
+    meshes.emplace_back("grid", geoGen.CreateGrid(20.0f, 30.0f, 60, 40));
+    meshes.emplace_back("sphere", geoGen.CreateSphere(0.5f, 20, 20));
+    meshes.emplace_back("sphereLod1", geoGen.CreateSphere(0.5f, 12, 12));
+    meshes.emplace_back("sphereLod2", geoGen.CreateSphere(0.5f, 6, 6));
+    meshes.emplace_back("cylinder", geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20));
+    meshes.emplace_back("cylinderLod1", geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 10, 4));
+    meshes.emplace_back("cylinderLod2", geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 6, 1));
 
-    // Cache the vertex offsets to each object in the concatenated vertex buffer.
-    UINT boxVertexOffset = 0;
-    UINT gridVertexOffset = (UINT)box.Vertices.size();
-    UINT sphereVertexOffset = gridVertexOffset + (UINT)grid.Vertices.size();
-    UINT cylinderVertexOffset = sphereVertexOffset + (UINT)sphere.Vertices.size();
-
-    // Cache the starting index for each object in the concatenated index buffer.
-    UINT boxIndexOffset = 0;
-    UINT gridIndexOffset = (UINT)box.Indices32.size();
-    UINT sphereIndexOffset = gridIndexOffset + (UINT)grid.Indices32.size();
-    UINT cylinderIndexOffset = sphereIndexOffset + (UINT)sphere.Indices32.size();
-
-    SubmeshGeometry boxSubmesh;
-    boxSubmesh.IndexCount = (UINT)box.Indices32.size();
-    boxSubmesh.StartIndexLocation = boxIndexOffset;
-    boxSubmesh.BaseVertexLocation = boxVertexOffset;
-
-    SubmeshGeometry gridSubmesh;
-    gridSubmesh.IndexCount = (UINT)grid.Indices32.size();
-    gridSubmesh.StartIndexLocation = gridIndexOffset;
-    gridSubmesh.BaseVertexLocation = gridVertexOffset;
-
-    SubmeshGeometry sphereSubmesh;
-    sphereSubmesh.IndexCount = (UINT)sphere.Indices32.size();
-    sphereSubmesh.StartIndexLocation = sphereIndexOffset;
-    sphereSubmesh.BaseVertexLocation = sphereVertexOffset;
-
-    SubmeshGeometry cylinderSubmesh;
-    cylinderSubmesh.IndexCount = (UINT)cylinder.Indices32.size();
-    cylinderSubmesh.StartIndexLocation = cylinderIndexOffset;
-    cylinderSubmesh.BaseVertexLocation = cylinderVertexOffset;
+    auto geo = std::make_unique<MeshGeometry>();
+    geo->Name = "shapeGeo";
 
     //
-    // Extract the vertex elements we are interested in and pack the
-    // vertices of all the meshes into one vertex buffer.
+    // We are concatenating all the geometry into one big vertex/index buffer.  So
+    // define the regions in the buffer each submesh covers, and extract the vertex
+    // elements we are interested in while packing the vertices.
     //
 
-    auto totalVertexCount =
-        box.Vertices.size() +
-        grid.Vertices.size() +
-        sphere.Vertices.size() +
-        cylinder.Vertices.size();
-
-    std::vector<Vertex> vertices(totalVertexCount);
+    std::vector<Vertex> vertices;
+    std::vector<std::uint16_t> indices;
 
-    UINT k = 0;
-    for (size_t i = 0; i < box.Vertices.size(); ++i, ++k)
+    for (auto& [name, mesh] : meshes)
     {
-        vertices[k].Pos = box.Vertices[i].Position;
-        vertices[k].Normal = box.Vertices[i].Normal;
-        vertices[k].TexC = box.Vertices[i].TexC;
-        vertices[k].TangentU = box.Vertices[i].TangentU;
-    }
+        SubmeshGeometry submesh;
+        submesh.IndexCount = (UINT)mesh.Indices32.size();
+        submesh.StartIndexLocation = (UINT)indices.size();
+        submesh.BaseVertexLocation = (INT)vertices.size();
 
-    for (size_t i = 0; i < grid.Vertices.size(); ++i, ++k)
-    {
-        vertices[k].Pos = grid.Vertices[i].Position;
-        vertices[k].Normal = grid.Vertices[i].Normal;
-        vertices[k].TexC = grid.Vertices[i].TexC;
-        vertices[k].TangentU = grid.Vertices[i].TangentU;
-    }
+        XMVECTOR vMin = XMVectorReplicate(+MathHelper::Infinity);
+        XMVECTOR vMax = XMVectorReplicate(-MathHelper::Infinity);
 
-    for (size_t i = 0; i < sphere.Vertices.size(); ++i, ++k)
-    {
-        vertices[k].Pos = sphere.Vertices[i].Position;
-        vertices[k].Normal = sphere.Vertices[i].Normal;
-        vertices[k].TexC = sphere.Vertices[i].TexC;
-        vertices[k].TangentU = sphere.Vertices[i].TangentU;
-    }
+        for (const auto& v : mesh.Vertices)
+        {
+            Vertex vertex;
+            vertex.Pos = v.Position;
+            vertex.Normal = v.Normal;
+            vertex.TexC = v.TexC;
+            vertex.TangentU = v.TangentU;
+            vertices.push_back(vertex);
+
+            XMVECTOR p = XMLoadFloat3(&v.Position);
+            vMin = XMVectorMin(vMin, p);
+            vMax = XMVectorMax(vMax, p);
+        }
 
-    for (size_t i = 0; i < cylinder.Vertices.size(); ++i, ++k)
-    {
-        vertices[k].Pos = cylinder.Vertices[i].Position;
-        vertices[k].Normal = cylinder.Vertices[i].Normal;
-        vertices[k].TexC = cylinder.Vertices[i].TexC;
-        vertices[k].TangentU = cylinder.Vertices[i].TangentU;
-    }
+        XMStoreFloat3(&submesh.Bounds.Center, 0.5f * (vMin + vMax));
+        XMStoreFloat3(&submesh.Bounds.Extents, 0.5f * (vMax - vMin));
 
-    std::vector<std::uint16_t> indices;
-    indices.insert(indices.end(), std::begin(box.GetIndices16()), std::end(box.GetIndices16()));
-    indices.insert(indices.end(), std::begin(grid.GetIndices16()), std::end(grid.GetIndices16()));
-    indices.insert(indices.end(), std::begin(sphere.GetIndices16()), std::end(sphere.GetIndices16()));
-    indices.insert(indices.end(), std::begin(cylinder.GetIndices16()), std::end(cylinder.GetIndices16()));
+        indices.insert(indices.end(), std::begin(mesh.GetIndices16()), std::end(mesh.GetIndices16()));
+
+        geo->DrawArgs[name] = submesh;
+    }
 
     const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
     const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
 
-    auto geo = std::make_unique<MeshGeometry>();
-    geo->Name = "shapeGeo";
-
     ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
     CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
     ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
     CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-    geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(pDevice.Get(),
-        pCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-    geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(pDevice.Get(),
-        pCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
     geo->VertexByteStride = sizeof(Vertex);
     geo->VertexBufferByteSize = vbByteSize;
     geo->IndexFormat = DXGI_FORMAT_R16_UINT;
     geo->IndexBufferByteSize = ibByteSize;
 
-    geo->DrawArgs["box"] = boxSubmesh;
-    geo->DrawArgs["grid"] = gridSubmesh;
-    geo->DrawArgs["sphere"] = sphereSubmesh;
-    geo->DrawArgs["cylinder"] = cylinderSubmesh;
+    // Switch to the next coarser level when the shape is shorter than these many pixels on screen.
+    LodSet& sphereLods = lodSets["sphere"];
+    sphereLods.Levels = { geo->DrawArgs["sphere"], geo->DrawArgs["sphereLod1"], geo->DrawArgs["sphereLod2"] };
+    sphereLods.ScreenHeights = { 120.0f, 40.0f };
 
-    geometries[geo->Name] = std::move(geo);
+    LodSet& cylinderLods = lodSets["cylinder"];
+    cylinderLods.Levels = { geo->DrawArgs["cylinder"], geo->DrawArgs["cylinderLod1"], geo->DrawArgs["cylinderLod2"] };
+    cylinderLods.ScreenHeights = { 200.0f, 60.0f };
+
+    return geo;
 }
 
+std::unique_ptr<MeshGeometry> NormalMapApp::BuildCarGeometry()
+{
+    // Cooked into the vertex layout the shaders use, with its bounds, so it only
+    // has to be uploaded.
+    const AssetEntry& entry = FindAsset("Models/car");
+    std::vector<std::uint8_t> buffer;
+    const std::uint8_t* data = AssetData(entry, buffer);
+
+    MeshView mesh;
+    ThrowIfFailed(mesh.Parse(data, (size_t)entry.Size) && mesh.Header->VertexStride == sizeof(Vertex) ?
+        S_OK : HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+
+    const UINT vbByteSize = mesh.Header->VertexCount * mesh.Header->VertexStride;
+    const UINT ibByteSize = mesh.Header->IndexCount * mesh.Header->IndexSize;
+
+    auto geo = std::make_unique<MeshGeometry>();
+    geo->Name = "carGeo";
+
+    ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
+    CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), mesh.Vertices, vbByteSize);
+
+    ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+    CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), mesh.Indices, ibByteSize);
+
+    geo->VertexByteStride = mesh.Header->VertexStride;
+    geo->VertexBufferByteSize = vbByteSize;
+    geo->IndexFormat = mesh.Header->IndexSize == sizeof(std::uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    geo->IndexBufferByteSize = ibByteSize;
+
+    SubmeshGeometry submesh;
+    submesh.IndexCount = mesh.Header->IndexCount;
+    submesh.StartIndexLocation = 0;
+    submesh.BaseVertexLocation = 0;
+    submesh.Bounds.Center = { mesh.Header->BoundsCenter[0], mesh.Header->BoundsCenter[1], mesh.Header->BoundsCenter[2] };
+    submesh.Bounds.Extents = { mesh.Header->BoundsExtents[0], mesh.Header->BoundsExtents[1], mesh.Header->BoundsExtents[2] };
+
+    geo->DrawArgs["car"] = submesh;
+
+    return geo;
+}
 
 void NormalMapApp::BuildPSOs()
 {
@@ -574,7 +942,9 @@ void NormalMapApp::BuildPSOs()
     opaquePsoDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
     opaquePsoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
     opaquePsoDesc.DSVFormat = depthStencilFormat;
-    ThrowIfFailed(pDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&PSOs["opaque"])));
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> opaque;
+    ThrowIfFailed(pDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&opaque)));
+    opaquePso = PSOs.Insert("opaque", opaque);
 
     auto skyMapPsoDesc = opaquePsoDesc;
     skyMapPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
@@ -582,15 +952,26 @@ void NormalMapApp::BuildPSOs()
     skyMapPsoDesc.VS = CD3DX12_SHADER_BYTECODE(shaders["skyVS"].Get());
     skyMapPsoDesc.PS = CD3DX12_SHADER_BYTECODE(shaders["skyPS"].Get());
 
-    ThrowIfFailed(pDevice->CreateGraphicsPipelineState(&skyMapPsoDesc, IID_PPV_ARGS(&PSOs["sky"])));
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> sky;
+    ThrowIfFailed(pDevice->CreateGraphicsPipelineState(&skyMapPsoDesc, IID_PPV_ARGS(&sky)));
+    skyPso = PSOs.Insert("sky", sky);
 
 }
 
 void NormalMapApp::BuildFrameResources()
 {
+    // Materials do not change once built, so every frame resource gets the whole
+    // material table here, one bulk copy each, and nothing rewrites it per frame.
+    std::vector<MaterialData> materialTable(materials.Size());
+    for (const Material& mat : materials)
+    {
+        materialTable[mat.MatCBIndex] = MakeMaterialData(mat);
+    }
+
     for (int i = 0; i < gNumFrameResources; ++i)
     {
-        frameResources.push_back(std::make_unique<FrameResource>(pDevice.Get(), 1, (UINT)allRItems.size(), (UINT)materials.size()));
+        frameResources.push_back(std::make_unique<FrameResource>(pDevice.Get(), (UINT)materials.Size()));
+        frameResources.back()->MaterialBuffer->CopyRange(0, materialTable);
     }
 }
 
@@ -600,106 +981,115 @@ void NormalMapApp::BuildMaterials()
     auto bricks0 = std::make_unique<Material>();
     bricks0->Name = "bricks0";
     bricks0->MatCBIndex = 0;
-    bricks0->DiffuseSrvHeapIndex = 0;
-    bricks0->NormalSrvHeapIndex = 1;
+    bricks0->DiffuseSrvHeapIndex = textureSlots["bricksDiffuseMap"].Slot;
+    bricks0->DiffuseArraySlice = textureSlots["bricksDiffuseMap"].Slice;
+    bricks0->NormalSrvHeapIndex = textureSlots["bricksNormalMap"].Slot;
+    bricks0->NormalArraySlice = textureSlots["bricksNormalMap"].Slice;
     bricks0->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
     bricks0->FresnelR0 = XMFLOAT3(0.1f, 0.1f, 0.1f);
     bricks0->Roughness = 0.3f;
 
     auto tile0 = std::make_unique<Material>();
     tile0->Name = "tile0";
-    tile0->MatCBIndex = 2;
-    tile0->DiffuseSrvHeapIndex = 2;
-    tile0->NormalSrvHeapIndex = 3;
+    tile0->MatCBIndex = 1;
+    tile0->DiffuseSrvHeapIndex = textureSlots["tileDiffuseMap"].Slot;
+    tile0->DiffuseArraySlice = textureSlots["tileDiffuseMap"].Slice;
+    tile0->NormalSrvHeapIndex = textureSlots["tileNormalMap"].Slot;
+    tile0->NormalArraySlice = textureSlots["tileNormalMap"].Slice;
     tile0->DiffuseAlbedo = XMFLOAT4(0.9f, 0.9f, 0.9f, 1.0f);
     tile0->FresnelR0 = XMFLOAT3(0.2f, 0.2f, 0.2f);
     tile0->Roughness = 0.1f;
 
     auto mirror0 = std::make_unique<Material>();
     mirror0->Name = "mirror0";
-    mirror0->MatCBIndex = 3;
-    mirror0->DiffuseSrvHeapIndex = 4;
-    mirror0->NormalSrvHeapIndex = 5;
+    mirror0->MatCBIndex = 2;
+    mirror0->DiffuseSrvHeapIndex = textureSlots["defaultDiffuseMap"].Slot;
+    mirror0->DiffuseArraySlice = textureSlots["defaultDiffuseMap"].Slice;
+    mirror0->NormalSrvHeapIndex = textureSlots["defaultNormalMap"].Slot;
+    mirror0->NormalArraySlice = textureSlots["defaultNormalMap"].Slice;
     mirror0->DiffuseAlbedo = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
     mirror0->FresnelR0 = XMFLOAT3(0.98f, 0.97f, 0.95f);
     mirror0->Roughness = 0.1f;
 
     auto sky = std::make_unique<Material>();
     sky->Name = "sky";
-    sky->MatCBIndex = 4;
-    sky->DiffuseSrvHeapIndex = 6;
-    sky->NormalSrvHeapIndex = 7;
+    sky->MatCBIndex = 3;
+    sky->DiffuseSrvHeapIndex = textureSlots["skyCubeMap"].Slot;
+    sky->DiffuseArraySlice = textureSlots["skyCubeMap"].Slice;
+    sky->NormalSrvHeapIndex = textureSlots["defaultNormalMap"].Slot;
+    sky->NormalArraySlice = textureSlots["defaultNormalMap"].Slice;
     sky->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
     sky->FresnelR0 = XMFLOAT3(0.1f, 0.1f, 0.1f);
     sky->Roughness = 1.0f;
 
-    materials["bricks0"] = std::move(bricks0);
-    materials["tile0"] = std::move(tile0);
-    materials["mirror0"] = std::move(mirror0);
-    materials["sky"] = std::move(sky);
+    materials.Insert(bricks0->Name, std::move(*bricks0));
+    materials.Insert(tile0->Name, std::move(*tile0));
+    materials.Insert(mirror0->Name, std::move(*mirror0));
+    materials.Insert(sky->Name, std::move(*sky));
 }
 
 void NormalMapApp::BuildRenderItems()
 {
     using namespace DirectX;
+
+    // All geometry is loaded, so the pointers stay valid.
+    MeshGeometry* shapeGeo = &geometries[geometries.Find("shapeGeo")];
+    MeshGeometry* carGeo = &geometries[geometries.Find("carGeo")];
+
     auto skyRitem = std::make_unique<RenderItem>();
-    XMStoreFloat4x4(&skyRitem->World, XMMatrixScaling(5000.0f, 5000.0f, 5000.0f));
-    skyRitem->TexTransform = MathHelper::Identity4x4();
-    skyRitem->ObjCBIndex = 0;
-    skyRitem->Mat = materials["sky"].get();
-    skyRitem->Geo = geometries["shapeGeo"].get();
+    skyRitem->Mat = materials.Find("sky");
+    skyRitem->Transform = transforms.Add(XMMatrixScaling(5000.0f, 5000.0f, 5000.0f), XMMatrixIdentity(), materials[skyRitem->Mat].MatCBIndex);
+    skyRitem->Geo = shapeGeo;
     skyRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
     skyRitem->IndexCount = skyRitem->Geo->DrawArgs["sphere"].IndexCount;
     skyRitem->StartIndexLocation = skyRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
     skyRitem->BaseVertexLocation = skyRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
+    skyRitem->Bounds = skyRitem->Geo->DrawArgs["sphere"].Bounds;
 
     rItemLayer[(int)RenderLayer::Sky].push_back(skyRitem.get());
     allRItems.push_back(std::move(skyRitem));
 
     auto boxRitem = std::make_unique<RenderItem>();
-    XMStoreFloat4x4(&boxRitem->World, XMMatrixScaling(2.0f, 1.0f, 2.0f) * XMMatrixTranslation(0.0f, 0.5f, 0.0f));
-    XMStoreFloat4x4(&boxRitem->TexTransform, XMMatrixScaling(1.0f, 0.5f, 1.0f));
-    boxRitem->ObjCBIndex = 1;
-    boxRitem->Mat = materials["bricks0"].get();
-    boxRitem->Geo = geometries["shapeGeo"].get();
+    boxRitem->Mat = materials.Find("bricks0");
+    boxRitem->Transform = transforms.Add(XMMatrixScaling(2.0f, 1.0f, 2.0f) * XMMatrixTranslation(0.0f, 0.5f, 0.0f), XMMatrixScaling(1.0f, 0.5f, 1.0f), materials[boxRitem->Mat].MatCBIndex);
+    boxRitem->Geo = shapeGeo;
     boxRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
     boxRitem->IndexCount = boxRitem->Geo->DrawArgs["box"].IndexCount;
     boxRitem->StartIndexLocation = boxRitem->Geo->DrawArgs["box"].StartIndexLocation;
     boxRitem->BaseVertexLocation = boxRitem->Geo->DrawArgs["box"].BaseVertexLocation;
+    boxRitem->Bounds = boxRitem->Geo->DrawArgs["box"].Bounds;
 
     rItemLayer[(int)RenderLayer::Opaque].push_back(boxRitem.get());
     allRItems.push_back(std::move(boxRitem));
 
     auto globeRitem = std::make_unique<RenderItem>();
-    XMStoreFloat4x4(&globeRitem->World, XMMatrixScaling(2.0f, 2.0f, 2.0f) * XMMatrixTranslation(0.0f, 2.0f, 0.0f));
-    XMStoreFloat4x4(&globeRitem->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-    globeRitem->ObjCBIndex = 2;
-    globeRitem->Mat = materials["mirror0"].get();
-    globeRitem->Geo = geometries["shapeGeo"].get();
+    globeRitem->Mat = materials.Find("mirror0");
+    globeRitem->Transform = transforms.Add(XMMatrixScaling(2.0f, 2.0f, 2.0f) * XMMatrixTranslation(0.0f, 2.0f, 0.0f), XMMatrixScaling(1.0f, 1.0f, 1.0f), materials[globeRitem->Mat].MatCBIndex);
+    globeRitem->Geo = shapeGeo;
     globeRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
     globeRitem->IndexCount = globeRitem->Geo->DrawArgs["sphere"].IndexCount;
     globeRitem->StartIndexLocation = globeRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
     globeRitem->BaseVertexLocation = globeRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
+    globeRitem->Bounds = globeRitem->Geo->DrawArgs["sphere"].Bounds;
+    globeRitem->Lods = &lodSets["sphere"];
 
     rItemLayer[(int)RenderLayer::Opaque].push_back(globeRitem.get());
     allRItems.push_back(std::move(globeRitem));
 
     auto gridRitem = std::make_unique<RenderItem>();
-    gridRitem->World = MathHelper::Identity4x4();
-    XMStoreFloat4x4(&gridRitem->TexTransform, XMMatrixScaling(8.0f, 8.0f, 1.0f));
-    gridRitem->ObjCBIndex = 3;
-    gridRitem->Mat = materials["tile0"].get();
-    gridRitem->Geo = geometries["shapeGeo"].get();
+    gridRitem->Mat = materials.Find("tile0");
+    gridRitem->Transform = transforms.Add(XMMatrixIdentity(), XMMatrixScaling(8.0f, 8.0f, 1.0f), materials[gridRitem->Mat].MatCBIndex);
+    gridRitem->Geo = shapeGeo;
     gridRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
     gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
     gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
     gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
+    gridRitem->Bounds = gridRitem->Geo->DrawArgs["grid"].Bounds;
 
     rItemLayer[(int)RenderLayer::Opaque].push_back(gridRitem.get());
     allRItems.push_back(std::move(gridRitem));
 
     XMMATRIX brickTexTransform = XMMatrixScaling(1.5f, 2.0f, 1.0f);
-    UINT objCBIndex = 4;
     for (int i = 0; i < 5; ++i)
     {
         auto leftCylRitem = std::make_unique<RenderItem>();
@@ -713,45 +1103,45 @@ void NormalMapApp::BuildRenderItems()
         XMMATRIX leftSphereWorld = XMMatrixTranslation(-5.0f, 3.5f, -10.0f + i * 5.0f);
         XMMATRIX rightSphereWorld = XMMatrixTranslation(+5.0f, 3.5f, -10.0f + i * 5.0f);
 
-        XMStoreFloat4x4(&leftCylRitem->World, rightCylWorld);
-        XMStoreFloat4x4(&leftCylRitem->TexTransform, brickTexTransform);
-        leftCylRitem->ObjCBIndex = objCBIndex++;
-        leftCylRitem->Mat = materials["bricks0"].get();
-        leftCylRitem->Geo = geometries["shapeGeo"].get();
+        leftCylRitem->Mat = materials.Find("bricks0");
+        leftCylRitem->Transform = transforms.Add(rightCylWorld, brickTexTransform, materials[leftCylRitem->Mat].MatCBIndex);
+        leftCylRitem->Geo = shapeGeo;
         leftCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
         leftCylRitem->IndexCount = leftCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
         leftCylRitem->StartIndexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
         leftCylRitem->BaseVertexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
+        leftCylRitem->Bounds = leftCylRitem->Geo->DrawArgs["cylinder"].Bounds;
+        leftCylRitem->Lods = &lodSets["cylinder"];
 
-        XMStoreFloat4x4(&rightCylRitem->World, leftCylWorld);
-        XMStoreFloat4x4(&rightCylRitem->TexTransform, brickTexTransform);
-        rightCylRitem->ObjCBIndex = objCBIndex++;
-        rightCylRitem->Mat = materials["bricks0"].get();
-        rightCylRitem->Geo = geometries["shapeGeo"].get();
+        rightCylRitem->Mat = materials.Find("bricks0");
+        rightCylRitem->Transform = transforms.Add(leftCylWorld, brickTexTransform, materials[rightCylRitem->Mat].MatCBIndex);
+        rightCylRitem->Geo = shapeGeo;
         rightCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
         rightCylRitem->IndexCount = rightCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
         rightCylRitem->StartIndexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
         rightCylRitem->BaseVertexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
+        rightCylRitem->Bounds = rightCylRitem->Geo->DrawArgs["cylinder"].Bounds;
+        rightCylRitem->Lods = &lodSets["cylinder"];
 
-        XMStoreFloat4x4(&leftSphereRitem->World, leftSphereWorld);
-        leftSphereRitem->TexTransform = MathHelper::Identity4x4();
-        leftSphereRitem->ObjCBIndex = objCBIndex++;
-        leftSphereRitem->Mat = materials["mirror0"].get();
-        leftSphereRitem->Geo = geometries["shapeGeo"].get();
+        leftSphereRitem->Mat = materials.Find("mirror0");
+        leftSphereRitem->Transform = transforms.Add(leftSphereWorld, XMMatrixIdentity(), materials[leftSphereRitem->Mat].MatCBIndex);
+        leftSphereRitem->Geo = shapeGeo;
         leftSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
         leftSphereRitem->IndexCount = leftSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
         leftSphereRitem->StartIndexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
         leftSphereRitem->BaseVertexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
+        leftSphereRitem->Bounds = leftSphereRitem->Geo->DrawArgs["sphere"].Bounds;
+        leftSphereRitem->Lods = &lodSets["sphere"];
 
-        XMStoreFloat4x4(&rightSphereRitem->World, rightSphereWorld);
-        rightSphereRitem->TexTransform = MathHelper::Identity4x4();
-        rightSphereRitem->ObjCBIndex = objCBIndex++;
-        rightSphereRitem->Mat = materials["mirror0"].get();
-        rightSphereRitem->Geo = geometries["shapeGeo"].get();
+        rightSphereRitem->Mat = materials.Find("mirror0");
+        rightSphereRitem->Transform = transforms.Add(rightSphereWorld, XMMatrixIdentity(), materials[rightSphereRitem->Mat].MatCBIndex);
+        rightSphereRitem->Geo = shapeGeo;
         rightSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
         rightSphereRitem->IndexCount = rightSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
         rightSphereRitem->StartIndexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
         rightSphereRitem->BaseVertexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
+        rightSphereRitem->Bounds = rightSphereRitem->Geo->DrawArgs["sphere"].Bounds;
+        rightSphereRitem->Lods = &lodSets["sphere"];
 
         rItemLayer[(int)RenderLayer::Opaque].push_back(leftCylRitem.get());
         rItemLayer[(int)RenderLayer::Opaque].push_back(rightCylRitem.get());
@@ -763,14 +1153,101 @@ void NormalMapApp::BuildRenderItems()
         allRItems.push_back(std::move(leftSphereRitem));
         allRItems.push_back(std::move(rightSphereRitem));
     }
+
+    //
+    // Parented objects.  Their world matrices come from the scene graph; AnimateScene
+    // sets the local transforms every frame.
+    //
+
+    carNode = sceneGraph.CreateNode(SceneGraph::NoParent, XMMatrixIdentity());
+
+    auto carRitem = std::make_unique<RenderItem>();
+    carRitem->Mat = materials.Find("mirror0");
+    carRitem->Transform = transforms.Add(XMMatrixIdentity(), XMMatrixIdentity(), materials[carRitem->Mat].MatCBIndex,
+        ObjectMotion::Dynamic);
+    carRitem->Geo = carGeo;
+    carRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+    carRitem->IndexCount = carRitem->Geo->DrawArgs["car"].IndexCount;
+    carRitem->StartIndexLocation = carRitem->Geo->DrawArgs["car"].StartIndexLocation;
+    carRitem->BaseVertexLocation = carRitem->Geo->DrawArgs["car"].BaseVertexLocation;
+    carRitem->Bounds = carRitem->Geo->DrawArgs["car"].Bounds;
+    sceneGraph.Bind(sceneGraph.CreateNode(carNode, XMMatrixIdentity()), carRitem->Transform);
+
+    rItemLayer[(int)RenderLayer::Opaque].push_back(carRitem.get());
+    allRItems.push_back(std::move(carRitem));
+
+    for (int i = 0; i < 4; ++i)
+    {
+        auto wheelRitem = std::make_unique<RenderItem>();
+        wheelRitem->Mat = materials.Find("tile0");
+        wheelRitem->Transform = transforms.Add(XMMatrixIdentity(), XMMatrixIdentity(), materials[wheelRitem->Mat].MatCBIndex,
+            ObjectMotion::Dynamic);
+        wheelRitem->Geo = shapeGeo;
+        wheelRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+        wheelRitem->IndexCount = wheelRitem->Geo->DrawArgs["cylinder"].IndexCount;
+        wheelRitem->StartIndexLocation = wheelRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
+        wheelRitem->BaseVertexLocation = wheelRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
+        wheelRitem->Bounds = wheelRitem->Geo->DrawArgs["cylinder"].Bounds;
+        wheelRitem->Lods = &lodSets["cylinder"];
+
+        UINT wheelNode = sceneGraph.CreateNode(carNode, XMMatrixIdentity());
+        sceneGraph.Bind(wheelNode, wheelRitem->Transform);
+        wheelNodes.push_back(wheelNode);
+
+        rItemLayer[(int)RenderLayer::Opaque].push_back(wheelRitem.get());
+        allRItems.push_back(std::move(wheelRitem));
+    }
+
+    reflectorOrbitNode = sceneGraph.CreateNode(SceneGraph::NoParent, XMMatrixIdentity());
+    for (int i = 0; i < 3; ++i)
+    {
+        float angle = i * XM_2PI / 3.0f;
+
+        auto reflectorRitem = std::make_unique<RenderItem>();
+        reflectorRitem->Mat = materials.Find("mirror0");
+        reflectorRitem->Transform = transforms.Add(XMMatrixIdentity(), XMMatrixIdentity(), materials[reflectorRitem->Mat].MatCBIndex,
+            ObjectMotion::Dynamic);
+        reflectorRitem->Geo = shapeGeo;
+        reflectorRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+        reflectorRitem->IndexCount = reflectorRitem->Geo->DrawArgs["sphere"].IndexCount;
+        reflectorRitem->StartIndexLocation = reflectorRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
+        reflectorRitem->BaseVertexLocation = reflectorRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
+        reflectorRitem->Bounds = reflectorRitem->Geo->DrawArgs["sphere"].Bounds;
+        reflectorRitem->Lods = &lodSets["sphere"];
+
+        // The reflector is a sibling of its moon's orbit so the moon does not inherit its scale.
+        UINT reflectorPivot = sceneGraph.CreateNode(reflectorOrbitNode,
+            XMMatrixTranslation(2.5f * cosf(angle), 0.0f, 2.5f * sinf(angle)));
+        sceneGraph.Bind(sceneGraph.CreateNode(reflectorPivot, XMMatrixScaling(0.6f, 0.6f, 0.6f)), reflectorRitem->Transform);
+
+        auto moonRitem = std::make_unique<RenderItem>();
+        moonRitem->Mat = materials.Find("bricks0");
+        moonRitem->Transform = transforms.Add(XMMatrixIdentity(), XMMatrixIdentity(), materials[moonRitem->Mat].MatCBIndex,
+            ObjectMotion::Dynamic);
+        moonRitem->Geo = shapeGeo;
+        moonRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+        moonRitem->IndexCount = moonRitem->Geo->DrawArgs["sphere"].IndexCount;
+        moonRitem->StartIndexLocation = moonRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
+        moonRitem->BaseVertexLocation = moonRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
+        moonRitem->Bounds = moonRitem->Geo->DrawArgs["sphere"].Bounds;
+        moonRitem->Lods = &lodSets["sphere"];
+
+        UINT moonOrbit = sceneGraph.CreateNode(reflectorPivot, XMMatrixIdentity());
+        sceneGraph.Bind(sceneGraph.CreateNode(moonOrbit,
+            XMMatrixScaling(0.2f, 0.2f, 0.2f) * XMMatrixTranslation(0.7f, 0.0f, 0.0f)), moonRitem->Transform);
+        moonOrbitNodes.push_back(moonOrbit);
+
+        rItemLayer[(int)RenderLayer::Opaque].push_back(reflectorRitem.get());
+        rItemLayer[(int)RenderLayer::Opaque].push_back(moonRitem.get());
+        allRItems.push_back(std::move(reflectorRitem));
+        allRItems.push_back(std::move(moonRitem));
+    }
+
+    sceneGraph.Update(transforms);
 }
 
 void NormalMapApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& rItems)
 {
-    UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-
-    auto objectCB = currFrameResource->ObjectCB->Resource();
-
     // For each render item...
     for (size_t i = 0; i < rItems.size(); ++i)
     {
@@ -780,15 +1257,32 @@ void NormalMapApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std
         cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
         cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
 
-        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex * objCBByteSize;
-
-        cmdList->SetGraphicsRootConstantBufferView(0, objCBAddress);
+        cmdList->SetGraphicsRoot32BitConstant(0, transforms.ObjectIndex(ri->Transform), 0);
 
 
         cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
     }
 }
 
+void NormalMapApp::DrawBatchesIndirect(ID3D12GraphicsCommandList* cmdList, const std::vector<InstanceBatch>& batches,
+    const IndirectCommandPacker& packer)
+{
+    const UploadAllocation& args = currFrameResource->IndirectArgs;
+
+    // One ExecuteIndirect per run of batches sharing vertex/index buffers and topology.
+    for (const IndirectDrawRun& run : packer.Runs())
+    {
+        const InstanceBatch& first = batches[run.FirstBatch];
+
+        cmdList->IASetVertexBuffers(0, 1, &first.Geo->VertexBufferView());
+        cmdList->IASetIndexBuffer(&first.Geo->IndexBufferView());
+        cmdList->IASetPrimitiveTopology(first.PrimitiveType);
+
+        cmdList->ExecuteIndirect(pCommandSignature.Get(), run.CommandCount,
+            args.Resource, args.Offset + (UINT64)run.FirstCommand * sizeof(IndirectDrawCommand), nullptr, 0);
+    }
+}
+
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> NormalMapApp::GetStaticSamplers()
 {
     // Applications usually only need a handful of samplers.  So just define them all up front
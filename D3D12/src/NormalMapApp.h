@@ -4,28 +4,18 @@
 #include "FrameResource.h"
 #include "Camera.h"
 #include "CubeRenderTarget.h"
-
-struct RenderItem
-{
-	RenderItem() = default;
-	RenderItem(const RenderItem& rhs) = delete;
-
-	DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
-	DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
-
-	int NumFramesDirty = gNumFrameResources;
-
-	UINT ObjCBIndex = -1;
-
-	Material* Mat = nullptr;
-	MeshGeometry* Geo = nullptr;
-
-	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-
-	UINT IndexCount = 0;
-	UINT StartIndexLocation = 0;
-	int BaseVertexLocation = 0;
-};
+#include "RenderItem.h"
+#include "InstanceBatcher.h"
+#include "LodSelector.h"
+#include "TransformStore.h"
+#include "SceneGraph.h"
+#include "DeferredReleaseQueue.h"
+#include "GpuBufferPool.h"
+#include "UploadBatch.h"
+#include "SlotMap.h"
+#include "TextureCache.h"
+#include "AssetPack.h"
+#include "Common/TexturePacker.h"
 
 enum class RenderLayer : int
 {
@@ -57,20 +47,53 @@ private:
 
 	void OnKeyboardInput(const GameTimer& gt);
 	void AnimateMaterials(const GameTimer& gt);
-	void UpdateObjectCBs(const GameTimer& gt);
-	void UpdateMaterialBuffer(const GameTimer& gt);
+	void AnimateScene(const GameTimer& gt);
+	void UpdateLods(const GameTimer& gt);
+	void UpdateTextureStreaming(const GameTimer& gt);
+	void UpdateObjectBuffer(const GameTimer& gt);
+	void UploadStaticObjectBuffer(ID3D12GraphicsCommandList* cmdList);
+	void UpdateInstanceBuffer(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
 
-	void LoadTextures();
+	// Textures parsed and packed into arrays, waiting to be uploaded.
+	struct PendingTextures
+	{
+		std::vector<const AssetEntry*> Entries;
+		TextureArrayPacker Packer;
+	};
+
+	// Initialization steps, run as a TaskGraph by Initialize.  The Build*Geometry
+	// steps only produce the meshes; AddGeometry uploads them.
+	void LoadAssetPack();
+	void PackTextures(PendingTextures& pending);
+	void UploadTextures(PendingTextures& pending);
+	// Sets the ambient spherical harmonics in mainPassCB from the sky cube map.
+	void ProjectSkyIrradiance();
 	void BuildRootSignature();
+	void BuildCommandSignature();
 	void BuildDescriptorHeaps();
 	void BuildShadersAndInputLayout();
-	void BuildShapeGeometry();
+	std::unique_ptr<MeshGeometry> BuildShapeGeometry();
+	std::unique_ptr<MeshGeometry> BuildCarGeometry();
 	void BuildPSOs();
 	void BuildFrameResources();
 	void BuildMaterials();
 	void BuildRenderItems();
+	// The pack entry called name; throws if there is none.
+	const AssetEntry& FindAsset(const std::string& name)const;
+	// The payload of entry, straight from the mapped pack or, if it is compressed,
+	// decompressed into buffer.
+	const std::uint8_t* AssetData(const AssetEntry& entry, std::vector<std::uint8_t>& buffer)const;
+	// Stores geo and uploads its vertices and indices from its CPU copies.
+	void AddGeometry(std::unique_ptr<MeshGeometry> geo);
+	// Places the vertex and index data of the geometry in the geometry pool.
+	void UploadGeometry(GeometryHandle geometry, const void* vertices, UINT vbByteSize,
+		const void* indices, UINT ibByteSize);
+	// Points the meshes at their current place in the geometry pool, after Defragment.
+	void UpdateGeometryLocations();
 	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& rItems);
+	void DrawBatchesIndirect(ID3D12GraphicsCommandList* cmdList, const std::vector<InstanceBatch>& batches,
+		const IndirectCommandPacker& packer);
 
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6>  GetStaticSamplers();
@@ -78,28 +101,92 @@ private:
 	Camera cam;
 
 	std::vector<std::unique_ptr<FrameResource>> frameResources;
+	// objects retired while the GPU may still use them
+	ResourceReleaseQueue releaseQueue;
+	// per-frame transient data for all frames in flight
+	std::unique_ptr<UploadRing> uploadRing;
 	FrameResource* currFrameResource = nullptr;
 	int currFrameResourceIndex = 0;
 
 	UINT cbvSrvDescriptorSize = 0;
 
 	Microsoft::WRL::ComPtr<ID3D12RootSignature> pRootSignature = nullptr;
+	Microsoft::WRL::ComPtr<ID3D12CommandSignature> pCommandSignature = nullptr;
 
+	// One region of TextureDescriptorCount SRVs per frame resource, refreshed from the
+	// texture streamer each frame.
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> pSrvDescriptorHeap = nullptr;
-
-	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> geometries;
-	std::unordered_map<std::string, std::unique_ptr<Texture>> textures;
-	std::unordered_map<std::string, std::unique_ptr<Material>> materials;
+	static const UINT TextureDescriptorCount = 10;
+
+	// Textures, shaders and meshes, mapped for the whole run; textures streamed from
+	// the mapping keep it alive through this pointer.
+	std::shared_ptr<AssetPack> assets;
+
+	// all textures, by the descriptor index the materials use
+	std::unique_ptr<TextureStreamer> textureStreamer;
+	// shares streamer slots between names and files with the same contents
+	std::unique_ptr<TextureCache> textureCache;
+	// Where a texture is: the slot of its texture array and its slice in it.
+	struct TextureLocation
+	{
+		UINT Slot = 0;
+		UINT Slice = 0;
+	};
+	// by texture name, for building the materials
+	std::unordered_map<std::string, TextureLocation> textureSlots;
+	UINT skyTextureSlot = 0;
+
+	// Created at load time and looked up by name only there; per-frame code uses
+	// handles, or pointers taken once loading is done.
+	SlotMap<MeshGeometry> geometries;
+	SlotMap<Material> materials;
+	SlotMap<Microsoft::WRL::ComPtr<ID3D12PipelineState>> PSOs;
+	SlotHandle<Microsoft::WRL::ComPtr<ID3D12PipelineState>> opaquePso;
+	SlotHandle<Microsoft::WRL::ComPtr<ID3D12PipelineState>> skyPso;
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3DBlob>> shaders;
-	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D12PipelineState>> PSOs;
+
+	// vertex and index buffers of all meshes
+	struct GeometryAllocations
+	{
+		GeometryHandle Geometry;
+		UINT Vertices = GpuBufferPool::InvalidAllocation;
+		UINT Indices = GpuBufferPool::InvalidAllocation;
+	};
+	std::unique_ptr<GpuBufferPool> geometryPool;
+	std::vector<GeometryAllocations> geometryAllocations;
 
 	std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout;
 
+	std::unordered_map<std::string, LodSet> lodSets;
+	LodSelector lodSelector;
+	UINT64 lastLodTriangles = 0;
+
 	// all of the render items
 	std::vector<std::unique_ptr<RenderItem>> allRItems;
 	// render items divided by PSO
 	std::vector<RenderItem*> rItemLayer[(int)RenderLayer::Count];
 
+	// per-object world, tex transform and material index, indexed by RenderItem::Transform
+	TransformStore transforms;
+
+	// object data of the static objects, uploaded only when one of them changes
+	Microsoft::WRL::ComPtr<ID3D12Resource> pStaticObjectBuffer = nullptr;
+	D3D12_RESOURCE_STATES staticObjectBufferState = D3D12_RESOURCE_STATE_COMMON;
+	UINT staticObjectCapacity = 0;
+
+	// parented objects; bound nodes write their world matrix into transforms
+	SceneGraph sceneGraph;
+	UINT carNode = SceneGraph::NoParent;
+	std::vector<UINT> wheelNodes;
+	UINT reflectorOrbitNode = SceneGraph::NoParent;
+	std::vector<UINT> moonOrbitNodes;
+
+	// opaque items drawn as instanced batches
+	InstanceBatcher opaqueBatcher;
+	IndirectCommandPacker opaquePacker;
+	// submit the opaque layer with ExecuteIndirect instead of one draw call per batch
+	bool indirectDraw = true;
+
 	PassConstants mainPassCB;
 
 	DirectX::XMFLOAT3 eyePos = { 0.0f, 0.0f, 0.0f };
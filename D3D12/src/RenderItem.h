@@ -0,0 +1,39 @@
+#pragma once
+#include "Common/d3dUtil.h"
+#include "TransformStore.h"
+#include "SlotMap.h"
+
+struct LodSet;
+
+using MaterialHandle = SlotHandle<Material>;
+using GeometryHandle = SlotHandle<MeshGeometry>;
+
+// Lightweight structure stores parameters to draw a shape.  This will
+// vary from app-to-app.
+struct RenderItem
+{
+	RenderItem() = default;
+	RenderItem(const RenderItem& rhs) = delete;
+
+	// World matrix, texture transform and material index live in the TransformStore.
+	// Its object index locates the object in the static or per-frame dynamic object buffer.
+	TransformHandle Transform;
+
+	MaterialHandle Mat;
+	// Resolved from a GeometryHandle once all geometry is loaded.
+	MeshGeometry* Geo = nullptr;
+
+	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+	UINT IndexCount = 0;
+	UINT StartIndexLocation = 0;
+	int BaseVertexLocation = 0;
+
+	// Object space bounds of the submesh, used to estimate its size on screen.
+	DirectX::BoundingBox Bounds;
+
+	// Optional levels of detail.  When set, the LOD selector overwrites the draw
+	// arguments above with the submesh of CurrentLod every frame.
+	const LodSet* Lods = nullptr;
+	UINT CurrentLod = 0;
+};
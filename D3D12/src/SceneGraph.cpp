@@ -0,0 +1,236 @@
+#include "SceneGraph.h"
+#include <ppl.h>
+
+using namespace DirectX;
+
+UINT SceneGraph::CreateNode(UINT parent, FXMMATRIX local)
+{
+	assert(parent == NoParent || parent < idToOrder.size());
+
+	UINT id = (UINT)idToOrder.size();
+	UINT order = (UINT)orderToId.size();
+	idToOrder.push_back(order);
+	orderToId.push_back(id);
+
+	XMFLOAT4X4A m;
+	XMStoreFloat4x4A(&m, local);
+	locals.push_back(m);
+	worlds.push_back(m);
+
+	UINT parentOrder = parent == NoParent ? NoParent : idToOrder[parent];
+	parents.push_back(parentOrder);
+	depths.push_back(parentOrder == NoParent ? 0 : depths[parentOrder] + 1);
+	firstChildren.push_back(0);
+	childCounts.push_back(0);
+	handles.push_back(TransformHandle());
+	stamps.push_back(0);
+
+	// Appending breaks the breadth-first layout; it is restored before the next Update.
+	orderDirty = true;
+	dirtyNodes.push_back(id);
+
+	return id;
+}
+
+void SceneGraph::SetLocal(UINT node, FXMMATRIX local)
+{
+	XMStoreFloat4x4A(&locals[idToOrder[node]], local);
+	dirtyNodes.push_back(node);
+}
+
+void SceneGraph::Bind(UINT node, TransformHandle transform)
+{
+	handles[idToOrder[node]] = transform;
+	dirtyNodes.push_back(node);
+}
+
+const XMFLOAT4X4A& SceneGraph::GetWorld(UINT node)const
+{
+	return worlds[idToOrder[node]];
+}
+
+UINT SceneGraph::NodeCount()const
+{
+	return (UINT)orderToId.size();
+}
+
+UINT SceneGraph::Update(TransformStore& transforms)
+{
+	if (orderDirty)
+	{
+		RebuildOrder();
+	}
+
+	if (dirtyNodes.empty())
+	{
+		return 0;
+	}
+
+	// A node is recomputed at most once per Update, whether it changed itself or
+	// sits below a changed node.
+	++stamp;
+
+	// Breadth-first order sorts the changed nodes by depth.
+	seeds.clear();
+	for (UINT id : dirtyNodes)
+	{
+		seeds.push_back(idToOrder[id]);
+	}
+	dirtyNodes.clear();
+	std::sort(seeds.begin(), seeds.end());
+
+	updated.clear();
+	current.clear();
+
+	size_t nextSeed = 0;
+	UINT depth = depths[seeds[0]];
+	for (;;)
+	{
+		for (; nextSeed < seeds.size() && depths[seeds[nextSeed]] == depth; ++nextSeed)
+		{
+			UINT i = seeds[nextSeed];
+			if (stamps[i] != stamp)
+			{
+				stamps[i] = stamp;
+				current.push_back(i);
+			}
+		}
+
+		if (current.empty())
+		{
+			if (nextSeed == seeds.size())
+				break;
+
+			// Nothing left to propagate, skip ahead to the next changed node.
+			depth = depths[seeds[nextSeed]];
+			continue;
+		}
+
+		// Parents were finished on the previous depth, so this depth is independent.
+		ComputeWorlds(current);
+		updated.insert(updated.end(), current.begin(), current.end());
+
+		next.clear();
+		for (UINT i : current)
+		{
+			for (UINT c = firstChildren[i]; c < firstChildren[i] + childCounts[i]; ++c)
+			{
+				stamps[c] = stamp;
+				next.push_back(c);
+			}
+		}
+		std::swap(current, next);
+		++depth;
+	}
+
+	for (UINT i : updated)
+	{
+		if (transforms.IsValid(handles[i]))
+		{
+			transforms.SetWorld(handles[i], worlds[i]);
+		}
+	}
+
+	return (UINT)updated.size();
+}
+
+void SceneGraph::RebuildOrder()
+{
+	const UINT count = (UINT)orderToId.size();
+
+	// Children of every node, by id, in creation order.
+	std::vector<UINT> parentIds(count, NoParent);
+	std::vector<std::vector<UINT>> childIds(count);
+	std::vector<UINT> roots;
+	for (UINT id = 0; id < count; ++id)
+	{
+		UINT parentOrder = parents[idToOrder[id]];
+		if (parentOrder == NoParent)
+		{
+			roots.push_back(id);
+		}
+		else
+		{
+			parentIds[id] = orderToId[parentOrder];
+			childIds[parentIds[id]].push_back(id);
+		}
+	}
+
+	// Breadth-first walk.  The queue is the new order.
+	std::vector<UINT> newOrderToId = roots;
+	newOrderToId.reserve(count);
+	for (size_t head = 0; head < newOrderToId.size(); ++head)
+	{
+		const auto& children = childIds[newOrderToId[head]];
+		newOrderToId.insert(newOrderToId.end(), children.begin(), children.end());
+	}
+	assert(newOrderToId.size() == count);
+
+	std::vector<UINT> newIdToOrder(count);
+	for (UINT order = 0; order < count; ++order)
+	{
+		newIdToOrder[newOrderToId[order]] = order;
+	}
+
+	std::vector<XMFLOAT4X4A> newLocals(count);
+	std::vector<XMFLOAT4X4A> newWorlds(count);
+	std::vector<TransformHandle> newHandles(count);
+	std::vector<UINT> newStamps(count);
+	for (UINT order = 0; order < count; ++order)
+	{
+		UINT oldOrder = idToOrder[newOrderToId[order]];
+		newLocals[order] = locals[oldOrder];
+		newWorlds[order] = worlds[oldOrder];
+		newHandles[order] = handles[oldOrder];
+		newStamps[order] = stamps[oldOrder];
+	}
+
+	for (UINT order = 0; order < count; ++order)
+	{
+		UINT id = newOrderToId[order];
+		UINT parent = parentIds[id] == NoParent ? NoParent : newIdToOrder[parentIds[id]];
+		parents[order] = parent;
+		depths[order] = parent == NoParent ? 0 : depths[parent] + 1;
+
+		const auto& children = childIds[id];
+		childCounts[order] = (UINT)children.size();
+		firstChildren[order] = children.empty() ? 0 : newIdToOrder[children[0]];
+	}
+
+	locals = std::move(newLocals);
+	worlds = std::move(newWorlds);
+	handles = std::move(newHandles);
+	stamps = std::move(newStamps);
+	orderToId = std::move(newOrderToId);
+	idToOrder = std::move(newIdToOrder);
+
+	orderDirty = false;
+}
+
+void SceneGraph::ComputeWorlds(const std::vector<UINT>& nodes)
+{
+	auto compute = [this](UINT i)
+	{
+		XMMATRIX world = XMLoadFloat4x4A(&locals[i]);
+		if (parents[i] != NoParent)
+		{
+			world = world * XMLoadFloat4x4A(&worlds[parents[i]]);
+		}
+		XMStoreFloat4x4A(&worlds[i], world);
+	};
+
+	if (nodes.size() < ParallelThreshold)
+	{
+		for (UINT i : nodes)
+		{
+			compute(i);
+		}
+	}
+	else
+	{
+		concurrency::parallel_for(size_t(0), nodes.size(), [&](size_t k)
+		{
+			compute(nodes[k]);
+		});
+	}
+}
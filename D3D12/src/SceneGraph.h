@@ -0,0 +1,75 @@
+#pragma once
+#include "Common/d3dUtil.h"
+#include "TransformStore.h"
+
+// Transform hierarchy.  Nodes are stored breadth-first in flat arrays, so every
+// parent precedes its children, the children of a node are contiguous and each
+// depth is one contiguous range.  Update only recomputes the subtrees below
+// nodes whose local transform changed, one depth at a time, and hands the new
+// world matrices of bound nodes to the TransformStore, which takes care of
+// uploading them.
+class SceneGraph
+{
+public:
+	static const UINT NoParent = UINT_MAX;
+
+	SceneGraph() = default;
+	SceneGraph(const SceneGraph& rhs) = delete;
+	SceneGraph& operator=(const SceneGraph& rhs) = delete;
+	~SceneGraph() = default;
+
+	///<summary>
+	/// Adds a node below parent (or a root for NoParent) and returns its id.  Ids stay
+	/// valid while the breadth-first storage is reordered.
+	///</summary>
+	UINT CreateNode(UINT parent, DirectX::FXMMATRIX local);
+
+	void SetLocal(UINT node, DirectX::FXMMATRIX local);
+
+	///<summary>
+	/// Makes the node drive the world matrix of an object in the TransformStore.
+	///</summary>
+	void Bind(UINT node, TransformHandle transform);
+
+	const DirectX::XMFLOAT4X4A& GetWorld(UINT node)const;
+	UINT NodeCount()const;
+
+	///<summary>
+	/// Recomputes the world matrices below every node changed since the last call and
+	/// writes the bound ones to transforms.  Returns the number of nodes recomputed.
+	///</summary>
+	UINT Update(TransformStore& transforms);
+
+private:
+	void RebuildOrder();
+	void ComputeWorlds(const std::vector<UINT>& nodes);
+
+private:
+	// Levels with fewer nodes to recompute than this are not worth a parallel_for.
+	static const size_t ParallelThreshold = 512;
+
+	// Breadth-first, indexed by order.
+	std::vector<DirectX::XMFLOAT4X4A> locals;
+	std::vector<DirectX::XMFLOAT4X4A> worlds;
+	std::vector<UINT> parents;
+	std::vector<UINT> firstChildren;
+	std::vector<UINT> childCounts;
+	std::vector<UINT> depths;
+	std::vector<TransformHandle> handles;
+	std::vector<UINT> stamps;
+	std::vector<UINT> orderToId;
+
+	// Indexed by id.
+	std::vector<UINT> idToOrder;
+
+	// Ids whose local transform changed since the last Update.
+	std::vector<UINT> dirtyNodes;
+	bool orderDirty = false;
+	UINT stamp = 0;
+
+	// Scratch for Update.
+	std::vector<UINT> seeds;
+	std::vector<UINT> current;
+	std::vector<UINT> next;
+	std::vector<UINT> updated;
+};
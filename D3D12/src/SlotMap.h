@@ -0,0 +1,186 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Stable reference to a value in a SlotMap<T>.  The slot never moves; the
+// generation detects use after Remove.
+template<typename T>
+struct SlotHandle
+{
+	std::uint32_t Slot = UINT32_MAX;
+	std::uint32_t Generation = 0;
+
+	bool IsNull()const
+	{
+		return Slot == UINT32_MAX;
+	}
+
+	bool operator==(const SlotHandle& rhs)const
+	{
+		return Slot == rhs.Slot && Generation == rhs.Generation;
+	}
+};
+
+// Owns values of T in one dense array and hands out generational handles to them,
+// the same scheme TransformStore uses for transforms.  Lookup by handle is an index
+// and a generation compare; iteration walks the dense array.  Values may be given a
+// name, which Find resolves to a handle: do that once at load and keep the handle,
+// so per-frame code never hashes strings.  Remove moves the last value into the
+// hole, so pointers and references to values are only valid until the next Insert
+// or Remove.
+template<typename T>
+class SlotMap
+{
+public:
+	using Handle = SlotHandle<T>;
+
+	SlotMap() = default;
+	SlotMap(const SlotMap& rhs) = delete;
+	SlotMap& operator=(const SlotMap& rhs) = delete;
+	~SlotMap() = default;
+
+	void Reserve(std::size_t capacity)
+	{
+		values.reserve(capacity);
+		denseToSlot.reserve(capacity);
+		slots.reserve(capacity);
+	}
+
+	Handle Insert(T value)
+	{
+		std::uint32_t slot;
+		if (!freeSlots.empty())
+		{
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else
+		{
+			slot = (std::uint32_t)slots.size();
+			slots.emplace_back();
+		}
+
+		slots[slot].Dense = (std::uint32_t)values.size();
+		values.push_back(std::move(value));
+		denseToSlot.push_back(slot);
+
+		Handle h;
+		h.Slot = slot;
+		h.Generation = slots[slot].Generation;
+		return h;
+	}
+
+	///<summary>
+	/// Inserts value and registers it under name, which must be unique.
+	///</summary>
+	Handle Insert(const std::string& name, T value)
+	{
+		assert(names.find(name) == names.end());
+
+		Handle h = Insert(std::move(value));
+		names[name] = h;
+		slots[h.Slot].Name = name;
+		return h;
+	}
+
+	void Remove(Handle h)
+	{
+		assert(Contains(h));
+		Slot& s = slots[h.Slot];
+
+		// Keep the values dense.
+		std::uint32_t last = (std::uint32_t)values.size() - 1;
+		if (s.Dense != last)
+		{
+			values[s.Dense] = std::move(values[last]);
+			denseToSlot[s.Dense] = denseToSlot[last];
+			slots[denseToSlot[s.Dense]].Dense = s.Dense;
+		}
+		values.pop_back();
+		denseToSlot.pop_back();
+
+		if (!s.Name.empty())
+		{
+			names.erase(s.Name);
+			s.Name.clear();
+		}
+		s.Dense = UINT32_MAX;
+		s.Generation++;
+		freeSlots.push_back(h.Slot);
+	}
+
+	bool Contains(Handle h)const
+	{
+		return h.Slot < slots.size() &&
+			slots[h.Slot].Generation == h.Generation &&
+			slots[h.Slot].Dense != UINT32_MAX;
+	}
+
+	///<summary>
+	/// Returns nullptr for a stale or null handle.
+	///</summary>
+	T* Get(Handle h)
+	{
+		return Contains(h) ? &values[slots[h.Slot].Dense] : nullptr;
+	}
+
+	const T* Get(Handle h)const
+	{
+		return Contains(h) ? &values[slots[h.Slot].Dense] : nullptr;
+	}
+
+	T& operator[](Handle h)
+	{
+		assert(Contains(h));
+		return values[slots[h.Slot].Dense];
+	}
+
+	const T& operator[](Handle h)const
+	{
+		assert(Contains(h));
+		return values[slots[h.Slot].Dense];
+	}
+
+	///<summary>
+	/// Handle of the value inserted under name, or a null handle.  Hashes the name;
+	/// meant for load time.
+	///</summary>
+	Handle Find(const std::string& name)const
+	{
+		auto it = names.find(name);
+		return it != names.end() ? it->second : Handle();
+	}
+
+	std::size_t Size()const
+	{
+		return values.size();
+	}
+
+	// Dense iteration, in no particular order.
+	typename std::vector<T>::iterator begin() { return values.begin(); }
+	typename std::vector<T>::iterator end() { return values.end(); }
+	typename std::vector<T>::const_iterator begin()const { return values.begin(); }
+	typename std::vector<T>::const_iterator end()const { return values.end(); }
+
+private:
+	struct Slot
+	{
+		std::uint32_t Dense = UINT32_MAX;
+		std::uint32_t Generation = 0;
+		std::string Name;
+	};
+
+	// Dense, indexed by dense index.
+	std::vector<T> values;
+	std::vector<std::uint32_t> denseToSlot;
+
+	// Sparse, indexed by slot.
+	std::vector<Slot> slots;
+	std::vector<std::uint32_t> freeSlots;
+
+	std::unordered_map<std::string, Handle> names;
+};
@@ -0,0 +1,88 @@
+#include "StreamingCopy.h"
+#include <cstdint>
+#include <cstring>
+#include <emmintrin.h>
+
+void StreamingCopy(void* dst, const void* src, size_t bytes)
+{
+	auto d = static_cast<std::uint8_t*>(dst);
+	auto s = static_cast<const std::uint8_t*>(src);
+
+	// Small copies are not worth the fence.
+	if (bytes < 256)
+	{
+		memcpy(d, s, bytes);
+		return;
+	}
+
+	// Reach 16 byte alignment on the destination with a regular copy.
+	size_t head = (16 - (reinterpret_cast<std::uintptr_t>(d) & 15)) & 15;
+	memcpy(d, s, head);
+	d += head;
+	s += head;
+	bytes -= head;
+
+	// 64 bytes per iteration is one write-combining line.
+	size_t blocks = bytes / 64;
+	for (size_t i = 0; i < blocks; ++i, d += 64, s += 64)
+	{
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+		__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+		__m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d), a);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), b);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), c);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), e);
+	}
+	bytes -= blocks * 64;
+
+	memcpy(d, s, bytes);
+
+	// Make the streamed stores visible before the GPU is told to read them.
+	_mm_sfence();
+}
+
+void StreamingCopyStrided(void* dst, size_t dstStride, const void* src, size_t elementBytes, size_t count)
+{
+	auto d = static_cast<std::uint8_t*>(dst);
+	auto s = static_cast<const std::uint8_t*>(src);
+
+	if (((reinterpret_cast<std::uintptr_t>(d) | dstStride) & 15) != 0)
+	{
+		for (size_t i = 0; i < count; ++i, d += dstStride, s += elementBytes)
+		{
+			memcpy(d, s, elementBytes);
+		}
+		return;
+	}
+
+	// Streaming part of a write-combining line and storing the rest normally is
+	// slower than either, so each slot is streamed whole, padding included.
+	const size_t chunks = elementBytes / 16;
+	const size_t tail = elementBytes - chunks * 16;
+	const __m128i zero = _mm_setzero_si128();
+
+	for (size_t i = 0; i < count; ++i, d += dstStride, s += elementBytes)
+	{
+		size_t offset = 0;
+		for (; offset < chunks * 16; offset += 16)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + offset));
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d + offset), v);
+		}
+		if (tail > 0)
+		{
+			alignas(16) std::uint8_t last[16] = {};
+			memcpy(last, s + offset, tail);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d + offset), _mm_load_si128(reinterpret_cast<const __m128i*>(last)));
+			offset += 16;
+		}
+		for (; offset < dstStride; offset += 16)
+		{
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d + offset), zero);
+		}
+	}
+
+	_mm_sfence();
+}
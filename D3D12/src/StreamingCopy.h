@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+
+///<summary>
+/// Copies bytes into write-combined memory (upload heaps) with non-temporal stores,
+/// so large copies fill whole write-combining lines and do not evict the cache.
+/// Ends with a store fence; dst must not be read back.
+///</summary>
+void StreamingCopy(void* dst, const void* src, size_t bytes);
+
+///<summary>
+/// StreamingCopy for count tightly packed elements of elementBytes each into slots
+/// dstStride bytes apart, such as constant buffer elements.  The padding after each
+/// element is zeroed so whole lines are streamed.  One store fence for the range.
+///</summary>
+void StreamingCopyStrided(void* dst, size_t dstStride, const void* src, size_t elementBytes, size_t count);
@@ -0,0 +1,104 @@
+#include "TextureCache.h"
+#include "ContentHash.h"
+
+TextureCache::TextureCache(TextureStreamer& streamer)
+	:streamer(streamer)
+{
+	UINT slotCount = streamer.DescriptorCount();
+	entries.resize(slotCount);
+
+	// Hand out the lowest slots first.
+	for (UINT i = slotCount; i > 0; --i)
+	{
+		freeSlots.push_back(i - 1);
+	}
+}
+
+UINT TextureCache::Acquire(std::vector<uint8_t> ddsData, UploadBatch& batch)
+{
+	std::uint64_t hash = ContentHash(ddsData.data(), ddsData.size());
+	stats.HashedBytes += ddsData.size();
+
+	auto memory = std::make_shared<const std::vector<uint8_t>>(std::move(ddsData));
+	return Acquire(memory->data(), memory->size(), hash, memory, batch);
+}
+
+UINT TextureCache::Acquire(const uint8_t* ddsData, size_t ddsSize, std::uint64_t hash,
+	std::shared_ptr<const void> owner, UploadBatch& batch)
+{
+	auto known = hashes.find(hash);
+	if (known != hashes.end() && entries[known->second].Size == ddsSize)
+	{
+		Entry& e = entries[known->second];
+		e.RefCount++;
+
+		stats.References++;
+		stats.ContentHits++;
+		stats.DuplicateBytesAvoided += e.Size;
+		return known->second;
+	}
+
+	UINT slot = AllocateSlot();
+	Entry& e = entries[slot];
+	e.Hash = hash;
+	e.Size = ddsSize;
+	e.RefCount = 1;
+
+	try
+	{
+		streamer.Add(slot, ddsData, ddsSize, std::move(owner), batch);
+	}
+	catch (...)
+	{
+		entries[slot] = Entry();
+		freeSlots.push_back(slot);
+		throw;
+	}
+
+	if (known == hashes.end())
+	{
+		hashes[hash] = slot;
+	}
+
+	stats.UniqueTextures++;
+	stats.References++;
+	return slot;
+}
+
+void TextureCache::Release(UINT slot)
+{
+	assert(slot < entries.size() && entries[slot].RefCount > 0);
+	Entry& e = entries[slot];
+
+	stats.References--;
+	if (--e.RefCount > 0)
+		return;
+
+	auto known = hashes.find(e.Hash);
+	if (known != hashes.end() && known->second == slot)
+	{
+		hashes.erase(known);
+	}
+
+	streamer.Remove(slot);
+	e = Entry();
+	freeSlots.push_back(slot);
+	stats.UniqueTextures--;
+}
+
+TextureCacheStats TextureCache::GetStats()const
+{
+	return stats;
+}
+
+UINT TextureCache::AllocateSlot()
+{
+	if (freeSlots.empty())
+	{
+		ThrowIfFailed(E_OUTOFMEMORY);
+	}
+
+	UINT slot = freeSlots.back();
+	freeSlots.pop_back();
+	return slot;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "TextureStreamer.h"
+#include <unordered_map>
+
+struct TextureCacheStats
+{
+	UINT UniqueTextures = 0;
+	// Acquires not yet released, over all textures.
+	UINT References = 0;
+	// Acquires answered by a texture with the same contents.
+	UINT ContentHits = 0;
+	// File bytes that did not have to be loaded again because of the hits.
+	UINT64 DuplicateBytesAvoided = 0;
+	// Bytes hashed here; asset pack entries come with their hash.
+	UINT64 HashedBytes = 0;
+};
+
+// Hands out texture slots of a TextureStreamer by DDS contents, loading each distinct
+// texture once.  Textures are identified by a hash of their contents, so the same DDS
+// under another name shares the texture and its descriptor slot.  Slots are
+// reference counted: every Acquire needs a Release, and the last one empties the
+// slot for reuse.
+//
+// Asset pack entries carry the hash taken when the pack was cooked, so from one run
+// to the next textures are shared without reading them.
+class TextureCache
+{
+public:
+	TextureCache(TextureStreamer& streamer);
+	TextureCache(const TextureCache& rhs) = delete;
+	TextureCache& operator=(const TextureCache& rhs) = delete;
+	~TextureCache() = default;
+
+	///<summary>
+	/// Returns the slot holding the DDS file in ddsData, such as a packed texture
+	/// array, adding it to the streamer (with its tail uploaded through batch) unless
+	/// a texture with the same contents is already there.
+	///</summary>
+	UINT Acquire(std::vector<uint8_t> ddsData, UploadBatch& batch);
+
+	///<summary>
+	/// Acquire for a DDS file in memory whose content hash is already known, such as an
+	/// asset pack entry.  owner is kept alive for as long as the texture reads ddsData.
+	///</summary>
+	UINT Acquire(const uint8_t* ddsData, size_t ddsSize, std::uint64_t hash,
+		std::shared_ptr<const void> owner, UploadBatch& batch);
+
+	///<summary>
+	/// Drops one reference to slot, removing the texture with the last one.
+	///</summary>
+	void Release(UINT slot);
+
+	TextureCacheStats GetStats()const;
+
+private:
+	struct Entry
+	{
+		std::uint64_t Hash = 0;
+		UINT64 Size = 0;
+		UINT RefCount = 0;
+	};
+
+	UINT AllocateSlot();
+
+private:
+	TextureStreamer& streamer;
+
+	// indexed by slot; RefCount 0 for free slots
+	std::vector<Entry> entries;
+	std::vector<UINT> freeSlots;
+
+	std::unordered_map<std::uint64_t, UINT> hashes;
+
+	TextureCacheStats stats;
+};
@@ -0,0 +1,572 @@
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	D3D12_SUBRESOURCE_DATA SubresourceData(const DdsImage& image, UINT mip, UINT slice)
+	{
+		DdsSubresource s = image.Subresource(mip, slice);
+
+		D3D12_SUBRESOURCE_DATA data;
+		data.pData = s.Data;
+		data.RowPitch = (LONG_PTR)s.RowPitch;
+		data.SlicePitch = (LONG_PTR)s.SlicePitch;
+		return data;
+	}
+
+	bool IsBlockCompressed(DXGI_FORMAT format)
+	{
+		return (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM) ||
+			(format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+	}
+}
+
+TextureStreamer::TextureStreamer(ID3D12Device* device, ResourceReleaseQueue& releaseQueue, UINT descriptorCount,
+	UINT64 budget, UINT tailSize, UINT workerCount)
+	:device(device), releaseQueue(releaseQueue), budget(budget), tailSize(tailSize)
+{
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = descriptorCount;
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&pDescriptorHeap)));
+	descriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+	textures.resize(descriptorCount);
+	for (UINT i = 0; i < descriptorCount; ++i)
+	{
+		WriteNullDescriptor(i);
+	}
+
+	for (UINT i = 0; i < workerCount; ++i)
+	{
+		workers.emplace_back(&TextureStreamer::WorkerMain, this);
+	}
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	jobReady.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void TextureStreamer::Add(UINT slot, std::vector<uint8_t> ddsData, UploadBatch& batch)
+{
+	auto memory = std::make_shared<const std::vector<uint8_t>>(std::move(ddsData));
+	Add(slot, memory->data(), memory->size(), memory, batch);
+}
+
+void TextureStreamer::Add(UINT slot, const uint8_t* ddsData, size_t ddsSize, std::shared_ptr<const void> owner,
+	UploadBatch& batch)
+{
+	auto source = std::make_shared<Source>();
+	source->Owner = std::move(owner);
+	ThrowIfFailed(source->Image.Parse(ddsData, ddsSize) == DdsResult::Ok ?
+		S_OK : HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+	Add(slot, std::move(source), batch);
+}
+
+void TextureStreamer::Add(UINT slot, std::shared_ptr<Source> source, UploadBatch& batch)
+{
+	assert(slot < textures.size() && textures[slot].Resource == nullptr);
+	StreamedTexture& t = textures[slot];
+
+	if (source->Image.Dimension() != DdsDimension::Texture2D)
+	{
+		ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+	}
+	t.Data = std::move(source);
+
+	// The tail starts at the first mip no larger than tailSize.
+	UINT tail = 0;
+	while (tail + 1 < t.Data->Image.MipCount() &&
+		MathHelper::Max(t.Data->Image.Width() >> tail, t.Data->Image.Height() >> tail) > tailSize)
+	{
+		++tail;
+	}
+	while (!CanStartAt(t.Data->Image, tail))
+	{
+		--tail;
+	}
+	t.TailMip = tail;
+	t.WantedMip = tail;
+
+	D3D12_RESOURCE_DESC desc = TextureDesc(t.Data->Image, tail);
+	Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(&resource)));
+
+	for (UINT slice = 0; slice < t.Data->Image.ArraySize(); ++slice)
+	{
+		for (UINT mip = tail; mip < t.Data->Image.MipCount(); ++mip)
+		{
+			UINT subresource = D3D12CalcSubresource(mip - tail, slice, 0, desc.MipLevels, desc.DepthOrArraySize);
+			batch.AddTextureSubresource(resource.Get(), desc, subresource, SubresourceData(t.Data->Image, mip, slice),
+				D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		}
+	}
+
+	Replace(t, resource, tail, AllocationSize(desc));
+}
+
+void TextureStreamer::Remove(UINT slot)
+{
+	assert(slot < textures.size() && textures[slot].Resource != nullptr);
+	StreamedTexture& t = textures[slot];
+
+	stats.ResidentBytes -= t.ResidentBytes;
+	releaseQueue.Release(std::move(t.Resource));
+	t = StreamedTexture();
+
+	WriteNullDescriptor(slot);
+}
+
+void TextureStreamer::Request(UINT slot, float screenTexels)
+{
+	if (slot >= textures.size() || textures[slot].Resource == nullptr)
+		return;
+
+	StreamedTexture& t = textures[slot];
+
+	// Mip m is (size >> m) texels across, so log2(size / screenTexels) is the mip
+	// that maps one texel to one pixel.
+	UINT mip = t.TailMip;
+	if (screenTexels > 0.0f)
+	{
+		float size = (float)MathHelper::Max(t.Data->Image.Width(), t.Data->Image.Height());
+		float m = floorf(log2f(size / screenTexels));
+		mip = m <= 0.0f ? 0 : MathHelper::Min((UINT)m, t.TailMip);
+	}
+
+	if (t.LastUsedFrame != frame)
+	{
+		t.LastUsedFrame = frame;
+		t.WantedMip = mip;
+	}
+	else
+	{
+		t.WantedMip = MathHelper::Min(t.WantedMip, mip);
+	}
+}
+
+void TextureStreamer::Update(ID3D12GraphicsCommandList* cmdList)
+{
+	std::vector<Result> finished;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished.swap(results);
+	}
+	for (Result& r : finished)
+	{
+		FinishUpload(cmdList, r);
+	}
+
+	// Textures not drawn this frame need no more than their tail.
+	for (StreamedTexture& t : textures)
+	{
+		if (t.LastUsedFrame != frame)
+		{
+			t.WantedMip = t.TailMip;
+		}
+	}
+
+	MakeRoom(cmdList, 0, nullptr);
+
+	// The textures furthest from the detail they want go first.
+	std::vector<UINT> wanted;
+	for (UINT i = 0; i < (UINT)textures.size(); ++i)
+	{
+		const StreamedTexture& t = textures[i];
+		if (t.Resource != nullptr && !t.Pending && t.WantedMip < t.FirstMip)
+		{
+			wanted.push_back(i);
+		}
+	}
+	std::sort(wanted.begin(), wanted.end(), [this](UINT a, UINT b)
+	{
+		return textures[a].FirstMip - textures[a].WantedMip > textures[b].FirstMip - textures[b].WantedMip;
+	});
+
+	for (UINT slot : wanted)
+	{
+		if (stats.PendingUploads >= MaxPendingUploads)
+			break;
+
+		StreamedTexture& t = textures[slot];
+
+		// Bring in as much of the wanted detail as fits, taking memory from textures
+		// that are unused or hold more than they need.  Nothing is evicted until a
+		// target is known to fit, so a detail that does not fit costs no mips.
+		const UINT64 available = budget + t.ResidentBytes + FreeableBytes(&t);
+		UINT target = t.WantedMip;
+		UINT64 bytes = 0;
+		for (; target < t.FirstMip; ++target)
+		{
+			if (!CanStartAt(t.Data->Image, target))
+				continue;
+
+			bytes = AllocationSize(TextureDesc(t.Data->Image, target));
+			if (stats.ResidentBytes + stats.PendingBytes + bytes <= available)
+				break;
+		}
+		if (target >= t.FirstMip)
+			continue;
+
+		MakeRoom(cmdList, bytes, &t);
+
+		Job job;
+		job.Slot = slot;
+		job.Data = t.Data;
+		job.FromMip = t.FirstMip;
+		job.ToMip = target;
+		job.ReservedBytes = bytes;
+
+		t.Pending = true;
+		stats.PendingUploads++;
+		stats.PendingBytes += bytes;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(job);
+		}
+		jobReady.notify_one();
+	}
+
+	++frame;
+}
+
+void TextureStreamer::SetBudget(UINT64 budget)
+{
+	this->budget = budget;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE TextureStreamer::Descriptors()const
+{
+	return pDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+}
+
+UINT TextureStreamer::DescriptorCount()const
+{
+	return (UINT)textures.size();
+}
+
+TextureStreamerStats TextureStreamer::GetStats()const
+{
+	TextureStreamerStats s = stats;
+	s.Budget = budget;
+	return s;
+}
+
+void TextureStreamer::WorkerMain()
+{
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobReady.wait(lock, [this] { return quit || !jobs.empty(); });
+			if (quit)
+				return;
+
+			job = jobs.front();
+			jobs.pop_front();
+		}
+
+		Result r = Load(job);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		results.push_back(std::move(r));
+	}
+}
+
+TextureStreamer::Result TextureStreamer::Load(const Job& job)const
+{
+	const DdsImage& image = job.Data->Image;
+
+	Result r;
+	r.Request = job;
+	try
+	{
+		D3D12_RESOURCE_DESC desc = TextureDesc(image, job.ToMip);
+		ThrowIfFailed(device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(&r.Resource)));
+		r.Bytes = AllocationSize(desc);
+
+		// Only the new mips come from the file; the resident ones are copied on the GPU.
+		r.Batch = std::make_unique<UploadBatch>();
+		for (UINT slice = 0; slice < image.ArraySize(); ++slice)
+		{
+			for (UINT mip = job.ToMip; mip < job.FromMip; ++mip)
+			{
+				UINT subresource = D3D12CalcSubresource(mip - job.ToMip, slice, 0, desc.MipLevels, desc.DepthOrArraySize);
+				r.Batch->AddTextureSubresource(r.Resource.Get(), desc, subresource, SubresourceData(image, mip, slice),
+					D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+			}
+		}
+
+		// Packing reads the mapped file, so the page faults happen here rather than on
+		// the render thread.
+		r.Staging = r.Batch->CreateStaging(device);
+	}
+	catch (...)
+	{
+		// Out of memory or a lost device: the texture keeps the mips it has.
+		r.Resource = nullptr;
+		r.Staging = nullptr;
+	}
+	return r;
+}
+
+void TextureStreamer::FinishUpload(ID3D12GraphicsCommandList* cmdList, Result& result)
+{
+	StreamedTexture& t = textures[result.Request.Slot];
+
+	stats.PendingUploads--;
+	stats.PendingBytes -= result.Request.ReservedBytes;
+
+	// The slot was emptied, and maybe refilled, while the job ran.
+	if (t.Data != result.Request.Data)
+		return;
+
+	t.Pending = false;
+	if (result.Resource == nullptr)
+		return;
+
+	// Pending textures are never evicted, so the resident mips are still the ones the
+	// job started from.
+	assert(t.FirstMip == result.Request.FromMip);
+
+	CopyResidentMips(cmdList, t, result.Resource.Get(), result.Request.ToMip);
+	result.Batch->Record(cmdList, result.Staging.Get(), 0);
+	releaseQueue.Release(result.Staging);
+
+	stats.MipsStreamedIn += result.Request.FromMip - result.Request.ToMip;
+	Replace(t, result.Resource, result.Request.ToMip, result.Bytes);
+}
+
+void TextureStreamer::Evict(ID3D12GraphicsCommandList* cmdList, StreamedTexture& t)
+{
+	UINT first = NextStartMip(t, t.FirstMip);
+
+	D3D12_RESOURCE_DESC desc = TextureDesc(t.Data->Image, first);
+	Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&resource)));
+
+	CopyResidentMips(cmdList, t, resource.Get(), first);
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(resource.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+	stats.MipsEvicted += first - t.FirstMip;
+	Replace(t, resource, first, AllocationSize(desc));
+}
+
+bool TextureStreamer::MakeRoom(ID3D12GraphicsCommandList* cmdList, UINT64 bytes, const StreamedTexture* keep)
+{
+	// bytes is the size keep will have, so its current size is already counted.
+	UINT64 freed = keep != nullptr ? keep->ResidentBytes : 0;
+
+	while (stats.ResidentBytes + stats.PendingBytes + bytes > budget + freed)
+	{
+		StreamedTexture* victim = PickVictim(keep);
+		if (victim == nullptr)
+			return false;
+
+		Evict(cmdList, *victim);
+	}
+	return true;
+}
+
+TextureStreamer::StreamedTexture* TextureStreamer::PickVictim(const StreamedTexture* keep)
+{
+	StreamedTexture* victim = nullptr;
+	for (StreamedTexture& t : textures)
+	{
+		if (!CanEvict(t, t.FirstMip, keep))
+			continue;
+
+		if (victim == nullptr || t.LastUsedFrame < victim->LastUsedFrame)
+		{
+			victim = &t;
+		}
+	}
+	return victim;
+}
+
+UINT64 TextureStreamer::FreeableBytes(const StreamedTexture* keep)const
+{
+	// PickVictim takes a mip at a time from the same texture for as long as it may.
+	UINT64 freeable = 0;
+	for (const StreamedTexture& t : textures)
+	{
+		UINT first = t.FirstMip;
+		while (CanEvict(t, first, keep))
+		{
+			first = NextStartMip(t, first);
+		}
+		if (first != t.FirstMip)
+		{
+			freeable += t.ResidentBytes - AllocationSize(TextureDesc(t.Data->Image, first));
+		}
+	}
+	return freeable;
+}
+
+bool TextureStreamer::CanEvict(const StreamedTexture& t, UINT firstMip, const StreamedTexture* keep)const
+{
+	if (&t == keep || t.Resource == nullptr || t.Pending || firstMip >= t.TailMip)
+		return false;
+
+	// Textures drawn this frame only give up mips they do not need.
+	return t.LastUsedFrame != frame || NextStartMip(t, firstMip) <= t.WantedMip;
+}
+
+void TextureStreamer::CopyResidentMips(ID3D12GraphicsCommandList* cmdList, StreamedTexture& t,
+	ID3D12Resource* dest, UINT destFirstMip)
+{
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(t.Resource.Get(),
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE));
+
+	const UINT mipCount = t.Data->Image.MipCount();
+	const UINT arraySize = t.Data->Image.ArraySize();
+	for (UINT slice = 0; slice < arraySize; ++slice)
+	{
+		for (UINT mip = MathHelper::Max(t.FirstMip, destFirstMip); mip < mipCount; ++mip)
+		{
+			CD3DX12_TEXTURE_COPY_LOCATION dst(dest,
+				D3D12CalcSubresource(mip - destFirstMip, slice, 0, mipCount - destFirstMip, arraySize));
+			CD3DX12_TEXTURE_COPY_LOCATION src(t.Resource.Get(),
+				D3D12CalcSubresource(mip - t.FirstMip, slice, 0, mipCount - t.FirstMip, arraySize));
+			cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+		}
+	}
+}
+
+void TextureStreamer::Replace(StreamedTexture& t, Microsoft::WRL::ComPtr<ID3D12Resource> resource,
+	UINT firstMip, UINT64 bytes)
+{
+	// Frames in flight may still sample the old texture.
+	if (t.Resource != nullptr)
+	{
+		releaseQueue.Release(std::move(t.Resource));
+	}
+
+	stats.ResidentBytes = stats.ResidentBytes - t.ResidentBytes + bytes;
+	t.Resource = std::move(resource);
+	t.ResidentBytes = bytes;
+	t.FirstMip = firstMip;
+
+	WriteDescriptor((UINT)(&t - textures.data()));
+}
+
+void TextureStreamer::WriteDescriptor(UINT slot)
+{
+	const StreamedTexture& t = textures[slot];
+	const UINT mipLevels = t.Data->Image.MipCount() - t.FirstMip;
+	const UINT arraySize = t.Data->Image.ArraySize();
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = t.Data->Image.Format();
+
+	if (t.Data->Image.IsCubeMap() && arraySize == 6)
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCube.MostDetailedMip = 0;
+		srvDesc.TextureCube.MipLevels = mipLevels;
+		srvDesc.TextureCube.ResourceMinLODClamp = 0.0f;
+	}
+	else if (t.Data->Image.IsCubeMap())
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBEARRAY;
+		srvDesc.TextureCubeArray.MostDetailedMip = 0;
+		srvDesc.TextureCubeArray.MipLevels = mipLevels;
+		srvDesc.TextureCubeArray.First2DArrayFace = 0;
+		srvDesc.TextureCubeArray.NumCubes = arraySize / 6;
+	}
+	else
+	{
+		// Single textures are one-slice arrays, so the shaders index packed arrays and
+		// lone textures alike.
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = mipLevels;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = arraySize;
+	}
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(pDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), slot, descriptorSize);
+	device->CreateShaderResourceView(t.Resource.Get(), &srvDesc, hDescriptor);
+}
+
+void TextureStreamer::WriteNullDescriptor(UINT slot)
+{
+	// Empty slots read as black rather than whatever the heap held.
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MipLevels = 1;
+	srvDesc.Texture2DArray.ArraySize = 1;
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(pDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), slot, descriptorSize);
+	device->CreateShaderResourceView(nullptr, &srvDesc, hDescriptor);
+}
+
+UINT TextureStreamer::NextStartMip(const StreamedTexture& t, UINT firstMip)const
+{
+	UINT mip = firstMip + 1;
+	while (mip < t.TailMip && !CanStartAt(t.Data->Image, mip))
+	{
+		++mip;
+	}
+	return mip;
+}
+
+D3D12_RESOURCE_DESC TextureStreamer::TextureDesc(const DdsImage& image, UINT firstMip)const
+{
+	return CD3DX12_RESOURCE_DESC::Tex2D(image.Format(),
+		MathHelper::Max<UINT64>(1, image.Width() >> firstMip),
+		MathHelper::Max<UINT>(1, image.Height() >> firstMip),
+		(UINT16)image.ArraySize(),
+		(UINT16)(image.MipCount() - firstMip));
+}
+
+UINT64 TextureStreamer::AllocationSize(const D3D12_RESOURCE_DESC& desc)const
+{
+	return device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+}
+
+bool TextureStreamer::CanStartAt(const DdsImage& image, UINT mip)
+{
+	// Block-compressed textures need their top mip to be whole blocks.
+	if (mip == 0 || !IsBlockCompressed(image.Format()))
+		return true;
+
+	return (image.Width() >> mip) % 4 == 0 && (image.Height() >> mip) % 4 == 0 &&
+		(image.Width() >> mip) > 0 && (image.Height() >> mip) > 0;
+}
@@ -0,0 +1,183 @@
+#pragma once
+#include "Common/d3dUtil.h"
+#include "Common/DdsImage.h"
+#include "DeferredReleaseQueue.h"
+#include "UploadBatch.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+struct TextureStreamerStats
+{
+	UINT64 Budget = 0;
+	UINT64 ResidentBytes = 0;
+	// Bytes reserved for uploads still on the workers.
+	UINT64 PendingBytes = 0;
+	UINT PendingUploads = 0;
+	// Mip levels brought in and dropped since startup, per texture.
+	UINT MipsStreamedIn = 0;
+	UINT MipsEvicted = 0;
+};
+
+// Keeps DDS textures in video memory at the detail the scene needs, within a
+// budget.  Add creates a texture with only its mip tail (the mips no larger than
+// tailSize), which is cheap to load up front.  Every frame the app reports how many
+// texels each texture spans on screen; Update then has worker threads create a
+// texture with the missing larger mips and pack them into a staging buffer straight
+// from the mapped file, and records the copies once they are ready.  While the
+// resident textures exceed the budget, the least recently used ones lose their
+// largest mip.
+//
+// Resident mips never leave their texture in place: a texture with more or fewer
+// mips replaces it, the resident ones are copied over on the GPU, and the old one
+// goes to the release queue.  Its SRV is rewritten in a CPU-only descriptor heap, so
+// copy Descriptors() into the shader-visible heap each frame instead of binding
+// descriptors that frames in flight may still read.
+class TextureStreamer
+{
+public:
+	///<summary>
+	/// descriptorCount is the number of texture slots, which are also the descriptor
+	/// indices the shaders use.
+	///</summary>
+	TextureStreamer(ID3D12Device* device, ResourceReleaseQueue& releaseQueue, UINT descriptorCount,
+		UINT64 budget, UINT tailSize = 64, UINT workerCount = 2);
+	TextureStreamer(const TextureStreamer& rhs) = delete;
+	TextureStreamer& operator=(const TextureStreamer& rhs) = delete;
+	~TextureStreamer();
+
+	///<summary>
+	/// Creates a 2D, array or cube DDS texture built in memory, such as a texture array
+	/// packed at load time, with its mip tail in slot and queues the tail's upload in batch.
+	///</summary>
+	void Add(UINT slot, std::vector<uint8_t> ddsData, UploadBatch& batch);
+
+	///<summary>
+	/// Add for a DDS file in memory owned elsewhere, such as an entry of a mapped asset
+	/// pack.  The streamer keeps owner alive for as long as it reads ddsData.
+	///</summary>
+	void Add(UINT slot, const uint8_t* ddsData, size_t ddsSize, std::shared_ptr<const void> owner, UploadBatch& batch);
+
+	///<summary>
+	/// Empties slot, whose texture is released once frames in flight are done with it.
+	/// An upload still on a worker is dropped when it comes back, so the slot can be
+	/// reused right away.
+	///</summary>
+	void Remove(UINT slot);
+
+	///<summary>
+	/// Reports that the texture in slot is drawn screenTexels pixels across, counting
+	/// one repeat of it.  Call for every use each frame before Update; slots without a
+	/// texture are ignored.
+	///</summary>
+	void Request(UINT slot, float screenTexels);
+
+	///<summary>
+	/// Records the uploads the workers have finished, evicts least recently used mips
+	/// while over budget and starts uploads for textures that want more detail.
+	///</summary>
+	void Update(ID3D12GraphicsCommandList* cmdList);
+
+	void SetBudget(UINT64 budget);
+
+	///<summary>
+	/// CPU-only descriptors of all slots, null SRVs for empty ones.
+	///</summary>
+	D3D12_CPU_DESCRIPTOR_HANDLE Descriptors()const;
+	UINT DescriptorCount()const;
+
+	TextureStreamerStats GetStats()const;
+
+private:
+	// Whatever owns the DDS file in memory and its parsed image, shared with the jobs
+	// reading from them.
+	struct Source
+	{
+		std::shared_ptr<const void> Owner;
+		DdsImage Image;
+	};
+
+	struct StreamedTexture
+	{
+		std::shared_ptr<const Source> Data;
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		UINT64 ResidentBytes = 0;
+
+		// The texture holds mips FirstMip to the last; TailMip is always resident.
+		UINT FirstMip = 0;
+		UINT TailMip = 0;
+		// Most detailed mip asked for in the last frame it was used.
+		UINT WantedMip = 0;
+		UINT64 LastUsedFrame = 0;
+		bool Pending = false;
+	};
+
+	struct Job
+	{
+		UINT Slot = 0;
+		std::shared_ptr<const Source> Data;
+		UINT FromMip = 0;
+		UINT ToMip = 0;
+		UINT64 ReservedBytes = 0;
+	};
+
+	struct Result
+	{
+		Job Request;
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		Microsoft::WRL::ComPtr<ID3D12Resource> Staging;
+		std::unique_ptr<UploadBatch> Batch;
+		UINT64 Bytes = 0;
+	};
+
+	void Add(UINT slot, std::shared_ptr<Source> source, UploadBatch& batch);
+
+	void WorkerMain();
+	Result Load(const Job& job)const;
+
+	void FinishUpload(ID3D12GraphicsCommandList* cmdList, Result& result);
+	void Evict(ID3D12GraphicsCommandList* cmdList, StreamedTexture& t);
+	bool MakeRoom(ID3D12GraphicsCommandList* cmdList, UINT64 bytes, const StreamedTexture* keep);
+	StreamedTexture* PickVictim(const StreamedTexture* keep);
+	UINT64 FreeableBytes(const StreamedTexture* keep)const;
+	bool CanEvict(const StreamedTexture& t, UINT firstMip, const StreamedTexture* keep)const;
+
+	void CopyResidentMips(ID3D12GraphicsCommandList* cmdList, StreamedTexture& t,
+		ID3D12Resource* dest, UINT destFirstMip);
+	void Replace(StreamedTexture& t, Microsoft::WRL::ComPtr<ID3D12Resource> resource, UINT firstMip, UINT64 bytes);
+	void WriteDescriptor(UINT slot);
+	void WriteNullDescriptor(UINT slot);
+	UINT NextStartMip(const StreamedTexture& t, UINT firstMip)const;
+
+	D3D12_RESOURCE_DESC TextureDesc(const DdsImage& image, UINT firstMip)const;
+	UINT64 AllocationSize(const D3D12_RESOURCE_DESC& desc)const;
+	static bool CanStartAt(const DdsImage& image, UINT mip);
+
+private:
+	ID3D12Device* device = nullptr;
+	ResourceReleaseQueue& releaseQueue;
+
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> pDescriptorHeap;
+	UINT descriptorSize = 0;
+
+	// indexed by slot
+	std::vector<StreamedTexture> textures;
+
+	UINT64 budget = 0;
+	UINT tailSize = 0;
+	UINT64 frame = 1;
+	TextureStreamerStats stats;
+
+	// Bounds the staging memory held by uploads in flight.
+	static const UINT MaxPendingUploads = 4;
+
+	// Jobs go to the workers and results come back under the mutex; the workers only
+	// read the sources their jobs hold, which do not change after Add.
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable jobReady;
+	std::deque<Job> jobs;
+	std::vector<Result> results;
+	bool quit = false;
+};
@@ -0,0 +1,279 @@
+#include "TlsfAllocator.h"
+#include <bit>
+#include <cassert>
+
+TlsfAllocator::TlsfAllocator(std::uint64_t capacity, std::uint64_t granularity)
+	:granularity(granularity)
+{
+	assert(granularity != 0 && (granularity & (granularity - 1)) == 0);
+	granularityLog2 = (std::uint32_t)std::countr_zero(granularity);
+
+	for (auto& heads : freeHeads)
+	{
+		for (std::uint32_t& head : heads)
+		{
+			head = NoBlock;
+		}
+	}
+
+	std::uint64_t units = capacity >> granularityLog2;
+	this->capacity = units << granularityLog2;
+
+	if (units > 0)
+	{
+		std::uint32_t b = NewBlock();
+		blocks[b].Offset = 0;
+		blocks[b].Size = units;
+		InsertFree(b);
+	}
+}
+
+std::uint64_t TlsfAllocator::Allocate(std::uint64_t size)
+{
+	std::uint64_t units = size == 0 ? 1 : ((size - 1) >> granularityLog2) + 1;
+
+	std::uint32_t b = FindFreeBlock(units);
+	if (b == NoBlock)
+		return InvalidOffset;
+
+	RemoveFree(b);
+
+	// Give the tail back as a new free block.
+	if (blocks[b].Size > units)
+	{
+		std::uint32_t rest = NewBlock();
+		blocks[rest].Offset = blocks[b].Offset + units;
+		blocks[rest].Size = blocks[b].Size - units;
+		blocks[rest].PrevPhysical = b;
+		blocks[rest].NextPhysical = blocks[b].NextPhysical;
+		if (blocks[rest].NextPhysical != NoBlock)
+		{
+			blocks[blocks[rest].NextPhysical].PrevPhysical = rest;
+		}
+		blocks[b].NextPhysical = rest;
+		blocks[b].Size = units;
+		InsertFree(rest);
+	}
+
+	std::uint64_t offset = blocks[b].Offset << granularityLog2;
+	allocations[offset] = b;
+	return offset;
+}
+
+void TlsfAllocator::Free(std::uint64_t offset)
+{
+	auto it = allocations.find(offset);
+	assert(it != allocations.end());
+	std::uint32_t b = it->second;
+	allocations.erase(it);
+
+	// Merge with the free neighbours so free space never stays split.
+	std::uint32_t prev = blocks[b].PrevPhysical;
+	if (prev != NoBlock && blocks[prev].Free)
+	{
+		RemoveFree(prev);
+		blocks[prev].Size += blocks[b].Size;
+		blocks[prev].NextPhysical = blocks[b].NextPhysical;
+		if (blocks[b].NextPhysical != NoBlock)
+		{
+			blocks[blocks[b].NextPhysical].PrevPhysical = prev;
+		}
+		DeleteBlock(b);
+		b = prev;
+	}
+
+	std::uint32_t next = blocks[b].NextPhysical;
+	if (next != NoBlock && blocks[next].Free)
+	{
+		RemoveFree(next);
+		blocks[b].Size += blocks[next].Size;
+		blocks[b].NextPhysical = blocks[next].NextPhysical;
+		if (blocks[next].NextPhysical != NoBlock)
+		{
+			blocks[blocks[next].NextPhysical].PrevPhysical = b;
+		}
+		DeleteBlock(next);
+	}
+
+	InsertFree(b);
+}
+
+std::uint64_t TlsfAllocator::AllocationSize(std::uint64_t offset)const
+{
+	auto it = allocations.find(offset);
+	assert(it != allocations.end());
+	return blocks[it->second].Size << granularityLog2;
+}
+
+std::uint64_t TlsfAllocator::Capacity()const
+{
+	return capacity;
+}
+
+std::uint64_t TlsfAllocator::Granularity()const
+{
+	return granularity;
+}
+
+std::uint32_t TlsfAllocator::AllocationCount()const
+{
+	return (std::uint32_t)allocations.size();
+}
+
+TlsfAllocator::Stats TlsfAllocator::GetStats()const
+{
+	Stats stats;
+	stats.Capacity = capacity;
+	stats.FreeBytes = freeUnits << granularityLog2;
+	stats.AllocationCount = AllocationCount();
+	stats.FreeBlockCount = freeBlockCount;
+
+	// The largest block is in the highest non-empty bin, which spans a range of sizes.
+	if (firstLevelBitmap != 0)
+	{
+		std::uint32_t fl = 63 - (std::uint32_t)std::countl_zero(firstLevelBitmap);
+		std::uint32_t sl = 31 - (std::uint32_t)std::countl_zero(secondLevelBitmaps[fl]);
+
+		std::uint64_t largest = 0;
+		for (std::uint32_t b = freeHeads[fl][sl]; b != NoBlock; b = blocks[b].NextFree)
+		{
+			largest = blocks[b].Size > largest ? blocks[b].Size : largest;
+		}
+		stats.LargestFreeBlock = largest << granularityLog2;
+	}
+
+	return stats;
+}
+
+void TlsfAllocator::Mapping(std::uint64_t units, std::uint32_t& fl, std::uint32_t& sl)
+{
+	// Sizes below SecondLevelCount units get one exact bin each; above that, each
+	// power of two is split into SecondLevelCount bins.
+	if (units < SecondLevelCount)
+	{
+		fl = 0;
+		sl = (std::uint32_t)units;
+	}
+	else
+	{
+		std::uint32_t log2 = 63 - (std::uint32_t)std::countl_zero(units);
+		fl = log2 - (SecondLevelLog2 - 1);
+		sl = (std::uint32_t)(units >> (log2 - SecondLevelLog2)) - SecondLevelCount;
+	}
+}
+
+std::uint32_t TlsfAllocator::FindFreeBlock(std::uint64_t units)const
+{
+	// Round up to the next bin boundary, so that every block in the bin found fits.
+	std::uint64_t rounded = units;
+	if (units >= SecondLevelCount)
+	{
+		std::uint32_t log2 = 63 - (std::uint32_t)std::countl_zero(units);
+		rounded += (1ull << (log2 - SecondLevelLog2)) - 1;
+	}
+
+	std::uint32_t fl, sl;
+	Mapping(rounded, fl, sl);
+
+	std::uint32_t slMap = secondLevelBitmaps[fl] & (~0u << sl);
+	if (slMap == 0)
+	{
+		std::uint64_t flMap = fl + 1 < FirstLevelCount ? firstLevelBitmap & (~0ull << (fl + 1)) : 0;
+		if (flMap != 0)
+		{
+			fl = (std::uint32_t)std::countr_zero(flMap);
+			slMap = secondLevelBitmaps[fl];
+		}
+	}
+	if (slMap != 0)
+	{
+		return freeHeads[fl][(std::uint32_t)std::countr_zero(slMap)];
+	}
+
+	// Nothing larger is free; a block in the request's own bin may still fit.  This
+	// matters for requests close to the capacity.
+	Mapping(units, fl, sl);
+	for (std::uint32_t b = freeHeads[fl][sl]; b != NoBlock; b = blocks[b].NextFree)
+	{
+		if (blocks[b].Size >= units)
+			return b;
+	}
+	return NoBlock;
+}
+
+void TlsfAllocator::InsertFree(std::uint32_t block)
+{
+	std::uint32_t fl, sl;
+	Mapping(blocks[block].Size, fl, sl);
+
+	Block& b = blocks[block];
+	b.Free = true;
+	b.PrevFree = NoBlock;
+	b.NextFree = freeHeads[fl][sl];
+	if (b.NextFree != NoBlock)
+	{
+		blocks[b.NextFree].PrevFree = block;
+	}
+	freeHeads[fl][sl] = block;
+
+	firstLevelBitmap |= 1ull << fl;
+	secondLevelBitmaps[fl] |= 1u << sl;
+
+	freeUnits += b.Size;
+	freeBlockCount++;
+}
+
+void TlsfAllocator::RemoveFree(std::uint32_t block)
+{
+	std::uint32_t fl, sl;
+	Mapping(blocks[block].Size, fl, sl);
+
+	Block& b = blocks[block];
+	if (b.PrevFree != NoBlock)
+	{
+		blocks[b.PrevFree].NextFree = b.NextFree;
+	}
+	else
+	{
+		freeHeads[fl][sl] = b.NextFree;
+	}
+	if (b.NextFree != NoBlock)
+	{
+		blocks[b.NextFree].PrevFree = b.PrevFree;
+	}
+
+	if (freeHeads[fl][sl] == NoBlock)
+	{
+		secondLevelBitmaps[fl] &= ~(1u << sl);
+		if (secondLevelBitmaps[fl] == 0)
+		{
+			firstLevelBitmap &= ~(1ull << fl);
+		}
+	}
+
+	b.Free = false;
+	b.PrevFree = NoBlock;
+	b.NextFree = NoBlock;
+
+	freeUnits -= b.Size;
+	freeBlockCount--;
+}
+
+std::uint32_t TlsfAllocator::NewBlock()
+{
+	if (!unusedBlocks.empty())
+	{
+		std::uint32_t b = unusedBlocks.back();
+		unusedBlocks.pop_back();
+		blocks[b] = Block();
+		return b;
+	}
+
+	blocks.emplace_back();
+	return (std::uint32_t)blocks.size() - 1;
+}
+
+void TlsfAllocator::DeleteBlock(std::uint32_t block)
+{
+	unusedBlocks.push_back(block);
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Two-level segregated fit allocator over a range of offsets.  Free blocks are
+// binned by size class (a power of two, split into 16 linear steps); two bitmaps
+// find a fitting non-empty bin in constant time, and freed blocks merge with their
+// free neighbours immediately.  Every offset and size is a multiple of the
+// granularity.  Knows nothing about the memory itself, so it can be exercised
+// without a device.
+class TlsfAllocator
+{
+public:
+	static const std::uint64_t InvalidOffset = UINT64_MAX;
+
+	struct Stats
+	{
+		std::uint64_t Capacity = 0;
+		std::uint64_t FreeBytes = 0;
+		std::uint64_t LargestFreeBlock = 0;
+		std::uint32_t AllocationCount = 0;
+		std::uint32_t FreeBlockCount = 0;
+
+		///<summary>
+		/// 0 when all free space is one block, approaching 1 as it splits into many
+		/// small ones.
+		///</summary>
+		float Fragmentation()const
+		{
+			return FreeBytes == 0 ? 0.0f : 1.0f - (float)LargestFreeBlock / (float)FreeBytes;
+		}
+	};
+
+	///<summary>
+	/// granularity must be a power of two; capacity is rounded down to a multiple of it.
+	///</summary>
+	explicit TlsfAllocator(std::uint64_t capacity = 0, std::uint64_t granularity = 256);
+
+	///<summary>
+	/// Returns the offset of size bytes, or InvalidOffset if no free block is large
+	/// enough.  The offset is aligned to the granularity.
+	///</summary>
+	std::uint64_t Allocate(std::uint64_t size);
+
+	///<summary>
+	/// Frees an offset returned by Allocate.
+	///</summary>
+	void Free(std::uint64_t offset);
+
+	///<summary>
+	/// Size of the allocation at offset, rounded up to the granularity.
+	///</summary>
+	std::uint64_t AllocationSize(std::uint64_t offset)const;
+
+	std::uint64_t Capacity()const;
+	std::uint64_t Granularity()const;
+	std::uint32_t AllocationCount()const;
+	Stats GetStats()const;
+
+private:
+	static const std::uint32_t SecondLevelLog2 = 4;
+	static const std::uint32_t SecondLevelCount = 1 << SecondLevelLog2;
+	static const std::uint32_t FirstLevelCount = 64;
+	static const std::uint32_t NoBlock = UINT32_MAX;
+
+	struct Block
+	{
+		std::uint64_t Offset = 0;
+		std::uint64_t Size = 0;
+		std::uint32_t PrevPhysical = NoBlock;
+		std::uint32_t NextPhysical = NoBlock;
+		std::uint32_t PrevFree = NoBlock;
+		std::uint32_t NextFree = NoBlock;
+		bool Free = false;
+	};
+
+	static void Mapping(std::uint64_t units, std::uint32_t& fl, std::uint32_t& sl);
+
+	std::uint32_t FindFreeBlock(std::uint64_t units)const;
+	void InsertFree(std::uint32_t block);
+	void RemoveFree(std::uint32_t block);
+	std::uint32_t NewBlock();
+	void DeleteBlock(std::uint32_t block);
+
+private:
+	std::uint64_t capacity = 0;
+	std::uint64_t granularity = 0;
+	std::uint32_t granularityLog2 = 0;
+
+	// Sizes inside blocks are in units of the granularity.
+	std::vector<Block> blocks;
+	std::vector<std::uint32_t> unusedBlocks;
+
+	std::uint64_t firstLevelBitmap = 0;
+	std::uint32_t secondLevelBitmaps[FirstLevelCount] = {};
+	std::uint32_t freeHeads[FirstLevelCount][SecondLevelCount];
+
+	// Allocated offset -> block.
+	std::unordered_map<std::uint64_t, std::uint32_t> allocations;
+	std::uint64_t freeUnits = 0;
+	std::uint32_t freeBlockCount = 0;
+};
@@ -0,0 +1,226 @@
+#include "TransformStore.h"
+#include "FrameResource.h"
+
+using namespace DirectX;
+
+void TransformStore::Reserve(UINT capacity)
+{
+	worlds.reserve(capacity);
+	texTransforms.reserve(capacity);
+	materialIndices.reserve(capacity);
+	denseToSlot.reserve(capacity);
+
+	slotToDense.reserve(capacity);
+	slotGenerations.reserve(capacity);
+}
+
+TransformHandle TransformStore::Add(const XMFLOAT4X4& world, const XMFLOAT4X4& texTransform, UINT materialIndex,
+	ObjectMotion motion)
+{
+	UINT slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		slot = (UINT)slotToDense.size();
+		slotToDense.push_back(UINT_MAX);
+		slotGenerations.push_back(0);
+	}
+
+	UINT dense = (UINT)worlds.size();
+	slotToDense[slot] = dense;
+
+	worlds.push_back(XMFLOAT4X4A(&world.m[0][0]));
+	texTransforms.push_back(XMFLOAT4X4A(&texTransform.m[0][0]));
+	materialIndices.push_back(materialIndex);
+	denseToSlot.push_back(slot);
+
+	if (motion == ObjectMotion::Static)
+	{
+		// Move the first dynamic object to the back to make room at the end of the static range.
+		SwapDense(dense, staticCount);
+		staticCount++;
+		staticDirty = true;
+	}
+
+	TransformHandle h;
+	h.Slot = slot;
+	h.Generation = slotGenerations[slot];
+	return h;
+}
+
+TransformHandle TransformStore::Add(FXMMATRIX world, CXMMATRIX texTransform, UINT materialIndex, ObjectMotion motion)
+{
+	XMFLOAT4X4 w, t;
+	XMStoreFloat4x4(&w, world);
+	XMStoreFloat4x4(&t, texTransform);
+	return Add(w, t, materialIndex, motion);
+}
+
+void TransformStore::Remove(TransformHandle h)
+{
+	UINT dense = Dense(h);
+
+	// Keep both ranges dense.  A static hole is filled by the last static object,
+	// which leaves the hole at the boundary to be filled by the last dynamic object.
+	if (dense < staticCount)
+	{
+		SwapDense(dense, staticCount - 1);
+		dense = staticCount - 1;
+		staticCount--;
+		staticDirty = true;
+	}
+	SwapDense(dense, Count() - 1);
+
+	worlds.pop_back();
+	texTransforms.pop_back();
+	materialIndices.pop_back();
+	denseToSlot.pop_back();
+
+	slotToDense[h.Slot] = UINT_MAX;
+	slotGenerations[h.Slot]++;
+	freeSlots.push_back(h.Slot);
+}
+
+bool TransformStore::IsValid(TransformHandle h)const
+{
+	return h.Slot < slotToDense.size() &&
+		slotGenerations[h.Slot] == h.Generation &&
+		slotToDense[h.Slot] != UINT_MAX;
+}
+
+UINT TransformStore::Count()const
+{
+	return (UINT)worlds.size();
+}
+
+UINT TransformStore::StaticCount()const
+{
+	return staticCount;
+}
+
+UINT TransformStore::DynamicCount()const
+{
+	return Count() - staticCount;
+}
+
+bool TransformStore::IsStatic(TransformHandle h)const
+{
+	return Dense(h) < staticCount;
+}
+
+UINT TransformStore::ObjectIndex(TransformHandle h)const
+{
+	UINT dense = Dense(h);
+	return dense < staticCount ? dense : (dense - staticCount) | DynamicObjectBit;
+}
+
+const XMFLOAT4X4A& TransformStore::GetWorld(TransformHandle h)const
+{
+	return worlds[Dense(h)];
+}
+
+const XMFLOAT4X4A& TransformStore::GetTexTransform(TransformHandle h)const
+{
+	return texTransforms[Dense(h)];
+}
+
+UINT TransformStore::GetMaterialIndex(TransformHandle h)const
+{
+	return materialIndices[Dense(h)];
+}
+
+void TransformStore::SetWorld(TransformHandle h, const XMFLOAT4X4& world)
+{
+	worlds[Dense(h)] = XMFLOAT4X4A(&world.m[0][0]);
+	MarkDirty(h);
+}
+
+void TransformStore::SetTexTransform(TransformHandle h, const XMFLOAT4X4& texTransform)
+{
+	texTransforms[Dense(h)] = XMFLOAT4X4A(&texTransform.m[0][0]);
+	MarkDirty(h);
+}
+
+void TransformStore::SetMaterialIndex(TransformHandle h, UINT materialIndex)
+{
+	materialIndices[Dense(h)] = materialIndex;
+	MarkDirty(h);
+}
+
+XMFLOAT4X4A* TransformStore::Worlds()
+{
+	return worlds.data();
+}
+
+XMFLOAT4X4A* TransformStore::TexTransforms()
+{
+	return texTransforms.data();
+}
+
+void TransformStore::MarkDirty(TransformHandle h)
+{
+	// Dynamic objects are written every frame anyway.
+	if (IsStatic(h))
+	{
+		staticDirty = true;
+	}
+}
+
+bool TransformStore::StaticDirty()const
+{
+	return staticDirty;
+}
+
+void TransformStore::WriteStatic(ObjectData* dst)
+{
+	WriteObjectData(0, staticCount, dst);
+	staticDirty = false;
+}
+
+void TransformStore::WriteDynamic(ObjectData* dst)const
+{
+	WriteObjectData(staticCount, DynamicCount(), dst);
+}
+
+void TransformStore::WriteObjectData(UINT first, UINT count, ObjectData* dst)const
+{
+	// Upload heaps are write-combined: write each element front to back and never read it.
+	for (UINT i = first; i < first + count; ++i, ++dst)
+	{
+		// The last row of the transpose is always (0, 0, 0, 1) and is not stored.
+		XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4A(&worlds[i]));
+		XMMATRIX texTransform = XMMatrixTranspose(XMLoadFloat4x4A(&texTransforms[i]));
+
+		XMStoreFloat4(&dst->World[0], world.r[0]);
+		XMStoreFloat4(&dst->World[1], world.r[1]);
+		XMStoreFloat4(&dst->World[2], world.r[2]);
+		XMStoreFloat4(&dst->TexTransform[0], texTransform.r[0]);
+		XMStoreFloat4(&dst->TexTransform[1], texTransform.r[1]);
+		XMStoreFloat4(&dst->TexTransform[2], texTransform.r[2]);
+		dst->MaterialIndex = materialIndices[i];
+	}
+}
+
+UINT TransformStore::Dense(TransformHandle h)const
+{
+	assert(IsValid(h));
+	return slotToDense[h.Slot];
+}
+
+void TransformStore::SwapDense(UINT a, UINT b)
+{
+	if (a == b)
+		return;
+
+	std::swap(worlds[a], worlds[b]);
+	std::swap(texTransforms[a], texTransforms[b]);
+	std::swap(materialIndices[a], materialIndices[b]);
+	std::swap(denseToSlot[a], denseToSlot[b]);
+
+	slotToDense[denseToSlot[a]] = a;
+	slotToDense[denseToSlot[b]] = b;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "Common/d3dUtil.h"
+
+struct ObjectData;
+
+// Stable reference to an object in a TransformStore.  The slot never moves;
+// the generation detects use after Remove.
+struct TransformHandle
+{
+	UINT Slot = UINT_MAX;
+	UINT Generation = 0;
+};
+
+// Static objects are placed once and uploaded once; dynamic objects are expected
+// to change every frame and are written every frame.
+enum class ObjectMotion : int
+{
+	Static = 0,
+	Dynamic = 1
+};
+
+// Data-oriented storage for per-object transforms.  World matrices, texture
+// transforms and material indices live in dense parallel arrays so that
+// animation and upload walk contiguous memory; handles map to dense indices
+// through a slot table.  Static objects occupy the front of the arrays and
+// dynamic ones the back, so each group uploads as one contiguous range.
+// Removing an object moves another one into the hole.
+class TransformStore
+{
+public:
+	// DYNAMIC_OBJECT_BIT in ObjectData.hlsli.
+	static const UINT DynamicObjectBit = 0x80000000;
+
+	TransformStore() = default;
+	TransformStore(const TransformStore& rhs) = delete;
+	TransformStore& operator=(const TransformStore& rhs) = delete;
+	~TransformStore() = default;
+
+	void Reserve(UINT capacity);
+
+	TransformHandle Add(const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4X4& texTransform, UINT materialIndex,
+		ObjectMotion motion = ObjectMotion::Static);
+	TransformHandle Add(DirectX::FXMMATRIX world, DirectX::CXMMATRIX texTransform, UINT materialIndex,
+		ObjectMotion motion = ObjectMotion::Static);
+	void Remove(TransformHandle h);
+	bool IsValid(TransformHandle h)const;
+
+	UINT Count()const;
+	UINT StaticCount()const;
+	UINT DynamicCount()const;
+	bool IsStatic(TransformHandle h)const;
+
+	///<summary>
+	/// Index the shaders use to find the object: its element in the static object buffer,
+	/// or its element in the per-frame dynamic object buffer with DynamicObjectBit set.
+	///</summary>
+	UINT ObjectIndex(TransformHandle h)const;
+
+	const DirectX::XMFLOAT4X4A& GetWorld(TransformHandle h)const;
+	const DirectX::XMFLOAT4X4A& GetTexTransform(TransformHandle h)const;
+	UINT GetMaterialIndex(TransformHandle h)const;
+
+	void SetWorld(TransformHandle h, const DirectX::XMFLOAT4X4& world);
+	void SetTexTransform(TransformHandle h, const DirectX::XMFLOAT4X4& texTransform);
+	void SetMaterialIndex(TransformHandle h, UINT materialIndex);
+
+	///<summary>
+	/// Dense arrays for bulk animation, static objects first.  Call MarkDirty for any
+	/// static object written through them.
+	///</summary>
+	DirectX::XMFLOAT4X4A* Worlds();
+	DirectX::XMFLOAT4X4A* TexTransforms();
+
+	void MarkDirty(TransformHandle h);
+
+	///<summary>
+	/// True when a static object was added, removed or changed since the last WriteStatic.
+	///</summary>
+	bool StaticDirty()const;
+
+	///<summary>
+	/// Writes every static object and clears StaticDirty.  dst receives StaticCount() elements.
+	///</summary>
+	void WriteStatic(ObjectData* dst);
+
+	///<summary>
+	/// Writes every dynamic object.  dst receives DynamicCount() elements.
+	///</summary>
+	void WriteDynamic(ObjectData* dst)const;
+
+	///<summary>
+	/// Batched kernel: transposes dense elements [first, first + count) and writes them
+	/// as packed ObjectData (3x4 world, 3x4 tex transform, material index) to dst.
+	///</summary>
+	void WriteObjectData(UINT first, UINT count, ObjectData* dst)const;
+
+private:
+	UINT Dense(TransformHandle h)const;
+	void SwapDense(UINT a, UINT b);
+
+private:
+	// Dense, indexed by dense index.  [0, staticCount) are static.
+	std::vector<DirectX::XMFLOAT4X4A> worlds;
+	std::vector<DirectX::XMFLOAT4X4A> texTransforms;
+	std::vector<UINT> materialIndices;
+	std::vector<UINT> denseToSlot;
+	UINT staticCount = 0;
+
+	// Sparse, indexed by slot.
+	std::vector<UINT> slotToDense;
+	std::vector<UINT> slotGenerations;
+	std::vector<UINT> freeSlots;
+
+	bool staticDirty = false;
+};
@@ -80,6 +80,7 @@ void TreeBillboardsApp::Update(const GameTimer& gt)
     UpdateMaterialCBs(gt);
     UpdateMainPassCB(gt);
     UpdateWaves(gt);
+    UpdateTreeInstances(gt);
 }
 
 void TreeBillboardsApp::Draw(const GameTimer& gt)
@@ -116,7 +117,7 @@ void TreeBillboardsApp::Draw(const GameTimer& gt)
     DrawRenderItems(pCommandList.Get(), rItemLayer[(int)RenderLayer::Opaque]);
 
     pCommandList->SetPipelineState(PSOs["treeSprites"].Get());
-    DrawRenderItems(pCommandList.Get(), rItemLayer[(int)RenderLayer::TreeSprites]);
+    DrawTreeSprites(pCommandList.Get(), rItemLayer[(int)RenderLayer::TreeSprites]);
 
     pCommandList->SetPipelineState(PSOs["alphaZero"].Get());
     DrawRenderItems(pCommandList.Get(), rItemLayer[(int)RenderLayer::AlphaZero]);
@@ -360,6 +361,23 @@ void TreeBillboardsApp::UpdateWaves(const GameTimer& gt)
     wavesRItem->Geo->VertexBufferGPU = currWavesVB->Resource();
 }
 
+void TreeBillboardsApp::UpdateTreeInstances(const GameTimer& gt)
+{
+    using namespace DirectX;
+
+    XMMATRIX V = XMLoadFloat4x4(&view);
+    XMMATRIX P = XMLoadFloat4x4(&proj);
+    XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(V), V);
+
+    BoundingFrustum frustumW;
+    BoundingFrustum::CreateFromMatrix(frustumW, P);
+    frustumW.Transform(frustumW, invView);
+
+    // Only the cells that survive culling and LOD reach this frame's instance buffer.
+    visibleTreeCount = foliage->Cull(frustumW, eyePos,
+        treeInstanceBuffers[currFrameResourceIndex].get(), MaxVisibleTrees);
+}
+
 void TreeBillboardsApp::LoadTextures()
 {
     auto grassTex = std::make_unique<Texture>();
@@ -685,65 +703,25 @@ void TreeBillboardsApp::BuildBoxGeometry()
 
 void TreeBillboardsApp::BuildTreeSpritesGeometry()
 {
-    using namespace DirectX;
-    struct TreeSpriteVertex
-    {
-        XMFLOAT3 Pos;
-        XMFLOAT2 Size;
-    };
-
-    static const int treeCount = 16;
-    std::array<TreeSpriteVertex, 16> vertices;
-    for (UINT i = 0; i < treeCount; ++i)
+    // The same square the hardcoded sprites were placed in, without the trees
+    // that would stand in the water at y = 0.
+    FoliageDesc foliageDesc;
+    foliageDesc.Width = 90.0f;
+    foliageDesc.Depth = 90.0f;
+    foliageDesc.MinHeight = 0.0f;
+    foliageDesc.MinSpacing = 6.0f;
+    foliageDesc.CellSize = 16.0f;
+
+    foliage = std::make_unique<FoliageSystem>(foliageDesc);
+    foliage->Scatter([this](float x, float z) { return GetHillsHeight(x, z); }, 1337u);
+
+    // The visible set changes every frame, so the sprites are streamed from upload
+    // memory instead of living in a static default buffer.
+    UINT maxTrees = MathHelper::Min(MaxVisibleTrees, MathHelper::Max(1u, foliage->Stats().TotalInstances));
+    for (int i = 0; i < gNumFrameResources; ++i)
     {
-        float x = MathHelper::RandF(-45.0f, 45.0f);
-        float z = MathHelper::RandF(-45.0f, 45.0f);
-        float y = GetHillsHeight(x, z);
-
-        // Move tree slightly above land height.
-        y += 8.0f;
-
-        vertices[i].Pos = XMFLOAT3(x, y, z);
-        vertices[i].Size = XMFLOAT2(20.0f, 20.0f);
+        treeInstanceBuffers.push_back(std::make_unique<UploadBuffer<FoliageInstance>>(pDevice.Get(), maxTrees, false));
     }
-
-    std::array<std::uint16_t, 16> indices =
-    {
-        0, 1, 2, 3, 4, 5, 6, 7,
-        8, 9, 10, 11, 12, 13, 14, 15
-    };
-
-    const UINT vbByteSize = (UINT)vertices.size() * sizeof(TreeSpriteVertex);
-    const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
-
-    auto geo = std::make_unique<MeshGeometry>();
-    geo->Name = "treeSpritesGeo";
-
-    ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-    CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-    ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-    CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
-
-    geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(pDevice.Get(),
-        pCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-    geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(pDevice.Get(),
-        pCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
-    geo->VertexByteStride = sizeof(TreeSpriteVertex);
-    geo->VertexBufferByteSize = vbByteSize;
-    geo->IndexFormat = DXGI_FORMAT_R16_UINT;
-    geo->IndexBufferByteSize = ibByteSize;
-
-    SubmeshGeometry submesh;
-    submesh.IndexCount = (UINT)indices.size();
-    submesh.StartIndexLocation = 0;
-    submesh.BaseVertexLocation = 0;
-
-    geo->DrawArgs["points"] = submesh;
-
-    geometries["treeSpritesGeo"] = std::move(geo);
 }
 
 void TreeBillboardsApp::BuildPSOs()
@@ -909,11 +887,9 @@ void TreeBillboardsApp::BuildRenderItems()
     treeSpritesRitem->World = MathHelper::Identity4x4();
     treeSpritesRitem->ObjCBIndex = 3;
     treeSpritesRitem->Mat = materials["treeSprites"].get();
-    treeSpritesRitem->Geo = geometries["treeSpritesGeo"].get();
+    // Geometry comes from the per-frame foliage instance buffer, see DrawTreeSprites.
+    treeSpritesRitem->Geo = nullptr;
     treeSpritesRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_POINTLIST;
-    treeSpritesRitem->IndexCount = treeSpritesRitem->Geo->DrawArgs["points"].IndexCount;
-    treeSpritesRitem->StartIndexLocation = treeSpritesRitem->Geo->DrawArgs["points"].StartIndexLocation;
-    treeSpritesRitem->BaseVertexLocation = treeSpritesRitem->Geo->DrawArgs["points"].BaseVertexLocation;
 
     rItemLayer[(int)RenderLayer::TreeSprites].push_back(treeSpritesRitem.get());
 
@@ -1029,3 +1005,39 @@ void TreeBillboardsApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, cons
     }
 }
 
+void TreeBillboardsApp::DrawTreeSprites(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& rItems)
+{
+    UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+    UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+
+    auto objectCB = currFrameResource->ObjectCB->Resource();
+    auto matCB = currFrameResource->MaterialCB->Resource();
+
+    auto instanceBuffer = treeInstanceBuffers[currFrameResourceIndex]->Resource();
+
+    D3D12_VERTEX_BUFFER_VIEW vbv;
+    vbv.BufferLocation = instanceBuffer->GetGPUVirtualAddress();
+    vbv.StrideInBytes = sizeof(FoliageInstance);
+    vbv.SizeInBytes = visibleTreeCount * sizeof(FoliageInstance);
+
+    for (size_t i = 0; i < rItems.size() && visibleTreeCount > 0; ++i)
+    {
+        auto ri = rItems[i];
+
+        cmdList->IASetVertexBuffers(0, 1, &vbv);
+        cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+
+        CD3DX12_GPU_DESCRIPTOR_HANDLE tex(pSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+        tex.Offset(ri->Mat->DiffuseSrvHeapIndex, cbvSrvDescriptorSize);
+
+        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex * objCBByteSize;
+        D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex * matCBByteSize;
+
+        cmdList->SetGraphicsRootDescriptorTable(0, tex);
+        cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
+        cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
+
+        // One point per visible billboard; the geometry shader expands it into a quad.
+        cmdList->DrawInstanced(visibleTreeCount, 1, 0, 0);
+    }
+}
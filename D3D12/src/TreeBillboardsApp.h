@@ -3,6 +3,7 @@
 #include "UploadBuffer.h"
 #include "FrameResource.h"
 #include "Common/Waves.h"
+#include "FoliageSystem.h"
 
 using namespace DirectX::PackedVector;
 
@@ -62,6 +63,7 @@ private:
 	void UpdateMaterialCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
 	void UpdateWaves(const GameTimer& gt);
+	void UpdateTreeInstances(const GameTimer& gt);
 
 	void LoadTextures();
 	void BuildRootSignature();
@@ -76,6 +78,7 @@ private:
 	void BuildMaterials();
 	void BuildRenderItems();
 	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+	void DrawTreeSprites(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
 
@@ -111,6 +114,14 @@ private:
 
 	std::unique_ptr<Waves> waves;
 
+	// Upper bound on the billboards written into a frame's instance buffer.
+	static constexpr UINT MaxVisibleTrees = 1 << 20;
+
+	std::unique_ptr<FoliageSystem> foliage;
+	// one instance buffer per frame resource, bound as the tree sprite vertex buffer
+	std::vector<std::unique_ptr<UploadBuffer<FoliageInstance>>> treeInstanceBuffers;
+	UINT visibleTreeCount = 0;
+
 	PassConstants mainPassCB;
 
 	DirectX::XMFLOAT3 eyePos = { 0.0f, 0.0f, 0.0f };
@@ -0,0 +1,32 @@
+#include "UploadBatch.h"
+
+void UploadBatch::Submit(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, ResourceReleaseQueue& releaseQueue)
+{
+	if (Empty())
+		return;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> staging = CreateStaging(device);
+	Record(cmdList, staging.Get(), 0);
+	releaseQueue.Release(staging);
+
+	Clear();
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> UploadBatch::CreateStaging(ID3D12Device* device)const
+{
+	Microsoft::WRL::ComPtr<ID3D12Resource> staging;
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(StagingSize()),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&staging)));
+
+	BYTE* mapped = nullptr;
+	ThrowIfFailed(staging->Map(0, nullptr, reinterpret_cast<void**>(&mapped)));
+	Pack(mapped);
+	staging->Unmap(0, nullptr);
+
+	return staging;
+}
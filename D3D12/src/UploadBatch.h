@@ -0,0 +1,27 @@
+#pragma once
+#include "Common/d3dUtil.h"
+#include "DeferredReleaseQueue.h"
+#include "UploadLayout.h"
+
+// An UploadLayout with the staging buffer that carries it: CreateStaging packs the
+// batch into a new upload buffer, and Submit records it on the graphics command list.
+class UploadBatch : public UploadLayout
+{
+public:
+	UploadBatch() = default;
+	UploadBatch(const UploadBatch& rhs) = delete;
+	UploadBatch& operator=(const UploadBatch& rhs) = delete;
+	~UploadBatch() = default;
+
+	///<summary>
+	/// Creates an upload buffer of StagingSize() bytes and packs the batch into it.
+	/// Only touches the device, so it can run off the render thread.
+	///</summary>
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateStaging(ID3D12Device* device)const;
+
+	///<summary>
+	/// Uploads the batch on the graphics command list through one staging buffer,
+	/// which goes to releaseQueue, and empties the batch.
+	///</summary>
+	void Submit(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, ResourceReleaseQueue& releaseQueue);
+};
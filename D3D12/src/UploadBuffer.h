@@ -1,12 +1,14 @@
 #pragma once
 #include "Common/d3dUtil.h"
+#include "StreamingCopy.h"
+#include <span>
 
 template <typename T>
 class UploadBuffer
 {
 public:
 	UploadBuffer(ID3D12Device* device, UINT elementCount, bool isConstantBuffer)
-		:isConstantBuffer(isConstantBuffer)
+		:elementCount(elementCount), isConstantBuffer(isConstantBuffer)
 	{
 		elementByteSize = sizeof(T);
 		if (isConstantBuffer)
@@ -41,14 +43,45 @@ public:
 	{
 		return pUploadBuffer.Get();
 	}
+	BYTE* MappedData() const
+	{
+		return mappedData;
+	}
+	UINT ElementByteSize() const
+	{
+		return elementByteSize;
+	}
+	UINT ElementCount() const
+	{
+		return elementCount;
+	}
 	void CopyData(int elementIndex, const T& data)
 	{
 		memcpy(&mappedData[elementIndex * elementByteSize], &data, sizeof(T));
 	}
+	///<summary>
+	/// Copies data into elements [first, first + data.size()).  Tightly packed buffers
+	/// take one streaming copy; constant buffers a strided one that skips the padding.
+	///</summary>
+	void CopyRange(UINT first, std::span<const T> data)
+	{
+		assert(first + data.size() <= elementCount);
+
+		BYTE* dst = &mappedData[(size_t)first * elementByteSize];
+		if (elementByteSize == sizeof(T))
+		{
+			StreamingCopy(dst, data.data(), data.size_bytes());
+		}
+		else
+		{
+			StreamingCopyStrided(dst, elementByteSize, data.data(), sizeof(T), data.size());
+		}
+	}
 
 private:
 	Microsoft::WRL::ComPtr<ID3D12Resource> pUploadBuffer;
 	BYTE* mappedData = nullptr;
 	UINT elementByteSize = 0;
-	bool isConstantBuffer = flase;
+	UINT elementCount = 0;
+	bool isConstantBuffer = false;
 };
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "UploadLayout.h"
+#include "LinearRingAllocator.h"
+#include "StreamingCopy.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	// Texels per block edge: 4 for block-compressed formats, 1 otherwise.
+	UINT BlockSize(DXGI_FORMAT format)
+	{
+		if ((format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM) ||
+			(format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB))
+		{
+			return 4;
+		}
+		return 1;
+	}
+}
+
+void UploadLayout::AddTextureSubresource(ID3D12Resource* dest, const D3D12_RESOURCE_DESC& desc, UINT subresource,
+	const D3D12_SUBRESOURCE_DATA& data, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+{
+	const UINT block = BlockSize(desc.Format);
+	const bool volume = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D;
+
+	UINT mip = subresource % desc.MipLevels;
+	UINT width = (UINT)std::max<UINT64>(1, desc.Width >> mip);
+	UINT height = std::max<UINT>(1, desc.Height >> mip);
+	UINT depth = volume ? std::max<UINT>(1, desc.DepthOrArraySize >> mip) : 1;
+
+	TextureCopy c;
+	c.Dest = dest;
+	c.Subresource = subresource;
+	c.Data = data;
+
+	// The source rows are tightly packed; the staging rows are padded to the pitch
+	// alignment and every subresource starts at the placement alignment.
+	c.NumRows = (height + block - 1) / block;
+	c.RowSizeInBytes = (UINT64)data.RowPitch;
+
+	c.Footprint.Offset = LinearRingAllocator::AlignUp(stagingSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+	c.Footprint.Footprint.Format = desc.Format;
+	c.Footprint.Footprint.Width = (UINT)LinearRingAllocator::AlignUp(width, block);
+	c.Footprint.Footprint.Height = (UINT)LinearRingAllocator::AlignUp(height, block);
+	c.Footprint.Footprint.Depth = depth;
+	c.Footprint.Footprint.RowPitch = (UINT)LinearRingAllocator::AlignUp(c.RowSizeInBytes,
+		D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+
+	textures.push_back(c);
+	stagingSize = c.Footprint.Offset + (UINT64)c.Footprint.Footprint.RowPitch * c.NumRows * depth;
+
+	AddTarget(dest, before, after);
+}
+
+UINT64 UploadLayout::StagingSize()const
+{
+	return stagingSize;
+}
+
+bool UploadLayout::Empty()const
+{
+	return textures.empty();
+}
+
+void UploadLayout::Pack(BYTE* staging)const
+{
+	for (const TextureCopy& c : textures)
+	{
+		const D3D12_SUBRESOURCE_FOOTPRINT& fp = c.Footprint.Footprint;
+		BYTE* dst = staging + c.Footprint.Offset;
+		auto src = static_cast<const BYTE*>(c.Data.pData);
+
+		for (UINT z = 0; z < fp.Depth; ++z)
+		{
+			for (UINT row = 0; row < c.NumRows; ++row)
+			{
+				StreamingCopy(dst + ((UINT64)z * c.NumRows + row) * fp.RowPitch,
+					src + (UINT64)z * c.Data.SlicePitch + (UINT64)row * c.Data.RowPitch,
+					(size_t)c.RowSizeInBytes);
+			}
+		}
+	}
+}
+
+void UploadLayout::Clear()
+{
+	textures.clear();
+	targets.clear();
+	stagingSize = 0;
+}
+
+const std::vector<UploadLayout::TextureCopy>& UploadLayout::Textures()const
+{
+	return textures;
+}
+
+const std::vector<UploadLayout::Target>& UploadLayout::Targets()const
+{
+	return targets;
+}
+
+void UploadLayout::AddTarget(ID3D12Resource* resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+{
+	for (const Target& t : targets)
+	{
+		if (t.Resource == resource)
+		{
+			// One transition each way per resource, so all its copies must agree.
+			assert(t.Before == before && t.After == after);
+			return;
+		}
+	}
+
+	Target t;
+	t.Resource = resource;
+	t.Before = before;
+	t.After = after;
+	targets.push_back(t);
+}
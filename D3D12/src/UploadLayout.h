@@ -0,0 +1,126 @@
+#pragma once
+#include "Common/D3D12Types.h"
+#include <vector>
+
+// Lays out the initial data of many texture subresources in one staging buffer,
+// with the placed footprints D3D12 requires, and remembers the state each
+// destination has to leave COPY_DEST in.  Record then issues one barrier call
+// before the copies and one after, however many copies target a resource.  The
+// source data is only read by Pack, so it has to stay alive until then.
+//
+// Nothing here touches the device: Record takes any command list type with
+// ResourceBarrier and CopyTextureRegion, so a recording stand-in can check the
+// copies and barriers without a GPU.  UploadBatch adds the staging buffer.
+class UploadLayout
+{
+public:
+	struct TextureCopy
+	{
+		ID3D12Resource* Dest = nullptr;
+		UINT Subresource = 0;
+		// Offset is relative to the start of the batch.
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT Footprint = {};
+		UINT NumRows = 0;
+		UINT64 RowSizeInBytes = 0;
+		D3D12_SUBRESOURCE_DATA Data = {};
+	};
+
+	struct Target
+	{
+		ID3D12Resource* Resource = nullptr;
+		D3D12_RESOURCE_STATES Before = D3D12_RESOURCE_STATE_COMMON;
+		D3D12_RESOURCE_STATES After = D3D12_RESOURCE_STATE_COMMON;
+	};
+
+	UploadLayout() = default;
+	UploadLayout(const UploadLayout& rhs) = delete;
+	UploadLayout& operator=(const UploadLayout& rhs) = delete;
+	~UploadLayout() = default;
+
+	///<summary>
+	/// Copies one subresource of a texture described by desc.  data holds tightly
+	/// packed rows of blocks.  dest is in state before until the batch is recorded and
+	/// in state after from then on.
+	///</summary>
+	void AddTextureSubresource(ID3D12Resource* dest, const D3D12_RESOURCE_DESC& desc, UINT subresource,
+		const D3D12_SUBRESOURCE_DATA& data, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
+
+	///<summary>
+	/// Bytes of staging memory the batch needs.
+	///</summary>
+	UINT64 StagingSize()const;
+
+	bool Empty()const;
+
+	///<summary>
+	/// Writes the data of every copy to mapped staging memory of StagingSize() bytes.
+	///</summary>
+	void Pack(BYTE* staging)const;
+
+	///<summary>
+	/// Records the batch, reading from staging at stagingOffset (a multiple of
+	/// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT).  Without barriers, the destinations
+	/// rely on implicit promotion out of and decay back to COMMON, which is what a
+	/// copy queue requires.
+	///</summary>
+	template<typename CommandList>
+	void Record(CommandList* cmdList, ID3D12Resource* staging, UINT64 stagingOffset, bool barriers = true)const
+	{
+		std::vector<D3D12_RESOURCE_BARRIER> transitions;
+		if (barriers)
+		{
+			for (const Target& t : targets)
+			{
+				if (t.Before != D3D12_RESOURCE_STATE_COPY_DEST)
+				{
+					transitions.push_back(CD3DX12_RESOURCE_BARRIER::Transition(t.Resource,
+						t.Before, D3D12_RESOURCE_STATE_COPY_DEST));
+				}
+			}
+			if (!transitions.empty())
+			{
+				cmdList->ResourceBarrier((UINT)transitions.size(), transitions.data());
+			}
+		}
+
+		for (const TextureCopy& c : textures)
+		{
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = c.Footprint;
+			footprint.Offset += stagingOffset;
+
+			CD3DX12_TEXTURE_COPY_LOCATION dst(c.Dest, c.Subresource);
+			CD3DX12_TEXTURE_COPY_LOCATION src(staging, footprint);
+			cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+		}
+
+		if (barriers)
+		{
+			transitions.clear();
+			for (const Target& t : targets)
+			{
+				if (t.After != D3D12_RESOURCE_STATE_COPY_DEST)
+				{
+					transitions.push_back(CD3DX12_RESOURCE_BARRIER::Transition(t.Resource,
+						D3D12_RESOURCE_STATE_COPY_DEST, t.After));
+				}
+			}
+			if (!transitions.empty())
+			{
+				cmdList->ResourceBarrier((UINT)transitions.size(), transitions.data());
+			}
+		}
+	}
+
+	void Clear();
+
+	const std::vector<TextureCopy>& Textures()const;
+	const std::vector<Target>& Targets()const;
+
+private:
+	void AddTarget(ID3D12Resource* resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
+
+private:
+	std::vector<TextureCopy> textures;
+	std::vector<Target> targets;
+	UINT64 stagingSize = 0;
+};
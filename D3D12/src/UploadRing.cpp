@@ -0,0 +1,77 @@
+#include "UploadRing.h"
+
+UploadRing::UploadRing(ID3D12Device* device, UINT64 capacity, ResourceReleaseQueue& releaseQueue)
+	:device(device), releaseQueue(releaseQueue)
+{
+	CreateBuffer(capacity);
+}
+
+UploadRing::~UploadRing()
+{
+	if (pBuffer != nullptr)
+	{
+		pBuffer->Unmap(0, nullptr);
+	}
+	mappedData = nullptr;
+}
+
+UploadAllocation UploadRing::Allocate(UINT64 size, UINT64 alignment)
+{
+	UINT64 offset = ring.Allocate(size, alignment);
+	if (offset == LinearRingAllocator::InvalidOffset)
+	{
+		// Frames still in flight keep reading the old buffer, and earlier allocations
+		// of this frame may still be written, so it is retired mapped rather than
+		// released.  It is destroyed after the fence of the current frame.
+		releaseQueue.Release(pBuffer);
+
+		CreateBuffer(MathHelper::Max(2 * ring.Capacity(), LinearRingAllocator::AlignUp(size, alignment)));
+
+		offset = ring.Allocate(size, alignment);
+		assert(offset != LinearRingAllocator::InvalidOffset);
+	}
+
+	UploadAllocation alloc;
+	alloc.Resource = pBuffer.Get();
+	alloc.Offset = offset;
+	alloc.CPU = mappedData + offset;
+	alloc.GPU = pBuffer->GetGPUVirtualAddress() + offset;
+	return alloc;
+}
+
+void UploadRing::EndFrame(UINT64 fenceValue)
+{
+	ring.EndFrame(fenceValue);
+}
+
+void UploadRing::Reclaim(UINT64 completedFenceValue)
+{
+	ring.Reclaim(completedFenceValue);
+}
+
+UINT64 UploadRing::Capacity()const
+{
+	return ring.Capacity();
+}
+
+UINT64 UploadRing::UsedBytes()const
+{
+	return ring.UsedBytes();
+}
+
+void UploadRing::CreateBuffer(UINT64 capacity)
+{
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(capacity),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(pBuffer.ReleaseAndGetAddressOf())));
+
+	// Stays mapped for the lifetime of the buffer; the fences keep the CPU off
+	// memory the GPU may still read.
+	ThrowIfFailed(pBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mappedData)));
+
+	ring = LinearRingAllocator(capacity);
+}
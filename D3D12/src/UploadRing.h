@@ -0,0 +1,65 @@
+#pragma once
+#include "Common/d3dUtil.h"
+#include "LinearRingAllocator.h"
+#include "DeferredReleaseQueue.h"
+
+// A piece of the upload ring, valid until the frame it was allocated in has
+// been reclaimed.
+struct UploadAllocation
+{
+	ID3D12Resource* Resource = nullptr;
+	UINT64 Offset = 0;
+	BYTE* CPU = nullptr;
+	D3D12_GPU_VIRTUAL_ADDRESS GPU = 0;
+};
+
+// One persistently mapped upload buffer that every frame in flight sub-allocates
+// its transient data from (pass constants, instance data, indirect arguments,
+// dynamic vertices).  Memory is handed back per frame by fence value.  When a
+// frame needs more than is free, the ring is replaced by a larger one and the old
+// buffer goes to the release queue, which frees it once the GPU is done with it.
+class UploadRing
+{
+public:
+	UploadRing(ID3D12Device* device, UINT64 capacity, ResourceReleaseQueue& releaseQueue);
+	UploadRing(const UploadRing& rhs) = delete;
+	UploadRing& operator=(const UploadRing& rhs) = delete;
+	~UploadRing();
+
+	///<summary>
+	/// Allocates size bytes.  The default alignment satisfies constant buffer views.
+	///</summary>
+	UploadAllocation Allocate(UINT64 size, UINT64 alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+	template<typename T>
+	UploadAllocation AllocateConstants(const T& data)
+	{
+		UploadAllocation alloc = Allocate(sizeof(T));
+		memcpy(alloc.CPU, &data, sizeof(T));
+		return alloc;
+	}
+
+	///<summary>
+	/// Call once per frame after signaling fenceValue for it, along with
+	/// ResourceReleaseQueue::EndFrame.
+	///</summary>
+	void EndFrame(UINT64 fenceValue);
+
+	///<summary>
+	/// Frees the frames whose fence value the GPU has reached.
+	///</summary>
+	void Reclaim(UINT64 completedFenceValue);
+
+	UINT64 Capacity()const;
+	UINT64 UsedBytes()const;
+
+private:
+	void CreateBuffer(UINT64 capacity);
+
+private:
+	ID3D12Device* device = nullptr;
+	ResourceReleaseQueue& releaseQueue;
+	Microsoft::WRL::ComPtr<ID3D12Resource> pBuffer;
+	BYTE* mappedData = nullptr;
+	LinearRingAllocator ring;
+};